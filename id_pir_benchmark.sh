@@ -0,0 +1,12 @@
+#!/bin/bash
+# query latency and server cpu time of id pir versus database size,
+# server and client run in one process, so network is not counted.
+# usage: bash id_pir_benchmark.sh [row bytes] [row count ...]
+
+ROW_BYTES=${1:-64}
+shift
+ROW_COUNTS=${@:-"1000 10000 100000 1000000"}
+BENCH_BIN=./bazel-bin/test/primihub/kernel/id_pir_benchmark
+
+bazel build --config=linux_x86_64 //test/primihub/kernel:id_pir_benchmark || exit 1
+${BENCH_BIN} ${ROW_BYTES} ${ROW_COUNTS}
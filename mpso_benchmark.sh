@@ -0,0 +1,71 @@
+#!/bin/bash
+# multi-party psi/psu of third_party/MPSU against chained two-party kkrt,
+# k parties chaining kkrt run k-1 two-party psi one after another,
+# each with the full set size as the worst case of intermediate result.
+# volePSI is expected at third_party/MPSU/libvolepsi, see its README.md
+
+bash pre_build.sh
+bazel build --config=linux_x86_64 :libpsi_test
+
+pushd third_party/MPSU
+mkdir -p build && cd build
+cmake .. && make -j
+MPSU_BIN=$(pwd)/main
+popd
+KKRT_BIN=$(pwd)/bazel-bin/libpsi_test
+WORK_DIR=$(mktemp -d)
+mkdir -p ${WORK_DIR}/sc ${WORK_DIR}/triple
+
+## replace lo with your card
+sudo tc qdisc del dev lo root
+## about 100mbps
+sudo tc qdisc add dev lo root handle 1: tbf rate 100mbit burst 100000 limit 10000
+## about 0.3ms ping latency
+sudo tc qdisc add dev lo parent 1:1 handle 10: netem delay 0.15msec
+
+THREADS=4
+
+now_ms() {
+  echo $(($(date +%s%N) / 1000000))
+}
+
+# run_parties <k> <args>: run all parties of mpsu main and wait
+run_parties() {
+  local k=$1
+  shift
+  for ((r = 0; r < k; r++)); do
+    ${MPSU_BIN} "$@" -k ${k} -r ${r} -dir ${WORK_DIR} &
+  done
+  wait
+}
+
+for proto in psi psu; do
+  for k in 3 4 5; do
+    for nn in 14 16 18; do
+      echo -e "\e[32m m${proto}: parties: ${k}, set size: 2^${nn}, threads: ${THREADS} \e[0m"
+      start=$(now_ms)
+      ${MPSU_BIN} -${proto} -k ${k} -nn ${nn} -genSC -dir ${WORK_DIR}
+      if [ "${proto}" == "psu" ]; then
+        run_parties ${k} -${proto} -nn ${nn} -nt ${THREADS} -genTriple
+      fi
+      offline=$(( $(now_ms) - start ))
+      start=$(now_ms)
+      run_parties ${k} -${proto} -nn ${nn} -nt ${THREADS} -genBase
+      online=$(( $(now_ms) - start ))
+      echo "m${proto} offline(ms): ${offline} online(ms): ${online}"
+
+      if [ "${proto}" == "psi" ]; then
+        start=$(now_ms)
+        for ((i = 1; i < k; i++)); do
+          ${KKRT_BIN} -kkrt -ss $((1 << nn)) -rs $((1 << nn)) -t ${THREADS}
+        done
+        chained=$(( $(now_ms) - start ))
+        echo "chained kkrt of ${k} parties(ms): ${chained}"
+      fi
+      rm -rf ${WORK_DIR}/sc/* ${WORK_DIR}/triple/*
+    done
+  done
+done
+
+sudo tc qdisc del dev lo root
+rm -rf ${WORK_DIR}
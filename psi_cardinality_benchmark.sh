@@ -0,0 +1,69 @@
+#!/bin/bash
+# time and traffic of intersection size only psi versus full intersection,
+# nodes are expected to be started by start_server.sh
+# and datasets of CLIENT_DATASET and SERVER_DATASET to be registered.
+# traffic is counted on NET_DEV, all nodes are expected to run on it.
+# usage: bash psi_cardinality_benchmark.sh
+
+SERVER_INFO="127.0.0.1:50050"
+CLIENT_DATASET=${CLIENT_DATASET:-psi_client_data}
+SERVER_DATASET=${SERVER_DATASET:-psi_server_data}
+NET_DEV=${NET_DEV:-lo}
+CLI_BIN=./bazel-bin/cli
+WORK_DIR=$(mktemp -d)
+
+[ -x ${CLI_BIN} ] || bazel build --config=linux_x86_64 :cli
+
+now_ms() {
+  echo $(($(date +%s%N) / 1000000))
+}
+
+tx_bytes() {
+  cat /sys/class/net/${NET_DEV}/statistics/tx_bytes
+}
+
+# make_conf <template> <psi tag> <psi type> <output>
+make_conf() {
+  python3 - "$@" ${CLIENT_DATASET} ${SERVER_DATASET} <<'PYEOF'
+import json, sys
+template, psi_tag, psi_type, output, client_ds, server_ds = sys.argv[1:]
+with open(template) as f:
+    conf = json.load(f)
+conf["params"]["psiTag"]["value"] = int(psi_tag)
+conf["params"]["psiType"]["value"] = int(psi_type)
+# full intersection is synced to server as a usual job does
+conf["params"]["sync_result_to_server"]["value"] = 1
+conf["party_datasets"]["CLIENT"]["CLIENT"] = client_ds
+conf["party_datasets"]["SERVER"]["SERVER"] = server_ds
+with open(output, "w") as f:
+    json.dump(conf, f, indent=2)
+PYEOF
+}
+
+# psi tag: ECDH = 0, KKRT = 1; psi type: INTERSECTION = 0, CARDINALITY = 2
+for psi in "0 example/psi_ecdh_task_conf.json" \
+           "1 example/psi_kkrt_task_conf.json"; do
+  set -- ${psi}
+  psi_tag=$1
+  template=$2
+  base_cost=0
+  base_bytes=0
+  for psi_type in 0 2; do
+    conf=${WORK_DIR}/psi_${psi_tag}_${psi_type}.json
+    make_conf ${template} ${psi_tag} ${psi_type} ${conf}
+    start=$(now_ms)
+    start_bytes=$(tx_bytes)
+    ${CLI_BIN} --server="${SERVER_INFO}" --task_config_file=${conf} > /dev/null
+    cost=$(( $(now_ms) - start ))
+    bytes=$(( $(tx_bytes) - start_bytes ))
+    if [ ${base_cost} -eq 0 ]; then
+      base_cost=${cost}
+      base_bytes=${bytes}
+    fi
+    saved_time=$(awk "BEGIN {printf \"%.1f\", 100 * (1 - ${cost} / ${base_cost})}")
+    saved_bytes=$(awk "BEGIN {printf \"%.1f\", 100 * (1 - ${bytes} / ${base_bytes})}")
+    echo -e "\e[32m psiTag: ${psi_tag} psiType: ${psi_type} time(ms): ${cost} bytes: ${bytes} saved time: ${saved_time}% saved bytes: ${saved_bytes}% \e[0m"
+  done
+done
+
+rm -rf ${WORK_DIR}
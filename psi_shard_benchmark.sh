@@ -0,0 +1,65 @@
+#!/bin/bash
+# speedup of partitioned psi versus shard count,
+# nodes are expected to be started by start_server.sh
+# and datasets of CLIENT_DATASET and SERVER_DATASET to be registered.
+# usage: bash psi_shard_benchmark.sh [shard num list]
+
+SERVER_INFO="127.0.0.1:50050"
+CLIENT_DATASET=${CLIENT_DATASET:-psi_client_data}
+SERVER_DATASET=${SERVER_DATASET:-psi_server_data}
+SHARD_LIST=${@:-1 2 4 8 16}
+CLI_BIN=./bazel-bin/cli
+WORK_DIR=$(mktemp -d)
+
+[ -x ${CLI_BIN} ] || bazel build --config=linux_x86_64 :cli
+
+## replace lo with your card
+sudo tc qdisc del dev lo root
+## about 1000mbps
+sudo tc qdisc add dev lo root handle 1: tbf rate 1000mbit burst 100000 limit 10000
+## about 0.3ms ping latency
+sudo tc qdisc add dev lo parent 1:1 handle 10: netem delay 0.15msec
+
+now_ms() {
+  echo $(($(date +%s%N) / 1000000))
+}
+
+# make_conf <template> <psi tag> <shard num> <output>
+make_conf() {
+  python3 - "$@" ${CLIENT_DATASET} ${SERVER_DATASET} <<'PYEOF'
+import json, sys
+template, psi_tag, shard_num, output, client_ds, server_ds = sys.argv[1:]
+with open(template) as f:
+    conf = json.load(f)
+conf["params"]["psiTag"]["value"] = int(psi_tag)
+conf["params"]["psi_shard_num"]["value"] = int(shard_num)
+conf["params"]["sync_result_to_server"]["value"] = 0
+conf["party_datasets"]["CLIENT"]["CLIENT"] = client_ds
+conf["party_datasets"]["SERVER"]["SERVER"] = server_ds
+with open(output, "w") as f:
+    json.dump(conf, f, indent=2)
+PYEOF
+}
+
+# psi tag: ECDH = 0, KKRT = 1, CM20 = 3, MKKRT = 4
+for psi in "0 example/psi_ecdh_task_conf.json" \
+           "1 example/psi_kkrt_task_conf.json" \
+           "3 example/psi_kkrt_task_conf.json"; do
+  set -- ${psi}
+  psi_tag=$1
+  template=$2
+  base_cost=0
+  for shard_num in ${SHARD_LIST}; do
+    conf=${WORK_DIR}/psi_${psi_tag}_${shard_num}.json
+    make_conf ${template} ${psi_tag} ${shard_num} ${conf}
+    start=$(now_ms)
+    ${CLI_BIN} --server="${SERVER_INFO}" --task_config_file=${conf} > /dev/null
+    cost=$(( $(now_ms) - start ))
+    [ ${base_cost} -eq 0 ] && base_cost=${cost}
+    speedup=$(awk "BEGIN {printf \"%.2f\", ${base_cost} / ${cost}}")
+    echo -e "\e[32m psiTag: ${psi_tag} shards: ${shard_num} time(ms): ${cost} speedup: ${speedup} \e[0m"
+  done
+done
+
+sudo tc qdisc del dev lo root
+rm -rf ${WORK_DIR}
@@ -22,6 +22,8 @@ from primihub.utils.logger_util import logger
 class PsiType(Enum):
     KKRT = "KKRT"
     ECDH = "ECDH"
+    CM20 = "CM20"
+    MKKRT = "MKKRT"
 
 class DataType(Enum):
     Interger = 0
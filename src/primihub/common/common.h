@@ -28,6 +28,7 @@ namespace primihub {
 [[maybe_unused]] static const char* PARTY_CLIENT = "CLIENT";
 [[maybe_unused]] static const char* PARTY_SERVER = "SERVER";
 [[maybe_unused]] static const char* PARTY_TEE_COMPUTE = "TEE_COMPUTE";
+[[maybe_unused]] static const char* PARTY_DEALER = "DEALER";
 [[maybe_unused]] static const char* DEFAULT = "DEFAULT";
 [[maybe_unused]] static const char* DATA_RECORD_SEP = "####";
 
@@ -94,6 +95,12 @@ public:
   static bool IsTeeCompute(const std::string& party_name) {
     return party_name == PARTY_TEE_COMPUTE;
   }
+  /**
+   * trusted dealer of correlated randomness, it owns no data
+  */
+  static bool IsDealer(const std::string& party_name) {
+    return party_name == PARTY_DEALER;
+  }
   static bool IsAuxiliaryCompute(const std::string& party_name) {
     return party_name == AUX_COMPUTE_NODE;
   }
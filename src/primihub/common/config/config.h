@@ -126,6 +126,95 @@ struct Tee {
   std::string cert_path;
 };
 
+struct CompressConfig {
+  std::string algorithm{"none"};   // none, zstd, lz4
+  int level{1};                    // only used by zstd
+  // message smaller than min_size is sent without compression
+  uint64_t min_size{4096};
+  // key of incompressible payload, e.g. ciphertext, never compressed
+  std::vector<std::string> exclude_keys;
+};
+
+struct FlowControlConfig {
+  // bytes of received data buffered for one task and one key,
+  // sender is held back when exceeded, 0 means unlimited
+  uint64_t task_memory_budget{0};
+  uint64_t key_memory_budget{0};
+  // max time a sender is held back, data is rejected or spilled after it
+  int32_t wait_timeout_ms{60000};
+  // spill payload to local disk instead of holding it in memory.
+  // if disabled, one payload may go over budget, further data of an
+  // exceeded budget is rejected and the sending peer fails
+  bool spill_enable{false};
+  std::string spill_dir{"/tmp/primihub_spill"};
+  // payload not smaller than spill_threshold is always spilled
+  uint64_t spill_threshold{256 * 1024 * 1024};
+};
+
+struct CoalesceConfig {
+  // batch small messages sent to the same peer into one wire message,
+  // must be enabled on all parties of the task
+  bool enable{false};
+  // pending messages are sent at most flush_window_us after the first one
+  uint32_t flush_window_us{200};
+  // pending messages are sent once their total size reaches max_batch_size
+  uint64_t max_batch_size{64 * 1024};
+  // message not smaller than max_message_size is sent directly
+  uint64_t max_message_size{16 * 1024};
+};
+
+struct ShmLinkConfig {
+  // task process receives data from node daemon by shared memory
+  // instead of loopback grpc, only used when task runs in process
+  bool enable{false};
+  // bytes of shared memory ring for data delivered to one task process
+  uint64_t ring_size{64 * 1024 * 1024};
+};
+
+struct ChannelPoolConfig {
+  // grpc channels are shared by all tasks of this process,
+  // keyed by peer address and tls config
+  bool enable{true};
+  // keepalive ping interval and timeout of idle connection
+  int32_t keepalive_time_ms{30000};
+  int32_t keepalive_timeout_ms{10000};
+  // keepalive pings are sent while no call is active, and accepted from
+  // peers. peers with default ping policy reject such pings by GOAWAY,
+  // so it must be set on all parties
+  bool keepalive_without_calls{false};
+  // channel not borrowed by any task for idle_timeout_s is released
+  int32_t idle_timeout_s{600};
+  // peers "ip:port" connected on node start
+  std::vector<std::string> warmup_peers;
+};
+
+struct LinkConfig {
+  std::string mode{"grpc"};   // grpc, grpc_stream, raw_socket
+  // raw socket link is plaintext, grpc stream is used instead if tls is on
+  // raw socket link listens on grpc_port + socket_port_offset
+  uint32_t socket_port_offset{1000};
+  CompressConfig compress;
+  FlowControlConfig flow_control;
+  CoalesceConfig coalesce;
+  ShmLinkConfig shm;
+  ChannelPoolConfig channel_pool;
+};
+
+struct PirServingConfig {
+  // keyword pir server tasks run in node process and share
+  // sender dbs loaded from cache, instead of loading db per task
+  bool enable{false};
+  // memory budget of resident sender dbs, estimated by size of db cache,
+  // idle dbs are evicted in lru order, 0 means unlimited
+  uint64_t max_memory_bytes{0};
+  // concurrent query sessions on one db, 0 means unlimited
+  uint32_t max_sessions_per_db{0};
+  // time a session waits for admission, negative means no timeout
+  int32_t admission_timeout_ms{30000};
+  // db cache paths loaded on node start
+  std::vector<std::string> preload_dbs;
+};
+
 struct NodeConfig {
   Node server_config;
   ServerInfo public_ip_proxy_config;
@@ -138,6 +227,8 @@ struct NodeConfig {
   ServerInfo proxy_server_cfg;
   StorageInfo storage_info;
   bool disable_report{false};
+  LinkConfig link_cfg;
+  PirServingConfig pir_serving;
 };
 
 }  // namespace primihub::common
@@ -153,6 +244,13 @@ using ServerInfo = primihub::common::ServerInfo;
 using CertificateConfig = primihub::common::CertificateConfig;
 using RedisConfig = primihub::common::RedisConfig;
 using Tee = primihub::common::Tee;
+using LinkConfig = primihub::common::LinkConfig;
+using CompressConfig = primihub::common::CompressConfig;
+using FlowControlConfig = primihub::common::FlowControlConfig;
+using CoalesceConfig = primihub::common::CoalesceConfig;
+using ShmLinkConfig = primihub::common::ShmLinkConfig;
+using ChannelPoolConfig = primihub::common::ChannelPoolConfig;
+using PirServingConfig = primihub::common::PirServingConfig;
 
 template <> struct convert<RedisConfig> {
   static Node encode(const RedisConfig &redis_cfg) {
@@ -332,6 +430,12 @@ template <> struct convert<NodeConfig> {
     if (node["tee"]) {
       nc.tee_conf = node["tee"].as<Tee>();
     }
+    if (node["link"]) {
+      nc.link_cfg = node["link"].as<LinkConfig>();
+    }
+    if (node["pir_serving"]) {
+      nc.pir_serving = node["pir_serving"].as<PirServingConfig>();
+    }
     return true;
   }
 };
@@ -355,6 +459,226 @@ template <> struct convert<Tee> {
   }
 };
 
+template <> struct convert<CompressConfig> {
+  static Node encode(const CompressConfig& compress_cfg) {
+    Node node;
+    node["algorithm"] = compress_cfg.algorithm;
+    node["level"] = compress_cfg.level;
+    node["min_size"] = compress_cfg.min_size;
+    node["exclude_keys"] = compress_cfg.exclude_keys;
+    return node;
+  }
+
+  static bool decode(const Node& node, CompressConfig& compress_cfg) {  // NOLINT
+    if (node["algorithm"]) {
+      compress_cfg.algorithm = node["algorithm"].as<std::string>();
+    }
+    if (node["level"]) {
+      compress_cfg.level = node["level"].as<int>();
+    }
+    if (node["min_size"]) {
+      compress_cfg.min_size = node["min_size"].as<uint64_t>();
+    }
+    if (node["exclude_keys"]) {
+      compress_cfg.exclude_keys =
+          node["exclude_keys"].as<std::vector<std::string>>();
+    }
+    return true;
+  }
+};
+
+template <> struct convert<FlowControlConfig> {
+  static Node encode(const FlowControlConfig& flow_cfg) {
+    Node node;
+    node["task_memory_budget"] = flow_cfg.task_memory_budget;
+    node["key_memory_budget"] = flow_cfg.key_memory_budget;
+    node["wait_timeout_ms"] = flow_cfg.wait_timeout_ms;
+    node["spill_enable"] = flow_cfg.spill_enable;
+    node["spill_dir"] = flow_cfg.spill_dir;
+    node["spill_threshold"] = flow_cfg.spill_threshold;
+    return node;
+  }
+
+  static bool decode(const Node& node, FlowControlConfig& flow_cfg) {  // NOLINT
+    if (node["task_memory_budget"]) {
+      flow_cfg.task_memory_budget = node["task_memory_budget"].as<uint64_t>();
+    }
+    if (node["key_memory_budget"]) {
+      flow_cfg.key_memory_budget = node["key_memory_budget"].as<uint64_t>();
+    }
+    if (node["wait_timeout_ms"]) {
+      flow_cfg.wait_timeout_ms = node["wait_timeout_ms"].as<int32_t>();
+    }
+    if (node["spill_enable"]) {
+      flow_cfg.spill_enable = node["spill_enable"].as<bool>();
+    }
+    if (node["spill_dir"]) {
+      flow_cfg.spill_dir = node["spill_dir"].as<std::string>();
+    }
+    if (node["spill_threshold"]) {
+      flow_cfg.spill_threshold = node["spill_threshold"].as<uint64_t>();
+    }
+    return true;
+  }
+};
+
+template <> struct convert<CoalesceConfig> {
+  static Node encode(const CoalesceConfig& coalesce_cfg) {
+    Node node;
+    node["enable"] = coalesce_cfg.enable;
+    node["flush_window_us"] = coalesce_cfg.flush_window_us;
+    node["max_batch_size"] = coalesce_cfg.max_batch_size;
+    node["max_message_size"] = coalesce_cfg.max_message_size;
+    return node;
+  }
+
+  static bool decode(const Node& node, CoalesceConfig& coalesce_cfg) {  // NOLINT
+    if (node["enable"]) {
+      coalesce_cfg.enable = node["enable"].as<bool>();
+    }
+    if (node["flush_window_us"]) {
+      coalesce_cfg.flush_window_us = node["flush_window_us"].as<uint32_t>();
+    }
+    if (node["max_batch_size"]) {
+      coalesce_cfg.max_batch_size = node["max_batch_size"].as<uint64_t>();
+    }
+    if (node["max_message_size"]) {
+      coalesce_cfg.max_message_size = node["max_message_size"].as<uint64_t>();
+    }
+    return true;
+  }
+};
+
+template <> struct convert<ShmLinkConfig> {
+  static Node encode(const ShmLinkConfig& shm_cfg) {
+    Node node;
+    node["enable"] = shm_cfg.enable;
+    node["ring_size"] = shm_cfg.ring_size;
+    return node;
+  }
+
+  static bool decode(const Node& node, ShmLinkConfig& shm_cfg) {  // NOLINT
+    if (node["enable"]) {
+      shm_cfg.enable = node["enable"].as<bool>();
+    }
+    if (node["ring_size"]) {
+      shm_cfg.ring_size = node["ring_size"].as<uint64_t>();
+    }
+    return true;
+  }
+};
+
+template <> struct convert<ChannelPoolConfig> {
+  static Node encode(const ChannelPoolConfig& pool_cfg) {
+    Node node;
+    node["enable"] = pool_cfg.enable;
+    node["keepalive_time_ms"] = pool_cfg.keepalive_time_ms;
+    node["keepalive_timeout_ms"] = pool_cfg.keepalive_timeout_ms;
+    node["keepalive_without_calls"] = pool_cfg.keepalive_without_calls;
+    node["idle_timeout_s"] = pool_cfg.idle_timeout_s;
+    node["warmup_peers"] = pool_cfg.warmup_peers;
+    return node;
+  }
+
+  static bool decode(const Node& node, ChannelPoolConfig& pool_cfg) {  // NOLINT
+    if (node["enable"]) {
+      pool_cfg.enable = node["enable"].as<bool>();
+    }
+    if (node["keepalive_time_ms"]) {
+      pool_cfg.keepalive_time_ms = node["keepalive_time_ms"].as<int32_t>();
+    }
+    if (node["keepalive_timeout_ms"]) {
+      pool_cfg.keepalive_timeout_ms =
+          node["keepalive_timeout_ms"].as<int32_t>();
+    }
+    if (node["keepalive_without_calls"]) {
+      pool_cfg.keepalive_without_calls =
+          node["keepalive_without_calls"].as<bool>();
+    }
+    if (node["idle_timeout_s"]) {
+      pool_cfg.idle_timeout_s = node["idle_timeout_s"].as<int32_t>();
+    }
+    if (node["warmup_peers"]) {
+      pool_cfg.warmup_peers =
+          node["warmup_peers"].as<std::vector<std::string>>();
+    }
+    return true;
+  }
+};
+
+template <> struct convert<LinkConfig> {
+  static Node encode(const LinkConfig& link_cfg) {
+    Node node;
+    node["mode"] = link_cfg.mode;
+    node["socket_port_offset"] = link_cfg.socket_port_offset;
+    node["compress"] = link_cfg.compress;
+    node["flow_control"] = link_cfg.flow_control;
+    node["coalesce"] = link_cfg.coalesce;
+    node["shm"] = link_cfg.shm;
+    node["channel_pool"] = link_cfg.channel_pool;
+    return node;
+  }
+
+  static bool decode(const Node& node, LinkConfig& link_cfg) {    // NOLINT
+    if (node["mode"]) {
+      link_cfg.mode = node["mode"].as<std::string>();
+    }
+    if (node["socket_port_offset"]) {
+      link_cfg.socket_port_offset = node["socket_port_offset"].as<uint32_t>();
+    }
+    if (node["compress"]) {
+      link_cfg.compress = node["compress"].as<CompressConfig>();
+    }
+    if (node["flow_control"]) {
+      link_cfg.flow_control = node["flow_control"].as<FlowControlConfig>();
+    }
+    if (node["coalesce"]) {
+      link_cfg.coalesce = node["coalesce"].as<CoalesceConfig>();
+    }
+    if (node["shm"]) {
+      link_cfg.shm = node["shm"].as<ShmLinkConfig>();
+    }
+    if (node["channel_pool"]) {
+      link_cfg.channel_pool = node["channel_pool"].as<ChannelPoolConfig>();
+    }
+    return true;
+  }
+};
+
+template <> struct convert<PirServingConfig> {
+  static Node encode(const PirServingConfig& serving_cfg) {
+    Node node;
+    node["enable"] = serving_cfg.enable;
+    node["max_memory_bytes"] = serving_cfg.max_memory_bytes;
+    node["max_sessions_per_db"] = serving_cfg.max_sessions_per_db;
+    node["admission_timeout_ms"] = serving_cfg.admission_timeout_ms;
+    node["preload_dbs"] = serving_cfg.preload_dbs;
+    return node;
+  }
+
+  static bool decode(const Node& node, PirServingConfig& serving_cfg) {  // NOLINT
+    if (node["enable"]) {
+      serving_cfg.enable = node["enable"].as<bool>();
+    }
+    if (node["max_memory_bytes"]) {
+      serving_cfg.max_memory_bytes = node["max_memory_bytes"].as<uint64_t>();
+    }
+    if (node["max_sessions_per_db"]) {
+      serving_cfg.max_sessions_per_db =
+          node["max_sessions_per_db"].as<uint32_t>();
+    }
+    if (node["admission_timeout_ms"]) {
+      serving_cfg.admission_timeout_ms =
+          node["admission_timeout_ms"].as<int32_t>();
+    }
+    if (node["preload_dbs"]) {
+      serving_cfg.preload_dbs =
+          node["preload_dbs"].as<std::vector<std::string>>();
+    }
+    return true;
+  }
+};
+
 }  // namespace YAML
 
 #endif  // SRC_PRIMIHUB_COMMON_CONFIG_CONFIG_H_
@@ -225,6 +225,30 @@ std::shared_ptr<arrow::Table> ReadCSVFile(const std::string& file_path,
   return Read(input, read_opt, parse_opt, convert_opt);
 }
 
+std::shared_ptr<arrow::csv::StreamingReader> OpenCSVStream(
+    const std::string& file_path,
+    const ReadOptions& read_opt,
+    const ParseOptions& parse_opt,
+    const ConvertOptions& convert_opt) {
+  auto result_ifstream = arrow::io::ReadableFile::Open(file_path);
+  if (!result_ifstream.ok()) {
+    std::stringstream ss;
+    ss << "Failed to open file: " << file_path << " "
+        << "detail: " << result_ifstream.status();
+    RaiseException(ss.str());
+  }
+  std::shared_ptr<arrow::io::InputStream> input = result_ifstream.ValueOrDie();
+  arrow::io::IOContext io_context = arrow::io::default_io_context();
+  auto maybe_reader = arrow::csv::StreamingReader::Make(
+      io_context, input, read_opt, parse_opt, convert_opt);
+  if (!maybe_reader.ok()) {
+    std::stringstream ss;
+    ss << "read data failed, " << "detail: " << maybe_reader.status();
+    RaiseException(ss.str());
+  }
+  return *maybe_reader;
+}
+
 std::string ReadRawData(const std::string& file_path, int64_t line_number) {
   // read data first 100 lines
   std::ifstream csv_data(file_path, std::ios::in);
@@ -345,6 +369,7 @@ CSVCursor::CSVCursor(const std::string& file_path,
 CSVCursor::~CSVCursor() { this->close(); }
 
 void CSVCursor::close() {
+  stream_reader_.reset();
 }
 
 retcode CSVCursor::ColumnIndexToColumnName(const std::string& file_path,
@@ -495,6 +520,42 @@ std::shared_ptr<Dataset> CSVCursor::read(int64_t offset, int64_t limit) {
   return nullptr;
 }
 
+std::shared_ptr<Dataset> CSVCursor::ReadNextBatch(
+    const std::shared_ptr<arrow::Schema>& data_schema, int64_t batch_bytes) {
+  if (stream_reader_ == nullptr) {
+    CsvOptions csv_options;
+    auto ret = MakeCsvOptions(data_schema, &csv_options);
+    if (ret != retcode::SUCCESS) {
+      LOG(ERROR) << "make csv file options failed";
+      return nullptr;
+    }
+    if (batch_bytes > 0) {
+      csv_options.read_options.block_size = batch_bytes;
+    }
+    stream_reader_ = csv::OpenCSVStream(this->file_path_,
+                                        csv_options.read_options,
+                                        csv_options.parse_options,
+                                        csv_options.convert_options);
+  }
+  std::shared_ptr<arrow::RecordBatch> batch;
+  auto status = stream_reader_->ReadNext(&batch);
+  if (!status.ok()) {
+    std::stringstream ss;
+    ss << "read data failed, " << "detail: " << status;
+    RaiseException(ss.str());
+  }
+  if (batch == nullptr) {
+    return nullptr;
+  }
+  auto maybe_table = arrow::Table::FromRecordBatches({batch});
+  if (!maybe_table.ok()) {
+    LOG(ERROR) << "make table from record batch failed, "
+               << maybe_table.status();
+    return nullptr;
+  }
+  return std::make_shared<Dataset>(*maybe_table, this->driver_);
+}
+
 std::shared_ptr<Dataset> CSVCursor::ReadImpl(const std::string& file_path,
     const ReadOptions& read_options,
     const ParseOptions& parse_options,
@@ -693,6 +754,14 @@ retcode CSVDriver::Write(const std::vector<std::string>& fields_name,
   return primihub::csv::WriteImpl(fields_name, table, file_path);
 }
 
+retcode CSVDriver::Append(std::shared_ptr<arrow::Table> table,
+                          const std::string& file_path) {
+  bool include_header{false};
+  bool append_data{true};
+  return primihub::csv::WriteContent(table, file_path,
+                                     include_header, append_data);
+}
+
 std::string CSVDriver::getDataURL() const {
   return filePath_;
 }
@@ -66,6 +66,13 @@ class CSVCursor : public Cursor {
   std::shared_ptr<Dataset> read(
       const std::shared_ptr<arrow::Schema>& data_schema) override;
   std::shared_ptr<Dataset> read(int64_t offset, int64_t limit) override;
+  /**
+   * stream csv file by blocks of batch_bytes,
+   * memory held by cursor is bounded by the block size
+  */
+  std::shared_ptr<Dataset> ReadNextBatch(
+      const std::shared_ptr<arrow::Schema>& data_schema,
+      int64_t batch_bytes) override;
   int write(std::shared_ptr<Dataset> dataset) override;
   void close() override;
 
@@ -110,6 +117,7 @@ class CSVCursor : public Cursor {
   unsigned long long offset_{0};   // NOLINT
   std::shared_ptr<CSVDriver> driver_;
   std::vector<int> colum_index_;
+  std::shared_ptr<arrow::csv::StreamingReader> stream_reader_{nullptr};
 };
 
 class CSVDriver : public DataDriver,
@@ -138,6 +146,11 @@ class CSVDriver : public DataDriver,
   retcode Write(const std::vector<std::string>& fields_name,
                 std::shared_ptr<arrow::Table> table,
                 const std::string& file_path);
+  /**
+   * append table data to existing file without csv title
+  */
+  retcode Append(std::shared_ptr<arrow::Table> table,
+                 const std::string& file_path);
 
  protected:
   void setDriverType();
@@ -196,6 +196,15 @@ Cursor::MakeArrowSchema(const std::vector<FieldType>& data_schema) {
   VLOG(5) << "arrow_schema: " << arrow_schema->field_names().size();
   return arrow_schema;
 }
+
+std::shared_ptr<Dataset> Cursor::ReadNextBatch(
+    const std::shared_ptr<arrow::Schema>& data_schema, int64_t batch_bytes) {
+  if (batch_read_finished_) {
+    return nullptr;
+  }
+  batch_read_finished_ = true;
+  return read(data_schema);
+}
 ////////////////////// DataDriver /////////////////////////////
 std::string DataDriver::getDriverType() const {
   return driver_type;
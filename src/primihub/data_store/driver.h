@@ -95,12 +95,25 @@ class Cursor {
   }
 
   virtual std::shared_ptr<Dataset> read(const std::shared_ptr<arrow::Schema>& data_schema) = 0;
+  /**
+   * read data batch by batch, return nullptr after the last batch
+   * batch_bytes: hint of data size of one batch
+   * driver without streaming read returns the whole data as one batch
+  */
+  std::shared_ptr<Dataset> ReadNextBatch(
+      const std::vector<FieldType>& data_schema, int64_t batch_bytes) {
+    auto arrow_schema = MakeArrowSchema(data_schema);
+    return ReadNextBatch(arrow_schema, batch_bytes);
+  }
+  virtual std::shared_ptr<Dataset> ReadNextBatch(
+      const std::shared_ptr<arrow::Schema>& data_schema, int64_t batch_bytes);
   virtual int write(std::shared_ptr<Dataset> dataset) = 0;
   virtual void close() = 0;
   std::vector<int>& SelectedColumnIndex() {return selected_column_index_;}
 
  protected:
   std::shared_ptr<arrow::Schema> MakeArrowSchema(const std::vector<FieldType>& data_schema);
+  bool batch_read_finished_{false};
 
  public:
   std::vector<int> selected_column_index_;
@@ -33,6 +33,17 @@ struct Options {
   // offline task
   bool generate_db{false};
   std::string db_path;
+  // id pir downloads whole database instead of seal pir query
+  bool id_pir_download{false};
+  // cpu budget for query processing of server, 0 means half of the cores
+  size_t query_thread_num{0};
+  // numa node whose cpus run query processing, -1 means no pinning
+  int numa_node{-1};
+  // server shares db loaded from cache with other tasks of this process
+  bool resident_db{false};
+  // number of query blocks in flight for keyword pir,
+  // 1 means blocks are processed one after another
+  size_t pipeline_depth{1};
   Node peer_node;
   Node proxy_node;
 };
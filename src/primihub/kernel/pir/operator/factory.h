@@ -4,6 +4,7 @@
 #include <glog/logging.h>
 #include <memory>
 #include "src/primihub/kernel/pir/common.h"
+#include "src/primihub/kernel/pir/operator/id_pir.h"
 #include "src/primihub/kernel/pir/operator/keyword_pir_impl/keyword_pir_client.h"
 #include "src/primihub/kernel/pir/operator/keyword_pir_impl/keyword_pir_server.h"
 namespace primihub::pir {
@@ -13,9 +14,16 @@ class Factory {
       const Options& options) {
     std::unique_ptr<BasePirOperator> operator_ptr{nullptr};
     switch (pir_type) {
-    case PirType::ID_PIR:
-      LOG(ERROR) << "Unimplement";
+    case PirType::ID_PIR: {
+      if (RoleValidation::IsClient(options.role)) {
+        operator_ptr = std::make_unique<IdPirOperatorClient>(options);
+      } else if (RoleValidation::IsServer(options.role)) {
+        operator_ptr = std::make_unique<IdPirOperatorServer>(options);
+      } else {
+        LOG(ERROR) << "unknown role: " << static_cast<int>(options.role);
+      }
       break;
+    }
     case PirType::KEY_PIR: {
       if (RoleValidation::IsClient(options.role)) {
         operator_ptr = std::make_unique<KeywordPirOperatorClient>(options);
@@ -1,2 +1,258 @@
 // "Copyright [2023] <PrimiHub>"
 #include "src/primihub/kernel/pir/operator/id_pir.h"
+#include <glog/logging.h>
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <thread>
+#include <utility>
+
+#include "src/primihub/common/value_check_util.h"
+#include "src/primihub/kernel/pir/operator/id_pir_impl/seal_pir.h"
+#include "src/primihub/util/endian_util.h"
+#include "src/primihub/util/util.h"
+
+namespace primihub::pir {
+namespace {
+bool ParseRowIndex(const std::string& key, uint64_t* index) {
+  if (key.empty() || key.size() > 19 ||
+      !std::all_of(key.begin(), key.end(),
+                   [](unsigned char c) {return std::isdigit(c);})) {
+    return false;
+  }
+  *index = std::stoull(key);
+  return true;
+}
+}  // namespace
+
+// ------------------------Server----------------------------
+retcode IdPirOperatorServer::OnExecute(const PirDataType& input,
+                                       PirDataType* result) {
+  thread_num_ = std::max<size_t>(std::thread::hardware_concurrency() / 2, 1);
+  std::unique_ptr<IdPirDatabase> db{nullptr};
+  if (this->options_.generate_db) {
+    // generate db offline which can load when task execute
+    db = CreateDb(input);
+    CHECK_NULLPOINTER(db, retcode::FAIL);
+    return db->Save(this->options_.db_path);
+  }
+  if (this->options_.use_cache) {
+    db = IdPirDatabase::Load(this->options_.db_path);
+  } else {
+    db = CreateDb(input);
+  }
+  CHECK_NULLPOINTER(db, retcode::FAIL);
+  auto ret = ProcessParams(*db);
+  CHECK_RETCODE_WITH_RETVALUE(ret, retcode::FAIL);
+  ret = ProcessQuery(*db);
+  CHECK_RETCODE_WITH_RETVALUE(ret, retcode::FAIL);
+  {
+    std::string task_end;
+    auto link_ctx = this->GetLinkContext();
+    ret = link_ctx->Recv(this->key_task_end_, ProxyNode(), &task_end);
+    CHECK_RETCODE_WITH_RETVALUE(ret, retcode::FAIL);
+    LOG(INFO) << "task status: " << task_end;
+  }
+  return retcode::SUCCESS;
+}
+
+std::unique_ptr<IdPirDatabase> IdPirOperatorServer::CreateDb(
+    const PirDataType& input) {
+  std::vector<std::string> rows(input.size());
+  std::string sep = DATA_RECORD_SEP;
+  for (const auto& [key, labels] : input) {
+    uint64_t index{0};
+    if (!ParseRowIndex(key, &index) || index >= rows.size()) {
+      LOG(ERROR) << "invalid row index: " << key << " "
+                 << "rows: " << rows.size();
+      return nullptr;
+    }
+    auto& row = rows[index];
+    for (size_t i = 0; i < labels.size(); i++) {
+      if (i != 0) {
+        row.append(sep);
+      }
+      row.append(labels[i]);
+    }
+  }
+  return IdPirDatabase::Create(rows);
+}
+
+retcode IdPirOperatorServer::RecvRequest(IdPirRequest expected,
+                                         std::string* payload) {
+  CHECK_TASK_STOPPED(retcode::FAIL);
+  std::string request;
+  auto link_ctx = this->GetLinkContext();
+  CHECK_NULLPOINTER_WITH_ERROR_MSG(link_ctx, "LinkContext is empty");
+  auto ret = link_ctx->Recv(this->key_, ProxyNode(), &request);
+  if (ret != retcode::SUCCESS || request.empty()) {
+    LOG(ERROR) << "recv request from : " << PeerNode().to_string()
+               << " failed";
+    return retcode::FAIL;
+  }
+  auto type = static_cast<IdPirRequest>(request[0]);
+  if (type != expected) {
+    LOG(ERROR) << "unexpected request type: " << static_cast<int>(type) << " "
+               << "expected: " << static_cast<int>(expected);
+    return retcode::FAIL;
+  }
+  *payload = request.substr(1);
+  return retcode::SUCCESS;
+}
+
+retcode IdPirOperatorServer::ProcessParams(const IdPirDatabase& db) {
+  std::string payload;
+  auto ret = RecvRequest(IdPirRequest::PARAMS, &payload);
+  CHECK_RETCODE_WITH_RETVALUE(ret, retcode::FAIL);
+  uint64_t params[2] = {htonll(db.row_count()), htonll(db.row_bytes())};
+  std::string_view params_sv{reinterpret_cast<char*>(params), sizeof(params)};
+  ret = this->GetLinkContext()->Send(this->response_key_, ProxyNode(),
+                                     params_sv);
+  if (ret != retcode::SUCCESS) {
+    LOG(ERROR) << "send params to " << PeerNode().to_string() << " failed";
+    return retcode::FAIL;
+  }
+  return retcode::SUCCESS;
+}
+
+retcode IdPirOperatorServer::ProcessQuery(const IdPirDatabase& db) {
+  std::unique_ptr<SealPirServer> pir_server{nullptr};
+  if (!this->options_.id_pir_download) {
+    // encode database while client generates its keys
+    pir_server = std::make_unique<SealPirServer>(db, thread_num_);
+    auto ret = pir_server->Preprocess();
+    CHECK_RETCODE_WITH_RETVALUE(ret, retcode::FAIL);
+  }
+  std::string query;
+  auto expected = this->options_.id_pir_download ? IdPirRequest::DOWNLOAD
+                                                 : IdPirRequest::QUERY;
+  auto ret = RecvRequest(expected, &query);
+  CHECK_RETCODE_WITH_RETVALUE(ret, retcode::FAIL);
+  auto link_ctx = this->GetLinkContext();
+  if (this->options_.id_pir_download) {
+    ret = link_ctx->Send(this->response_key_, ProxyNode(), db.data());
+  } else {
+    std::string response;
+    ret = pir_server->Answer(query, &response);
+    CHECK_RETCODE_WITH_RETVALUE(ret, retcode::FAIL);
+    VLOG(5) << "query size: " << query.size() << " "
+            << "response size: " << response.size();
+    ret = link_ctx->Send(this->response_key_, ProxyNode(), response);
+  }
+  if (ret != retcode::SUCCESS) {
+    LOG(ERROR) << "send response to " << PeerNode().to_string() << " failed";
+    return retcode::FAIL;
+  }
+  return retcode::SUCCESS;
+}
+
+// ------------------------Client----------------------------
+retcode IdPirOperatorClient::OnExecute(const PirDataType& input,
+                                       PirDataType* result) {
+  uint64_t row_count{0};
+  uint64_t row_bytes{0};
+  auto ret = RequestParams(&row_count, &row_bytes);
+  CHECK_RETCODE_WITH_RETVALUE(ret, retcode::FAIL);
+  std::vector<std::string> orig_items;
+  std::vector<uint64_t> query_rows;
+  for (const auto& [key, _] : input) {
+    uint64_t index{0};
+    if (!ParseRowIndex(key, &index) || index >= row_count) {
+      LOG(WARNING) << "invalid row index: " << key << " "
+                   << "rows of server: " << row_count;
+      continue;
+    }
+    orig_items.push_back(key);
+    query_rows.push_back(index);
+  }
+  std::vector<std::string> rows;
+  if (this->options_.id_pir_download) {
+    std::string db_data;
+    ret = Request(IdPirRequest::DOWNLOAD, std::string(), &db_data);
+    CHECK_RETCODE_WITH_RETVALUE(ret, retcode::FAIL);
+    if (db_data.size() != row_count * row_bytes) {
+      LOG(ERROR) << "size of database mismatches, expected: "
+                 << row_count * row_bytes << " received: " << db_data.size();
+      return retcode::FAIL;
+    }
+    std::string_view db_sv(db_data);
+    for (auto index : query_rows) {
+      rows.push_back(IdPirDatabase::TrimRow(
+          db_sv.substr(index * row_bytes, row_bytes)));
+    }
+  } else {
+    SealPirClient pir_client(row_count, row_bytes);
+    std::string query;
+    ret = pir_client.CreateQuery(query_rows, &query);
+    CHECK_RETCODE_WITH_RETVALUE(ret, retcode::FAIL);
+    std::string response;
+    ret = Request(IdPirRequest::QUERY, query, &response);
+    CHECK_RETCODE_WITH_RETVALUE(ret, retcode::FAIL);
+    ret = pir_client.ExtractRows(response, query_rows, &rows);
+    CHECK_RETCODE_WITH_RETVALUE(ret, retcode::FAIL);
+  }
+  ExtractResult(orig_items, rows, result);
+  {
+    std::string task_end{"SUCCESS"};
+    auto link_ctx = this->GetLinkContext();
+    ret = link_ctx->Send(this->key_task_end_, PeerNode(), task_end);
+    CHECK_RETCODE_WITH_RETVALUE(ret, retcode::FAIL);
+  }
+  return retcode::SUCCESS;
+}
+
+retcode IdPirOperatorClient::Request(IdPirRequest type,
+                                     const std::string& payload,
+                                     std::string* response) {
+  CHECK_TASK_STOPPED(retcode::FAIL);
+  auto link_ctx = this->GetLinkContext();
+  CHECK_NULLPOINTER_WITH_ERROR_MSG(link_ctx, "LinkContext is empty");
+  std::string request;
+  request.reserve(payload.size() + 1);
+  request.push_back(static_cast<char>(type));
+  request.append(payload);
+  auto ret = link_ctx->Send(this->key_, PeerNode(), request);
+  if (ret != retcode::SUCCESS) {
+    LOG(ERROR) << "send request to peer: [" << PeerNode().to_string()
+               << "] failed";
+    return retcode::FAIL;
+  }
+  ret = link_ctx->Recv(this->response_key_, PeerNode(), response);
+  if (ret != retcode::SUCCESS) {
+    LOG(ERROR) << "recv response from peer: [" << PeerNode().to_string()
+               << "] failed";
+    return retcode::FAIL;
+  }
+  return retcode::SUCCESS;
+}
+
+retcode IdPirOperatorClient::RequestParams(uint64_t* row_count,
+                                           uint64_t* row_bytes) {
+  std::string response;
+  auto ret = Request(IdPirRequest::PARAMS, std::string(), &response);
+  CHECK_RETCODE_WITH_RETVALUE(ret, retcode::FAIL);
+  uint64_t params[2];
+  if (response.size() != sizeof(params)) {
+    LOG(ERROR) << "invalid params of id pir, size: " << response.size();
+    return retcode::FAIL;
+  }
+  memcpy(params, response.data(), sizeof(params));
+  *row_count = ntohll(params[0]);
+  *row_bytes = ntohll(params[1]);
+  VLOG(5) << "rows of server: " << *row_count << " "
+          << "row bytes: " << *row_bytes;
+  return retcode::SUCCESS;
+}
+
+retcode IdPirOperatorClient::ExtractResult(
+    const std::vector<std::string>& orig_items,
+    const std::vector<std::string>& rows,
+    PirDataType* result) {
+  std::string sep = DATA_RECORD_SEP;
+  for (size_t i = 0; i < orig_items.size(); i++) {
+    auto& labels = (*result)[orig_items[i]];
+    str_split(rows[i], &labels, sep);
+  }
+  return retcode::SUCCESS;
+}
+}  // namespace primihub::pir
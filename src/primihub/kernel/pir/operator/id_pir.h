@@ -1,5 +1,59 @@
 // "Copyright [2023] <PrimiHub>"
 #ifndef SRC_PRIMIHUB_KERNEL_PIR_OPERATOR_ID_PIR_H_
 #define SRC_PRIMIHUB_KERNEL_PIR_OPERATOR_ID_PIR_H_
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
 
+#include "src/primihub/kernel/pir/operator/base_pir.h"
+#include "src/primihub/kernel/pir/common.h"
+#include "src/primihub/kernel/pir/operator/id_pir_impl/id_pir_database.h"
+
+namespace primihub::pir {
+enum class IdPirRequest : uint8_t {
+  PARAMS = 0,
+  QUERY,
+  DOWNLOAD,
+};
+
+/**
+ * index pir, client retrieves row i of server dataset by index i.
+ * by default rows are retrieved by seal pir, so server learns nothing
+ * about the queried indices, with option id_pir_download, client
+ * downloads the whole database instead, which needs no homomorphic
+ * computation and suits small database or fast network.
+*/
+class IdPirOperatorServer : public BasePirOperator {
+ public:
+  explicit IdPirOperatorServer(const Options& options) :
+      BasePirOperator(options) {}
+  retcode OnExecute(const PirDataType& input, PirDataType* result) override;
+
+ protected:
+  /**
+   * key of input is row index, labels of row are joined by DATA_RECORD_SEP
+  */
+  std::unique_ptr<IdPirDatabase> CreateDb(const PirDataType& input);
+  retcode RecvRequest(IdPirRequest expected, std::string* payload);
+  retcode ProcessParams(const IdPirDatabase& db);
+  retcode ProcessQuery(const IdPirDatabase& db);
+  size_t thread_num_{1};
+};
+
+class IdPirOperatorClient : public BasePirOperator {
+ public:
+  explicit IdPirOperatorClient(const Options& options) :
+      BasePirOperator(options) {}
+  retcode OnExecute(const PirDataType& input, PirDataType* result) override;
+
+ protected:
+  retcode RequestParams(uint64_t* row_count, uint64_t* row_bytes);
+  retcode Request(IdPirRequest type, const std::string& payload,
+                  std::string* response);
+  retcode ExtractResult(const std::vector<std::string>& orig_items,
+                        const std::vector<std::string>& rows,
+                        PirDataType* result);
+};
+}  // namespace primihub::pir
 #endif  // SRC_PRIMIHUB_KERNEL_PIR_OPERATOR_ID_PIR_H_
@@ -0,0 +1,120 @@
+/*
+* Copyright (c) 2023 by PrimiHub
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      https://www.apache.org/licenses/
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#include "src/primihub/kernel/pir/operator/id_pir_impl/id_pir_database.h"
+#include <glog/logging.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <functional>
+#include <thread>
+
+#include "src/primihub/util/endian_util.h"
+#include "src/primihub/util/file_util.h"
+
+namespace primihub::pir {
+namespace {
+constexpr char kCacheMagic[] = "PHIDPIR1";
+constexpr size_t kCacheMagicSize = sizeof(kCacheMagic) - 1;
+}  // namespace
+
+std::unique_ptr<IdPirDatabase> IdPirDatabase::Create(
+    const std::vector<std::string>& rows) {
+  uint64_t row_bytes{1};
+  for (const auto& row : rows) {
+    row_bytes = std::max<uint64_t>(row_bytes, row.size());
+  }
+  std::string data(rows.size() * row_bytes, '\0');
+  for (size_t i = 0; i < rows.size(); i++) {
+    std::copy(rows[i].begin(), rows[i].end(), data.begin() + i * row_bytes);
+  }
+  VLOG(5) << "id pir database, rows: " << rows.size() << " "
+          << "row bytes: " << row_bytes;
+  return std::unique_ptr<IdPirDatabase>(
+      new IdPirDatabase(rows.size(), row_bytes, std::move(data)));
+}
+
+std::string IdPirDatabase::TrimRow(std::string_view row) {
+  auto pos = row.find_last_not_of('\0');
+  if (pos == std::string_view::npos) {
+    return std::string();
+  }
+  return std::string(row.substr(0, pos + 1));
+}
+
+std::unique_ptr<IdPirDatabase> IdPirDatabase::Load(
+    const std::string& file_path) {
+  std::ifstream in(file_path, std::ios::binary);
+  if (!in.is_open()) {
+    LOG(ERROR) << "open id pir database: " << file_path << " failed";
+    return nullptr;
+  }
+  std::string magic(kCacheMagicSize, '\0');
+  uint64_t be_row_count{0};
+  uint64_t be_row_bytes{0};
+  bool valid = in.read(magic.data(), magic.size()) && magic == kCacheMagic &&
+      in.read(reinterpret_cast<char*>(&be_row_count), sizeof(uint64_t)) &&
+      in.read(reinterpret_cast<char*>(&be_row_bytes), sizeof(uint64_t));
+  if (!valid) {
+    LOG(ERROR) << "invalid id pir database: " << file_path;
+    return nullptr;
+  }
+  uint64_t row_count = ntohll(be_row_count);
+  uint64_t row_bytes = ntohll(be_row_bytes);
+  std::string data(row_count * row_bytes, '\0');
+  if (!in.read(data.data(), data.size())) {
+    LOG(ERROR) << "id pir database: " << file_path << " is truncated";
+    return nullptr;
+  }
+  VLOG(5) << "load id pir database: " << file_path << " "
+          << "rows: " << row_count << " row bytes: " << row_bytes;
+  return std::unique_ptr<IdPirDatabase>(
+      new IdPirDatabase(row_count, row_bytes, std::move(data)));
+}
+
+retcode IdPirDatabase::Save(const std::string& file_path) const {
+  if (ValidateDir(file_path) != 0) {
+    LOG(ERROR) << "create dir for id pir database: " << file_path
+               << " failed";
+    return retcode::FAIL;
+  }
+  // online task never reads partial database
+  auto tmp_path = file_path + ".tmp." + std::to_string(::getpid()) + "_" +
+      std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id()));
+  {
+    std::ofstream out(tmp_path, std::ios::binary | std::ios::trunc);
+    uint64_t be_row_count = htonll(row_count_);
+    uint64_t be_row_bytes = htonll(row_bytes_);
+    out.write(kCacheMagic, kCacheMagicSize);
+    out.write(reinterpret_cast<char*>(&be_row_count), sizeof(uint64_t));
+    out.write(reinterpret_cast<char*>(&be_row_bytes), sizeof(uint64_t));
+    out.write(data_.data(), data_.size());
+    if (!out.good()) {
+      LOG(ERROR) << "write id pir database: " << tmp_path << " failed";
+      out.close();
+      RemoveFile(tmp_path);
+      return retcode::FAIL;
+    }
+  }
+  if (std::rename(tmp_path.c_str(), file_path.c_str()) != 0) {
+    LOG(ERROR) << "rename id pir database to: " << file_path << " failed";
+    RemoveFile(tmp_path);
+    return retcode::FAIL;
+  }
+  VLOG(5) << "save id pir database: " << file_path;
+  return retcode::SUCCESS;
+}
+}  // namespace primihub::pir
@@ -0,0 +1,59 @@
+/*
+* Copyright (c) 2023 by PrimiHub
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      https://www.apache.org/licenses/
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#ifndef SRC_PRIMIHUB_KERNEL_PIR_OPERATOR_ID_PIR_IMPL_ID_PIR_DATABASE_H_
+#define SRC_PRIMIHUB_KERNEL_PIR_OPERATOR_ID_PIR_IMPL_ID_PIR_DATABASE_H_
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "src/primihub/common/common.h"
+
+namespace primihub::pir {
+/**
+ * database of index pir, row i of dataset is retrieved by index i.
+ * rows are padded with '\0' to the length of the longest row and stored
+ * one after another. it is the preprocessed form of database,
+ * it is saved as cache file by offline task, so that online task
+ * neither reads nor joins the dataset again.
+*/
+class IdPirDatabase {
+ public:
+  static std::unique_ptr<IdPirDatabase> Create(
+      const std::vector<std::string>& rows);
+  static std::unique_ptr<IdPirDatabase> Load(const std::string& file_path);
+  retcode Save(const std::string& file_path) const;
+  uint64_t row_count() const {return row_count_;}
+  uint64_t row_bytes() const {return row_bytes_;}
+  std::string_view Row(uint64_t index) const {
+    return std::string_view(data_).substr(index * row_bytes_, row_bytes_);
+  }
+  const std::string& data() const {return data_;}
+  /**
+   * row without padding
+  */
+  static std::string TrimRow(std::string_view row);
+
+ private:
+  IdPirDatabase(uint64_t row_count, uint64_t row_bytes, std::string&& data)
+      : row_count_(row_count), row_bytes_(row_bytes), data_(std::move(data)) {}
+  uint64_t row_count_{0};
+  uint64_t row_bytes_{0};
+  std::string data_;
+};
+}  // namespace primihub::pir
+#endif  // SRC_PRIMIHUB_KERNEL_PIR_OPERATOR_ID_PIR_IMPL_ID_PIR_DATABASE_H_
@@ -0,0 +1,430 @@
+/*
+* Copyright (c) 2023 by PrimiHub
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      https://www.apache.org/licenses/
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#include "src/primihub/kernel/pir/operator/id_pir_impl/seal_pir.h"
+#include <glog/logging.h>
+#include <algorithm>
+#include <exception>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <sstream>
+#include <utility>
+
+#include "src/primihub/util/endian_util.h"
+#include "seal/util/polyarithsmallmod.h"
+
+namespace primihub::pir {
+namespace {
+/**
+ * run fn(begin, end) on consecutive ranges of [0, total) concurrently,
+ * exception of fn is rethrown to caller
+*/
+void ParallelRange(uint64_t total, size_t thread_num,
+                   const std::function<void(uint64_t, uint64_t)>& fn) {
+  if (total == 0) {
+    return;
+  }
+  uint64_t range_num = std::max<uint64_t>(1, std::min<uint64_t>(thread_num,
+                                                                total));
+  uint64_t step = (total + range_num - 1) / range_num;
+  std::vector<std::future<void>> futures;
+  for (uint64_t begin = 0; begin < total; begin += step) {
+    futures.push_back(std::async(std::launch::async, fn, begin,
+                                 std::min(total, begin + step)));
+  }
+  for (auto& fut : futures) {
+    fut.get();
+  }
+}
+
+void WriteItem(const std::string& item, std::ostream* out) {
+  uint64_t be_size = htonll(item.size());
+  out->write(reinterpret_cast<char*>(&be_size), sizeof(uint64_t));
+  out->write(item.data(), item.size());
+}
+
+bool ReadItem(std::istream* in, std::string* item) {
+  uint64_t be_size{0};
+  if (!in->read(reinterpret_cast<char*>(&be_size), sizeof(uint64_t))) {
+    return false;
+  }
+  item->resize(ntohll(be_size));
+  return static_cast<bool>(in->read(item->data(), item->size()));
+}
+
+void WriteCount(uint64_t count, std::ostream* out) {
+  uint64_t be_count = htonll(count);
+  out->write(reinterpret_cast<char*>(&be_count), sizeof(uint64_t));
+}
+
+bool ReadCount(std::istream* in, uint64_t* count) {
+  uint64_t be_count{0};
+  if (!in->read(reinterpret_cast<char*>(&be_count), sizeof(uint64_t))) {
+    return false;
+  }
+  *count = ntohll(be_count);
+  return true;
+}
+
+template <typename T>
+void WriteSealObject(const T& object, std::ostream* out) {
+  std::stringstream ss;
+  object.save(ss);
+  WriteItem(ss.str(), out);
+}
+
+template <typename T>
+bool ReadSealObject(const seal::SEALContext& context, std::istream* in,
+                    T* object) {
+  std::string item;
+  if (!ReadItem(in, &item)) {
+    return false;
+  }
+  std::stringstream ss(item);
+  object->load(context, ss);
+  return true;
+}
+}  // namespace
+
+SealPirParams::SealPirParams(uint64_t row_count, uint64_t row_bytes)
+    : row_count(row_count), row_bytes(std::max<uint64_t>(row_bytes, 1)) {
+  if (this->row_bytes <= kPolyDegree) {
+    rows_per_plaintext = kPolyDegree / this->row_bytes;
+  }
+  group_bytes = rows_per_plaintext * this->row_bytes;
+  plaintexts_per_row = (group_bytes + kPolyDegree - 1) / kPolyDegree;
+  group_count = (row_count + rows_per_plaintext - 1) / rows_per_plaintext;
+  query_ciphertext_count = (group_count + kPolyDegree - 1) / kPolyDegree;
+}
+
+std::unique_ptr<seal::SEALContext> SealPirParams::CreateContext() {
+  seal::EncryptionParameters parms(seal::scheme_type::bfv);
+  parms.set_poly_modulus_degree(kPolyDegree);
+  parms.set_coeff_modulus(seal::CoeffModulus::BFVDefault(kPolyDegree));
+  parms.set_plain_modulus(kPlainModulus);
+  return std::make_unique<seal::SEALContext>(parms, true,
+                                             seal::sec_level_type::tc128);
+}
+
+uint32_t SealPirParams::CeilLog2(uint64_t value) {
+  uint32_t log_value{0};
+  while ((1ull << log_value) < value) {
+    log_value++;
+  }
+  return log_value;
+}
+
+uint64_t SealPirParams::GroupsOfCiphertext(uint64_t index) const {
+  return std::min<uint64_t>(kPolyDegree, group_count - index * kPolyDegree);
+}
+
+// server
+SealPirServer::SealPirServer(const IdPirDatabase& db, size_t thread_num)
+    : db_(db), params_(db.row_count(), db.row_bytes()),
+      thread_num_(std::max<size_t>(thread_num, 1)) {
+  context_ = SealPirParams::CreateContext();
+  evaluator_ = std::make_unique<seal::Evaluator>(*context_);
+}
+
+retcode SealPirServer::Preprocess() {
+  const auto& data = db_.data();
+  uint64_t plaintext_count = params_.group_count * params_.plaintexts_per_row;
+  plaintexts_.clear();
+  plaintexts_.resize(plaintext_count);
+  auto parms_id = context_->first_parms_id();
+  try {
+    ParallelRange(plaintext_count, thread_num_,
+        [&](uint64_t begin, uint64_t end) {
+      for (uint64_t i = begin; i < end; i++) {
+        uint64_t group = i / params_.plaintexts_per_row;
+        uint64_t part = i % params_.plaintexts_per_row;
+        uint64_t group_end = std::min<uint64_t>(
+            (group + 1) * params_.group_bytes, data.size());
+        uint64_t offset = group * params_.group_bytes +
+                          part * SealPirParams::kPolyDegree;
+        uint64_t offset_end = std::min<uint64_t>(
+            offset + SealPirParams::kPolyDegree, group_end);
+        auto& plaintext = plaintexts_[i];
+        plaintext.resize(SealPirParams::kPolyDegree);
+        plaintext.set_zero();
+        for (uint64_t j = offset; j < offset_end; j++) {
+          plaintext[j - offset] = static_cast<uint8_t>(data[j]);
+        }
+        evaluator_->transform_to_ntt_inplace(plaintext, parms_id);
+      }
+    });
+  } catch (std::exception& e) {
+    LOG(ERROR) << "preprocess id pir database failed, " << e.what();
+    return retcode::FAIL;
+  }
+  VLOG(5) << "preprocess id pir database, groups: " << params_.group_count
+          << " plaintexts: " << plaintext_count;
+  return retcode::SUCCESS;
+}
+
+void SealPirServer::MultiplyPowerOfX(const seal::Ciphertext& encrypted,
+                                     uint32_t index,
+                                     seal::Ciphertext* destination) {
+  auto context_data = context_->get_context_data(encrypted.parms_id());
+  const auto& coeff_modulus = context_data->parms().coeff_modulus();
+  size_t coeff_count = encrypted.poly_modulus_degree();
+  *destination = encrypted;
+  for (size_t i = 0; i < encrypted.size(); i++) {
+    for (size_t j = 0; j < coeff_modulus.size(); j++) {
+      seal::util::negacyclic_shift_poly_coeffmod(
+          encrypted.data(i) + j * coeff_count, coeff_count, index,
+          coeff_modulus[j],
+          destination->data(i) + j * coeff_count);
+    }
+  }
+}
+
+std::vector<seal::Ciphertext> SealPirServer::Expand(
+    const seal::Ciphertext& encrypted, uint64_t m,
+    const seal::GaloisKeys& galois_keys) {
+  uint32_t logm = SealPirParams::CeilLog2(m);
+  uint32_t n2 = SealPirParams::kPolyDegree << 1;
+  std::vector<seal::Ciphertext> temp{encrypted};
+  for (uint32_t i = 0; i < logm; i++) {
+    uint32_t galois_elt = SealPirParams::GaloisElt(i);
+    uint32_t index_raw = n2 - (1u << i);
+    uint32_t index = (static_cast<uint64_t>(index_raw) * galois_elt) % n2;
+    uint64_t half = temp.size();
+    uint64_t needed = (i + 1 == logm) ? m : (half << 1);
+    std::vector<seal::Ciphertext> next(needed);
+    ParallelRange(half, thread_num_, [&](uint64_t begin, uint64_t end) {
+      seal::Ciphertext rotated;
+      seal::Ciphertext shifted;
+      seal::Ciphertext rotated_shifted;
+      for (uint64_t a = begin; a < end; a++) {
+        if (a + half >= needed) {
+          // coefficients of the odd part are zero in query
+          evaluator_->add(temp[a], temp[a], next[a]);
+          continue;
+        }
+        evaluator_->apply_galois(temp[a], galois_elt, galois_keys, rotated);
+        evaluator_->add(temp[a], rotated, next[a]);
+        MultiplyPowerOfX(temp[a], index_raw, &shifted);
+        MultiplyPowerOfX(rotated, index, &rotated_shifted);
+        evaluator_->add(shifted, rotated_shifted, next[a + half]);
+      }
+    });
+    temp = std::move(next);
+  }
+  return temp;
+}
+
+retcode SealPirServer::AnswerRow(const std::vector<seal::Ciphertext>& query,
+                                 const seal::GaloisKeys& galois_keys,
+                                 std::vector<seal::Ciphertext>* answer) {
+  std::vector<seal::Ciphertext> selection;
+  selection.reserve(params_.group_count);
+  for (size_t i = 0; i < query.size(); i++) {
+    auto expanded = Expand(query[i], params_.GroupsOfCiphertext(i),
+                           galois_keys);
+    for (auto& ct : expanded) {
+      selection.push_back(std::move(ct));
+    }
+  }
+  // every range of groups accumulates its own partial answer
+  size_t width = params_.plaintexts_per_row;
+  std::vector<std::vector<seal::Ciphertext>> partials;
+  std::mutex partials_mtx;
+  ParallelRange(selection.size(), thread_num_,
+      [&](uint64_t begin, uint64_t end) {
+    std::vector<seal::Ciphertext> partial(width);
+    seal::Ciphertext product;
+    for (uint64_t g = begin; g < end; g++) {
+      evaluator_->transform_to_ntt_inplace(selection[g]);
+      for (size_t w = 0; w < width; w++) {
+        const auto& plaintext = plaintexts_[g * width + w];
+        if (g == begin) {
+          evaluator_->multiply_plain(selection[g], plaintext, partial[w]);
+        } else {
+          evaluator_->multiply_plain(selection[g], plaintext, product);
+          evaluator_->add_inplace(partial[w], product);
+        }
+      }
+    }
+    std::lock_guard<std::mutex> lck(partials_mtx);
+    partials.push_back(std::move(partial));
+  });
+  answer->clear();
+  answer->resize(width);
+  for (size_t w = 0; w < width; w++) {
+    (*answer)[w] = std::move(partials[0][w]);
+    for (size_t i = 1; i < partials.size(); i++) {
+      evaluator_->add_inplace((*answer)[w], partials[i][w]);
+    }
+    evaluator_->transform_from_ntt_inplace((*answer)[w]);
+  }
+  return retcode::SUCCESS;
+}
+
+retcode SealPirServer::Answer(const std::string& query,
+                              std::string* response) {
+  if (plaintexts_.empty()) {
+    LOG(ERROR) << "id pir database is not preprocessed";
+    return retcode::FAIL;
+  }
+  std::stringstream in(query);
+  std::stringstream out;
+  try {
+    uint64_t query_num{0};
+    if (!ReadCount(&in, &query_num)) {
+      LOG(ERROR) << "invalid id pir query";
+      return retcode::FAIL;
+    }
+    std::string galois_item;
+    if (!ReadItem(&in, &galois_item)) {
+      LOG(ERROR) << "galois keys are missing in id pir query";
+      return retcode::FAIL;
+    }
+    seal::GaloisKeys galois_keys;
+    if (!galois_item.empty()) {
+      std::stringstream ss(galois_item);
+      galois_keys.load(*context_, ss);
+    }
+    WriteCount(query_num, &out);
+    std::vector<seal::Ciphertext> row_query(params_.query_ciphertext_count);
+    std::vector<seal::Ciphertext> answer;
+    for (uint64_t i = 0; i < query_num; i++) {
+      for (auto& ct : row_query) {
+        if (!ReadSealObject(*context_, &in, &ct)) {
+          LOG(ERROR) << "id pir query is truncated at row: " << i;
+          return retcode::FAIL;
+        }
+      }
+      auto ret = AnswerRow(row_query, galois_keys, &answer);
+      if (ret != retcode::SUCCESS) {
+        return retcode::FAIL;
+      }
+      for (const auto& ct : answer) {
+        WriteSealObject(ct, &out);
+      }
+    }
+    VLOG(5) << "answer id pir query of rows: " << query_num;
+  } catch (std::exception& e) {
+    LOG(ERROR) << "answer id pir query failed, " << e.what();
+    return retcode::FAIL;
+  }
+  *response = out.str();
+  return retcode::SUCCESS;
+}
+
+// client
+SealPirClient::SealPirClient(uint64_t row_count, uint64_t row_bytes)
+    : params_(row_count, row_bytes) {
+  context_ = SealPirParams::CreateContext();
+  keygen_ = std::make_unique<seal::KeyGenerator>(*context_);
+  encryptor_ = std::make_unique<seal::Encryptor>(*context_,
+                                                 keygen_->secret_key());
+  decryptor_ = std::make_unique<seal::Decryptor>(*context_,
+                                                 keygen_->secret_key());
+}
+
+retcode SealPirClient::CreateQuery(const std::vector<uint64_t>& rows,
+                                   std::string* query) {
+  const uint64_t t = SealPirParams::kPlainModulus;
+  std::stringstream out;
+  try {
+    WriteCount(rows.size(), &out);
+    uint32_t max_logm = SealPirParams::CeilLog2(
+        std::min<uint64_t>(SealPirParams::kPolyDegree, params_.group_count));
+    if (max_logm == 0) {
+      WriteItem(std::string(), &out);
+    } else {
+      std::vector<uint32_t> galois_elts;
+      for (uint32_t i = 0; i < max_logm; i++) {
+        galois_elts.push_back(SealPirParams::GaloisElt(i));
+      }
+      WriteSealObject(keygen_->create_galois_keys(galois_elts), &out);
+    }
+    for (auto row : rows) {
+      if (row >= params_.row_count) {
+        LOG(ERROR) << "row: " << row << " is out of range: "
+                   << params_.row_count;
+        return retcode::FAIL;
+      }
+      uint64_t group = params_.GroupOf(row);
+      uint64_t target = group / SealPirParams::kPolyDegree;
+      for (uint64_t i = 0; i < params_.query_ciphertext_count; i++) {
+        seal::Plaintext plaintext(SealPirParams::kPolyDegree);
+        plaintext.set_zero();
+        if (i == target) {
+          // expansion multiplies by 2^logm, cancel it in advance
+          uint32_t logm =
+              SealPirParams::CeilLog2(params_.GroupsOfCiphertext(i));
+          uint64_t inverse{1};
+          for (uint32_t j = 0; j < logm; j++) {
+            inverse = inverse * ((t + 1) / 2) % t;
+          }
+          plaintext[group % SealPirParams::kPolyDegree] = inverse;
+        }
+        WriteSealObject(encryptor_->encrypt_symmetric(plaintext), &out);
+      }
+    }
+  } catch (std::exception& e) {
+    LOG(ERROR) << "create id pir query failed, " << e.what();
+    return retcode::FAIL;
+  }
+  *query = out.str();
+  return retcode::SUCCESS;
+}
+
+retcode SealPirClient::ExtractRows(const std::string& response,
+                                   const std::vector<uint64_t>& rows,
+                                   std::vector<std::string>* result) {
+  std::stringstream in(response);
+  result->clear();
+  try {
+    uint64_t row_num{0};
+    if (!ReadCount(&in, &row_num) || row_num != rows.size()) {
+      LOG(ERROR) << "id pir response mismatches query, rows: " << rows.size();
+      return retcode::FAIL;
+    }
+    std::string group_bytes;
+    seal::Ciphertext ct;
+    seal::Plaintext plaintext;
+    for (auto row : rows) {
+      group_bytes.assign(
+          params_.plaintexts_per_row * SealPirParams::kPolyDegree, '\0');
+      for (size_t w = 0; w < params_.plaintexts_per_row; w++) {
+        if (!ReadSealObject(*context_, &in, &ct)) {
+          LOG(ERROR) << "id pir response is truncated at row: " << row;
+          return retcode::FAIL;
+        }
+        if (decryptor_->invariant_noise_budget(ct) <= 0) {
+          LOG(ERROR) << "noise budget of id pir response is exhausted";
+          return retcode::FAIL;
+        }
+        decryptor_->decrypt(ct, plaintext);
+        size_t offset = w * SealPirParams::kPolyDegree;
+        for (size_t i = 0; i < plaintext.coeff_count(); i++) {
+          group_bytes[offset + i] = static_cast<char>(plaintext[i]);
+        }
+      }
+      uint64_t pos = (row % params_.rows_per_plaintext) * params_.row_bytes;
+      result->push_back(IdPirDatabase::TrimRow(
+          std::string_view(group_bytes).substr(pos, params_.row_bytes)));
+    }
+  } catch (std::exception& e) {
+    LOG(ERROR) << "extract id pir response failed, " << e.what();
+    return retcode::FAIL;
+  }
+  return retcode::SUCCESS;
+}
+}  // namespace primihub::pir
@@ -0,0 +1,131 @@
+/*
+* Copyright (c) 2023 by PrimiHub
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      https://www.apache.org/licenses/
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#ifndef SRC_PRIMIHUB_KERNEL_PIR_OPERATOR_ID_PIR_IMPL_SEAL_PIR_H_
+#define SRC_PRIMIHUB_KERNEL_PIR_OPERATOR_ID_PIR_IMPL_SEAL_PIR_H_
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "src/primihub/common/common.h"
+#include "src/primihub/kernel/pir/operator/id_pir_impl/id_pir_database.h"
+
+// SEAL
+#include "seal/seal.h"
+
+namespace primihub::pir {
+/**
+ * layout of database for seal pir.
+ * rows_per_plaintext consecutive rows make a group, bytes of group are
+ * coefficient-encoded one byte per coefficient into plaintexts_per_row
+ * plaintexts, the latter is larger than 1 only if a row is longer than
+ * a plaintext.
+*/
+struct SealPirParams {
+  SealPirParams(uint64_t row_count, uint64_t row_bytes);
+  /**
+   * bfv context shared by client and server
+  */
+  static std::unique_ptr<seal::SEALContext> CreateContext();
+  /**
+   * galois element which splits coefficients at level of query expansion
+  */
+  static uint32_t GaloisElt(uint32_t level) {
+    return static_cast<uint32_t>(kPolyDegree >> level) + 1;
+  }
+  static uint32_t CeilLog2(uint64_t value);
+  uint64_t GroupOf(uint64_t row) const {return row / rows_per_plaintext;}
+  /**
+   * number of groups selected by query ciphertext index
+  */
+  uint64_t GroupsOfCiphertext(uint64_t index) const;
+  uint64_t row_count{0};
+  uint64_t row_bytes{0};
+  uint64_t rows_per_plaintext{1};
+  uint64_t plaintexts_per_row{1};
+  uint64_t group_count{0};
+  uint64_t group_bytes{0};
+  // each ciphertext of query selects up to kPolyDegree groups
+  uint64_t query_ciphertext_count{0};
+  static constexpr size_t kPolyDegree = 4096;
+  // small plain modulus leaves noise budget for query expansion
+  // and plaintext multiplication of up to kPolyDegree groups
+  static constexpr uint64_t kPlainModulus = 65537;
+};
+
+/**
+ * single server pir on seal bfv, SealPIR of one dimension.
+ * query of group g is a ciphertext encrypting x^(g mod kPolyDegree)
+ * scaled by 2^-logm, server expands it by galois automorphisms into one
+ * ciphertext per group, the one of group g encrypts 1 and the others 0,
+ * answer is sum of products of these ciphertexts and plaintexts of
+ * groups, so server learns nothing about which row is queried.
+ * plaintexts are kept in ntt form after preprocessing, they take 16 times
+ * as much memory as the database.
+*/
+class SealPirServer {
+ public:
+  SealPirServer(const IdPirDatabase& db, size_t thread_num);
+  /**
+   * encode database into plaintexts in ntt form
+  */
+  retcode Preprocess();
+  /**
+   * answer all rows of query, format of query and response is
+   * number of rows, followed by length-prefixed items
+  */
+  retcode Answer(const std::string& query, std::string* response);
+
+ protected:
+  std::vector<seal::Ciphertext> Expand(const seal::Ciphertext& encrypted,
+                                       uint64_t m,
+                                       const seal::GaloisKeys& galois_keys);
+  void MultiplyPowerOfX(const seal::Ciphertext& encrypted, uint32_t index,
+                        seal::Ciphertext* destination);
+  retcode AnswerRow(const std::vector<seal::Ciphertext>& query,
+                    const seal::GaloisKeys& galois_keys,
+                    std::vector<seal::Ciphertext>* answer);
+
+ private:
+  const IdPirDatabase& db_;
+  SealPirParams params_;
+  size_t thread_num_{1};
+  std::unique_ptr<seal::SEALContext> context_{nullptr};
+  std::unique_ptr<seal::Evaluator> evaluator_{nullptr};
+  // group major, plaintexts_per_row plaintexts for each group
+  std::vector<seal::Plaintext> plaintexts_;
+};
+
+class SealPirClient {
+ public:
+  SealPirClient(uint64_t row_count, uint64_t row_bytes);
+  retcode CreateQuery(const std::vector<uint64_t>& rows, std::string* query);
+  /**
+   * result: row for each of rows of query, padding is removed
+  */
+  retcode ExtractRows(const std::string& response,
+                      const std::vector<uint64_t>& rows,
+                      std::vector<std::string>* result);
+
+ private:
+  SealPirParams params_;
+  std::unique_ptr<seal::SEALContext> context_{nullptr};
+  std::unique_ptr<seal::KeyGenerator> keygen_{nullptr};
+  std::unique_ptr<seal::Encryptor> encryptor_{nullptr};
+  std::unique_ptr<seal::Decryptor> decryptor_{nullptr};
+};
+}  // namespace primihub::pir
+#endif  // SRC_PRIMIHUB_KERNEL_PIR_OPERATOR_ID_PIR_IMPL_SEAL_PIR_H_
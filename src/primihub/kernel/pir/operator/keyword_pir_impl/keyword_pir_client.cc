@@ -17,11 +17,14 @@
 #include "src/primihub/kernel/pir/operator/keyword_pir_impl/keyword_pir_client.h"
 #include <fstream>
 #include <algorithm>
+#include <future>
 #include <unordered_map>
 
 #include "src/primihub/common/value_check_util.h"
 #include "src/primihub/util/util.h"
 #include "src/primihub/util/file_util.h"
+#include "src/primihub/util/endian_util.h"
+#include "src/primihub/util/ring_queue.h"
 #include "src/primihub/common/common.h"
 
 namespace primihub::pir {
@@ -45,16 +48,7 @@ retcode KeywordPirOperatorClient::OnExecute(const PirDataType& input,
     items_vec.emplace_back(std::move(item));
     orig_item_total.emplace_back(key);
   }
-  std::vector<HashedItem> oprf_items_total;
-  std::vector<LabelKey> label_keys_total;
-  VLOG(5) << "begin to Receiver::RequestOPRF";
-  ret = RequestOprf(items_vec, &oprf_items_total, &label_keys_total);
-  CHECK_RETCODE_WITH_RETVALUE(ret, retcode::FAIL);
-
-  CHECK_TASK_STOPPED(retcode::FAIL);
-  VLOG(5) << "Receiver::RequestOPRF end, begin to receiver.request_query";
 
-  this->receiver_ = std::make_unique<Receiver>(*psi_params_);
   size_t query_size = input.size();
   auto table_size = this->psi_params_->table_params().table_size;
   table_size = static_cast<size_t>(table_size * PirConstant::table_size_factor);
@@ -75,68 +69,59 @@ retcode KeywordPirOperatorClient::OnExecute(const PirDataType& input,
     LOG(INFO) << "block_item_info: " << block_item_info_str;
   }
 
-  int64_t start_index{0};
-  for (size_t i = 0; i < block_item_info.size(); i++) {
-    int64_t size_per_query = block_item_info[i];
-    if (i > 0) {
-      start_index += block_item_info[i-1];
-    }
-    LOG(INFO) << "start batch group: " << i << " "
-        << "start index: " << start_index << " "
-        << "group size: " << size_per_query;
-    std::vector<std::string> orig_item;
-    std::vector<HashedItem> oprf_items;
-    std::vector<LabelKey> label_keys;
-    orig_item.reserve(size_per_query);
-    oprf_items.reserve(size_per_query);
-    label_keys.reserve(size_per_query);
-    for (size_t j = 0; j < size_per_query; j++) {
-      size_t index = start_index + j;
-      orig_item.push_back(orig_item_total[index]);
-      oprf_items.push_back(oprf_items_total[index]);
-      label_keys.push_back(label_keys_total[index]);
-    }
-    // request query
-    std::vector<MatchRecord> query_result;
-    auto query = this->receiver_->create_query(oprf_items);
-    // chl.send(move(query.first));
-    auto request_query_data = std::move(query.first);
-    std::ostringstream string_ss;
-    request_query_data->save(string_ss);
-    std::string query_data_str = string_ss.str();
-    auto itt = move(query.second);
-    VLOG(5) << "query_data_str size: " << query_data_str.size();
-
-    ret = link_ctx->Send(this->key_, PeerNode(), query_data_str);
+  if (this->options_.pipeline_depth > 1) {
+    ret = PipelinedQuery(orig_item_total, items_vec, block_item_info, result);
     CHECK_RETCODE_WITH_RETVALUE(ret, retcode::FAIL);
-
-    // receive package count
-    uint32_t package_count = 0;
-    std::string pkg_count_key = this->PackageCountKey(link_ctx->request_id());
-    ret = link_ctx->Recv(pkg_count_key,
-                        this->PeerNode(),
-                        reinterpret_cast<char*>(&package_count),
-                        sizeof(package_count));
+  } else {
+    std::vector<HashedItem> oprf_items_total;
+    std::vector<LabelKey> label_keys_total;
+    VLOG(5) << "begin to Receiver::RequestOPRF";
+    ret = RequestOprf(items_vec, &oprf_items_total, &label_keys_total);
     CHECK_RETCODE_WITH_RETVALUE(ret, retcode::FAIL);
 
-    VLOG(5) << "received package count: " << package_count;
-    std::vector<apsi::ResultPart> result_packages;
-    for (size_t i = 0; i < package_count; i++) {
-      std::string recv_data;
-      ret = link_ctx->Recv(this->response_key_, this->PeerNode(), &recv_data);
+    CHECK_TASK_STOPPED(retcode::FAIL);
+    VLOG(5) << "Receiver::RequestOPRF end, begin to receiver.request_query";
+
+    this->receiver_ = std::make_unique<Receiver>(*psi_params_);
+    int64_t start_index{0};
+    for (size_t i = 0; i < block_item_info.size(); i++) {
+      int64_t size_per_query = block_item_info[i];
+      if (i > 0) {
+        start_index += block_item_info[i-1];
+      }
+      LOG(INFO) << "start batch group: " << i << " "
+          << "start index: " << start_index << " "
+          << "group size: " << size_per_query;
+      std::vector<std::string> orig_item;
+      std::vector<HashedItem> oprf_items;
+      std::vector<LabelKey> label_keys;
+      orig_item.reserve(size_per_query);
+      oprf_items.reserve(size_per_query);
+      label_keys.reserve(size_per_query);
+      for (size_t j = 0; j < size_per_query; j++) {
+        size_t index = start_index + j;
+        orig_item.push_back(orig_item_total[index]);
+        oprf_items.push_back(oprf_items_total[index]);
+        label_keys.push_back(label_keys_total[index]);
+      }
+      // request query
+      std::vector<MatchRecord> query_result;
+      auto query = this->receiver_->create_query(oprf_items);
+      // chl.send(move(query.first));
+      auto request_query_data = std::move(query.first);
+      std::ostringstream string_ss;
+      request_query_data->save(string_ss);
+      std::string query_data_str = string_ss.str();
+      auto itt = move(query.second);
+      VLOG(5) << "query_data_str size: " << query_data_str.size();
+
+      ret = link_ctx->Send(this->key_, PeerNode(), query_data_str);
+      CHECK_RETCODE_WITH_RETVALUE(ret, retcode::FAIL);
+      ret = RecvQueryResult(*(this->receiver_), itt, label_keys,
+                            &query_result);
       CHECK_RETCODE_WITH_RETVALUE(ret, retcode::FAIL);
-      VLOG(5) << "client received data length: " << recv_data.size();
-      std::istringstream stream_in(recv_data);
-      auto result_part = std::make_unique<apsi::network::ResultPackage>();
-      auto seal_context = this->receiver_->get_seal_context();
-      result_part->load(stream_in, seal_context);
-      result_packages.push_back(std::move(result_part));
+      ExtractResult(orig_item, query_result, result);
     }
-    query_result = this->receiver_->process_result(label_keys, itt,
-                                                  result_packages);
-    VLOG(5) << "query_resultquery_resultquery_resultquery_result: "
-            << query_result.size();
-    ExtractResult(orig_item, query_result, result);
   }
   {
     std::string task_end{"SUCCESS"};
@@ -147,6 +132,143 @@ retcode KeywordPirOperatorClient::OnExecute(const PirDataType& input,
   return retcode::SUCCESS;
 }
 
+retcode KeywordPirOperatorClient::RecvQueryResult(
+    const Receiver& receiver,
+    const apsi::receiver::IndexTranslationTable& itt,
+    const std::vector<LabelKey>& label_keys,
+    std::vector<MatchRecord>* query_result) {
+  // receive package count
+  auto link_ctx = this->GetLinkContext();
+  uint32_t package_count = 0;
+  std::string pkg_count_key = this->PackageCountKey(link_ctx->request_id());
+  auto ret = link_ctx->Recv(pkg_count_key,
+                            this->PeerNode(),
+                            reinterpret_cast<char*>(&package_count),
+                            sizeof(package_count));
+  CHECK_RETCODE_WITH_RETVALUE(ret, retcode::FAIL);
+
+  VLOG(5) << "received package count: " << package_count;
+  std::vector<apsi::ResultPart> result_packages;
+  auto seal_context = receiver.get_seal_context();
+  for (size_t i = 0; i < package_count; i++) {
+    std::string recv_data;
+    ret = link_ctx->Recv(this->response_key_, this->PeerNode(), &recv_data);
+    CHECK_RETCODE_WITH_RETVALUE(ret, retcode::FAIL);
+    VLOG(5) << "client received data length: " << recv_data.size();
+    std::istringstream stream_in(recv_data);
+    auto result_part = std::make_unique<apsi::network::ResultPackage>();
+    result_part->load(stream_in, seal_context);
+    result_packages.push_back(std::move(result_part));
+  }
+  *query_result = receiver.process_result(label_keys, itt, result_packages);
+  VLOG(5) << "query result size: " << query_result->size();
+  return retcode::SUCCESS;
+}
+
+retcode KeywordPirOperatorClient::PipelinedQuery(
+    const std::vector<std::string>& orig_items,
+    const std::vector<apsi::Item>& items,
+    const std::vector<int64_t>& block_item_info,
+    PirDataType* result) {
+  struct PendingBlock {
+    size_t slot{0};
+    int64_t start_index{0};
+    int64_t item_count{0};
+    apsi::receiver::IndexTranslationTable itt;
+    std::vector<LabelKey> label_keys;
+  };
+  size_t block_num = block_item_info.size();
+  size_t depth = std::min(this->options_.pipeline_depth, block_num);
+  depth = std::max<size_t>(depth, 1);
+  LOG(INFO) << "pipelined query, blocks: " << block_num << " "
+            << "pipeline depth: " << depth;
+  // server sizes its loop by number of queries,
+  // which it can not learn from the oprf of one block
+  auto link_ctx = this->GetLinkContext();
+  uint64_t be_query_count = htonll(items.size());
+  std::string_view query_count_sv{reinterpret_cast<char*>(&be_query_count),
+                                  sizeof(be_query_count)};
+  auto ret = link_ctx->Send(this->key_, PeerNode(), query_count_sv);
+  CHECK_RETCODE_WITH_RETVALUE(ret, retcode::FAIL);
+
+  std::vector<std::unique_ptr<Receiver>> receivers;
+  primihub::MpmcRingQueue<size_t> free_slots(depth);
+  for (size_t i = 0; i < depth; i++) {
+    receivers.push_back(std::make_unique<Receiver>(*psi_params_));
+    free_slots.push(i);
+  }
+  primihub::MpmcRingQueue<PendingBlock> pending_blocks(depth);
+  // oprf and query of a block are sent once a slot is free
+  auto request_fut = std::async(std::launch::async, [&]() -> retcode {
+    int64_t start_index{0};
+    for (size_t i = 0; i < block_num; i++) {
+      PendingBlock block;
+      if (free_slots.pop(&block.slot) != primihub::QueueStatus::kOk) {
+        return retcode::FAIL;
+      }
+      block.start_index = start_index;
+      block.item_count = block_item_info[i];
+      start_index += block.item_count;
+      std::vector<Item> block_items(
+          items.begin() + block.start_index,
+          items.begin() + block.start_index + block.item_count);
+      std::vector<HashedItem> oprf_items;
+      auto ret = RequestOprf(block_items, PirConstant::oprf_key,
+                             PirConstant::oprf_response_key,
+                             &oprf_items, &block.label_keys);
+      if (ret != retcode::SUCCESS) {
+        LOG(ERROR) << "request oprf of block: " << i << " failed";
+        pending_blocks.shutdown();
+        return ret;
+      }
+      auto query = receivers[block.slot]->create_query(oprf_items);
+      std::ostringstream string_ss;
+      query.first->save(string_ss);
+      block.itt = std::move(query.second);
+      ret = link_ctx->Send(this->key_, PeerNode(), string_ss.str());
+      if (ret != retcode::SUCCESS) {
+        LOG(ERROR) << "send query of block: " << i << " failed";
+        pending_blocks.shutdown();
+        return ret;
+      }
+      VLOG(5) << "sent query of block: " << i << " "
+              << "slot: " << block.slot;
+      pending_blocks.push(std::move(block));
+    }
+    return retcode::SUCCESS;
+  });
+
+  ret = retcode::SUCCESS;
+  for (size_t i = 0; i < block_num; i++) {
+    PendingBlock block;
+    if (has_stopped() ||
+        pending_blocks.pop(&block) != primihub::QueueStatus::kOk) {
+      ret = retcode::FAIL;
+      break;
+    }
+    std::vector<MatchRecord> query_result;
+    ret = RecvQueryResult(*receivers[block.slot], block.itt,
+                          block.label_keys, &query_result);
+    if (ret != retcode::SUCCESS) {
+      LOG(ERROR) << "receive result of block: " << i << " failed";
+      break;
+    }
+    std::vector<std::string> orig_item(
+        orig_items.begin() + block.start_index,
+        orig_items.begin() + block.start_index + block.item_count);
+    ExtractResult(orig_item, query_result, result);
+    free_slots.push(block.slot);
+  }
+  if (ret != retcode::SUCCESS) {
+    free_slots.shutdown();
+  }
+  auto request_ret = request_fut.get();
+  if (ret != retcode::SUCCESS || request_ret != retcode::SUCCESS) {
+    return retcode::FAIL;
+  }
+  return retcode::SUCCESS;
+}
+
 // ------------------------Receiver----------------------------
 retcode KeywordPirOperatorClient::RequestPSIParams() {
   CHECK_TASK_STOPPED(retcode::FAIL);
@@ -185,11 +307,20 @@ retcode KeywordPirOperatorClient::RequestPSIParams() {
 retcode KeywordPirOperatorClient::RequestOprf(const std::vector<Item>& items,
     std::vector<apsi::HashedItem>* res_items_ptr,
     std::vector<apsi::LabelKey>* res_label_keys_ptr) {
+  return RequestOprf(items, this->key_, this->response_key_,
+                     res_items_ptr, res_label_keys_ptr);
+}
+
+retcode KeywordPirOperatorClient::RequestOprf(const std::vector<Item>& items,
+    const std::string& request_key,
+    const std::string& response_key,
+    std::vector<apsi::HashedItem>* res_items_ptr,
+    std::vector<apsi::LabelKey>* res_label_keys_ptr) {
   CHECK_TASK_STOPPED(retcode::FAIL);
 
   RequestType type = RequestType::Oprf;
   std::string oprf_response;
-  auto oprf_receiver = this->receiver_->CreateOPRFReceiver(items);
+  auto oprf_receiver = Receiver::CreateOPRFReceiver(items);
   auto& res_items = *res_items_ptr;
   auto& res_label_keys = *res_label_keys_ptr;
   res_items.resize(oprf_receiver.item_count());
@@ -201,13 +332,13 @@ retcode KeywordPirOperatorClient::RequestOprf(const std::vector<Item>& items,
       oprf_request.size()};
   auto link_ctx = this->GetLinkContext();
   CHECK_NULLPOINTER_WITH_ERROR_MSG(link_ctx, "LinkContext is empty");
-  auto ret = link_ctx->Send(this->key_, PeerNode(), oprf_request_sv);
+  auto ret = link_ctx->Send(request_key, PeerNode(), oprf_request_sv);
   if (ret != retcode::SUCCESS) {
     LOG(ERROR) << "requestOprf to peer: [" << PeerNode().to_string()
         << "] failed";
     return ret;
   }
-  ret = link_ctx->Recv(this->response_key_, this->PeerNode(), &oprf_response);
+  ret = link_ctx->Recv(response_key, this->PeerNode(), &oprf_response);
   if (ret != retcode::SUCCESS || oprf_response.empty()) {
     LOG(ERROR) << "receive oprf_response from peer: ["
                << PeerNode().to_string() << "] failed";
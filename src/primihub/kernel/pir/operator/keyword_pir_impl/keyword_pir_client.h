@@ -72,6 +72,11 @@ class KeywordPirOperatorClient : public BasePirOperator {
   */
   retcode RequestOprf(const std::vector<Item>& items,
         std::vector<apsi::HashedItem>*, std::vector<apsi::LabelKey>*);
+  retcode RequestOprf(const std::vector<Item>& items,
+                      const std::string& request_key,
+                      const std::string& response_key,
+                      std::vector<apsi::HashedItem>* res_items,
+                      std::vector<apsi::LabelKey>* res_label_keys);
   /**
   * Performs a labeled PSI query. The query is a vector of items,
   * and the result is a same-size vector of MatchRecord objects.
@@ -81,6 +86,23 @@ class KeywordPirOperatorClient : public BasePirOperator {
   * label if a sender's data included it.
   */
   retcode RequestQuery();
+  /**
+   * receive result packages of one query block and decrypt them
+   * by the receiver which created the query
+  */
+  retcode RecvQueryResult(const apsi::receiver::Receiver& receiver,
+      const apsi::receiver::IndexTranslationTable& itt,
+      const std::vector<apsi::LabelKey>& label_keys,
+      std::vector<apsi::receiver::MatchRecord>* query_result);
+  /**
+   * up to pipeline_depth blocks are in flight, oprf and query encryption
+   * of following blocks run while server processes a block and
+   * its result is decrypted, each slot of pipeline has its own receiver
+  */
+  retcode PipelinedQuery(const std::vector<std::string>& orig_items,
+                         const std::vector<apsi::Item>& items,
+                         const std::vector<int64_t>& block_item_info,
+                         PirDataType* result);
   retcode ExtractResult(const std::vector<std::string>& orig_vec,
       const std::vector<apsi::receiver::MatchRecord>& query_result,
       PirDataType* result);
@@ -24,6 +24,10 @@ enum class RequestType : uint8_t {
 };
 struct PirConstant {
   inline static double table_size_factor{0.9};
+  // oprf of pipelined query is exchanged on its own keys,
+  // so it is not queued behind query of previous blocks
+  inline static constexpr char oprf_key[] = "pir_oprf_key";
+  inline static constexpr char oprf_response_key[] = "response_pir_oprf_key";
 };
 }
 #endif  // SRC_PRIMIHUB_KERNEL_PIR_OPERATOR_KEYWORD_PIR_IMPL_KEYWORD_PIR_COMMON_H_
@@ -15,16 +15,41 @@
 */
 
 #include "src/primihub/kernel/pir/operator/keyword_pir_impl/keyword_pir_server.h"
+#include "src/primihub/kernel/pir/operator/keyword_pir_impl/keyword_pir_serving.h"
+#include <sys/stat.h>
+#include <unistd.h>
 #include <fstream>
 #include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
 #include <unordered_map>
 
 #include "src/primihub/common/value_check_util.h"
 #include "src/primihub/util/util.h"
 #include "src/primihub/util/file_util.h"
+#include "src/primihub/util/ring_queue.h"
+#include "src/primihub/util/bounded_executor.h"
+#include "src/primihub/util/endian_util.h"
+#include "src/primihub/util/mapped_file.h"
+#include "src/primihub/util/resident_registry.h"
 #include "src/primihub/common/common.h"
 
 namespace primihub::pir {
+namespace {
+constexpr size_t kResultPackageQueueSize = 64;
+// layout of db cache: | magic(8) | be64 size of SenderDB | SenderDB |
+// cache written by older version is a bare SenderDB
+constexpr char kDbCacheMagic[] = "PHSDBC01";
+constexpr size_t kDbCacheMagicSize = sizeof(kDbCacheMagic) - 1;
+constexpr size_t kDbCacheHeaderSize = kDbCacheMagicSize + sizeof(uint64_t);
+}  // namespace
 using Sender = apsi::sender::Sender;
 using OPRFKey = apsi::oprf::OPRFKey;
 using SenderDB = apsi::sender::SenderDB;
@@ -34,15 +59,134 @@ using CiphertextPowers = apsi::sender::CiphertextPowers;
 using PowersDag = apsi::PowersDag;
 using PSIParams = apsi::PSIParams;
 
+namespace {
+using SenderDbRegistry = ResidentRegistry<SenderDB>;
+
+std::shared_ptr<SenderDB> LoadSenderDb(const std::string& db_file_cache) {
+  SCopedTimer timer;
+  // deserialize from the shared page cache instead of copying
+  // the file through stream buffers
+  auto mapped_file = MappedFile::Open(db_file_cache);
+  if (mapped_file == nullptr) {
+    return nullptr;
+  }
+  auto db_data = mapped_file->view();
+  if (db_data.substr(0, kDbCacheMagicSize) == kDbCacheMagic) {
+    uint64_t be_size{0};
+    if (db_data.size() >= kDbCacheHeaderSize) {
+      memcpy(&be_size, db_data.data() + kDbCacheMagicSize, sizeof(be_size));
+    }
+    if (db_data.size() < kDbCacheHeaderSize ||
+        ntohll(be_size) != db_data.size() - kDbCacheHeaderSize) {
+      LOG(ERROR) << "db cache: " << db_file_cache << " is truncated";
+      return nullptr;
+    }
+    db_data.remove_prefix(kDbCacheHeaderSize);
+  }
+  mapped_file->Advise(MappedFile::Advice::SEQUENTIAL);
+  MemoryStreamBuf stream_buf(db_data);
+  std::istream fin(&stream_buf);
+  std::shared_ptr<SenderDB> sender_db{nullptr};
+  try {
+    auto db_info = SenderDB::Load(fin);
+    sender_db = std::make_shared<SenderDB>(std::move(std::get<0>(db_info)));
+    VLOG(0) << "load data from cache file, db_size: " << std::get<1>(db_info);
+  } catch (std::exception& e) {
+    LOG(ERROR) << "load db cache: " << db_file_cache << " failed, " << e.what();
+    return nullptr;
+  }
+  auto time_cost = timer.timeElapse();
+  VLOG(5) << "LoadDbFromCache cost time(ms): " << time_cost;
+  return sender_db;
+}
+
+SenderDbRegistry& ResidentDbRegistry() {
+  // key of resident db is "path#identity"
+  static SenderDbRegistry registry([](const std::string& key) {
+    return LoadSenderDb(key.substr(0, key.rfind('#')));
+  });
+  return registry;
+}
+
+/**
+ * resident db is keyed by path and identity of its cache file,
+ * cache rebuilt by DbInfo task gets a new key,
+ * and the stale db of the same path is dropped
+*/
+std::string ResidentDbKey(const std::string& db_path) {
+  static std::mutex mtx;
+  static std::map<std::string, std::string> current_keys;
+  std::string key = db_path + "#";
+  struct stat st;
+  if (::stat(db_path.c_str(), &st) == 0) {
+    key.append(std::to_string(st.st_ino)).append(":")
+       .append(std::to_string(st.st_mtim.tv_sec)).append(".")
+       .append(std::to_string(st.st_mtim.tv_nsec)).append(":")
+       .append(std::to_string(st.st_size));
+  }
+  std::string stale_key;
+  {
+    std::lock_guard<std::mutex> lck(mtx);
+    auto& current_key = current_keys[db_path];
+    if (current_key != key) {
+      stale_key.swap(current_key);
+      current_key = key;
+    }
+  }
+  if (!stale_key.empty()) {
+    LOG(INFO) << "db cache: " << db_path << " is rebuilt, "
+              << "drop stale resident db";
+    ResidentDbRegistry().Drop(stale_key);
+  }
+  return key;
+}
+}  // namespace
+
+void ConfigureResidentDb(uint64_t max_memory_bytes,
+                         uint32_t max_sessions_per_db,
+                         int32_t admission_timeout_ms) {
+  SenderDbRegistry::Options options;
+  options.max_memory_bytes = max_memory_bytes;
+  options.max_sessions = max_sessions_per_db;
+  options.admission_timeout_ms = admission_timeout_ms;
+  ResidentDbRegistry().Configure(options);
+  LOG(INFO) << "resident keyword pir db, "
+            << "max memory bytes: " << max_memory_bytes << " "
+            << "max sessions per db: " << max_sessions_per_db << " "
+            << "admission timeout(ms): " << admission_timeout_ms;
+}
+
+retcode PreloadResidentDb(const std::vector<std::string>& db_paths) {
+  auto ret{retcode::SUCCESS};
+  for (const auto& db_path : db_paths) {
+    if (!ResidentDbRegistry().Preload(ResidentDbKey(db_path),
+                                      FileSize(db_path))) {
+      LOG(ERROR) << "preload keyword pir db: " << db_path << " failed";
+      ret = retcode::FAIL;
+      continue;
+    }
+    LOG(INFO) << "preload keyword pir db: " << db_path;
+  }
+  return ret;
+}
+
 retcode KeywordPirOperatorServer::OnExecute(const PirDataType& input,
                                             PirDataType* result) {
   VLOG(0) << "enter KeywordPirOperator  OPRFKey ctr";
   this->oprf_key_ = std::make_unique<apsi::oprf::OPRFKey>();
   VLOG(0) << "exit enter KeywordPirOperator OPRFKey ctr";
-  size_t cpu_core_num = std::thread::hardware_concurrency();
-  size_t use_core_num = cpu_core_num / 2;
-  LOG(INFO) << "ThreadPoolMgr thread count: " << use_core_num;
-  ThreadPoolMgr::SetThreadCount(use_core_num);
+  // query processing of this task never uses more threads than its budget,
+  // so concurrent tasks on one node share cpu predictably
+  query_thread_num_ = this->options_.query_thread_num;
+  if (query_thread_num_ == 0) {
+    query_thread_num_ = BoundedExecutor::DefaultThreadNum();
+  }
+  // pool of apsi is global to the process, task with resident db runs
+  // in node process along with other tasks and leaves it untouched
+  if (!this->options_.resident_db) {
+    LOG(INFO) << "ThreadPoolMgr thread count: " << query_thread_num_;
+    ThreadPoolMgr::SetThreadCount(query_thread_num_);
+  }
   int64_t client_data_size{0};
 
   auto params = SetPsiParams();
@@ -60,12 +204,33 @@ retcode KeywordPirOperatorServer::OnExecute(const PirDataType& input,
     return retcode::SUCCESS;
   }
 
-  auto ret = ProcessPSIParams();
-  CHECK_RETCODE_WITH_RETVALUE(ret, retcode::FAIL);
+  retcode ret{retcode::SUCCESS};
   std::shared_ptr<SenderDB> sender_db{nullptr};
-  if (DbCacheAvailable(this->options_.db_path)) {
-    sender_db = LoadDbFromCache(this->options_.db_path);
+  // keeps resident db and its admission slot until the task ends
+  std::unique_ptr<SenderDbRegistry::Session> db_session{nullptr};
+  const auto& db_path = this->options_.db_path;
+  if (DbCacheAvailable(db_path)) {
+    // cache is loaded while params are exchanged with client
+    auto load_fut = std::async(std::launch::async, [&]() {
+      if (!this->options_.resident_db) {
+        return LoadDbFromCache(db_path);
+      }
+      SCopedTimer timer;
+      db_session = ResidentDbRegistry().Acquire(ResidentDbKey(db_path),
+                                                FileSize(db_path));
+      if (db_session == nullptr) {
+        return std::shared_ptr<SenderDB>(nullptr);
+      }
+      *(this->oprf_key_) = db_session->object()->get_oprf_key();
+      VLOG(5) << "acquire resident db cost time(ms): " << timer.timeElapse();
+      return db_session->object();
+    });
+    ret = ProcessPSIParams();
+    sender_db = load_fut.get();
+    CHECK_RETCODE_WITH_RETVALUE(ret, retcode::FAIL);
   } else {
+    ret = ProcessPSIParams();
+    CHECK_RETCODE_WITH_RETVALUE(ret, retcode::FAIL);
     // std::unique_ptr<DBData>
     auto db_data = CreateDb(input);
     CHECK_NULLPOINTER(db_data, retcode::FAIL);
@@ -82,22 +247,20 @@ retcode KeywordPirOperatorServer::OnExecute(const PirDataType& input,
         std::max<uint32_t>(max_bin_bundles_per_bundle_idx,
                            sender_db->get_bin_bundle_count(bundle_idx));
   }
-  ret = ProcessOprf();
-  CHECK_RETCODE_WITH_RETVALUE(ret, retcode::FAIL);
-  auto table_size = static_cast<size_t>(this->table_size_ * PirConstant::table_size_factor);
-  auto block_size = this->query_data_size_ / table_size;
-  auto rem_size = this->query_data_size_ % table_size;
-  if (rem_size != 0) {
-    block_size++;
-  }
-  LOG(INFO) << "size of loop: " << block_size << " "
-      << "query_data_size: " << query_data_size_ << " "
-      << "table size: " << table_size;
-  for (size_t i = 0 ; i < block_size; i++) {
-    LOG(INFO) << "current loop: " << i << " total: " << block_size;
-    ret = ProcessQuery(sender_db);
+  if (this->options_.pipeline_depth > 1) {
+    ret = ProcessPipelinedQuery(sender_db);
+    CHECK_RETCODE_WITH_RETVALUE(ret, retcode::FAIL);
+  } else {
+    ret = ProcessOprf(this->key_, this->response_key_,
+                      &this->query_data_size_);
     CHECK_RETCODE_WITH_RETVALUE(ret, retcode::FAIL);
-    LOG(INFO) << "end of process loop: " << i;
+    auto block_size = BlockCount(this->query_data_size_);
+    for (size_t i = 0 ; i < block_size; i++) {
+      LOG(INFO) << "current loop: " << i << " total: " << block_size;
+      ret = ProcessQuery(sender_db);
+      CHECK_RETCODE_WITH_RETVALUE(ret, retcode::FAIL);
+      LOG(INFO) << "end of process loop: " << i;
+    }
   }
 
   {
@@ -122,10 +285,33 @@ retcode KeywordPirOperatorServer::CreateDbDataCache(const DBData& db_data,
     LOG(ERROR) << "create sender db failed";
     return retcode::FAIL;
   }
-  std::fstream fout(this->options_.db_path, std::ios::out);
-  size_t save_size = sender_db->save(fout);
-  VLOG(0) << "save_size: " << save_size
-          << " db path: " << this->options_.db_path;
+  // online task never maps a partial cache
+  const auto& db_path = this->options_.db_path;
+  auto tmp_path = db_path + ".tmp." + std::to_string(::getpid()) + "_" +
+      std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id()));
+  size_t save_size{0};
+  {
+    std::ofstream fout(tmp_path, std::ios::binary | std::ios::trunc);
+    uint64_t be_size{0};
+    fout.write(kDbCacheMagic, kDbCacheMagicSize);
+    fout.write(reinterpret_cast<char*>(&be_size), sizeof(be_size));
+    save_size = sender_db->save(fout);
+    be_size = htonll(save_size);
+    fout.seekp(kDbCacheMagicSize);
+    fout.write(reinterpret_cast<char*>(&be_size), sizeof(be_size));
+    if (!fout.good()) {
+      LOG(ERROR) << "write db cache: " << tmp_path << " failed";
+      fout.close();
+      RemoveFile(tmp_path);
+      return retcode::FAIL;
+    }
+  }
+  if (std::rename(tmp_path.c_str(), db_path.c_str()) != 0) {
+    LOG(ERROR) << "rename db cache to: " << db_path << " failed";
+    RemoveFile(tmp_path);
+    return retcode::FAIL;
+  }
+  VLOG(0) << "save_size: " << save_size << " db path: " << db_path;
   return retcode::SUCCESS;
 }
 
@@ -231,12 +417,70 @@ retcode KeywordPirOperatorServer::ProcessPSIParams() {
   return retcode::SUCCESS;
 }
 
-retcode KeywordPirOperatorServer::ProcessOprf() {
+size_t KeywordPirOperatorServer::BlockCount(int64_t query_data_size) {
+  auto table_size = static_cast<size_t>(
+      this->table_size_ * PirConstant::table_size_factor);
+  auto block_size = query_data_size / table_size;
+  auto rem_size = query_data_size % table_size;
+  if (rem_size != 0) {
+    block_size++;
+  }
+  LOG(INFO) << "size of loop: " << block_size << " "
+      << "query_data_size: " << query_data_size << " "
+      << "table size: " << table_size;
+  return block_size;
+}
+
+retcode KeywordPirOperatorServer::ProcessPipelinedQuery(
+    std::shared_ptr<SenderDB> sender_db) {
+  // number of queries is sent ahead of blocks
+  std::string query_count_str;
+  auto link_ctx = this->GetLinkContext();
+  auto ret = link_ctx->Recv(this->key_, ProxyNode(), &query_count_str);
+  if (ret != retcode::SUCCESS || query_count_str.size() != sizeof(uint64_t)) {
+    LOG(ERROR) << "receive query count from client failed";
+    return retcode::FAIL;
+  }
+  uint64_t be_query_count{0};
+  memcpy(&be_query_count, query_count_str.data(), sizeof(be_query_count));
+  this->query_data_size_ = ntohll(be_query_count);
+  auto block_size = BlockCount(this->query_data_size_);
+  // oprf of following blocks is answered while a block is processed
+  auto oprf_fut = std::async(std::launch::async, [&]() -> retcode {
+    for (size_t i = 0; i < block_size; i++) {
+      int64_t item_count{0};
+      auto ret = ProcessOprf(PirConstant::oprf_key,
+                             PirConstant::oprf_response_key, &item_count);
+      if (ret != retcode::SUCCESS) {
+        LOG(ERROR) << "process oprf of block: " << i << " failed";
+        return retcode::FAIL;
+      }
+    }
+    return retcode::SUCCESS;
+  });
+  for (size_t i = 0; i < block_size; i++) {
+    LOG(INFO) << "current pipelined block: " << i << " total: " << block_size;
+    ret = ProcessQuery(sender_db);
+    if (ret != retcode::SUCCESS) {
+      LOG(ERROR) << "process query of block: " << i << " failed";
+      break;
+    }
+  }
+  auto oprf_ret = oprf_fut.get();
+  if (ret != retcode::SUCCESS || oprf_ret != retcode::SUCCESS) {
+    return retcode::FAIL;
+  }
+  return retcode::SUCCESS;
+}
+
+retcode KeywordPirOperatorServer::ProcessOprf(const std::string& request_key,
+                                              const std::string& response_key,
+                                              int64_t* item_count) {
   CHECK_TASK_STOPPED(retcode::FAIL);
   VLOG(5) << "begin to process oprf";
   std::string oprf_request_str;
   auto link_ctx = this->GetLinkContext();
-  auto ret = link_ctx->Recv(this->key_, this->ProxyNode(), &oprf_request_str);
+  auto ret = link_ctx->Recv(request_key, this->ProxyNode(), &oprf_request_str);
   if (ret != retcode::SUCCESS || oprf_request_str.empty()) {
     LOG(ERROR) << "received oprf request from client failed ";
     return ret;
@@ -246,14 +490,14 @@ retcode KeywordPirOperatorServer::ProcessOprf() {
   // // OPRFKey key_oprf;
   auto oprf_response =
       OPRFSender::ProcessQueries(oprf_request_str, *(this->oprf_key_));
-  this->query_data_size_ = oprf_request_str.size() / apsi::oprf::oprf_query_size;
+  *item_count = oprf_request_str.size() / apsi::oprf::oprf_query_size;
   std::string oprf_response_str{
       reinterpret_cast<char*>(const_cast<unsigned char*>(oprf_response.data())),
       oprf_response.size()};
-  VLOG(5) << "qeury size from client: " << query_data_size_;
+  VLOG(5) << "qeury size from client: " << *item_count;
   // VLOG(5) << "send data size: " << oprf_response_str.size() << " "
   //         << "data content: " << oprf_response_str;
-  return link_ctx->Send(this->response_key_, ProxyNode(), oprf_response_str);
+  return link_ctx->Send(response_key, ProxyNode(), oprf_response_str);
 }
 
 retcode KeywordPirOperatorServer::ProcessQuery(
@@ -376,15 +620,63 @@ retcode KeywordPirOperatorServer::ProcessQuery(
 
   VLOG(5) << "Finished computing powers for all bundle indices";
   VLOG(5) << "Start processing bin bundle caches";
-  primihub::ThreadSafeQueue<std::string> result_package_queue;
+  // bounded, so serialized packages waiting for the sender hold
+  // limited memory; closed once all producers are done
+  primihub::MpmcRingQueue<std::string> result_package_queue(
+      kResultPackageQueueSize);
+  std::atomic<size_t> pending_producers{0};
+  for (uint32_t bundle_idx = 0; bundle_idx < bundle_idx_count; bundle_idx++) {
+    pending_producers += sender_db->get_cache_at(bundle_idx).size();
+  }
+  if (pending_producers.load() == 0) {
+    result_package_queue.shutdown();
+  }
+  // sender starts first, producers blocked by a full queue
+  // must never wait for the executor to accept more tasks
+  auto send_fut = std::async(
+      std::launch::async,
+      [&, this]() -> retcode {
+        auto link_ctx = this->GetLinkContext();
+        VLOG(5) << "package_count: " << package_count;
+        for (size_t i = 0; i < package_count; i++) {
+          std::string send_data;
+          auto status = result_package_queue.pop(&send_data);
+          if (status != primihub::QueueStatus::kOk) {
+            LOG(ERROR) << "result package is not available, index: " << i
+                       << " expected count: " << package_count;
+            return retcode::FAIL;
+          }
+          auto ret = link_ctx->Send(this->response_key_, ProxyNode(), send_data);
+          if (ret != retcode::SUCCESS) {
+            LOG(ERROR) << "send result to client, index: " << i
+                << " data length: " << send_data.size() << " failed";
+            // unblock producers waiting for free slots
+            result_package_queue.shutdown();
+            return retcode::FAIL;
+          }
+          VLOG(5) << "send result to client, index: " << i
+                  << " data length: " << send_data.size();
+        }
+        return retcode::SUCCESS;
+      });
+  std::atomic<bool> produce_failed{false};
   std::vector<future<void>> futures;
+  // bin bundle caches run on a pool bounded by the cpu budget of the task
+  // instead of one thread per cache
+  BoundedExecutor executor(query_thread_num_, 0,
+                           this->options_.numa_node);
   for (uint32_t bundle_idx = 0; bundle_idx < bundle_idx_count; bundle_idx++) {
     auto bundle_caches = sender_db->get_cache_at(bundle_idx);
     for (auto &cache : bundle_caches) {
       futures.push_back(
-        std::async(
-          std::launch::async,
+        executor.Submit(
           [&, bundle_idx, cache, this]() -> void {
+            // the last producer closes the queue even if it fails
+            std::shared_ptr<void> producer_guard(nullptr, [&](void*) {
+              if (pending_producers.fetch_sub(1) == 1) {
+                result_package_queue.shutdown();
+              }
+            });
             auto result_package =
                 ProcessBinBundleCache(sender_db,
                                       crypto_context,
@@ -394,6 +686,9 @@ retcode KeywordPirOperatorServer::ProcessQuery(
                                       compr_mode,
                                       pool);
             if (result_package == nullptr) {
+              LOG(ERROR) << "process bin bundle cache failed, "
+                         << "bundle: " << bundle_idx;
+              produce_failed.store(true);
               return;
             }
             // serialize and push into result package queue
@@ -401,7 +696,14 @@ retcode KeywordPirOperatorServer::ProcessQuery(
             result_package->save(string_ss);
             std::string result_package_str = string_ss.str();
             size_t data_len = result_package_str.length();
-            result_package_queue.push(std::move(result_package_str));
+            auto status =
+                result_package_queue.push(std::move(result_package_str));
+            if (status != primihub::QueueStatus::kOk) {
+              LOG(WARNING) << "result package queue is closed, "
+                           << "drop package of bundle: " << bundle_idx;
+              produce_failed.store(true);
+              return;
+            }
             VLOG(5) << "push data into result package queue, "
                     << "data length: " << data_len
                     << " label_result size: "
@@ -409,32 +711,20 @@ retcode KeywordPirOperatorServer::ProcessQuery(
           }));
     }
   }
-
-  futures.push_back(
-    std::async(
-      std::launch::async,
-      [&, this]() -> void {
-        auto link_ctx = this->GetLinkContext();
-        VLOG(5) << "package_count: " << package_count;
-        for (size_t i = 0; i < package_count; i++) {
-          std::string send_data;
-          result_package_queue.wait_and_pop(send_data);
-          auto ret = link_ctx->Send(this->response_key_, ProxyNode(), send_data);
-          if (ret != retcode::SUCCESS) {
-            LOG(ERROR) << "send result to client, index: " << i
-                << " data length: " << send_data.size() << " failed";
-            return;
-          }
-          VLOG(5) << "send result to client, index: " << i
-                  << " data length: " << send_data.size();
-        }
-      }));
   // Wait until all bin bundle caches have been processed
   for (auto& f : futures) {
     f.get();
   }
+  auto send_ret = send_fut.get();
+  LOG(INFO) << "query executor " << executor.StatsString();
   // link_ctx->CheckSendCompleteStatus(this->response_key_,
   //                                   ProxyNode(), package_count);
+  if (produce_failed.load() || send_ret != retcode::SUCCESS) {
+    LOG(ERROR) << "process query request failed, "
+               << "produce failed: " << produce_failed.load() << " "
+               << "send ret: " << static_cast<int>(send_ret);
+    return retcode::FAIL;
+  }
   VLOG(5) << "Finished processing query request";
   return retcode::SUCCESS;
 }
@@ -632,14 +922,10 @@ bool KeywordPirOperatorServer::DbCacheAvailable(const std::string& db_path) {
 
 std::shared_ptr<apsi::sender::SenderDB>
 KeywordPirOperatorServer::LoadDbFromCache(const std::string& db_file_cache) {
-  SCopedTimer timer;
-  std::fstream fin(db_file_cache, std::ios::in);
-  auto db_info = SenderDB::Load(fin);
-  auto sender_db = std::make_shared<SenderDB>(std::move(std::get<0>(db_info)));
-  VLOG(0) << "load data from cache file, db_size: " << std::get<1>(db_info);
-  *(this->oprf_key_) = sender_db->get_oprf_key();
-  auto time_cost = timer.timeElapse();
-  VLOG(5) << "LoadDbFromCache cost time(ms): " << time_cost;
+  auto sender_db = LoadSenderDb(db_file_cache);
+  if (sender_db != nullptr) {
+    *(this->oprf_key_) = sender_db->get_oprf_key();
+  }
   return sender_db;
 }
 
@@ -73,7 +73,20 @@ class KeywordPirOperatorServer : public BasePirOperator {
   /**
     process an OPRF query request to the Sender.
   */
-  retcode ProcessOprf();
+  retcode ProcessOprf(const std::string& request_key,
+                      const std::string& response_key,
+                      int64_t* item_count);
+  /**
+   * number of query blocks, each block fills at most
+   * table_size_factor of the table
+  */
+  size_t BlockCount(int64_t query_data_size);
+  /**
+   * oprf of blocks is answered on its own keys beside query processing,
+   * client keeps following blocks in flight
+  */
+  retcode ProcessPipelinedQuery(
+      std::shared_ptr<apsi::sender::SenderDB> sender_db);
   /**
     process a Query request to the Sender.
   */
@@ -117,6 +130,7 @@ class KeywordPirOperatorServer : public BasePirOperator {
   int64_t query_data_size_;
   int64_t table_size_;
   std::string psi_params_str_;
+  size_t query_thread_num_{1};
   std::unique_ptr<apsi::oprf::OPRFKey> oprf_key_{nullptr};
   std::unique_ptr<apsi::PSIParams> psi_params_{nullptr};
 };
@@ -0,0 +1,40 @@
+/*
+* Copyright (c) 2023 by PrimiHub
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      https://www.apache.org/licenses/
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#ifndef SRC_PRIMIHUB_KERNEL_PIR_OPERATOR_KEYWORD_PIR_IMPL_KEYWORD_PIR_SERVING_H_
+#define SRC_PRIMIHUB_KERNEL_PIR_OPERATOR_KEYWORD_PIR_IMPL_KEYWORD_PIR_SERVING_H_
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "src/primihub/common/common.h"
+
+namespace primihub::pir {
+/**
+ * keyword pir server tasks running in node process share sender dbs
+ * loaded from db cache, a db stays resident across tasks so a query
+ * only pays for oprf and query processing.
+ * memory of resident dbs is estimated by size of db cache.
+*/
+void ConfigureResidentDb(uint64_t max_memory_bytes,
+                         uint32_t max_sessions_per_db,
+                         int32_t admission_timeout_ms);
+/**
+ * load db caches ahead of queries, a cache failed to load is skipped
+*/
+retcode PreloadResidentDb(const std::vector<std::string>& db_paths);
+}  // namespace primihub::pir
+#endif  // SRC_PRIMIHUB_KERNEL_PIR_OPERATOR_KEYWORD_PIR_IMPL_KEYWORD_PIR_SERVING_H_
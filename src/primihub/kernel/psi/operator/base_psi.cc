@@ -15,9 +15,14 @@
  */
 
 #include "src/primihub/kernel/psi/operator/base_psi.h"
+#include <algorithm>
 #include <utility>
 #include <future>
 
+#include "src/primihub/kernel/psi/operator/key_hasher.h"
+#include "src/primihub/kernel/psi/operator/result_codec.h"
+#include "src/primihub/kernel/psi/util.h"
+#include "src/primihub/common/value_check_util.h"
 #include "src/primihub/util/endian_util.h"
 #include "src/primihub/util/util.h"
 
@@ -30,17 +35,53 @@ retcode BasePsiOperator::Execute(const std::vector<std::string>& input,
     LOG(ERROR) << "Execute PSI failed";
     return retcode::FAIL;
   }
+  if (sync_result) {
+    own_input_ = &input;
+    ret = SyncResult(result);
+    own_input_ = nullptr;
+  }
+  return ret;
+}
+
+retcode BasePsiOperator::Execute(
+    const std::shared_ptr<arrow::Table>& key_table,
+    bool sync_result,
+    std::vector<std::string>* result) {
+  auto ret = this->OnExecuteKeyTable(key_table, result);
+  if (ret != retcode::SUCCESS) {
+    LOG(ERROR) << "Execute PSI failed";
+    return retcode::FAIL;
+  }
+  if (sync_result) {
+    own_key_table_ = key_table;
+    ret = SyncResult(result);
+    own_key_table_ = nullptr;
+  }
+  return ret;
+}
+
+retcode BasePsiOperator::OnExecuteKeyTable(
+    const std::shared_ptr<arrow::Table>& key_table,
+    std::vector<std::string>* result) {
+  LOG(ERROR) << "key table input is not supported by this psi operator";
+  return retcode::FAIL;
+}
+
+retcode BasePsiOperator::SyncResult(std::vector<std::string>* result) {
   // broadcast result from party who get result during the protocol
   // to the other parties who participate
-  if (sync_result) {
-    SCopedTimer timer;
+  SCopedTimer timer;
+  auto ret{retcode::SUCCESS};
+  if (CardinalityOnly()) {
+    ret = SyncCardinality();
+  } else {
     ret = BroadcastPsiResult(result);
-    if (ret != retcode::SUCCESS) {
-      LOG(ERROR) << "Broadcast Psi Result failed";
-    }
-    auto time_cost = timer.timeElapse();
-    VLOG(5) << "BroadcastPsiResult time cost(ms): " << time_cost;
   }
+  if (ret != retcode::SUCCESS) {
+    LOG(ERROR) << "Broadcast Psi Result failed";
+  }
+  auto time_cost = timer.timeElapse();
+  VLOG(5) << "BroadcastPsiResult time cost(ms): " << time_cost;
   return ret;
 }
 
@@ -50,13 +91,38 @@ retcode BasePsiOperator::BroadcastPsiResult(std::vector<std::string>* result) {
   }
   auto ret{retcode::SUCCESS};
   if (RoleValidation::IsClient(options_.self_party)) {
-    ret = BroadcastResult(*result);
+    if (SyncByFingerprint()) {
+      ret = BroadcastFingerprint(*result);
+    } else {
+      ret = BroadcastResult(*result);
+    }
   } else {
-    ret = ReceiveResult(result);
+    if (SyncByFingerprint()) {
+      ret = ReceiveFingerprint(result);
+    } else {
+      ret = ReceiveResult(result);
+    }
   }
   return ret;
 }
 
+retcode BasePsiOperator::SyncCardinality() {
+  if (IgnoreResult(options_.self_party)) {
+    return retcode::SUCCESS;
+  }
+  if (RoleValidation::IsClient(options_.self_party)) {
+    return BroadcastResult({std::to_string(cardinality_)});
+  }
+  std::vector<std::string> result;
+  auto ret = ReceiveResult(&result);
+  if (ret != retcode::SUCCESS || result.size() != 1) {
+    LOG(ERROR) << "receive intersection size failed";
+    return retcode::FAIL;
+  }
+  cardinality_ = std::stoull(result[0]);
+  return retcode::SUCCESS;
+}
+
 retcode BasePsiOperator::BroadcastResult(
     const std::vector<std::string>& result) {
   retcode ret{retcode::SUCCESS};
@@ -75,10 +141,14 @@ retcode BasePsiOperator::BroadcastResult(
                       sizeof(be_item_len));
     result_str.append(item);
   }
+  return SendToParties(result_str);
+}
+
+retcode BasePsiOperator::SendToParties(const std::string& data) {
   std::vector<Node> party_list;
   BroadcastPartyList(&party_list);
   for (const auto& party_info : party_list) {
-    auto ret = this->GetLinkContext()->Send(this->key_, party_info, result_str);
+    auto ret = this->GetLinkContext()->Send(this->key_, party_info, data);
     if (ret != retcode::SUCCESS) {
       LOG(ERROR) << "Send result data to: "
                  << party_info.to_string() << " failed";
@@ -87,6 +157,94 @@ retcode BasePsiOperator::BroadcastResult(
   return retcode::SUCCESS;
 }
 
+size_t BasePsiOperator::FingerprintBits(size_t result_size) {
+  size_t bit_width{0};
+  while (result_size >> bit_width) {
+    bit_width++;
+  }
+  return std::min<size_t>(bit_width + kFalseMatchBits, 63);
+}
+
+retcode BasePsiOperator::BroadcastFingerprint(
+    const std::vector<std::string>& result) {
+  SCopedTimer timer;
+  std::vector<oc::block> hashes;
+  auto ret = KeyHasher(options_.psi_thread_num).HashKeys(result, &hashes);
+  CHECK_RETCODE(ret);
+  size_t bits = FingerprintBits(result.size());
+  std::vector<uint64_t> fingerprints;
+  fingerprints.reserve(hashes.size());
+  for (const auto& hash : hashes) {
+    fingerprints.push_back(KeyHasher::Fingerprint(hash, bits));
+  }
+  std::sort(fingerprints.begin(), fingerprints.end());
+  fingerprints.erase(std::unique(fingerprints.begin(), fingerprints.end()),
+                     fingerprints.end());
+  std::string encoded;
+  ret = IndexCodec::Encode(fingerprints, uint64_t{1} << bits, &encoded);
+  CHECK_RETCODE(ret);
+  VLOG(5) << "broadcast fingerprint of " << result.size() << " keys, "
+          << "bytes: " << encoded.size() << " "
+          << "time cost(ms): " << timer.timeElapse();
+  return SendToParties(encoded);
+}
+
+retcode BasePsiOperator::ReceiveFingerprint(std::vector<std::string>* result) {
+  SCopedTimer timer;
+  std::vector<uint64_t> fingerprints;
+  uint64_t universe{0};
+  {
+    std::string recv_data_str;
+    auto ret = this->GetLinkContext()->Recv(this->key_,
+                                            this->ProxyServerNode(),
+                                            &recv_data_str);
+    if (ret != retcode::SUCCESS) {
+      LOG(ERROR) << "ReceiveFingerprint failed for party name: "
+                 << options_.self_party;
+      return retcode::FAIL;
+    }
+    ret = IndexCodec::Decode(recv_data_str, &universe, &fingerprints);
+    CHECK_RETCODE(ret);
+  }
+  if (universe == 0 || (universe & (universe - 1)) != 0) {
+    LOG(ERROR) << "invalid universe of fingerprint: " << universe;
+    return retcode::FAIL;
+  }
+  size_t bits = __builtin_ctzll(universe);
+  std::vector<oc::block> hashes;
+  KeyHasher hasher(options_.psi_thread_num);
+  auto ret{retcode::SUCCESS};
+  if (own_key_table_ != nullptr) {
+    ret = hasher.HashTable(*own_key_table_, &hashes);
+  } else if (own_input_ != nullptr) {
+    ret = hasher.HashKeys(*own_input_, &hashes);
+  } else {
+    LOG(ERROR) << "no own keys to resolve result from";
+    return retcode::FAIL;
+  }
+  CHECK_RETCODE(ret);
+  std::vector<int64_t> rows;
+  for (size_t i = 0; i < hashes.size(); i++) {
+    auto fingerprint = KeyHasher::Fingerprint(hashes[i], bits);
+    if (std::binary_search(fingerprints.begin(), fingerprints.end(),
+                           fingerprint)) {
+      rows.push_back(i);
+    }
+  }
+  if (own_key_table_ != nullptr) {
+    ret = PsiCommonUtil().ExtractRowsFromTable(*own_key_table_, rows, result);
+  } else {
+    result->reserve(rows.size());
+    for (auto row : rows) {
+      result->push_back((*own_input_)[row]);
+    }
+  }
+  VLOG(5) << "resolve " << rows.size() << " rows from "
+          << fingerprints.size() << " fingerprints, "
+          << "time cost(ms): " << timer.timeElapse();
+  return ret;
+}
+
 retcode BasePsiOperator::ReceiveResult(std::vector<std::string>* result) {
   std::string recv_data_str;
   auto ret = this->GetLinkContext()->Recv(this->key_,
@@ -135,7 +293,8 @@ bool BasePsiOperator::IgnoreParty(const std::string& party_name) {
 }
 
 bool BasePsiOperator::IgnoreResult(const std::string& party_name) {
-  if (RoleValidation::IsTeeCompute(party_name)) {
+  if (RoleValidation::IsTeeCompute(party_name) ||
+      RoleValidation::IsDealer(party_name)) {
     return true;
   }
   return false;
@@ -179,6 +338,10 @@ retcode BasePsiOperator::GetResult(const std::vector<std::string>& input,
     const std::vector<uint64_t>& intersection_index,
     std::vector<std::string>* result) {
 //
+  if (CardinalityOnly()) {
+    cardinality_ = intersection_index.size();
+    return retcode::SUCCESS;
+  }
   if (options_.psi_result_type == PsiResultType::DIFFERENCE) {
     size_t diff_size = input.size() - intersection_index.size();
     result->reserve(diff_size);
@@ -236,4 +399,39 @@ retcode BasePsiOperator::GetResult(const std::vector<std::string>& input,
   }
   return retcode::SUCCESS;
 }
+
+retcode BasePsiOperator::GetResult(const arrow::Table& key_table,
+    const std::vector<int64_t>& rows,
+    const std::vector<uint64_t>& intersection_index,
+    std::vector<std::string>* result) {
+//
+  if (CardinalityOnly()) {
+    cardinality_ = intersection_index.size();
+    return retcode::SUCCESS;
+  }
+  SCopedTimer timer;
+  std::vector<int64_t> result_rows;
+  if (options_.psi_result_type == PsiResultType::DIFFERENCE) {
+    std::vector<bool> in_intersection(rows.size(), false);
+    for (auto index : intersection_index) {
+      in_intersection[index] = true;
+    }
+    result_rows.reserve(rows.size() - intersection_index.size());
+    for (size_t i = 0; i < rows.size(); i++) {
+      if (!in_intersection[i]) {
+        result_rows.push_back(rows[i]);
+      }
+    }
+  } else {
+    result_rows.reserve(intersection_index.size());
+    for (auto index : intersection_index) {
+      result_rows.push_back(rows[index]);
+    }
+  }
+  auto ret = PsiCommonUtil().ExtractRowsFromTable(key_table, result_rows,
+                                                  result);
+  auto time_cost = timer.timeElapse();
+  VLOG(3) << "Get Result from key table time cost: " << time_cost;
+  return ret;
+}
 }  // namespace primihub::psi
@@ -16,9 +16,11 @@
 #ifndef SRC_PRIMIHUB_KERNEL_PSI_OPERATOR_BASE_PSI_H_
 #define SRC_PRIMIHUB_KERNEL_PSI_OPERATOR_BASE_PSI_H_
 #include <map>
+#include <memory>
 #include <vector>
 #include <string>
 
+#include "arrow/api.h"
 #include "src/primihub/util/network/link_context.h"
 #include "src/primihub/common/common.h"
 #include "src/primihub/kernel/psi/operator/common.h"
@@ -31,12 +33,50 @@ struct Options {
   PsiResultType psi_result_type{PsiResultType::INTERSECTION};
   std::string code;
   Node proxy_node;      // location to fecth recv data
+  // ecdh psi processes stream_batch_size elements per batch,
+  // computation of batches overlaps transfer, 0 means whole set at once
+  size_t stream_batch_size{0};
+  // threads of ecdh psi elliptic curve operations, 0 means half of cores
+  size_t ecdh_thread_num{0};
+  // ecdh psi server reuses key and setup of its dataset from local cache
+  bool ecdh_server_cache{false};
+  std::string dataset_id;
+  std::vector<int> key_columns;
+  // channels and threads of cm20 and mkkrt psi, 0 means half of cores,
+  // parties run with the smaller one of their settings,
+  // it also sets threads hashing keys of kkrt, cm20 and mkkrt psi
+  size_t psi_thread_num{0};
+  // remove duplicated keys of key table input
+  bool filter_duplicate{true};
+  // intersection is synced to the other parties as key fingerprints
+  // instead of keys, see BroadcastFingerprint.
+  // the result is probabilistic, so it is off by default
+  bool sync_result_fingerprint{false};
+  // kkrt, cm20, mkkrt and ecdh psi split keys into psi_shard_num shards
+  // by key hash, one protocol instance per shard runs concurrently
+  // over its own channel, 1 means no partition.
+  // shards are padded by dummy keys to a size derived from the key count,
+  // so that sizes of shards are not revealed to the peer
+  size_t psi_shard_num{1};
+  // external psi spills keys to local disk and runs psi part by part,
+  // keys of one part take at most psi_memory_limit_mb in memory,
+  // 0 means all keys are loaded in memory
+  size_t psi_memory_limit_mb{0};
+  // distinguishes protocol instances of one task running over the same
+  // link, such as parts of external psi
+  std::string channel_tag;
+  // multi-party psi and psu run offline phase to generate
+  // correlated randomness, or online phase which consumes it
+  bool mpso_offline{false};
+  // log2 of set size which offline phase prepares for
+  uint32_t mpso_log_set_size{0};
 };
 
 class BasePsiOperator {
  public:
   explicit BasePsiOperator(const Options& options) : options_(options) {
     peer_node_ = PeerNode();
+    key_.append(options_.channel_tag);
   }
   virtual ~BasePsiOperator() = default;
   /**
@@ -47,6 +87,17 @@ class BasePsiOperator {
                   std::vector<std::string>* result);
   virtual retcode OnExecute(const std::vector<std::string>& input,
                             std::vector<std::string>* result) = 0;
+  /**
+   * PSI protocol on key columns of dataset,
+   * operator reads keys from arrow buffers without materializing them,
+   * result is materialized from rows of key_table
+  */
+  retcode Execute(const std::shared_ptr<arrow::Table>& key_table,
+                  bool sync_result,
+                  std::vector<std::string>* result);
+  virtual retcode OnExecuteKeyTable(
+      const std::shared_ptr<arrow::Table>& key_table,
+      std::vector<std::string>* result);
   /**
    * broadcast from the party who get the result to the others who participate
    * in the protocol
@@ -55,6 +106,10 @@ class BasePsiOperator {
    *  for party who get result after broadcast step, result is output
   */
   virtual retcode BroadcastPsiResult(std::vector<std::string>* result);
+  /**
+   * intersection size of CARDINALITY result type
+  */
+  uint64_t Cardinality() const {return cardinality_;}
 
  protected:
   /**
@@ -73,11 +128,50 @@ class BasePsiOperator {
   bool IgnoreResult(const std::string& party_name);
   retcode BroadcastResult(const std::vector<std::string>& result);
   retcode ReceiveResult(std::vector<std::string>* result);
+  /**
+   * result is a subset of the set of every receiver
+  */
+  virtual bool ResultInPeerSet() {
+    return options_.psi_result_type == PsiResultType::INTERSECTION;
+  }
+  /**
+   * intersection is sent as sorted fingerprints of its keys encoded by
+   * IndexCodec instead of the keys, receiver takes its own keys whose
+   * fingerprint is in the set, so result is resolved from local rows.
+   * it works only when ResultInPeerSet, and a key of receiver which is
+   * not in the result is taken with probability less than
+   * 2^-kFalseMatchBits, so it is used only if sync_result_fingerprint
+   * is set
+  */
+  bool SyncByFingerprint() {
+    return options_.sync_result_fingerprint && ResultInPeerSet();
+  }
+  retcode BroadcastFingerprint(const std::vector<std::string>& result);
+  retcode ReceiveFingerprint(std::vector<std::string>* result);
+  /**
+   * fingerprint takes kFalseMatchBits bits more than bit width of
+   * result size, so that each key of receiver matches falsely with
+   * probability less than 2^-kFalseMatchBits
+  */
+  static size_t FingerprintBits(size_t result_size);
+  retcode SendToParties(const std::string& data);
+  retcode SyncResult(std::vector<std::string>* result);
+  /**
+   * client sends intersection size to the others
+  */
+  retcode SyncCardinality();
 
   void set_stop() {stop_.store(true);}
   retcode GetResult(const std::vector<std::string>& input,
                     const std::vector<uint64_t>& intersection_index,
                     std::vector<std::string>* result);
+  /**
+   * rows: row of key_table for each element of psi input
+  */
+  retcode GetResult(const arrow::Table& key_table,
+                    const std::vector<int64_t>& rows,
+                    const std::vector<uint64_t>& intersection_index,
+                    std::vector<std::string>* result);
  protected:
   bool has_stopped() {
     return stop_.load(std::memory_order::memory_order_relaxed);
@@ -85,6 +179,9 @@ class BasePsiOperator {
   std::string PartyName() {return options_.self_party;}
   LinkContext* GetLinkContext() {return options_.link_ctx_ref;}
   PsiResultType GetPsiResultType() {return options_.psi_result_type;}
+  bool CardinalityOnly() {
+    return options_.psi_result_type == PsiResultType::CARDINALITY;
+  }
   Node PeerNode();
   Node& ProxyServerNode();
   retcode GetNodeByName(const std::string& party_name, Node* node_info);
@@ -94,6 +191,12 @@ class BasePsiOperator {
   Options options_;
   std::string key_{"default"};
   Node peer_node_;
+  uint64_t cardinality_{0};
+  // own keys of party for execution, receiver of fingerprint resolves
+  // result from them
+  const std::vector<std::string>* own_input_{nullptr};
+  std::shared_ptr<arrow::Table> own_key_table_{nullptr};
+  static constexpr size_t kFalseMatchBits = 40;
 };
 }  // namespace primihub::psi
 #endif  // SRC_PRIMIHUB_KERNEL_PSI_OPERATOR_BASE_PSI_H_
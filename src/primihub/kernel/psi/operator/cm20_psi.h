@@ -0,0 +1,37 @@
+// "Copyright [2023] <PrimiHub>"
+#ifndef SRC_PRIMIHUB_KERNEL_PSI_OPERATOR_CM20_PSI_H_
+#define SRC_PRIMIHUB_KERNEL_PSI_OPERATOR_CM20_PSI_H_
+#include <vector>
+#include <string>
+
+#include "src/primihub/kernel/psi/operator/kkrt_psi.h"
+
+namespace primihub::psi {
+/**
+ * CM20 psi, oprf based on oblivious transfer extension,
+ * it sends less data than kkrt, and suits low bandwidth network.
+ * protocol runs psi_thread_num threads over the same number of channels,
+ * channel and hashing of input are shared with kkrt psi
+*/
+class Cm20PsiOperator : public KkrtPsiOperator {
+ public:
+  explicit Cm20PsiOperator(const Options& options) : KkrtPsiOperator(options) {}
+
+ protected:
+  retcode ExecuteProtocol(const std::string& shard_tag,
+                          std::vector<oc::block>& input,
+                          std::vector<uint64_t>* result_index) override;
+  retcode Cm20Recv(std::vector<oc::Channel>& chls,
+                   std::vector<oc::block>& input,
+                   uint64_t send_size,
+                   std::vector<uint64_t>* result_index);
+  retcode Cm20Send(std::vector<oc::Channel>& chls,
+                   std::vector<oc::block>& input,
+                   uint64_t recv_size);
+
+ private:
+  static constexpr double kBinScale = 1.0;
+  static constexpr uint64_t kStatSecParam = 40;
+};
+}  // namespace primihub::psi
+#endif  // SRC_PRIMIHUB_KERNEL_PSI_OPERATOR_CM20_PSI_H_
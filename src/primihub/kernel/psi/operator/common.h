@@ -7,11 +7,17 @@ enum class PsiType {
   ECDH = 0,
   KKRT,
   TEE,
+  CM20,
+  MKKRT,
+  MPSI,
+  MPSU,
 };
 
 enum class PsiResultType {
   INTERSECTION = 0,
   DIFFERENCE = 1,
+  // size of intersection only, no element of intersection is output
+  CARDINALITY = 2,
 };
 }  // namespace primihub::psi
 
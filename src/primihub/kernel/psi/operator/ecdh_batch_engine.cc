@@ -0,0 +1,249 @@
+/*
+ * Copyright (c) 2023 by PrimiHub
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      https://www.apache.org/licenses/
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "src/primihub/kernel/psi/operator/ecdh_batch_engine.h"
+#include <glog/logging.h>
+#include <algorithm>
+#include <future>
+#include <thread>
+
+#include "private_set_intersection/cpp/psi_server.h"
+
+namespace primihub::psi {
+namespace openminded_psi = private_set_intersection;
+
+EcdhBatchEngine::EcdhBatchEngine(size_t thread_num) {
+  if (thread_num == 0) {
+    thread_num = std::thread::hardware_concurrency() / 2;
+  }
+  thread_num_ = std::max<size_t>(thread_num, 1);
+}
+
+std::vector<EcdhBatchEngine::Range> EcdhBatchEngine::Partition(size_t total) {
+  std::vector<Range> ranges;
+  size_t range_num = std::min(thread_num_, total / kMinRangeSize);
+  range_num = std::max<size_t>(range_num, 1);
+  size_t range_size = total / range_num;
+  size_t remainder = total % range_num;
+  size_t begin = 0;
+  for (size_t i = 0; i < range_num; i++) {
+    size_t end = begin + range_size + (i < remainder ? 1 : 0);
+    ranges.emplace_back(begin, end);
+    begin = end;
+  }
+  return ranges;
+}
+
+retcode EcdhBatchEngine::ParallelRun(const std::vector<Range>& ranges,
+    const std::function<retcode(size_t range_index, const Range&)>& func) {
+  if (ranges.size() == 1) {
+    return func(0, ranges[0]);
+  }
+  std::vector<std::future<retcode>> futs;
+  for (size_t i = 0; i < ranges.size(); i++) {
+    futs.push_back(std::async(std::launch::async, func, i, ranges[i]));
+  }
+  retcode ret{retcode::SUCCESS};
+  for (auto&& fut : futs) {
+    if (fut.get() != retcode::SUCCESS) {
+      ret = retcode::FAIL;
+    }
+  }
+  return ret;
+}
+
+retcode EcdhBatchEngine::CreateRequest(const std::string& client_key,
+                                       bool reveal_intersection,
+                                       absl::Span<const std::string> input,
+                                       psi_proto::Request* request) {
+  auto ranges = Partition(input.size());
+  std::vector<psi_proto::Request> partial_requests(ranges.size());
+  auto ret = ParallelRun(ranges,
+    [&](size_t index, const Range& range) -> retcode {
+      auto client = openminded_psi::PsiClient::CreateFromKey(
+          client_key, reveal_intersection);
+      if (!client.ok()) {
+        LOG(ERROR) << "create psi client failed, "
+                   << client.status().message();
+        return retcode::FAIL;
+      }
+      auto partial_request = client.value()->CreateRequest(
+          input.subspan(range.first, range.second - range.first));
+      if (!partial_request.ok()) {
+        LOG(ERROR) << "create psi request failed, "
+                   << partial_request.status().message();
+        return retcode::FAIL;
+      }
+      partial_requests[index] = std::move(partial_request).value();
+      return retcode::SUCCESS;
+    });
+  if (ret != retcode::SUCCESS) {
+    return retcode::FAIL;
+  }
+  *request = std::move(partial_requests[0]);
+  auto encrypted_elements = request->mutable_encrypted_elements();
+  encrypted_elements->Reserve(input.size());
+  for (size_t i = 1; i < partial_requests.size(); i++) {
+    for (auto& element : *partial_requests[i].mutable_encrypted_elements()) {
+      encrypted_elements->Add(std::move(element));
+    }
+  }
+  return retcode::SUCCESS;
+}
+
+retcode EcdhBatchEngine::ProcessRequest(const std::string& server_key,
+                                        bool reveal_intersection,
+                                        const psi_proto::Request& request,
+                                        psi_proto::Response* response) {
+  const auto& client_elements = request.encrypted_elements();
+  auto ranges = Partition(client_elements.size());
+  std::vector<psi_proto::Response> partial_responses(ranges.size());
+  auto ret = ParallelRun(ranges,
+    [&](size_t index, const Range& range) -> retcode {
+      auto server = openminded_psi::PsiServer::CreateFromKey(
+          server_key, reveal_intersection);
+      if (!server.ok()) {
+        LOG(ERROR) << "create psi server failed, "
+                   << server.status().message();
+        return retcode::FAIL;
+      }
+      psi_proto::Request partial_request;
+      partial_request.set_reveal_intersection(
+          request.reveal_intersection());
+      auto elements = partial_request.mutable_encrypted_elements();
+      elements->Reserve(range.second - range.first);
+      for (size_t i = range.first; i < range.second; i++) {
+        elements->Add()->assign(client_elements.Get(i));
+      }
+      auto partial_response = server.value()->ProcessRequest(partial_request);
+      if (!partial_response.ok()) {
+        LOG(ERROR) << "process psi request failed, "
+                   << partial_response.status().message();
+        return retcode::FAIL;
+      }
+      partial_responses[index] = std::move(partial_response).value();
+      return retcode::SUCCESS;
+    });
+  if (ret != retcode::SUCCESS) {
+    return retcode::FAIL;
+  }
+  *response = std::move(partial_responses[0]);
+  auto encrypted_elements = response->mutable_encrypted_elements();
+  encrypted_elements->Reserve(client_elements.size());
+  for (size_t i = 1; i < partial_responses.size(); i++) {
+    for (auto& element : *partial_responses[i].mutable_encrypted_elements()) {
+      encrypted_elements->Add(std::move(element));
+    }
+  }
+  if (!reveal_intersection && partial_responses.size() > 1) {
+    // order of client elements is hidden by sorting, as single server does
+    std::sort(encrypted_elements->begin(), encrypted_elements->end());
+  }
+  return retcode::SUCCESS;
+}
+
+retcode EcdhBatchEngine::GetIntersection(
+    const std::string& client_key,
+    bool reveal_intersection,
+    const psi_proto::ServerSetup& server_setup,
+    const psi_proto::Response& response,
+    std::vector<int64_t>* intersection) {
+  const auto& server_elements = response.encrypted_elements();
+  auto ranges = Partition(server_elements.size());
+  std::vector<std::vector<int64_t>> partial_intersections(ranges.size());
+  auto ret = ParallelRun(ranges,
+    [&](size_t index, const Range& range) -> retcode {
+      auto client = openminded_psi::PsiClient::CreateFromKey(
+          client_key, reveal_intersection);
+      if (!client.ok()) {
+        LOG(ERROR) << "create psi client failed, "
+                   << client.status().message();
+        return retcode::FAIL;
+      }
+      psi_proto::Response partial_response;
+      auto elements = partial_response.mutable_encrypted_elements();
+      elements->Reserve(range.second - range.first);
+      for (size_t i = range.first; i < range.second; i++) {
+        elements->Add()->assign(server_elements.Get(i));
+      }
+      auto partial_intersection = client.value()->GetIntersection(
+          server_setup, partial_response);
+      if (!partial_intersection.ok()) {
+        LOG(ERROR) << "get intersection failed, "
+                   << partial_intersection.status().message();
+        return retcode::FAIL;
+      }
+      auto& result = partial_intersections[index];
+      result = std::move(partial_intersection).value();
+      for (auto& element_index : result) {
+        element_index += range.first;
+      }
+      return retcode::SUCCESS;
+    });
+  if (ret != retcode::SUCCESS) {
+    return retcode::FAIL;
+  }
+  intersection->clear();
+  for (auto& partial_intersection : partial_intersections) {
+    intersection->insert(intersection->end(), partial_intersection.begin(),
+                         partial_intersection.end());
+  }
+  return retcode::SUCCESS;
+}
+
+retcode EcdhBatchEngine::GetIntersectionSize(
+    const std::string& client_key,
+    const psi_proto::ServerSetup& server_setup,
+    const psi_proto::Response& response,
+    int64_t* intersection_size) {
+  const auto& server_elements = response.encrypted_elements();
+  auto ranges = Partition(server_elements.size());
+  std::vector<int64_t> partial_sizes(ranges.size(), 0);
+  auto ret = ParallelRun(ranges,
+    [&](size_t index, const Range& range) -> retcode {
+      bool reveal_intersection{false};
+      auto client = openminded_psi::PsiClient::CreateFromKey(
+          client_key, reveal_intersection);
+      if (!client.ok()) {
+        LOG(ERROR) << "create psi client failed, "
+                   << client.status().message();
+        return retcode::FAIL;
+      }
+      psi_proto::Response partial_response;
+      auto elements = partial_response.mutable_encrypted_elements();
+      elements->Reserve(range.second - range.first);
+      for (size_t i = range.first; i < range.second; i++) {
+        elements->Add()->assign(server_elements.Get(i));
+      }
+      auto partial_size = client.value()->GetIntersectionSize(
+          server_setup, partial_response);
+      if (!partial_size.ok()) {
+        LOG(ERROR) << "get intersection size failed, "
+                   << partial_size.status().message();
+        return retcode::FAIL;
+      }
+      partial_sizes[index] = partial_size.value();
+      return retcode::SUCCESS;
+    });
+  if (ret != retcode::SUCCESS) {
+    return retcode::FAIL;
+  }
+  *intersection_size = 0;
+  for (auto size : partial_sizes) {
+    *intersection_size += size;
+  }
+  return retcode::SUCCESS;
+}
+}  // namespace primihub::psi
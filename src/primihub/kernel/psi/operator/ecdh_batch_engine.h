@@ -0,0 +1,91 @@
+/*
+ * Copyright (c) 2023 by PrimiHub
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      https://www.apache.org/licenses/
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef SRC_PRIMIHUB_KERNEL_PSI_OPERATOR_ECDH_BATCH_ENGINE_H_
+#define SRC_PRIMIHUB_KERNEL_PSI_OPERATOR_ECDH_BATCH_ENGINE_H_
+#include <functional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/types/span.h"
+#include "private_set_intersection/cpp/psi_client.h"
+#include "src/primihub/common/common.h"
+
+namespace primihub::psi {
+/**
+ * multi-core elliptic curve operations of ecdh psi.
+ * input is split into contiguous ranges, one per worker,
+ * each worker owns a psi client or server restored from the same key
+ * because cipher context is not thread safe.
+ * results of ranges are concatenated by range order,
+ * so output order is the same as single thread execution.
+ * thread_num: 0 means half of cpu cores
+*/
+class EcdhBatchEngine {
+ public:
+  explicit EcdhBatchEngine(size_t thread_num = 0);
+  size_t thread_num() const {return thread_num_;}
+  /**
+   * hash to curve and blind input by client key
+  */
+  retcode CreateRequest(const std::string& client_key,
+                        bool reveal_intersection,
+                        absl::Span<const std::string> input,
+                        psi_proto::Request* request);
+  /**
+   * re-blind client elements by server key
+  */
+  retcode ProcessRequest(const std::string& server_key,
+                         bool reveal_intersection,
+                         const psi_proto::Request& request,
+                         psi_proto::Response* response);
+  /**
+   * unblind server response and match it with server setup,
+   * intersection is index of response elements in ascending order
+  */
+  retcode GetIntersection(const std::string& client_key,
+                          bool reveal_intersection,
+                          const psi_proto::ServerSetup& server_setup,
+                          const psi_proto::Response& response,
+                          std::vector<int64_t>* intersection);
+  /**
+   * number of response elements matching server setup,
+   * for client whose reveal_intersection is false
+  */
+  retcode GetIntersectionSize(const std::string& client_key,
+                              const psi_proto::ServerSetup& server_setup,
+                              const psi_proto::Response& response,
+                              int64_t* intersection_size);
+
+ protected:
+  using Range = std::pair<size_t, size_t>;
+  /**
+   * split [0, total) into at most thread_num ranges,
+   * range is not smaller than kMinRangeSize unless total is
+  */
+  std::vector<Range> Partition(size_t total);
+  /**
+   * run func for each range in parallel
+  */
+  retcode ParallelRun(const std::vector<Range>& ranges,
+      const std::function<retcode(size_t range_index, const Range&)>& func);
+
+ private:
+  static constexpr size_t kMinRangeSize = 1024;
+  size_t thread_num_{1};
+};
+}  // namespace primihub::psi
+#endif  // SRC_PRIMIHUB_KERNEL_PSI_OPERATOR_ECDH_BATCH_ENGINE_H_
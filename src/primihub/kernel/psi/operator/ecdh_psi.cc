@@ -1,16 +1,24 @@
 // "Copyright [2023] <Primihub>"
 #include "src/primihub/kernel/psi/operator/ecdh_psi.h"
 
+#include <algorithm>
+#include <condition_variable>
+#include <future>
+#include <mutex>
 #include <utility>
 #include <set>
 
+#include "absl/types/span.h"
+
 #include "private_set_intersection/cpp/psi_client.h"
 #include "private_set_intersection/cpp/psi_server.h"
 
 #include "src/primihub/common/common.h"
 #include "src/primihub/common/value_check_util.h"
+#include "src/primihub/kernel/psi/operator/key_hasher.h"
 #include "src/primihub/util/util.h"
 #include "src/primihub/util/endian_util.h"
+#include "src/primihub/util/file_util.h"
 
 namespace primihub::psi {
 retcode EcdhPsiOperator::OnExecute(const std::vector<std::string>& input,
@@ -19,7 +27,19 @@ retcode EcdhPsiOperator::OnExecute(const std::vector<std::string>& input,
     LOG(ERROR) << "no data is set for ecdh psi";
     return retcode::FAIL;
   }
+  if (CardinalityOnly() &&
+      (options_.psi_shard_num > 1 || options_.stream_batch_size > 0)) {
+    LOG(ERROR) << "cardinality psi runs over the whole set, "
+               << "shard and stream mode are not supported";
+    return retcode::FAIL;
+  }
+  if (options_.psi_shard_num > 1) {
+    return ExecuteShards(input, result);
+  }
   if (RoleValidation::IsClient(PartyName())) {
+    if (options_.stream_batch_size > 0) {
+      return ExecuteAsClientByStream(input, result);
+    }
     return ExecuteAsClient(input, result);
   } else if (RoleValidation::IsServer(this->PartyName())) {
     return ExecuteAsServer(input);
@@ -31,6 +51,73 @@ retcode EcdhPsiOperator::OnExecute(const std::vector<std::string>& input,
   }
 }
 
+retcode EcdhPsiOperator::ExecuteShards(const std::vector<std::string>& input,
+                                       std::vector<std::string>* result) {
+  size_t shard_num = options_.psi_shard_num;
+  std::vector<oc::block> hashes;
+  KeyHasher(engine_->thread_num()).HashKeys(input, &hashes);
+  std::vector<std::vector<std::string>> shard_input(shard_num);
+  for (size_t i = 0; i < input.size(); i++) {
+    shard_input[KeyHasher::ShardOf(hashes[i], shard_num)].push_back(input[i]);
+  }
+  // every shard runs on the same padded size, so parties do not learn
+  // how the keys of each other split into shards.
+  // dummy of parties differs, so it never meets in intersection,
+  // and it is the same across runs, so server cache stays valid
+  size_t padded_size = KeyHasher::ShardPaddedSize(input.size(), shard_num);
+  for (size_t i = 0; i < shard_num; i++) {
+    padded_size = std::max(padded_size, shard_input[i].size());
+  }
+  if (padded_size > KeyHasher::ShardPaddedSize(input.size(), shard_num)) {
+    LOG(WARNING) << "shard size exceeds padded size, duplicated keys? "
+                 << "the largest shard size is revealed: " << padded_size;
+  }
+  auto dummy_prefix = KeyHasher::kShardDummyKey + PartyName();
+  std::vector<std::unique_ptr<EcdhPsiOperator>> shard_operators;
+  for (size_t i = 0; i < shard_num; i++) {
+    for (size_t j = shard_input[i].size(); j < padded_size; j++) {
+      shard_input[i].push_back(
+          dummy_prefix + "_" + std::to_string(i) + "_" + std::to_string(j));
+    }
+    auto shard_options = options_;
+    shard_options.psi_shard_num = 1;
+    // shards share threads of curve operations
+    shard_options.ecdh_thread_num =
+        std::max<size_t>(engine_->thread_num() / shard_num, 1);
+    // server cache entry of each shard
+    shard_options.dataset_id = options_.dataset_id + "_shard" +
+        std::to_string(i) + "_of_" + std::to_string(shard_num);
+    auto shard_operator = std::make_unique<EcdhPsiOperator>(shard_options);
+    shard_operator->key_ = key_ + "_shard" + std::to_string(i);
+    shard_operator->SetFpr(fpr_);
+    shard_operators.push_back(std::move(shard_operator));
+  }
+  std::vector<std::vector<std::string>> shard_result(shard_num);
+  std::vector<std::future<retcode>> futs;
+  for (size_t i = 0; i < shard_num; i++) {
+    futs.push_back(std::async(std::launch::async, [&, i]() -> retcode {
+      return shard_operators[i]->OnExecute(shard_input[i], &shard_result[i]);
+    }));
+  }
+  auto ret{retcode::SUCCESS};
+  for (size_t i = 0; i < shard_num; i++) {
+    if (futs[i].get() != retcode::SUCCESS) {
+      LOG(ERROR) << "ecdh psi of shard: " << i << " failed";
+      ret = retcode::FAIL;
+    }
+  }
+  if (ret != retcode::SUCCESS) {
+    return retcode::FAIL;
+  }
+  for (size_t i = 0; i < shard_num; i++) {
+    cardinality_ += shard_operators[i]->Cardinality();
+    for (auto& item : shard_result[i]) {
+      result->push_back(std::move(item));
+    }
+  }
+  return retcode::SUCCESS;
+}
+
 retcode EcdhPsiOperator::ExecuteAsClient(const std::vector<std::string>& input,
     std::vector<std::string>* result) {
   CHECK_TASK_STOPPED(retcode::FAIL);
@@ -51,8 +138,10 @@ retcode EcdhPsiOperator::ExecuteAsClient(const std::vector<std::string>& input,
   auto ts = timer.timeElapse();
   auto client = openminded_psi::PsiClient::CreateWithNewKey(
       reveal_intersection_).value();
-  // psi_proto::Request
-  auto client_request = client->CreateRequest(input).value();
+  psi_proto::Request client_request;
+  ret = engine_->CreateRequest(client->GetPrivateKeyBytes(),
+                               reveal_intersection_, input, &client_request);
+  CHECK_RETCODE_WITH_ERROR_MSG(ret, "client build psi request failed");
   // psi_proto::Response server_response;
   auto build_req_ts = timer.timeElapse();
   auto build_req_time_cost = build_req_ts - ts;
@@ -103,8 +192,21 @@ retcode EcdhPsiOperator::GetIntersection(
   auto build_resp_time_cost = timer.timeElapse();
   VLOG(5) << "build_response_time_cost(ms): " << build_resp_time_cost;
 
-  std::vector<int64_t> intersection =
-      std::move(client->GetIntersection(server_setup, entrpy_response)).value();
+  if (!reveal_intersection_) {
+    int64_t intersection_size{0};
+    auto ret = engine_->GetIntersectionSize(client->GetPrivateKeyBytes(),
+                                            server_setup, entrpy_response,
+                                            &intersection_size);
+    CHECK_RETCODE(ret);
+    cardinality_ = intersection_size;
+    VLOG(5) << "get intersection size time cost(ms): " << timer.timeElapse();
+    return retcode::SUCCESS;
+  }
+  std::vector<int64_t> intersection;
+  auto ret = engine_->GetIntersection(client->GetPrivateKeyBytes(),
+                                      reveal_intersection_, server_setup,
+                                      entrpy_response, &intersection);
+  CHECK_RETCODE(ret);
   auto get_intersection_ts = timer.timeElapse();
   auto get_intersection_time_cost = get_intersection_ts - build_resp_time_cost;
   VLOG(5) << "get_intersection_time_cost: " << get_intersection_time_cost;
@@ -130,6 +232,139 @@ retcode EcdhPsiOperator::GetIntersection(
   return retcode::SUCCESS;
 }
 
+retcode EcdhPsiOperator::ExecuteAsClientByStream(
+    const std::vector<std::string>& input,
+    std::vector<std::string>* result) {
+  CHECK_TASK_STOPPED(retcode::FAIL);
+  SCopedTimer timer;
+  size_t batch_size = options_.stream_batch_size;
+  size_t num_batches = (input.size() + batch_size - 1) / batch_size;
+  std::string init_param_str;
+  auto ret = BuildInitParam(input.size(), &init_param_str);
+  CHECK_RETCODE(ret);
+  ret = SendInitParam(init_param_str);
+  CHECK_RETCODE(ret);
+  VLOG(5) << "client begin to stream " << num_batches << " batches, "
+          << "batch size: " << batch_size;
+  auto client = openminded_psi::PsiClient::CreateWithNewKey(
+      reveal_intersection_).value();
+  auto client_key = client->GetPrivateKeyBytes();
+  std::mutex window_mtx;
+  std::condition_variable window_cv;
+  size_t matched_batches{0};
+  bool failed{false};
+  auto encrypt_fut = std::async(
+    std::launch::async,
+    [&]() -> retcode {
+      for (size_t i = 0; i < num_batches; i++) {
+        {
+          std::unique_lock<std::mutex> lck(window_mtx);
+          window_cv.wait(lck, [&]() {
+            return failed || i < matched_batches + kStreamWindow;
+          });
+          if (failed) {
+            return retcode::FAIL;
+          }
+        }
+        if (has_stopped()) {
+          return retcode::FAIL;
+        }
+        size_t begin = i * batch_size;
+        size_t count = std::min(batch_size, input.size() - begin);
+        psi_proto::Request request;
+        auto ret = engine_->CreateRequest(
+            client_key, reveal_intersection_,
+            absl::MakeConstSpan(input.data() + begin, count), &request);
+        if (ret != retcode::SUCCESS) {
+          LOG(ERROR) << "create psi request for batch: " << i << " failed";
+          return retcode::FAIL;
+        }
+        std::string request_str;
+        request.SerializeToString(&request_str);
+        ret = this->GetLinkContext()->Send(this->key_,
+                                           this->peer_node_, request_str);
+        if (ret != retcode::SUCCESS) {
+          LOG(ERROR) << "send psi request of batch: " << i << " to ["
+                     << this->peer_node_.to_string() << "] failed";
+          return retcode::FAIL;
+        }
+      }
+      return retcode::SUCCESS;
+    });
+  // match stage
+  std::vector<uint64_t> intersection_index;
+  uint64_t intersection_size{0};
+  psi_proto::ServerSetup server_setup;
+  std::string recv_str;
+  ret = this->GetLinkContext()->Recv(SetupKey(), this->ProxyServerNode(),
+                                     &recv_str);
+  if (ret == retcode::SUCCESS && !server_setup.ParseFromString(recv_str)) {
+    LOG(ERROR) << "parse server setup failed";
+    ret = retcode::FAIL;
+  }
+  for (size_t i = 0; ret == retcode::SUCCESS && i < num_batches; i++) {
+    recv_str.clear();
+    ret = this->GetLinkContext()->Recv(this->key_, this->ProxyServerNode(),
+                                       &recv_str);
+    if (ret != retcode::SUCCESS) {
+      LOG(ERROR) << "recv psi response of batch: " << i << " failed";
+      break;
+    }
+    psi_proto::Response response;
+    if (!response.ParseFromString(recv_str)) {
+      LOG(ERROR) << "parse psi response of batch: " << i << " failed";
+      ret = retcode::FAIL;
+      break;
+    }
+    if (!reveal_intersection_) {
+      int64_t batch_intersection_size{0};
+      ret = engine_->GetIntersectionSize(client_key, server_setup, response,
+                                         &batch_intersection_size);
+      if (ret != retcode::SUCCESS) {
+        LOG(ERROR) << "get intersection size of batch: " << i << " failed";
+        break;
+      }
+      intersection_size += batch_intersection_size;
+    } else {
+      std::vector<int64_t> batch_index;
+      ret = engine_->GetIntersection(client_key, reveal_intersection_,
+                                     server_setup, response, &batch_index);
+      if (ret != retcode::SUCCESS) {
+        LOG(ERROR) << "get intersection of batch: " << i << " failed";
+        break;
+      }
+      uint64_t offset = i * batch_size;
+      for (auto index : batch_index) {
+        intersection_index.push_back(offset + index);
+      }
+    }
+    {
+      std::lock_guard<std::mutex> lck(window_mtx);
+      matched_batches = i + 1;
+    }
+    window_cv.notify_all();
+  }
+  if (ret != retcode::SUCCESS) {
+    std::lock_guard<std::mutex> lck(window_mtx);
+    failed = true;
+  }
+  window_cv.notify_all();
+  auto encrypt_ret = encrypt_fut.get();
+  if (ret != retcode::SUCCESS || encrypt_ret != retcode::SUCCESS) {
+    LOG(ERROR) << "stream ecdh psi as client failed";
+    return retcode::FAIL;
+  }
+  if (!reveal_intersection_) {
+    cardinality_ = intersection_size;
+    VLOG(5) << "stream ecdh psi time cost(ms): " << timer.timeElapse() << " "
+            << "intersection size: " << cardinality_;
+    return retcode::SUCCESS;
+  }
+  VLOG(5) << "stream ecdh psi time cost(ms): " << timer.timeElapse() << " "
+          << "intersection size: " << intersection_index.size();
+  return GetResult(input, intersection_index, result);
+}
+
 retcode EcdhPsiOperator::BuildInitParam(int64_t element_size,
                                         std::string* init_param) {
   CHECK_TASK_STOPPED(retcode::FAIL);
@@ -147,6 +382,14 @@ retcode EcdhPsiOperator::BuildInitParam(int64_t element_size,
   pv_intersection.set_value_int32(this->reveal_intersection_ ? 1 : 0);
   pv_intersection.set_is_array(false);
   (*param_map)["reveal_intersection"] = pv_intersection;
+  // streaming mode is chosen by client
+  if (options_.stream_batch_size > 0) {
+    rpc::ParamValue pv_batch_size;
+    pv_batch_size.set_var_type(rpc::VarType::INT64);
+    pv_batch_size.set_value_int64(options_.stream_batch_size);
+    pv_batch_size.set_is_array(false);
+    (*param_map)["stream_batch_size"] = pv_batch_size;
+  }
   bool success = init_params.SerializeToString(init_param);
   if (!success) {
     LOG(ERROR) << "serialize init param failed";
@@ -245,19 +488,34 @@ retcode EcdhPsiOperator::ExecuteAsServer(
   SCopedTimer timer;
   size_t num_client_elements{0};
   bool reveal_intersection_flag{false};
-  auto ret = RecvInitParam(&num_client_elements, &reveal_intersection_flag);
+  size_t stream_batch_size{0};
+  auto ret = RecvInitParam(&num_client_elements, &reveal_intersection_flag,
+                           &stream_batch_size);
   CHECK_RETCODE(ret);
+  if (stream_batch_size > 0) {
+    if (CardinalityOnly()) {
+      // count of each batch would tell client which elements intersect
+      LOG(ERROR) << "stream mode is not supported by cardinality psi";
+      return retcode::FAIL;
+    }
+    return ExecuteAsServerByStream(input, num_client_elements,
+                                   reveal_intersection_flag,
+                                   stream_batch_size);
+  }
   // prepare for local computation
   VLOG(5) << "sever begin to SetupMessage";
-  std::unique_ptr<openminded_psi::PsiServer> server =
-      std::move(openminded_psi::PsiServer::CreateWithNewKey(
-          reveal_intersection_flag)).value();
-  // std::int64_t num_client_elements =
-  //     static_cast<std::int64_t>(psi_request.encrypted_elements().size());
-  psi_proto::ServerSetup server_setup =
-      std::move(server->CreateSetupMessage(fpr_,
-                                           num_client_elements,
-                                           input)).value();
+  std::string server_key;
+  psi_proto::ServerSetup server_setup;
+  bool cache_hit{false};
+  ret = InitServerKey(input, num_client_elements, reveal_intersection_flag,
+                      &server_key, &server_setup, &cache_hit);
+  CHECK_RETCODE(ret);
+  if (!cache_hit) {
+    ret = BuildServerSetup(input, num_client_elements,
+                           reveal_intersection_flag, server_key,
+                           &server_setup);
+    CHECK_RETCODE(ret);
+  }
   VLOG(5) << "sever end of SetupMessage";
   // recv request from client
   VLOG(5) << "server begin to init reauest according to recv data from client";
@@ -267,14 +525,169 @@ retcode EcdhPsiOperator::ExecuteAsServer(
   auto init_req_ts = timer.timeElapse();
   auto init_req_time_cost = init_req_ts;
   VLOG(5) << "init_req_time_cost(ms): " << init_req_time_cost;
-  psi_proto::Response server_response =
-      std::move(server->ProcessRequest(psi_request)).value();
+  psi_proto::Response server_response;
+  ret = engine_->ProcessRequest(server_key, reveal_intersection_flag,
+                                psi_request, &server_response);
+  CHECK_RETCODE_WITH_ERROR_MSG(ret, "server process psi request failed");
   VLOG(5) << "server end of process request, begin to build response";
   PreparePSIResponse(std::move(server_response), std::move(server_setup));
   VLOG(5) << "end of send psi response to client";
   return retcode::SUCCESS;
 }
 
+retcode EcdhPsiOperator::ExecuteAsServerByStream(
+    const std::vector<std::string>& input,
+    size_t num_client_elements,
+    bool reveal_intersection,
+    size_t batch_size) {
+  CHECK_TASK_STOPPED(retcode::FAIL);
+  SCopedTimer timer;
+  size_t num_batches = (num_client_elements + batch_size - 1) / batch_size;
+  VLOG(5) << "server begin to process " << num_batches << " batches, "
+          << "batch size: " << batch_size;
+  std::string server_key;
+  psi_proto::ServerSetup server_setup;
+  bool cache_hit{false};
+  auto ret = InitServerKey(input, num_client_elements, reveal_intersection,
+                           &server_key, &server_setup, &cache_hit);
+  CHECK_RETCODE(ret);
+  auto setup_fut = std::async(
+    std::launch::async,
+    [&]() -> retcode {
+      if (!cache_hit) {
+        auto build_ret = BuildServerSetup(input, num_client_elements,
+                                          reveal_intersection, server_key,
+                                          &server_setup);
+        if (build_ret != retcode::SUCCESS) {
+          return retcode::FAIL;
+        }
+      }
+      std::string setup_str;
+      server_setup.SerializeToString(&setup_str);
+      VLOG(5) << "server setup length: " << setup_str.size();
+      return this->GetLinkContext()->Send(SetupKey(), this->peer_node_,
+                                          setup_str);
+    });
+  for (size_t i = 0; i < num_batches; i++) {
+    if (has_stopped()) {
+      ret = retcode::FAIL;
+      break;
+    }
+    std::string request_str;
+    ret = this->GetLinkContext()->Recv(this->key_, this->ProxyServerNode(),
+                                       &request_str);
+    if (ret != retcode::SUCCESS) {
+      LOG(ERROR) << "recv psi request of batch: " << i << " failed";
+      break;
+    }
+    psi_proto::Request request;
+    if (!request.ParseFromString(request_str)) {
+      LOG(ERROR) << "parse psi request of batch: " << i << " failed";
+      ret = retcode::FAIL;
+      break;
+    }
+    psi_proto::Response response;
+    ret = engine_->ProcessRequest(server_key, reveal_intersection, request,
+                                  &response);
+    if (ret != retcode::SUCCESS) {
+      LOG(ERROR) << "process psi request of batch: " << i << " failed";
+      break;
+    }
+    std::string response_str;
+    response.SerializeToString(&response_str);
+    ret = this->GetLinkContext()->Send(this->key_, this->peer_node_,
+                                       response_str);
+    if (ret != retcode::SUCCESS) {
+      LOG(ERROR) << "send psi response of batch: " << i << " to ["
+                 << this->peer_node_.to_string() << "] failed";
+      break;
+    }
+  }
+  auto setup_ret = setup_fut.get();
+  if (ret != retcode::SUCCESS || setup_ret != retcode::SUCCESS) {
+    LOG(ERROR) << "stream ecdh psi as server failed";
+    return retcode::FAIL;
+  }
+  VLOG(5) << "stream ecdh psi time cost(ms): " << timer.timeElapse();
+  return retcode::SUCCESS;
+}
+
+retcode EcdhPsiOperator::InitServerKey(const std::vector<std::string>& input,
+                                       size_t num_client_elements,
+                                       bool reveal_intersection,
+                                       std::string* server_key,
+                                       psi_proto::ServerSetup* server_setup,
+                                       bool* cache_hit) {
+  *cache_hit = false;
+  if (options_.ecdh_server_cache) {
+    SCopedTimer timer;
+    server_cache_ = std::make_unique<EcdhServerCache>(
+        CompletePath(kServerCacheDir), options_.dataset_id,
+        options_.key_columns, fpr_, reveal_intersection);
+    dataset_fingerprint_ = EcdhServerCache::Fingerprint(input);
+    auto bucket = EcdhServerCache::ClientSizeBucket(num_client_elements);
+    EcdhServerCache::Entry entry;
+    auto ret = server_cache_->Load(dataset_fingerprint_, bucket, &entry);
+    if (ret == retcode::SUCCESS &&
+        server_setup->ParseFromString(entry.server_setup)) {
+      *server_key = std::move(entry.server_key);
+      *cache_hit = true;
+    }
+    VLOG(3) << "ecdh server cache of dataset: " << options_.dataset_id << " "
+            << (*cache_hit ? "hit" : "miss") << ", "
+            << "time cost(ms): " << timer.timeElapse();
+    if (*cache_hit) {
+      return retcode::SUCCESS;
+    }
+  }
+  auto server = openminded_psi::PsiServer::CreateWithNewKey(
+      reveal_intersection);
+  if (!server.ok()) {
+    LOG(ERROR) << "create psi server failed, " << server.status().message();
+    return retcode::FAIL;
+  }
+  *server_key = server.value()->GetPrivateKeyBytes();
+  return retcode::SUCCESS;
+}
+
+retcode EcdhPsiOperator::BuildServerSetup(
+    const std::vector<std::string>& input,
+    size_t num_client_elements,
+    bool reveal_intersection,
+    const std::string& server_key,
+    psi_proto::ServerSetup* server_setup) {
+  auto server = openminded_psi::PsiServer::CreateFromKey(
+      server_key, reveal_intersection);
+  if (!server.ok()) {
+    LOG(ERROR) << "create psi server failed, " << server.status().message();
+    return retcode::FAIL;
+  }
+  // cached setup serves every client set within the size bucket
+  uint64_t setup_client_size = num_client_elements;
+  if (server_cache_ != nullptr) {
+    setup_client_size = EcdhServerCache::ClientSizeBucket(num_client_elements);
+  }
+  auto setup = server.value()->CreateSetupMessage(fpr_, setup_client_size,
+                                                  input);
+  if (!setup.ok()) {
+    LOG(ERROR) << "create server setup failed, " << setup.status().message();
+    return retcode::FAIL;
+  }
+  *server_setup = std::move(setup).value();
+  if (server_cache_ != nullptr) {
+    EcdhServerCache::Entry entry;
+    entry.server_key = server_key;
+    server_setup->SerializeToString(&entry.server_setup);
+    auto ret = server_cache_->Store(dataset_fingerprint_, setup_client_size,
+                                    entry);
+    if (ret != retcode::SUCCESS) {
+      LOG(WARNING) << "store ecdh server cache of dataset: "
+                   << options_.dataset_id << " failed";
+    }
+  }
+  return retcode::SUCCESS;
+}
+
 retcode EcdhPsiOperator::InitRequest(psi_proto::Request* psi_request) {
   CHECK_TASK_STOPPED(retcode::FAIL);
   std::string request_str;
@@ -324,7 +737,8 @@ retcode EcdhPsiOperator::PreparePSIResponse(psi_proto::Response&& psi_response,
 }
 
 retcode EcdhPsiOperator::RecvInitParam(size_t* client_dataset_size,
-                                       bool* reveal_intersection) {
+                                       bool* reveal_intersection,
+                                       size_t* stream_batch_size) {
   CHECK_TASK_STOPPED(retcode::FAIL);
   VLOG(5) << "begin to recvInitParam ";
   std::string init_param_str;
@@ -350,6 +764,13 @@ retcode EcdhPsiOperator::RecvInitParam(size_t* client_dataset_size,
   }
   reveal_flag = it->second.value_int32() > 0;
   VLOG(5) << "reveal_intersection_: " << reveal_flag;
+  // absent for client which does not stream
+  *stream_batch_size = 0;
+  it = parm_map.find("stream_batch_size");
+  if (it != parm_map.end() && it->second.value_int64() > 0) {
+    *stream_batch_size = it->second.value_int64();
+  }
+  VLOG(5) << "stream_batch_size: " << *stream_batch_size;
   VLOG(5) << "end of recvInitParam ";
   return retcode::SUCCESS;
 }
@@ -23,6 +23,8 @@
 #include <vector>
 
 #include "src/primihub/kernel/psi/operator/base_psi.h"
+#include "src/primihub/kernel/psi/operator/ecdh_batch_engine.h"
+#include "src/primihub/kernel/psi/operator/ecdh_server_cache.h"
 #include "private_set_intersection/cpp/psi_client.h"
 #include "src/primihub/protos/common.pb.h"
 #include "src/primihub/protos/psi.pb.h"
@@ -32,7 +34,11 @@ namespace primihub::psi {
 namespace openminded_psi = private_set_intersection;
 class EcdhPsiOperator : public BasePsiOperator {
  public:
-  explicit EcdhPsiOperator(const Options& options) : BasePsiOperator(options) {}
+  explicit EcdhPsiOperator(const Options& options) : BasePsiOperator(options) {
+    engine_ = std::make_unique<EcdhBatchEngine>(options.ecdh_thread_num);
+    // server sorts response, client learns intersection size only
+    reveal_intersection_ = !CardinalityOnly();
+  }
   retcode OnExecute(const std::vector<std::string>& input,
                     std::vector<std::string>* result) override;
 
@@ -52,17 +58,65 @@ class EcdhPsiOperator : public BasePsiOperator {
     const std::unique_ptr<openminded_psi::PsiClient>& client,
     rpc::PsiResponse& response,
     std::vector<std::string>* result);
+  /**
+   * streaming mode, input is encrypted and sent batch by batch,
+   * at most kStreamWindow batches are in flight, so encrypted data
+   * held by both parties is bounded by batch size instead of set size.
+   * encrypt and send of later batches overlap double encryption
+   * on server and matching of earlier batches
+  */
+  retcode ExecuteAsClientByStream(const std::vector<std::string>& input,
+                                  std::vector<std::string>* result);
   // server method
   retcode ExecuteAsServer(const std::vector<std::string>& input);
   retcode InitRequest(psi_proto::Request* psi_request);
   retcode PreparePSIResponse(psi_proto::Response&& psi_response,
                              psi_proto::ServerSetup&& setup);
-  retcode RecvInitParam(size_t* client_dataset_size, bool* reveal_intersection);
+  retcode RecvInitParam(size_t* client_dataset_size, bool* reveal_intersection,
+                        size_t* stream_batch_size);
+  /**
+   * server setup is built and sent while batches of client are processed
+  */
+  retcode ExecuteAsServerByStream(const std::vector<std::string>& input,
+                                  size_t num_client_elements,
+                                  bool reveal_intersection,
+                                  size_t batch_size);
+  std::string SetupKey() {return key_ + "_setup";}
+  /**
+   * server key and setup are taken from local cache if enabled and valid,
+   * otherwise a new key is created and cache_hit is false
+  */
+  retcode InitServerKey(const std::vector<std::string>& input,
+                        size_t num_client_elements,
+                        bool reveal_intersection,
+                        std::string* server_key,
+                        psi_proto::ServerSetup* server_setup,
+                        bool* cache_hit);
+  /**
+   * build setup by server key and store it to cache if enabled
+  */
+  retcode BuildServerSetup(const std::vector<std::string>& input,
+                           size_t num_client_elements,
+                           bool reveal_intersection,
+                           const std::string& server_key,
+                           psi_proto::ServerSetup* server_setup);
   void SetFpr(double fpr) {fpr_ = fpr;}
+  /**
+   * split input into psi_shard_num shards by key hash,
+   * each shard is run by its own operator concurrently,
+   * link key of shard operator is tagged by shard index
+  */
+  retcode ExecuteShards(const std::vector<std::string>& input,
+                        std::vector<std::string>* result);
 
  private:
   bool reveal_intersection_{true};
   double fpr_{0.0001};
+  std::unique_ptr<EcdhBatchEngine> engine_{nullptr};
+  std::unique_ptr<EcdhServerCache> server_cache_{nullptr};
+  std::string dataset_fingerprint_;
+  static constexpr char kServerCacheDir[] = "ecdh_psi_cache";
+  static constexpr size_t kStreamWindow = 4;
 };
 }  // namespace primihub::psi
 
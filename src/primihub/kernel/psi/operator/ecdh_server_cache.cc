@@ -0,0 +1,206 @@
+/*
+ * Copyright (c) 2023 by PrimiHub
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      https://www.apache.org/licenses/
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "src/primihub/kernel/psi/operator/ecdh_server_cache.h"
+#include <sys/stat.h>
+#include <unistd.h>
+#include <openssl/evp.h>
+#include <glog/logging.h>
+#include <cstdio>
+#include <fstream>
+#include <functional>
+#include <sstream>
+#include <thread>
+
+#include "src/primihub/util/endian_util.h"
+#include "src/primihub/util/file_util.h"
+
+namespace primihub::psi {
+namespace {
+constexpr char kCacheMagic[] = "PHECDHC1";
+constexpr size_t kCacheMagicSize = sizeof(kCacheMagic) - 1;
+
+class Sha256 {
+ public:
+  Sha256() {
+    ctx_ = EVP_MD_CTX_new();
+    EVP_DigestInit_ex(ctx_, EVP_sha256(), nullptr);
+  }
+  ~Sha256() {EVP_MD_CTX_free(ctx_);}
+  void Update(const void* data, size_t size) {
+    EVP_DigestUpdate(ctx_, data, size);
+  }
+  /**
+   * length is prefixed, so that concatenated items are unambiguous
+  */
+  void UpdateItem(const std::string& item) {
+    uint64_t be_len = htonll(item.size());
+    Update(&be_len, sizeof(be_len));
+    Update(item.data(), item.size());
+  }
+  std::string HexDigest() {
+    unsigned char digest[EVP_MAX_MD_SIZE];
+    unsigned int digest_len{0};
+    EVP_DigestFinal_ex(ctx_, digest, &digest_len);
+    static const char kHex[] = "0123456789abcdef";
+    std::string hex;
+    for (unsigned int i = 0; i < digest_len; i++) {
+      hex.push_back(kHex[digest[i] >> 4]);
+      hex.push_back(kHex[digest[i] & 0xf]);
+    }
+    return hex;
+  }
+
+ private:
+  EVP_MD_CTX* ctx_{nullptr};
+};
+
+void WriteItem(std::ofstream* out, const std::string& item) {
+  uint64_t be_len = htonll(item.size());
+  out->write(reinterpret_cast<char*>(&be_len), sizeof(be_len));
+  out->write(item.data(), item.size());
+}
+
+/**
+ * remain: bytes left in file, length read from a corrupted file
+ * must not be trusted before it is checked against it
+*/
+bool ReadItem(std::ifstream* in, uint64_t* remain, std::string* item) {
+  uint64_t be_len{0};
+  if (*remain < sizeof(be_len) ||
+      !in->read(reinterpret_cast<char*>(&be_len), sizeof(be_len))) {
+    return false;
+  }
+  *remain -= sizeof(be_len);
+  uint64_t len = ntohll(be_len);
+  if (len > *remain) {
+    return false;
+  }
+  item->resize(len);
+  if (!in->read(item->data(), item->size())) {
+    return false;
+  }
+  *remain -= len;
+  return true;
+}
+}  // namespace
+
+EcdhServerCache::EcdhServerCache(const std::string& cache_dir,
+                                 const std::string& dataset_id,
+                                 const std::vector<int>& key_columns,
+                                 double fpr,
+                                 bool reveal_intersection) :
+    cache_dir_(cache_dir) {
+  Sha256 hasher;
+  hasher.UpdateItem(dataset_id);
+  for (const auto col : key_columns) {
+    hasher.UpdateItem(std::to_string(col));
+  }
+  std::ostringstream ss;
+  ss << fpr;
+  hasher.UpdateItem(ss.str());
+  hasher.UpdateItem(reveal_intersection ? "reveal" : "hidden");
+  cache_key_ = hasher.HexDigest();
+}
+
+std::string EcdhServerCache::Fingerprint(
+    const std::vector<std::string>& input) {
+  Sha256 hasher;
+  for (const auto& item : input) {
+    hasher.UpdateItem(item);
+  }
+  return hasher.HexDigest();
+}
+
+uint64_t EcdhServerCache::ClientSizeBucket(uint64_t num_client_elements) {
+  uint64_t bucket = 1;
+  while (bucket < num_client_elements) {
+    bucket <<= 1;
+  }
+  return bucket;
+}
+
+std::string EcdhServerCache::EntryPath(uint64_t client_size_bucket) {
+  return cache_dir_ + "/" + cache_key_ + "_" +
+         std::to_string(client_size_bucket) + ".cache";
+}
+
+retcode EcdhServerCache::Load(const std::string& fingerprint,
+                              uint64_t client_size_bucket,
+                              Entry* entry) {
+  auto file_path = EntryPath(client_size_bucket);
+  if (!FileExists(file_path)) {
+    return retcode::FAIL;
+  }
+  std::ifstream in(file_path, std::ios::binary | std::ios::ate);
+  std::streamoff file_size = in.tellg();
+  in.seekg(0);
+  std::string magic(kCacheMagicSize, '\0');
+  std::string cached_fingerprint;
+  bool valid = file_size >= static_cast<std::streamoff>(kCacheMagicSize) &&
+               in.read(magic.data(), magic.size()) &&
+               magic == kCacheMagic;
+  uint64_t remain = valid ? file_size - kCacheMagicSize : 0;
+  valid = valid &&
+          ReadItem(&in, &remain, &cached_fingerprint) &&
+          ReadItem(&in, &remain, &entry->server_key) &&
+          ReadItem(&in, &remain, &entry->server_setup);
+  in.close();
+  if (!valid || cached_fingerprint != fingerprint) {
+    VLOG(3) << "ecdh server cache: " << file_path << " is stale, remove it";
+    RemoveFile(file_path);
+    return retcode::FAIL;
+  }
+  VLOG(3) << "load ecdh server cache: " << file_path;
+  return retcode::SUCCESS;
+}
+
+retcode EcdhServerCache::Store(const std::string& fingerprint,
+                               uint64_t client_size_bucket,
+                               const Entry& entry) {
+  auto file_path = EntryPath(client_size_bucket);
+  if (ValidateDir(file_path) != 0) {
+    LOG(ERROR) << "create dir for ecdh server cache: " << file_path
+               << " failed";
+    return retcode::FAIL;
+  }
+  // concurrent task never reads partial entry,
+  // tasks of node daemon share the process
+  auto tmp_path = file_path + ".tmp." + std::to_string(::getpid()) + "_" +
+      std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id()));
+  {
+    std::ofstream out(tmp_path, std::ios::binary | std::ios::trunc);
+    // entry holds server private key
+    ::chmod(tmp_path.c_str(), S_IRUSR | S_IWUSR);
+    out.write(kCacheMagic, kCacheMagicSize);
+    WriteItem(&out, fingerprint);
+    WriteItem(&out, entry.server_key);
+    WriteItem(&out, entry.server_setup);
+    if (!out.good()) {
+      LOG(ERROR) << "write ecdh server cache: " << tmp_path << " failed";
+      out.close();
+      RemoveFile(tmp_path);
+      return retcode::FAIL;
+    }
+  }
+  if (std::rename(tmp_path.c_str(), file_path.c_str()) != 0) {
+    LOG(ERROR) << "rename ecdh server cache to: " << file_path << " failed";
+    RemoveFile(tmp_path);
+    return retcode::FAIL;
+  }
+  VLOG(3) << "store ecdh server cache: " << file_path;
+  return retcode::SUCCESS;
+}
+}  // namespace primihub::psi
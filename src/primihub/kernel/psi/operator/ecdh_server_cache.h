@@ -0,0 +1,71 @@
+/*
+ * Copyright (c) 2023 by PrimiHub
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      https://www.apache.org/licenses/
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef SRC_PRIMIHUB_KERNEL_PSI_OPERATOR_ECDH_SERVER_CACHE_H_
+#define SRC_PRIMIHUB_KERNEL_PSI_OPERATOR_ECDH_SERVER_CACHE_H_
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "src/primihub/common/common.h"
+
+namespace primihub::psi {
+/**
+ * local disk cache of ecdh psi server key and setup message,
+ * so that the same server dataset intersected with many clients
+ * is encrypted only once.
+ * entry is keyed by dataset id, key columns, fpr, reveal flag and
+ * bucket of client set size, setup built for the bucket upper bound
+ * keeps false positive rate for any client set within the bucket.
+ * entry records fingerprint of dataset content, entry of changed
+ * dataset is removed when it is loaded.
+ * server reuses its private key for all clients hitting the entry
+*/
+class EcdhServerCache {
+ public:
+  struct Entry {
+    std::string server_key;
+    std::string server_setup;   // serialized psi_proto::ServerSetup
+  };
+  EcdhServerCache(const std::string& cache_dir,
+                  const std::string& dataset_id,
+                  const std::vector<int>& key_columns,
+                  double fpr,
+                  bool reveal_intersection);
+  /**
+   * sha256 of dataset content
+  */
+  static std::string Fingerprint(const std::vector<std::string>& input);
+  /**
+   * smallest power of 2 not less than num_client_elements
+  */
+  static uint64_t ClientSizeBucket(uint64_t num_client_elements);
+  /**
+   * return FAIL if no valid entry for fingerprint and bucket
+  */
+  retcode Load(const std::string& fingerprint, uint64_t client_size_bucket,
+               Entry* entry);
+  retcode Store(const std::string& fingerprint, uint64_t client_size_bucket,
+                const Entry& entry);
+
+ protected:
+  std::string EntryPath(uint64_t client_size_bucket);
+
+ private:
+  std::string cache_dir_;
+  std::string cache_key_;
+};
+}  // namespace primihub::psi
+#endif  // SRC_PRIMIHUB_KERNEL_PSI_OPERATOR_ECDH_SERVER_CACHE_H_
@@ -0,0 +1,399 @@
+/*
+ * Copyright (c) 2023 by PrimiHub
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      https://www.apache.org/licenses/
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "src/primihub/kernel/psi/operator/external_psi.h"
+#include <arpa/inet.h>
+#include <unistd.h>
+#include <glog/logging.h>
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <numeric>
+
+#include "src/primihub/kernel/psi/operator/factory.h"
+#include "src/primihub/kernel/psi/util.h"
+#include "src/primihub/util/endian_util.h"
+#include "src/primihub/util/file_util.h"
+#include "src/primihub/util/util.h"
+
+namespace primihub::psi {
+namespace {
+constexpr int64_t kMinBatchBytes = 1 << 20;
+constexpr int64_t kMaxBatchBytes = 64 << 20;
+constexpr size_t kMinBufferSize = 4 << 10;
+constexpr size_t kMaxBufferSize = 1 << 20;
+
+std::string Digest(const oc::block& hash) {
+  return std::string(reinterpret_cast<const char*>(&hash),
+                     ExternalPsiOperator::kDigestSize);
+}
+
+/**
+ * cell of bucket is the first byte of digest, bucket is taken from
+ * the high half of hash, so cells of a bucket are evenly filled
+*/
+size_t CellOf(size_t bucket, const char* digest) {
+  return bucket * ExternalPsiOperator::kCellPerBucket +
+         static_cast<uint8_t>(digest[0]);
+}
+
+/**
+ * record: digest, big endian uint32 length of key, key
+*/
+bool ReadRecord(std::ifstream* in, std::string* digest, std::string* key) {
+  digest->resize(ExternalPsiOperator::kDigestSize);
+  if (!in->read(digest->data(), digest->size())) {
+    return false;
+  }
+  uint32_t be_len{0};
+  if (!in->read(reinterpret_cast<char*>(&be_len), sizeof(be_len))) {
+    return false;
+  }
+  key->resize(ntohl(be_len));
+  return static_cast<bool>(in->read(key->data(), key->size()));
+}
+}  // namespace
+
+ExternalPsiOperator::ExternalPsiOperator(const Options& options,
+                                         PsiType psi_type,
+                                         const std::string& spill_dir) :
+    BasePsiOperator(options), psi_type_(psi_type), spill_dir_(spill_dir),
+    hasher_(options.psi_thread_num) {
+  for (size_t i = 0; i < kBucketNum; i++) {
+    bucket_path_.push_back(spill_dir_ + "/bucket_" + std::to_string(i));
+  }
+  bucket_buffer_.resize(kBucketNum);
+  cell_size_.resize(kCellNum, 0);
+  // a quarter of memory limit buffers records of all buckets
+  size_t memory_limit = options_.psi_memory_limit_mb << 20;
+  buffer_limit_ = std::clamp(memory_limit / 4 / kBucketNum,
+                             kMinBufferSize, kMaxBufferSize);
+}
+
+ExternalPsiOperator::~ExternalPsiOperator() {
+  for (const auto& file_path : bucket_path_) {
+    if (FileExists(file_path)) {
+      RemoveFile(file_path);
+    }
+  }
+  ::rmdir(spill_dir_.c_str());
+}
+
+int64_t ExternalPsiOperator::BatchBytes() const {
+  // batch is held as arrow table and materialized keys at the same time
+  int64_t batch_bytes = (options_.psi_memory_limit_mb << 20) / 8;
+  return std::clamp(batch_bytes, kMinBatchBytes, kMaxBatchBytes);
+}
+
+retcode ExternalPsiOperator::Spill(const arrow::Table& batch) {
+  if (batch.num_rows() == 0) {
+    return retcode::SUCCESS;
+  }
+  std::vector<oc::block> hashes;
+  auto ret = hasher_.HashTable(batch, &hashes);
+  if (ret != retcode::SUCCESS) {
+    return retcode::FAIL;
+  }
+  std::vector<int64_t> rows(batch.num_rows());
+  std::iota(rows.begin(), rows.end(), 0);
+  std::vector<std::string> keys;
+  ret = PsiCommonUtil().ExtractRowsFromTable(batch, rows, &keys);
+  if (ret != retcode::SUCCESS) {
+    return retcode::FAIL;
+  }
+  for (size_t i = 0; i < keys.size(); i++) {
+    auto bucket = KeyHasher::ShardOf(hashes[i], kBucketNum);
+    auto& buffer = bucket_buffer_[bucket];
+    uint32_t be_len = htonl(keys[i].size());
+    buffer.append(reinterpret_cast<const char*>(&hashes[i]), kDigestSize);
+    buffer.append(reinterpret_cast<char*>(&be_len), sizeof(be_len));
+    buffer.append(keys[i]);
+    cell_size_[CellOf(bucket, reinterpret_cast<const char*>(&hashes[i]))]++;
+    if (buffer.size() >= buffer_limit_) {
+      ret = FlushBucket(bucket);
+      if (ret != retcode::SUCCESS) {
+        return retcode::FAIL;
+      }
+    }
+  }
+  return retcode::SUCCESS;
+}
+
+retcode ExternalPsiOperator::FlushBucket(size_t bucket) {
+  auto& buffer = bucket_buffer_[bucket];
+  if (buffer.empty()) {
+    return retcode::SUCCESS;
+  }
+  const auto& file_path = bucket_path_[bucket];
+  if (ValidateDir(file_path) != 0) {
+    LOG(ERROR) << "create dir for psi spill file: " << file_path << " failed";
+    return retcode::FAIL;
+  }
+  std::ofstream out(file_path, std::ios::binary | std::ios::app);
+  out.write(buffer.data(), buffer.size());
+  if (!out.good()) {
+    LOG(ERROR) << "write psi spill file: " << file_path << " failed";
+    return retcode::FAIL;
+  }
+  buffer.clear();
+  return retcode::SUCCESS;
+}
+
+retcode ExternalPsiOperator::Execute(bool sync_result,
+                                     const ResultWriter& writer) {
+  if (GetPsiResultType() == PsiResultType::CARDINALITY) {
+    // count of each group would reveal more than the total
+    LOG(ERROR) << "cardinality psi is not supported by external psi";
+    return retcode::FAIL;
+  }
+  for (size_t i = 0; i < kBucketNum; i++) {
+    auto ret = FlushBucket(i);
+    if (ret != retcode::SUCCESS) {
+      return retcode::FAIL;
+    }
+    std::string().swap(bucket_buffer_[i]);
+  }
+  if (sync_result && GetPsiResultType() == PsiResultType::DIFFERENCE) {
+    LOG(WARNING) << "difference of client is not synced to server "
+                 << "by external psi";
+  }
+  size_t cells_per_group{0};
+  auto ret = ExchangeCellsPerGroup(
+      CellsPerGroup(options_.psi_memory_limit_mb), &cells_per_group);
+  if (ret != retcode::SUCCESS) {
+    return retcode::FAIL;
+  }
+  if (cells_per_group == 0) {
+    LOG(ERROR) << "keys of one hash cell exceed psi memory limit of "
+               << "one of parties, too many duplicated keys or "
+               << "psi_memory_limit_mb is too small";
+    return retcode::FAIL;
+  }
+  auto groups = GroupCells(cells_per_group);
+  VLOG(3) << "external psi runs " << groups.size() << " groups "
+          << "under memory limit(MB): " << options_.psi_memory_limit_mb;
+  uint64_t result_num{0};
+  for (size_t i = 0; i < groups.size(); i++) {
+    SCopedTimer timer;
+    std::vector<std::string> digests;
+    ret = LoadDigests(groups[i], &digests);
+    if (ret != retcode::SUCCESS) {
+      return retcode::FAIL;
+    }
+    if (digests.empty()) {
+      // protocol of every group runs on both parties
+      std::string dummy = KeyHasher::kShardDummyKey + PartyName();
+      digests.push_back(Digest(KeyHasher::HashKey(dummy)));
+    }
+    auto group_operator = CreateGroupOperator(i, groups.size());
+    if (group_operator == nullptr) {
+      return retcode::FAIL;
+    }
+    std::vector<std::string> result;
+    ret = group_operator->Execute(digests, sync_result, &result);
+    if (ret != retcode::SUCCESS) {
+      LOG(ERROR) << "psi of group: " << i << " failed";
+      return retcode::FAIL;
+    }
+    std::vector<std::string>().swap(digests);
+    std::sort(result.begin(), result.end());
+    ret = EmitResult(groups[i], result, writer);
+    if (ret != retcode::SUCCESS) {
+      return retcode::FAIL;
+    }
+    result_num += result.size();
+    VLOG(3) << "psi of group: " << i << "/" << groups.size() << " "
+            << "cells: [" << groups[i].first << ", " << groups[i].second
+            << ") time cost(ms): " << timer.timeElapse();
+  }
+  VLOG(3) << "external psi finished, result size: " << result_num;
+  return retcode::SUCCESS;
+}
+
+retcode ExternalPsiOperator::OnExecute(const std::vector<std::string>& input,
+                                       std::vector<std::string>* result) {
+  auto options = options_;
+  options.psi_memory_limit_mb = 0;
+  auto psi_operator = Factory::Create(psi_type_, options);
+  if (psi_operator == nullptr) {
+    LOG(ERROR) << "create psi operator failed";
+    return retcode::FAIL;
+  }
+  auto ret = psi_operator->OnExecute(input, result);
+  cardinality_ = psi_operator->Cardinality();
+  return ret;
+}
+
+size_t ExternalPsiOperator::CellsPerGroup(size_t memory_limit_mb) const {
+  uint64_t max_keys = std::max<uint64_t>(
+      (memory_limit_mb << 20) / kBytesPerKey, 1);
+  for (size_t width = kCellNum; width != 0; width /= 2) {
+    bool fit = true;
+    for (size_t begin = 0; begin < kCellNum && fit; begin += width) {
+      uint64_t keys = std::accumulate(cell_size_.begin() + begin,
+                                      cell_size_.begin() + begin + width,
+                                      uint64_t{0});
+      fit = keys <= max_keys;
+    }
+    if (fit) {
+      return width;
+    }
+  }
+  return 0;
+}
+
+retcode ExternalPsiOperator::ExchangeCellsPerGroup(size_t cells_per_group,
+                                                   size_t* agreed) {
+  uint64_t be_value = htonll(cells_per_group);
+  std::string self_data(reinterpret_cast<char*>(&be_value), sizeof(be_value));
+  auto key = key_ + "_cells_per_group";
+  auto ret = GetLinkContext()->Send(key, peer_node_, self_data);
+  if (ret != retcode::SUCCESS) {
+    LOG(ERROR) << "send cells per group to peer failed";
+    return retcode::FAIL;
+  }
+  std::string peer_data;
+  ret = GetLinkContext()->Recv(key, ProxyServerNode(), &peer_data);
+  if (ret != retcode::SUCCESS || peer_data.size() != sizeof(uint64_t)) {
+    LOG(ERROR) << "receive cells per group from peer failed";
+    return retcode::FAIL;
+  }
+  std::memcpy(&be_value, peer_data.data(), sizeof(uint64_t));
+  *agreed = std::min<size_t>(cells_per_group, ntohll(be_value));
+  return retcode::SUCCESS;
+}
+
+std::vector<ExternalPsiOperator::Group> ExternalPsiOperator::GroupCells(
+    size_t cells_per_group) const {
+  std::vector<Group> groups;
+  for (size_t begin = 0; begin < kCellNum; begin += cells_per_group) {
+    groups.emplace_back(begin, std::min(begin + cells_per_group, kCellNum));
+  }
+  return groups;
+}
+
+retcode ExternalPsiOperator::ScanGroup(const Group& group,
+                                       const RecordVisitor& visit) {
+  std::string digest;
+  std::string key;
+  size_t first_bucket = group.first / kCellPerBucket;
+  size_t last_bucket = (group.second - 1) / kCellPerBucket;
+  for (size_t i = first_bucket; i <= last_bucket; i++) {
+    size_t begin = std::max(group.first, i * kCellPerBucket);
+    size_t end = std::min(group.second, (i + 1) * kCellPerBucket);
+    uint64_t keys = std::accumulate(cell_size_.begin() + begin,
+                                    cell_size_.begin() + end, uint64_t{0});
+    if (keys == 0) {
+      continue;
+    }
+    std::ifstream in(bucket_path_[i], std::ios::binary);
+    while (ReadRecord(&in, &digest, &key)) {
+      auto cell = CellOf(i, digest.data());
+      if (cell < begin || cell >= end) {
+        continue;
+      }
+      if (visit(&digest, &key) != retcode::SUCCESS) {
+        return retcode::FAIL;
+      }
+    }
+    if (!in.eof()) {
+      LOG(ERROR) << "read psi spill file: " << bucket_path_[i] << " failed";
+      return retcode::FAIL;
+    }
+  }
+  return retcode::SUCCESS;
+}
+
+retcode ExternalPsiOperator::LoadDigests(const Group& group,
+                                         std::vector<std::string>* digests) {
+  uint64_t total = std::accumulate(cell_size_.begin() + group.first,
+                                   cell_size_.begin() + group.second,
+                                   uint64_t{0});
+  digests->clear();
+  digests->reserve(total);
+  auto ret = ScanGroup(group, [&](std::string* digest, std::string*) {
+    digests->push_back(*digest);
+    return retcode::SUCCESS;
+  });
+  if (ret != retcode::SUCCESS) {
+    return retcode::FAIL;
+  }
+  std::sort(digests->begin(), digests->end());
+  auto last = std::unique(digests->begin(), digests->end());
+  auto duplicate_num = std::distance(last, digests->end());
+  if (duplicate_num != 0) {
+    VLOG(5) << "item has duplicated time, count: " << duplicate_num;
+  }
+  digests->erase(last, digests->end());
+  return retcode::SUCCESS;
+}
+
+retcode ExternalPsiOperator::EmitResult(
+    const Group& group,
+    const std::vector<std::string>& sorted_result,
+    const ResultWriter& writer) {
+  if (sorted_result.empty()) {
+    return retcode::SUCCESS;
+  }
+  // duplicated key is emitted once if duplicate is filtered
+  std::vector<bool> emitted(sorted_result.size(), false);
+  std::vector<std::string> keys;
+  auto ret = ScanGroup(group, [&](std::string* digest, std::string* key) {
+    auto it = std::lower_bound(sorted_result.begin(), sorted_result.end(),
+                               *digest);
+    if (it == sorted_result.end() || *it != *digest) {
+      return retcode::SUCCESS;
+    }
+    auto index = std::distance(sorted_result.begin(), it);
+    if (options_.filter_duplicate) {
+      if (emitted[index]) {
+        return retcode::SUCCESS;
+      }
+      emitted[index] = true;
+    }
+    keys.push_back(std::move(*key));
+    if (keys.size() >= kEmitBatchSize) {
+      if (writer(keys) != retcode::SUCCESS) {
+        return retcode::FAIL;
+      }
+      keys.clear();
+    }
+    return retcode::SUCCESS;
+  });
+  if (ret != retcode::SUCCESS) {
+    return retcode::FAIL;
+  }
+  if (!keys.empty()) {
+    return writer(keys);
+  }
+  return retcode::SUCCESS;
+}
+
+std::unique_ptr<BasePsiOperator> ExternalPsiOperator::CreateGroupOperator(
+    size_t group_index, size_t group_num) {
+  auto options = options_;
+  options.psi_memory_limit_mb = 0;
+  options.channel_tag += "_part" + std::to_string(group_index);
+  // server cache entry of each group
+  options.dataset_id += "_part" + std::to_string(group_index) + "_of_" +
+      std::to_string(group_num);
+  auto psi_operator = Factory::Create(psi_type_, options);
+  if (psi_operator == nullptr) {
+    LOG(ERROR) << "create psi operator for group: " << group_index
+               << " failed";
+  }
+  return psi_operator;
+}
+}  // namespace primihub::psi
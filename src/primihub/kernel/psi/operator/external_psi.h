@@ -0,0 +1,125 @@
+/*
+ * Copyright (c) 2023 by PrimiHub
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      https://www.apache.org/licenses/
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef SRC_PRIMIHUB_KERNEL_PSI_OPERATOR_EXTERNAL_PSI_H_
+#define SRC_PRIMIHUB_KERNEL_PSI_OPERATOR_EXTERNAL_PSI_H_
+#include <functional>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "arrow/api.h"
+#include "src/primihub/kernel/psi/operator/base_psi.h"
+#include "src/primihub/kernel/psi/operator/key_hasher.h"
+
+namespace primihub::psi {
+/**
+ * out-of-core psi for datasets larger than memory.
+ * spill stage: keys are read batch by batch, each key is hashed and
+ * appended to one of kBucketNum bucket files on local disk by its hash,
+ * record of bucket file is digest of key followed by the key itself.
+ * bucket is further split into kCellPerBucket cells by the first byte of
+ * digest, which is independent of bucket.
+ * execute stage: each party finds the widest equal width of consecutive
+ * cells whose local records fit in its psi_memory_limit_mb, parties
+ * exchange only that width and take the narrower one, so neither record
+ * number of buckets nor of cells is revealed. task fails if records of a
+ * single cell exceed the limit. groups run one after another by psi
+ * operator of psi_type on digests, each over its own channel, a group
+ * narrower than a bucket reads its bucket file and keeps its own cells.
+ * key of result digest is read back from bucket files and handed over
+ * to result writer group by group, neither keys nor result are held in
+ * memory as a whole.
+ * digest is the first kDigestSize bytes of key hash, it fits in small
+ * string buffer, so digest takes no heap allocation.
+*/
+class ExternalPsiOperator : public BasePsiOperator {
+ public:
+  using ResultWriter =
+      std::function<retcode(const std::vector<std::string>& result)>;
+  ExternalPsiOperator(const Options& options, PsiType psi_type,
+                      const std::string& spill_dir);
+  ~ExternalPsiOperator();
+  using BasePsiOperator::Execute;
+  /**
+   * spill keys of batch, batch holds key columns read as string
+  */
+  retcode Spill(const arrow::Table& batch);
+  /**
+   * run psi group by group on spilled keys,
+   * result of each group is passed to writer as soon as it is available
+  */
+  retcode Execute(bool sync_result, const ResultWriter& writer);
+  /**
+   * keys in memory are handled by psi operator of psi_type directly
+  */
+  retcode OnExecute(const std::vector<std::string>& input,
+                    std::vector<std::string>* result) override;
+  /**
+   * bytes of data loaded per batch in spill stage
+  */
+  int64_t BatchBytes() const;
+  static constexpr size_t kBucketNum = 256;
+  static constexpr size_t kCellPerBucket = 256;
+  static constexpr size_t kCellNum = kBucketNum * kCellPerBucket;
+  static constexpr size_t kDigestSize = 15;
+  // estimated memory per digest, including psi protocol state
+  static constexpr size_t kBytesPerKey = 128;
+
+ protected:
+  using Group = std::pair<size_t, size_t>;    // [begin, end) of cells
+  retcode FlushBucket(size_t bucket);
+  /**
+   * the widest power of two cell number per group whose local records
+   * fit in memory_limit_mb, 0 if records of one cell exceed it
+  */
+  size_t CellsPerGroup(size_t memory_limit_mb) const;
+  /**
+   * agreed: the narrower width of both parties, 0 if any party fails
+  */
+  retcode ExchangeCellsPerGroup(size_t cells_per_group, size_t* agreed);
+  std::vector<Group> GroupCells(size_t cells_per_group) const;
+  /**
+   * sorted unique digests of cells in group
+  */
+  retcode LoadDigests(const Group& group, std::vector<std::string>* digests);
+  /**
+   * pass keys whose digest is in sorted_result to writer
+  */
+  retcode EmitResult(const Group& group,
+                     const std::vector<std::string>& sorted_result,
+                     const ResultWriter& writer);
+  std::unique_ptr<BasePsiOperator> CreateGroupOperator(size_t group_index,
+                                                       size_t group_num);
+
+ private:
+  using RecordVisitor =
+      std::function<retcode(std::string* digest, std::string* key)>;
+  /**
+   * read records of cells in group from bucket files
+  */
+  retcode ScanGroup(const Group& group, const RecordVisitor& visit);
+  static constexpr size_t kEmitBatchSize = 1 << 16;
+  PsiType psi_type_;
+  std::string spill_dir_;
+  KeyHasher hasher_;
+  std::vector<std::string> bucket_path_;
+  std::vector<std::string> bucket_buffer_;
+  std::vector<uint64_t> cell_size_;
+  size_t buffer_limit_{0};
+};
+}  // namespace primihub::psi
+#endif  // SRC_PRIMIHUB_KERNEL_PSI_OPERATOR_EXTERNAL_PSI_H_
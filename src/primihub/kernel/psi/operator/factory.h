@@ -6,9 +6,14 @@
 #include "src/primihub/kernel/psi/operator/base_psi.h"
 #include "src/primihub/kernel/psi/operator/kkrt_psi.h"
 #include "src/primihub/kernel/psi/operator/ecdh_psi.h"
+#include "src/primihub/kernel/psi/operator/cm20_psi.h"
+#include "src/primihub/kernel/psi/operator/mkkrt_psi.h"
 #ifdef SGX
 #include "src/primihub/kernel/psi/operator/tee_psi.h"
 #endif  // SGX
+#ifdef MPSO
+#include "src/primihub/kernel/psi/operator/mpso_psi.h"
+#endif  // MPSO
 #include "src/primihub/common/value_check_util.h"
 
 namespace primihub::psi {
@@ -24,9 +29,21 @@ class Factory {
     case PsiType::ECDH:
       operator_ptr = std::make_unique<EcdhPsiOperator>(options);
       break;
+    case PsiType::CM20:
+      operator_ptr = std::make_unique<Cm20PsiOperator>(options);
+      break;
+    case PsiType::MKKRT:
+      operator_ptr = std::make_unique<MKkrtPsiOperator>(options);
+      break;
     case PsiType::TEE:
       operator_ptr = CreateTeeOperator(options, executor);
       break;
+    case PsiType::MPSI:
+      operator_ptr = CreateMpsoOperator(options, false);
+      break;
+    case PsiType::MPSU:
+      operator_ptr = CreateMpsoOperator(options, true);
+      break;
     default:
       LOG(ERROR) << "unknown psi operator: " << static_cast<int>(psi_type);
       break;
@@ -48,6 +65,16 @@ class Factory {
     RaiseException(err_msg);
 #endif
     }
+  static std::unique_ptr<BasePsiOperator> CreateMpsoOperator(
+      const Options& options, bool is_union) {
+#ifdef MPSO
+    return std::make_unique<MpsoPsiOperator>(options, is_union);
+#else
+    std::string err_msg{"multi-party psi is not enabled"};
+    LOG(ERROR) << err_msg;
+    RaiseException(err_msg);
+#endif
+  }
 
 };
 }  // namespace primihub::psi
@@ -0,0 +1,230 @@
+/*
+ * Copyright (c) 2023 by PrimiHub
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      https://www.apache.org/licenses/
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "src/primihub/kernel/psi/operator/key_hasher.h"
+#include <glog/logging.h>
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <future>
+#include <thread>
+#include <unordered_set>
+
+#include "cryptoTools/Crypto/AES.h"
+#include "src/primihub/kernel/psi/util.h"
+
+namespace primihub::psi {
+namespace {
+constexpr size_t kBlockBytes = sizeof(oc::block);
+
+struct BlockValueHash {
+  size_t operator()(const std::pair<uint64_t, uint64_t>& value) const {
+    // block is output of aes, any part of it is uniformly distributed
+    return static_cast<size_t>(value.first);
+  }
+};
+}  // namespace
+
+KeyHasher::KeyHasher(size_t thread_num) {
+  if (thread_num == 0) {
+    thread_num = std::thread::hardware_concurrency() / 2;
+  }
+  thread_num_ = std::max<size_t>(thread_num, 1);
+}
+
+void KeyHasher::Absorb(uint64_t col_index, const std::string_view* values,
+                       size_t num, oc::block* state) {
+  std::array<size_t, kBatchSize> block_num;
+  size_t step_num{0};
+  for (size_t j = 0; j < num; j++) {
+    block_num[j] = (values[j].size() + kBlockBytes - 1) / kBlockBytes;
+    step_num = std::max(step_num, block_num[j] + 1);
+  }
+  // keys of batch are encrypted together to fill the aes pipeline,
+  // key which has less blocks than others runs dummy steps in the end
+  std::array<oc::block, kBatchSize> input;
+  std::array<oc::block, kBatchSize> output;
+  for (size_t step = 0; step < step_num; step++) {
+    for (size_t j = 0; j < num; j++) {
+      oc::block message;
+      if (step < block_num[j]) {
+        size_t offset = step * kBlockBytes;
+        size_t len = std::min(kBlockBytes, values[j].size() - offset);
+        u8 buf[kBlockBytes] = {0};
+        std::memcpy(buf, values[j].data() + offset, len);
+        message = oc::toBlock(buf);
+      } else {
+        message = oc::toBlock(col_index, values[j].size());
+      }
+      input[j] = state[j] ^ message;
+    }
+    oc::mAesFixedKey.ecbEncBlocks(input.data(), num, output.data());
+    for (size_t j = 0; j < num; j++) {
+      if (step <= block_num[j]) {
+        state[j] = output[j] ^ input[j];
+      }
+    }
+  }
+}
+
+oc::block KeyHasher::HashKey(const std::string& key) {
+  std::string_view key_view(key);
+  std::string_view sep(DATA_RECORD_SEP);
+  oc::block state = oc::ZeroBlock;
+  uint64_t col_index{0};
+  size_t pos{0};
+  while (true) {
+    auto sep_pos = key_view.find(sep, pos);
+    auto value = key_view.substr(pos, sep_pos - pos);
+    Absorb(col_index, &value, 1, &state);
+    if (sep_pos == std::string_view::npos) {
+      break;
+    }
+    pos = sep_pos + sep.size();
+    col_index++;
+  }
+  return state;
+}
+
+std::vector<KeyHasher::Range> KeyHasher::Partition(int64_t total) {
+  std::vector<Range> ranges;
+  int64_t range_num = std::min<int64_t>(thread_num_, total / kMinRangeSize);
+  range_num = std::max<int64_t>(range_num, 1);
+  int64_t range_size = total / range_num;
+  int64_t remainder = total % range_num;
+  int64_t begin = 0;
+  for (int64_t i = 0; i < range_num; i++) {
+    int64_t end = begin + range_size + (i < remainder ? 1 : 0);
+    ranges.emplace_back(begin, end);
+    begin = end;
+  }
+  return ranges;
+}
+
+retcode KeyHasher::HashKeys(const std::vector<std::string>& input,
+                            std::vector<oc::block>* result) {
+  result->resize(input.size());
+  auto ranges = Partition(input.size());
+  std::vector<std::future<void>> futs;
+  for (const auto& range : ranges) {
+    futs.push_back(std::async(std::launch::async, [&, range]() {
+      for (int64_t i = range.first; i < range.second; i++) {
+        (*result)[i] = HashKey(input[i]);
+      }
+    }));
+  }
+  for (auto&& fut : futs) {
+    fut.get();
+  }
+  return retcode::SUCCESS;
+}
+
+retcode KeyHasher::HashTable(const arrow::Table& table,
+                             std::vector<oc::block>* result) {
+  int num_cols = table.num_columns();
+  if (num_cols == 0) {
+    LOG(ERROR) << "no column selected";
+    return retcode::FAIL;
+  }
+  for (int col_i = 0; col_i < num_cols; col_i++) {
+    auto type = table.column(col_i)->type();
+    if (!ArrowKeyReader::IsValidType(type->id())) {
+      LOG(ERROR) << "Unsupported data type for Psi: type: " << type->name();
+      return retcode::FAIL;
+    }
+  }
+  result->assign(table.num_rows(), oc::ZeroBlock);
+  auto ranges = Partition(table.num_rows());
+  std::vector<std::future<void>> futs;
+  for (const auto& range : ranges) {
+    futs.push_back(std::async(std::launch::async, [&, range]() {
+      char scratch[kBatchSize][ArrowKeyReader::kScratchSize];
+      std::array<std::string_view, kBatchSize> values;
+      for (int col_i = 0; col_i < num_cols; col_i++) {
+        int64_t chunk_start{0};
+        for (const auto& chunk : table.column(col_i)->chunks()) {
+          int64_t chunk_end = chunk_start + chunk->length();
+          int64_t start = std::max(range.first, chunk_start);
+          int64_t end = std::min(range.second, chunk_end);
+          ArrowKeyReader reader(*chunk);
+          for (int64_t i = start; i < end; i += kBatchSize) {
+            size_t num = std::min<int64_t>(kBatchSize, end - i);
+            for (size_t j = 0; j < num; j++) {
+              values[j] = reader.Value(i + j - chunk_start, scratch[j]);
+            }
+            Absorb(col_i, values.data(), num, result->data() + i);
+          }
+          chunk_start = chunk_end;
+        }
+      }
+    }));
+  }
+  for (auto&& fut : futs) {
+    fut.get();
+  }
+  return retcode::SUCCESS;
+}
+
+size_t KeyHasher::ShardOf(const oc::block& hash, size_t shard_num) {
+  uint64_t value{0};
+  std::memcpy(&value,
+              reinterpret_cast<const char*>(&hash) + sizeof(uint64_t),
+              sizeof(uint64_t));
+  return value % shard_num;
+}
+
+size_t KeyHasher::ShardPaddedSize(size_t total, size_t shard_num) {
+  // shard size X is binomial with mean mu, by Bernstein inequality
+  // P[X >= mu + t] <= exp(-t^2 / (2 * mu + 2 * t / 3)) <= 2^-bits / shards
+  double mu = static_cast<double>(total) / shard_num;
+  double bound = kShardOverflowBits * std::log(2.0) + std::log(shard_num);
+  double t = bound / 3 + std::sqrt(bound * bound / 9 + 2 * mu * bound);
+  auto padded_size = static_cast<size_t>(std::ceil(mu + t));
+  return std::max<size_t>(std::min(padded_size, total), 1);
+}
+
+uint64_t KeyHasher::Fingerprint(const oc::block& hash, size_t bits) {
+  // low half of block, high half decides shard
+  uint64_t value{0};
+  std::memcpy(&value, &hash, sizeof(uint64_t));
+  return value >> (64 - bits);
+}
+
+int64_t KeyHasher::FilterDuplicate(std::vector<oc::block>* hashes,
+                                   std::vector<int64_t>* rows) {
+  auto& items = *hashes;
+  std::unordered_set<std::pair<uint64_t, uint64_t>, BlockValueHash>
+      dup(items.size());
+  rows->clear();
+  rows->reserve(items.size());
+  size_t num_kept{0};
+  for (size_t i = 0; i < items.size(); i++) {
+    std::pair<uint64_t, uint64_t> value;
+    std::memcpy(&value.first, &items[i], sizeof(uint64_t));
+    std::memcpy(&value.second,
+                reinterpret_cast<const char*>(&items[i]) + sizeof(uint64_t),
+                sizeof(uint64_t));
+    if (!dup.insert(value).second) {
+      continue;
+    }
+    items[num_kept++] = items[i];
+    rows->push_back(i);
+  }
+  int64_t duplicate_num = items.size() - num_kept;
+  items.resize(num_kept);
+  return duplicate_num;
+}
+}  // namespace primihub::psi
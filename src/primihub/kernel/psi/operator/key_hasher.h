@@ -0,0 +1,96 @@
+/*
+ * Copyright (c) 2023 by PrimiHub
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      https://www.apache.org/licenses/
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef SRC_PRIMIHUB_KERNEL_PSI_OPERATOR_KEY_HASHER_H_
+#define SRC_PRIMIHUB_KERNEL_PSI_OPERATOR_KEY_HASHER_H_
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "arrow/api.h"
+#include "cryptoTools/Common/Defines.h"
+#include "src/primihub/common/common.h"
+
+namespace primihub::psi {
+/**
+ * hash psi key to 128 bits block by fixed-key aes in
+ * Matyas-Meyer-Oseas mode, h = aes(h ^ m) ^ h ^ m.
+ * value of each key column is absorbed by 16 bytes,
+ * followed by a block of column index and value length,
+ * so that composite key is hashed column by column without concatenation.
+ * key of arrow table is hashed from value buffers directly,
+ * string key joined by DATA_RECORD_SEP gets the same block as the row of
+ * table it comes from, so both input forms work with each other.
+ * key is chosen by its owner, collision resistance against chosen key
+ * is not required by semi-honest psi.
+ * thread_num: 0 means half of cpu cores
+*/
+class KeyHasher {
+ public:
+  explicit KeyHasher(size_t thread_num = 0);
+  /**
+   * absorb value of key column col_index for num keys in batch,
+   * num is not greater than kBatchSize
+  */
+  static void Absorb(uint64_t col_index, const std::string_view* values,
+                     size_t num, oc::block* state);
+  static oc::block HashKey(const std::string& key);
+  retcode HashKeys(const std::vector<std::string>& input,
+                   std::vector<oc::block>* result);
+  retcode HashTable(const arrow::Table& table, std::vector<oc::block>* result);
+  /**
+   * remove duplicated hash, rows is row index of the first occurrence
+   * for each remaining hash, return number of removed items
+  */
+  static int64_t FilterDuplicate(std::vector<oc::block>* hashes,
+                                 std::vector<int64_t>* rows);
+  /**
+   * shard of hashed key for partitioned psi,
+   * parties put the same key into the same shard
+  */
+  static size_t ShardOf(const oc::block& hash, size_t shard_num);
+  /**
+   * every shard is padded to this size by dummy keys, so that size of
+   * a shard tells nothing more than total, which is public as in
+   * unsharded psi. it is exceeded with probability less than
+   * 2^-kShardOverflowBits if keys are distinct
+  */
+  static size_t ShardPaddedSize(size_t total, size_t shard_num);
+  /**
+   * the first bits of hashed key, bits is in [1, 64]
+  */
+  static uint64_t Fingerprint(const oc::block& hash, size_t bits);
+  static constexpr size_t kBatchSize = 8;
+  static constexpr size_t kShardOverflowBits = 40;
+  /**
+   * prefix of dummy keys padding shards, so that protocol of every shard
+   * runs on both parties, it never appears in result.
+   * party name is appended, so dummy keys of parties never meet,
+   * and position in shard when a shard holds more than one
+  */
+  static constexpr char kShardDummyKey[] = "\x01primihub_psi_empty_shard";
+
+ protected:
+  using Range = std::pair<int64_t, int64_t>;
+  std::vector<Range> Partition(int64_t total);
+
+ private:
+  static constexpr int64_t kMinRangeSize = 1 << 16;
+  size_t thread_num_{1};
+};
+}  // namespace primihub::psi
+#endif  // SRC_PRIMIHUB_KERNEL_PSI_OPERATOR_KEY_HASHER_H_
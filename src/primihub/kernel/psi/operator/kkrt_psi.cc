@@ -2,15 +2,19 @@
 #include "src/primihub/kernel/psi/operator/kkrt_psi.h"
 #include <utility>
 #include <algorithm>
+#include <future>
+#include <limits>
+#include <numeric>
+#include <thread>
 
 #include "cryptoTools/Network/IOService.h"
 #include "cryptoTools/Common/config.h"
 #include "cryptoTools/Common/Defines.h"
-#include "cryptoTools/Crypto/RandomOracle.h"
 #include "cryptoTools/Crypto/PRNG.h"
 #include "cryptoTools/Common/Timer.h"
 
 #include "src/primihub/util/network/message_interface.h"
+#include "src/primihub/kernel/psi/operator/key_hasher.h"
 #include "libPSI/PSI/Kkrt/KkrtPsiSender.h"
 #include "libOTe/NChooseOne/Kkrt/KkrtNcoOtReceiver.h"
 #include "libOTe/NChooseOne/Kkrt/KkrtNcoOtSender.h"
@@ -24,11 +28,130 @@ namespace primihub::psi {
 retcode KkrtPsiOperator::OnExecute(const std::vector<std::string>& input,
                                    std::vector<std::string>* result) {
   if (input.empty()) {
-    LOG(ERROR) << "no data is set for kkrt psi";
+    LOG(ERROR) << "no data is set for psi";
     return retcode::FAIL;
   }
+  SCopedTimer timer;
+  std::vector<oc::block> hashed_input;
+  KeyHasher(options_.psi_thread_num).HashKeys(input, &hashed_input);
+  VLOG(5) << "hash data cost time(ms): " << timer.timeElapse();
+  std::vector<uint64_t> result_index;
+  auto ret = ExecuteShards(hashed_input, &result_index);
+  if (ret != retcode::SUCCESS) {
+    return retcode::FAIL;
+  }
+  if (RoleValidation::IsClient(PartyName())) {
+    ret = this->GetResult(input, result_index, result);
+  }
+  return ret;
+}
+
+retcode KkrtPsiOperator::OnExecuteKeyTable(
+    const std::shared_ptr<arrow::Table>& key_table,
+    std::vector<std::string>* result) {
+  SCopedTimer timer;
+  std::vector<oc::block> hashed_input;
+  auto ret = KeyHasher(options_.psi_thread_num).HashTable(*key_table,
+                                                          &hashed_input);
+  if (ret != retcode::SUCCESS) {
+    return retcode::FAIL;
+  }
+  std::vector<int64_t> rows;
+  if (options_.filter_duplicate) {
+    auto duplicate_num = KeyHasher::FilterDuplicate(&hashed_input, &rows);
+    if (duplicate_num != 0) {
+      LOG(WARNING) << "item has duplicated time, count: " << duplicate_num;
+    }
+  } else {
+    rows.resize(hashed_input.size());
+    std::iota(rows.begin(), rows.end(), 0);
+  }
+  VLOG(5) << "hash data cost time(ms): " << timer.timeElapse();
+  if (hashed_input.empty()) {
+    LOG(ERROR) << "no data is set for psi";
+    return retcode::FAIL;
+  }
+  std::vector<uint64_t> result_index;
+  ret = ExecuteShards(hashed_input, &result_index);
+  if (ret != retcode::SUCCESS) {
+    return retcode::FAIL;
+  }
+  if (RoleValidation::IsClient(PartyName())) {
+    ret = this->GetResult(*key_table, rows, result_index, result);
+  }
+  return ret;
+}
+
+retcode KkrtPsiOperator::ExecuteShards(std::vector<oc::block>& input,
+                                       std::vector<uint64_t>* result_index) {
+  size_t shard_num = options_.psi_shard_num;
+  if (shard_num <= 1) {
+    return ExecuteProtocol(options_.channel_tag, input, result_index);
+  }
+  constexpr uint64_t kDummyIndex = std::numeric_limits<uint64_t>::max();
+  std::vector<std::vector<oc::block>> shard_input(shard_num);
+  // index in input of each shard element
+  std::vector<std::vector<uint64_t>> shard_index(shard_num);
+  for (uint64_t i = 0; i < input.size(); i++) {
+    auto shard = KeyHasher::ShardOf(input[i], shard_num);
+    shard_input[shard].push_back(input[i]);
+    shard_index[shard].push_back(i);
+  }
+  // every shard runs on the same padded size, so parties do not learn
+  // how the keys of each other split into shards
+  size_t padded_size = KeyHasher::ShardPaddedSize(input.size(), shard_num);
+  for (size_t i = 0; i < shard_num; i++) {
+    padded_size = std::max(padded_size, shard_input[i].size());
+  }
+  if (padded_size > KeyHasher::ShardPaddedSize(input.size(), shard_num)) {
+    LOG(WARNING) << "shard size exceeds padded size, duplicated keys? "
+                 << "the largest shard size is revealed: " << padded_size;
+  }
+  auto dummy_prefix = KeyHasher::kShardDummyKey + PartyName();
+  for (size_t i = 0; i < shard_num; i++) {
+    for (size_t j = shard_input[i].size(); j < padded_size; j++) {
+      shard_input[i].push_back(KeyHasher::HashKey(
+          dummy_prefix + "_" + std::to_string(i) + "_" + std::to_string(j)));
+      shard_index[i].push_back(kDummyIndex);
+    }
+  }
+  std::vector<std::vector<uint64_t>> shard_result(shard_num);
+  std::vector<std::future<retcode>> futs;
+  for (size_t i = 0; i < shard_num; i++) {
+    futs.push_back(std::async(std::launch::async, [&, i]() -> retcode {
+      auto shard_tag = options_.channel_tag + "_shard" + std::to_string(i);
+      return ExecuteProtocol(shard_tag, shard_input[i], &shard_result[i]);
+    }));
+  }
+  auto ret{retcode::SUCCESS};
+  for (size_t i = 0; i < shard_num; i++) {
+    if (futs[i].get() != retcode::SUCCESS) {
+      LOG(ERROR) << "psi of shard: " << i << " failed";
+      ret = retcode::FAIL;
+    }
+  }
+  if (ret != retcode::SUCCESS) {
+    return retcode::FAIL;
+  }
+  result_index->clear();
+  for (size_t i = 0; i < shard_num; i++) {
+    for (auto index : shard_result[i]) {
+      auto input_index = shard_index[i][index];
+      if (input_index != kDummyIndex) {
+        result_index->push_back(input_index);
+      }
+    }
+  }
+  VLOG(5) << "psi of " << shard_num << " shards finished, "
+          << "intersection size: " << result_index->size();
+  return retcode::SUCCESS;
+}
+
+retcode KkrtPsiOperator::ExecuteProtocol(const std::string& shard_tag,
+                                         std::vector<oc::block>& input,
+                                         std::vector<uint64_t>* result_index) {
   oc::IOService ios;
-  auto msg_interface = BuildChannelInterface();
+  auto msg_interface = BuildChannelInterface(shard_tag);
   if (msg_interface == nullptr) {
     LOG(ERROR) << "BuildChannelInterface failed";
     return retcode::FAIL;
@@ -36,16 +159,14 @@ retcode KkrtPsiOperator::OnExecute(const std::vector<std::string>& input,
   oc::Channel chl(ios, msg_interface.release());
   auto ret{retcode::SUCCESS};
   if (RoleValidation::IsClient(PartyName())) {
-    std::vector<uint64_t> result_index;
-    ret = KkrtRecv(chl, input, &result_index);
-    this->GetResult(input, result_index, result);
+    ret = KkrtRecv(chl, input, result_index);
   } else {
     ret = KkrtSend(chl, input);
   }
   return ret;
 }
 
-auto KkrtPsiOperator::BuildChannelInterface() ->
+auto KkrtPsiOperator::BuildChannelInterface(const std::string& channel_tag) ->
     std::unique_ptr<TaskMessagePassInterface> {
 //
   std::string peer_party_name;
@@ -73,16 +194,59 @@ auto KkrtPsiOperator::BuildChannelInterface() ->
   // The 'osuCrypto::Channel' will consider it to be a unique_ptr and will
   // reset the unique_ptr, so the 'osuCrypto::Channel' will delete it.
   auto msg_interface = std::make_unique<TaskMessagePassInterface>(
-      this->PartyName(), peer_party_name, link_ctx, send_channel, recv_channel);
+      this->PartyName(), peer_party_name, link_ctx, send_channel, recv_channel,
+      channel_tag);
   return msg_interface;
 }
 
+retcode KkrtPsiOperator::BuildChannels(oc::IOService* ios,
+                                       size_t channel_num,
+                                       const std::string& tag_prefix,
+                                       std::vector<oc::Channel>* chls) {
+  for (size_t i = chls->size(); i < channel_num; i++) {
+    std::string channel_tag;
+    if (!tag_prefix.empty() || i > 0) {
+      channel_tag = tag_prefix + "_chl" + std::to_string(i);
+    }
+    auto msg_interface = BuildChannelInterface(channel_tag);
+    if (msg_interface == nullptr) {
+      LOG(ERROR) << "BuildChannelInterface failed, channel: " << i;
+      return retcode::FAIL;
+    }
+    chls->emplace_back(*ios, msg_interface.release());
+  }
+  return retcode::SUCCESS;
+}
+
+retcode KkrtPsiOperator::ExchangeParam(oc::Channel& chl, uint64_t self_size,
+                                       uint64_t* peer_size,
+                                       size_t* thread_num) {
+  size_t self_thread_num = options_.psi_thread_num;
+  if (self_thread_num == 0) {
+    self_thread_num = std::thread::hardware_concurrency() / 2;
+  }
+  self_thread_num = std::max<size_t>(self_thread_num, 1);
+  std::vector<u64> data{self_size, self_thread_num};
+  chl.asyncSend(std::move(data));
+  std::vector<u64> dest;
+  chl.recv(dest);
+  if (dest.size() != 2) {
+    LOG(ERROR) << "invalid psi param from peer, size: " << dest.size();
+    return retcode::FAIL;
+  }
+  *peer_size = dest[0];
+  *thread_num = std::max<size_t>(std::min<size_t>(self_thread_num, dest[1]), 1);
+  VLOG(5) << "self size: " << self_size << " peer size: " << *peer_size
+          << " thread num: " << *thread_num;
+  return retcode::SUCCESS;
+}
+
 retcode KkrtPsiOperator::KkrtRecv(oc::Channel& chl,
-                                  const std::vector<std::string>& input,
+                                  std::vector<oc::block>& input,
                                   std::vector<uint64_t>* result_index) {
   u8 dummy[1];
   // oc::PRNG prng(_mm_set_epi32(4253465, 3434565, 234435, 23987045));
-  oc::PRNG prng(oc::block(time(nullptr), time(nullptr)));
+  oc::PRNG prng(oc::sysRandomSeed());
   u64 sendSize;
   // u64 recvSize = 10;
   u64 recvSize = input.size();
@@ -94,11 +258,7 @@ retcode KkrtPsiOperator::KkrtRecv(oc::Channel& chl,
 
   // LOG(INFO) << "send size:" << dest[0];
   sendSize = dest[0];
-  std::vector<oc::block> sendSet(sendSize), recvSet(recvSize);
   SCopedTimer timer;
-  HashDataParallel(input, &recvSet);
-  auto time_cost = timer.timeElapse();
-  VLOG(5) << "encrypt data cost time(ms): " << time_cost;
   oc::KkrtNcoOtReceiver otRecv;
   oc::KkrtPsiReceiver recvPSIs;
   // LOG(INFO) << "client step 1";
@@ -120,7 +280,7 @@ retcode KkrtPsiOperator::KkrtRecv(oc::Channel& chl,
   // LOG(INFO) << "client step 4";
   // auto mid = timer.setTimePoint("init");
   auto start_psi_protocol = timer.timeElapse();
-  recvPSIs.sendInput(recvSet, chl);
+  recvPSIs.sendInput(input, chl);
   auto end_psi_protocol = timer.timeElapse();
   auto psi_protocol_time_cost = end_psi_protocol - start_psi_protocol;
   VLOG(5) << "execute psi protocol cost(ms): " << psi_protocol_time_cost;
@@ -139,10 +299,10 @@ retcode KkrtPsiOperator::KkrtRecv(oc::Channel& chl,
 }
 
 retcode KkrtPsiOperator::KkrtSend(oc::Channel& chl,
-                                  const std::vector<std::string>& input) {
+                                  std::vector<oc::block>& input) {
   u8 dummy[1];
   // osuCrypto::PRNG prng(_mm_set_epi32(4253465, 3434565, 234435, 23987045));
-  oc::PRNG prng(oc::block(time(nullptr), time(nullptr)));
+  oc::PRNG prng(oc::sysRandomSeed());
   u64 sendSize = input.size();
   u64 recvSize;
 
@@ -154,10 +314,6 @@ retcode KkrtPsiOperator::KkrtSend(oc::Channel& chl,
   // LOG(INFO) << "recv size:" << dest[0];
   recvSize = dest[0];
   SCopedTimer timer;
-  std::vector<oc::block> set(sendSize);
-  HashDataParallel(input, &set);
-  auto time_cost = timer.timeElapse();
-  VLOG(5) << "encrypt data cost time(ms): " << time_cost;
 
   oc::KkrtNcoOtSender otSend;
   oc::KkrtPsiSender sendPSIs;
@@ -176,7 +332,7 @@ retcode KkrtPsiOperator::KkrtSend(oc::Channel& chl,
   VLOG(5) << "init psi sender cost(ms): " << init_sender_cost;
   // LOG(INFO) << "server step 4";
   auto start_psi_protocol = timer.timeElapse();
-  sendPSIs.sendInput(set, chl);
+  sendPSIs.sendInput(input, chl);
   // LOG(INFO) << "server step 5";
   auto end_psi_protocol = timer.timeElapse();
   auto psi_protocol_time_cost = end_psi_protocol - start_psi_protocol;
@@ -188,54 +344,4 @@ retcode KkrtPsiOperator::KkrtSend(oc::Channel& chl,
   // LOG(INFO) << "server step 7";
   return retcode::SUCCESS;
 }
-
-retcode KkrtPsiOperator::HashDataParallel(const std::vector<std::string>& input,
-                                          std::vector<oc::block>* result_ptr) {
-  if (result_ptr->size() != input.size()) {
-    result_ptr->resize(input.size());
-  }
-  auto& result = *result_ptr;
-  uint64_t data_size = input.size();
-  uint64_t MAX_BLOCK_NUM = 10000000;  // 1000W
-  uint64_t block_num = data_size / MAX_BLOCK_NUM;
-  if (data_size % MAX_BLOCK_NUM) {
-    block_num++;
-  }
-  if (block_num == 1) {
-    u8 block_size = sizeof(oc::block);
-    oc::RandomOracle sha1(block_size);
-    u8 hash_dest[block_size];                                       // NOLINT
-    for (u64 i = 0; i < data_size; ++i) {
-      sha1.Update((u8 *)input[i].data(), input[i].size());          // NOLINT
-      sha1.Final((u8 *)hash_dest);                                  // NOLINT
-      result[i] = oc::toBlock(hash_dest);
-      sha1.Reset();
-    }
-  } else {
-    std::vector<std::future<void>> futs;
-    for (uint64_t i = 0; i < block_num; i++) {
-      uint64_t start_i = i * MAX_BLOCK_NUM;
-      uint64_t end_i = std::min((i+1) * MAX_BLOCK_NUM, data_size);
-      futs.push_back(
-        std::async(
-          std::launch::async,
-          [&, start_i, end_i]() {
-            u8 block_size = sizeof(oc::block);
-            oc::RandomOracle sha1(block_size);
-            u8 hash_dest[block_size];                               // NOLINT
-            for (u64 index = start_i; index < end_i; ++index) {
-              sha1.Update((u8 *)input[index].data(),                // NOLINT
-                          input[index].size());
-              sha1.Final((u8 *)hash_dest);                          // NOLINT
-              result[index] = oc::toBlock(hash_dest);
-              sha1.Reset();
-            }
-          }));
-    }
-    for (auto&& fut : futs) {
-      fut.get();
-    }
-  }
-  return retcode::SUCCESS;
-}
 }  // namespace primihub::psi
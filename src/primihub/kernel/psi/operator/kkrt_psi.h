@@ -9,6 +9,7 @@
 
 #include "src/primihub/kernel/psi/operator/base_psi.h"
 #include "cryptoTools/Network/Channel.h"
+#include "cryptoTools/Network/IOService.h"
 #include "cryptoTools/Common/Defines.h"
 #include "libPSI/PSI/Kkrt/KkrtPsiReceiver.h"
 #include "src/primihub/util/network/message_interface.h"
@@ -20,15 +21,46 @@ class KkrtPsiOperator : public BasePsiOperator {
   explicit KkrtPsiOperator(const Options& options) : BasePsiOperator(options) {}
   retcode OnExecute(const std::vector<std::string>& input,
                     std::vector<std::string>* result) override;
+  retcode OnExecuteKeyTable(const std::shared_ptr<arrow::Table>& key_table,
+                            std::vector<std::string>* result) override;
 
  protected:
-  auto BuildChannelInterface() -> std::unique_ptr<TaskMessagePassInterface>;
+  /**
+   * run psi protocol on hashed keys,
+   * result_index is index of intersection in input, for client only
+  */
+  virtual retcode ExecuteProtocol(const std::string& shard_tag,
+                                  std::vector<oc::block>& input,
+                                  std::vector<uint64_t>* result_index);
+  /**
+   * split input into psi_shard_num shards and run protocol of shards
+   * concurrently, channels of shard are tagged by shard index.
+   * result_index of shards is merged as index of input
+  */
+  retcode ExecuteShards(std::vector<oc::block>& input,
+                        std::vector<uint64_t>* result_index);
+  /**
+   * channel_tag distinguishes parallel channels to the peer
+  */
+  auto BuildChannelInterface(const std::string& channel_tag = "") ->
+      std::unique_ptr<TaskMessagePassInterface>;
+  /**
+   * extend chls to channel_num channels to the peer on ios,
+   * the first one of empty tag_prefix is the same as single channel
+  */
+  retcode BuildChannels(oc::IOService* ios, size_t channel_num,
+                        const std::string& tag_prefix,
+                        std::vector<oc::Channel>* chls);
+  /**
+   * exchange set size and thread num with peer,
+   * thread_num is the smaller one of both parties
+  */
+  retcode ExchangeParam(oc::Channel& chl, uint64_t self_size,
+                        uint64_t* peer_size, size_t* thread_num);
   retcode KkrtRecv(oc::Channel& chl,
-                   const std::vector<std::string>& input,
+                   std::vector<oc::block>& input,
                    std::vector<uint64_t>* result_index);
-  retcode KkrtSend(oc::Channel& chl, const std::vector<std::string>& input);
-  retcode HashDataParallel(const std::vector<std::string>& input,
-                           std::vector<oc::block>* result);
+  retcode KkrtSend(oc::Channel& chl, std::vector<oc::block>& input);
 };
 }  // namespace primihub::psi
 #endif  // SRC_PRIMIHUB_KERNEL_PSI_OPERATOR_KKRT_PSI_H_
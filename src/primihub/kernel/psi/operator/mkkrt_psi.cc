@@ -0,0 +1,85 @@
+// "Copyright [2023] <PrimiHub>"
+#include "src/primihub/kernel/psi/operator/mkkrt_psi.h"
+#include <utility>
+
+#include "cryptoTools/Crypto/PRNG.h"
+#include "libPSI/PSI/MKkrt/MKkrtPsiReceiver.h"
+#include "libPSI/PSI/MKkrt/MKkrtPsiSender.h"
+
+#include "src/primihub/util/util.h"
+
+namespace primihub::psi {
+retcode MKkrtPsiOperator::ExecuteProtocol(const std::string& shard_tag,
+                                          std::vector<oc::block>& input,
+                                          std::vector<uint64_t>* result_index) {
+  oc::IOService ios;
+  std::vector<oc::Channel> chls;
+  auto ret = BuildChannels(&ios, 1, shard_tag, &chls);
+  if (ret != retcode::SUCCESS) {
+    return retcode::FAIL;
+  }
+  uint64_t peer_size{0};
+  size_t thread_num{1};
+  ret = ExchangeParam(chls[0], input.size(), &peer_size, &thread_num);
+  if (ret != retcode::SUCCESS) {
+    return retcode::FAIL;
+  }
+  std::vector<oc::Channel> mask_chls;
+  ret = BuildChannels(&ios, thread_num, shard_tag, &chls);
+  if (ret != retcode::SUCCESS) {
+    return retcode::FAIL;
+  }
+  ret = BuildChannels(&ios, thread_num, shard_tag + "_mask", &mask_chls);
+  if (ret != retcode::SUCCESS) {
+    return retcode::FAIL;
+  }
+  if (RoleValidation::IsClient(PartyName())) {
+    ret = MKkrtRecv(chls, mask_chls, input, peer_size, result_index);
+  } else {
+    ret = MKkrtSend(chls, mask_chls, input, peer_size);
+  }
+  return ret;
+}
+
+retcode MKkrtPsiOperator::MKkrtRecv(std::vector<oc::Channel>& chls,
+                                    std::vector<oc::Channel>& mask_chls,
+                                    std::vector<oc::block>& input,
+                                    uint64_t send_size,
+                                    std::vector<uint64_t>* result_index) {
+  oc::PRNG prng(oc::sysRandomSeed());
+  u64 recv_size = input.size();
+  SCopedTimer timer;
+
+  oc::MKkrtPsiReceiver recv_psi;
+  auto start_init = timer.timeElapse();
+  recv_psi.init(send_size, recv_size, kStatSecParam, chls,
+                prng.get<oc::block>());
+  auto end_init = timer.timeElapse();
+  VLOG(5) << "init psi receiver cost(ms): " << end_init - start_init;
+  recv_psi.sendInput(input, chls, mask_chls);
+  VLOG(5) << "execute psi protocol cost(ms): "
+          << timer.timeElapse() - end_init;
+  *result_index = std::move(recv_psi.mIntersection);
+  return retcode::SUCCESS;
+}
+
+retcode MKkrtPsiOperator::MKkrtSend(std::vector<oc::Channel>& chls,
+                                    std::vector<oc::Channel>& mask_chls,
+                                    std::vector<oc::block>& input,
+                                    uint64_t recv_size) {
+  oc::PRNG prng(oc::sysRandomSeed());
+  u64 send_size = input.size();
+  SCopedTimer timer;
+
+  oc::MKkrtPsiSender send_psi;
+  auto start_init = timer.timeElapse();
+  send_psi.init(send_size, recv_size, kStatSecParam, chls,
+                prng.get<oc::block>());
+  auto end_init = timer.timeElapse();
+  VLOG(5) << "init psi sender cost(ms): " << end_init - start_init;
+  send_psi.sendInput(input, chls, mask_chls);
+  VLOG(5) << "execute psi protocol cost(ms): "
+          << timer.timeElapse() - end_init;
+  return retcode::SUCCESS;
+}
+}  // namespace primihub::psi
@@ -0,0 +1,38 @@
+// "Copyright [2023] <PrimiHub>"
+#ifndef SRC_PRIMIHUB_KERNEL_PSI_OPERATOR_MKKRT_PSI_H_
+#define SRC_PRIMIHUB_KERNEL_PSI_OPERATOR_MKKRT_PSI_H_
+#include <vector>
+#include <string>
+
+#include "src/primihub/kernel/psi/operator/kkrt_psi.h"
+
+namespace primihub::psi {
+/**
+ * multi-threaded kkrt psi, bins of cuckoo hash table are split among
+ * psi_thread_num threads, each thread owns one ot channel and one
+ * mask channel, it suits high bandwidth network and large dataset
+*/
+class MKkrtPsiOperator : public KkrtPsiOperator {
+ public:
+  explicit MKkrtPsiOperator(const Options& options) :
+      KkrtPsiOperator(options) {}
+
+ protected:
+  retcode ExecuteProtocol(const std::string& shard_tag,
+                          std::vector<oc::block>& input,
+                          std::vector<uint64_t>* result_index) override;
+  retcode MKkrtRecv(std::vector<oc::Channel>& chls,
+                    std::vector<oc::Channel>& mask_chls,
+                    std::vector<oc::block>& input,
+                    uint64_t send_size,
+                    std::vector<uint64_t>* result_index);
+  retcode MKkrtSend(std::vector<oc::Channel>& chls,
+                    std::vector<oc::Channel>& mask_chls,
+                    std::vector<oc::block>& input,
+                    uint64_t recv_size);
+
+ private:
+  static constexpr uint64_t kStatSecParam = 40;
+};
+}  // namespace primihub::psi
+#endif  // SRC_PRIMIHUB_KERNEL_PSI_OPERATOR_MKKRT_PSI_H_
@@ -0,0 +1,78 @@
+/*
+ * Copyright (c) 2023 by PrimiHub
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      https://www.apache.org/licenses/
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "src/primihub/kernel/psi/operator/mpso_link_socket.h"
+#include <glog/logging.h>
+#include <algorithm>
+#include <cstring>
+#include <string_view>
+
+namespace primihub::psi {
+MpsoLinkSocket::MpsoLinkSocket(network::LinkContext* link_ctx,
+                               const std::string& self_party,
+                               const std::string& peer_party,
+                               const Node& peer_node,
+                               const Node& proxy_node) :
+    link_ctx_(link_ctx), peer_node_(peer_node), proxy_node_(proxy_node) {
+  std::string key_prefix =
+      link_ctx->request_id() + "_" + link_ctx->sub_task_id() + "_";
+  send_key_ = key_prefix + self_party + "_" + peer_party + "_mpso";
+  recv_key_ = key_prefix + peer_party + "_" + self_party + "_mpso";
+}
+
+MpsoLinkSocket::Awaiter MpsoLinkSocket::send(coproto::span<uint8_t> data,
+                                             macoro::stop_token token) {
+  std::string_view send_sv(reinterpret_cast<char*>(data.data()), data.size());
+  auto ret = link_ctx_->Send(send_key_, peer_node_, send_sv);
+  if (ret != retcode::SUCCESS) {
+    LOG(ERROR) << "send mpso data to: " << peer_node_.to_string()
+               << " failed, key: " << send_key_;
+    return Awaiter{{coproto::code::ioError, 0}};
+  }
+  return Awaiter{{coproto::error_code{}, data.size()}};
+}
+
+MpsoLinkSocket::Awaiter MpsoLinkSocket::recv(coproto::span<uint8_t> data,
+                                             macoro::stop_token token) {
+  size_t filled{0};
+  while (filled < data.size()) {
+    if (recv_offset_ == recv_buf_.size()) {
+      recv_buf_.clear();
+      recv_offset_ = 0;
+      auto ret = link_ctx_->Recv(recv_key_, proxy_node_, &recv_buf_);
+      if (ret != retcode::SUCCESS) {
+        LOG(ERROR) << "recv mpso data failed, key: " << recv_key_;
+        return Awaiter{{coproto::code::ioError, filled}};
+      }
+    }
+    size_t copy_size = std::min(data.size() - filled,
+                                recv_buf_.size() - recv_offset_);
+    std::memcpy(data.data() + filled, recv_buf_.data() + recv_offset_,
+                copy_size);
+    filled += copy_size;
+    recv_offset_ += copy_size;
+  }
+  return Awaiter{{coproto::error_code{}, filled}};
+}
+
+coproto::Socket MpsoLinkSocket::MakeSocket(network::LinkContext* link_ctx,
+                                           const std::string& self_party,
+                                           const std::string& peer_party,
+                                           const Node& peer_node,
+                                           const Node& proxy_node) {
+  return coproto::makeSocket(MpsoLinkSocket(link_ctx, self_party, peer_party,
+                                            peer_node, proxy_node));
+}
+}  // namespace primihub::psi
@@ -0,0 +1,79 @@
+/*
+ * Copyright (c) 2023 by PrimiHub
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      https://www.apache.org/licenses/
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef SRC_PRIMIHUB_KERNEL_PSI_OPERATOR_MPSO_LINK_SOCKET_H_
+#define SRC_PRIMIHUB_KERNEL_PSI_OPERATOR_MPSO_LINK_SOCKET_H_
+#include <memory>
+#include <string>
+#include <utility>
+
+#include <coproto/coproto.h>
+#include "src/primihub/common/common.h"
+#include "src/primihub/util/network/link_context.h"
+
+namespace primihub::psi {
+/**
+ * coproto socket between two parties of a task over LinkContext,
+ * so that volePSI based protocols share the node data path.
+ * messages go to peer node by send key, and are fetched from proxy node.
+ * coproto reads a byte stream, received message is buffered until
+ * the whole read is filled.
+ * operation completes before it is awaited, caller thread blocks on it.
+*/
+class MpsoLinkSocket {
+ public:
+  using Result = std::pair<coproto::error_code, uint64_t>;
+  /**
+   * awaitable which is always ready
+  */
+  struct Awaiter {
+    Result result;
+    bool await_ready() {return true;}
+    template<typename Handle>
+    void await_suspend(Handle) {}
+    Result await_resume() {return result;}
+  };
+
+  MpsoLinkSocket(network::LinkContext* link_ctx,
+                 const std::string& self_party,
+                 const std::string& peer_party,
+                 const Node& peer_node,
+                 const Node& proxy_node);
+  Awaiter send(coproto::span<uint8_t> data,
+               macoro::stop_token token = {});
+  Awaiter recv(coproto::span<uint8_t> data,
+               macoro::stop_token token = {});
+  void close() {}
+
+  /**
+   * build coproto socket to peer_party
+  */
+  static coproto::Socket MakeSocket(network::LinkContext* link_ctx,
+                                    const std::string& self_party,
+                                    const std::string& peer_party,
+                                    const Node& peer_node,
+                                    const Node& proxy_node);
+
+ private:
+  network::LinkContext* link_ctx_{nullptr};
+  Node peer_node_;
+  Node proxy_node_;
+  std::string send_key_;
+  std::string recv_key_;
+  std::string recv_buf_;
+  size_t recv_offset_{0};
+};
+}  // namespace primihub::psi
+#endif  // SRC_PRIMIHUB_KERNEL_PSI_OPERATOR_MPSO_LINK_SOCKET_H_
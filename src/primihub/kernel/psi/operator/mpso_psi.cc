@@ -0,0 +1,303 @@
+/*
+ * Copyright (c) 2023 by PrimiHub
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      https://www.apache.org/licenses/
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "src/primihub/kernel/psi/operator/mpso_psi.h"
+#include <glog/logging.h>
+#include <algorithm>
+#include <charconv>
+#include <fstream>
+#include <thread>
+#include <unordered_map>
+
+#include "cryptoTools/Crypto/PRNG.h"
+#include "cryptoTools/Crypto/RandomOracle.h"
+#include "circuit/TripleGen.h"
+#include "common/util.h"
+#include "mpso/MPSI.h"
+#include "mpso/MPSU.h"
+#include "shuffle/ShareCorrelationGen.h"
+#include "src/primihub/kernel/psi/operator/mpso_link_socket.h"
+#include "src/primihub/util/file_util.h"
+#include "src/primihub/util/util.h"
+
+namespace primihub::psi {
+namespace {
+// padding elements of union, real keys are less than 2^63
+constexpr uint64_t kDummyFlag = 1ull << 63;
+
+std::string BlockKey(const oc::block& item) {
+  return std::string(reinterpret_cast<const char*>(&item), sizeof(item));
+}
+}  // namespace
+
+retcode MpsoPsiOperator::OnExecute(const std::vector<std::string>& input,
+                                   std::vector<std::string>* result) {
+  if (options_.mpso_log_set_size == 0 || options_.mpso_log_set_size > 30) {
+    LOG(ERROR) << "invalid mpso_log_set_size: "
+               << options_.mpso_log_set_size;
+    return retcode::FAIL;
+  }
+  data_dir_ = CompletePath(kDataDir);
+  mpsu::setDataDir(data_dir_);
+  std::vector<std::string> parties;
+  DataParties(&parties);
+  if (parties.size() < 2 || parties[0] != PARTY_CLIENT) {
+    LOG(ERROR) << "multi-party psi needs " << PARTY_CLIENT
+               << " and at least one other data party";
+    return retcode::FAIL;
+  }
+  if (RoleValidation::IsDealer(PartyName())) {
+    if (!options_.mpso_offline) {
+      LOG(ERROR) << "dealer participates in offline phase only";
+      return retcode::FAIL;
+    }
+    return DealShareCorrelation(parties);
+  }
+  auto it = std::find(parties.begin(), parties.end(), PartyName());
+  if (it == parties.end()) {
+    LOG(ERROR) << "party: " << PartyName() << " is not data party";
+    return retcode::FAIL;
+  }
+  size_t self_index = it - parties.begin();
+  VLOG(5) << "party: " << PartyName() << " index: " << self_index
+          << " party num: " << parties.size();
+  if (options_.mpso_offline) {
+    return RunOffline(parties, self_index);
+  }
+  return RunOnline(input, parties, self_index, result);
+}
+
+retcode MpsoPsiOperator::BroadcastPsiResult(
+    std::vector<std::string>* result) {
+  if (options_.mpso_offline) {
+    return retcode::SUCCESS;
+  }
+  return BasePsiOperator::BroadcastPsiResult(result);
+}
+
+void MpsoPsiOperator::DataParties(std::vector<std::string>* parties) {
+  parties->clear();
+  parties->push_back(PARTY_CLIENT);
+  for (const auto& [party_name, node] : options_.party_info) {
+    if (RoleValidation::IsClient(party_name) ||
+        RoleValidation::IsTeeCompute(party_name) ||
+        RoleValidation::IsDealer(party_name)) {
+      continue;
+    }
+    parties->push_back(party_name);
+  }
+}
+
+retcode MpsoPsiOperator::BuildSockets(const std::vector<std::string>& parties,
+                                      size_t self_index,
+                                      std::vector<coproto::Socket>* chl) {
+  chl->clear();
+  for (size_t i = 0; i < parties.size(); i++) {
+    if (i == self_index) {
+      continue;
+    }
+    Node peer_node;
+    auto ret = GetNodeByName(parties[i], &peer_node);
+    if (ret != retcode::SUCCESS) {
+      return retcode::FAIL;
+    }
+    chl->push_back(MpsoLinkSocket::MakeSocket(GetLinkContext(), PartyName(),
+                                              parties[i], peer_node,
+                                              ProxyServerNode()));
+  }
+  return retcode::SUCCESS;
+}
+
+uint32_t MpsoPsiOperator::ThreadNum() {
+  size_t thread_num = options_.psi_thread_num;
+  if (thread_num == 0) {
+    thread_num = std::thread::hardware_concurrency() / 2;
+  }
+  return std::max<size_t>(thread_num, 1);
+}
+
+std::string MpsoPsiOperator::ShareCorrelationFile(size_t party_index,
+                                                  size_t party_num) {
+  // the same as name of ShareCorrelation::writeToFile
+  return data_dir_ + "/sc/sc_" + std::to_string(party_num) + "_" +
+         std::to_string(ShuffleSize(party_num)) + "_P" +
+         std::to_string(party_index + 1);
+}
+
+retcode MpsoPsiOperator::DealShareCorrelation(
+    const std::vector<std::string>& parties) {
+  size_t party_num = parties.size();
+  if (ValidateDir(ShareCorrelationFile(0, party_num)) != 0) {
+    LOG(ERROR) << "create dir for share correlation failed";
+    return retcode::FAIL;
+  }
+  SCopedTimer timer;
+  ShareCorrelation sc(party_num, ShuffleSize(party_num));
+  sc.generate();
+  sc.writeToFile();
+  sc.release();
+  VLOG(5) << "generate share correlation cost(ms): " << timer.timeElapse();
+  auto ret{retcode::SUCCESS};
+  for (size_t i = 0; i < party_num; i++) {
+    auto file_path = ShareCorrelationFile(i, party_num);
+    std::string contents;
+    Node party_node;
+    if (ReadFileContents(file_path, &contents) != retcode::SUCCESS ||
+        GetNodeByName(parties[i], &party_node) != retcode::SUCCESS ||
+        GetLinkContext()->Send(kShareCorrelationKey, party_node, contents) !=
+            retcode::SUCCESS) {
+      LOG(ERROR) << "deal share correlation to: " << parties[i] << " failed";
+      ret = retcode::FAIL;
+    }
+    // dealer keeps nothing of parties
+    RemoveFile(file_path);
+  }
+  return ret;
+}
+
+retcode MpsoPsiOperator::RecvShareCorrelation(size_t self_index,
+                                              size_t party_num) {
+  std::string contents;
+  auto ret = GetLinkContext()->Recv(kShareCorrelationKey, ProxyServerNode(),
+                                    &contents);
+  if (ret != retcode::SUCCESS) {
+    LOG(ERROR) << "recv share correlation from dealer failed";
+    return retcode::FAIL;
+  }
+  auto file_path = ShareCorrelationFile(self_index, party_num);
+  if (ValidateDir(file_path) != 0) {
+    LOG(ERROR) << "create dir for: " << file_path << " failed";
+    return retcode::FAIL;
+  }
+  std::ofstream out(file_path, std::ios::binary | std::ios::trunc);
+  out.write(contents.data(), contents.size());
+  if (!out.good()) {
+    LOG(ERROR) << "write share correlation to: " << file_path << " failed";
+    return retcode::FAIL;
+  }
+  return retcode::SUCCESS;
+}
+
+retcode MpsoPsiOperator::RunOffline(const std::vector<std::string>& parties,
+                                    size_t self_index) {
+  SCopedTimer timer;
+  auto ret = RecvShareCorrelation(self_index, parties.size());
+  if (ret != retcode::SUCCESS) {
+    return retcode::FAIL;
+  }
+  if (is_union_) {
+    if (ValidateDir(data_dir_ + "/triple/") != 0) {
+      LOG(ERROR) << "create dir for boolean triples failed";
+      return retcode::FAIL;
+    }
+    std::vector<coproto::Socket> chl;
+    ret = BuildSockets(parties, self_index, &chl);
+    if (ret != retcode::SUCCESS) {
+      return retcode::FAIL;
+    }
+    mpsu::tripleGenParty(self_index, parties.size(), SetSize(), ThreadNum(),
+                         chl);
+  }
+  VLOG(5) << "mpso offline phase cost(ms): " << timer.timeElapse();
+  return retcode::SUCCESS;
+}
+
+retcode MpsoPsiOperator::RunOnline(const std::vector<std::string>& input,
+                                   const std::vector<std::string>& parties,
+                                   size_t self_index,
+                                   std::vector<std::string>* result) {
+  uint32_t set_size = SetSize();
+  if (input.size() > set_size) {
+    LOG(ERROR) << "set size: " << input.size() << " exceeds "
+               << set_size << " prepared by offline phase";
+    return retcode::FAIL;
+  }
+  bool is_client = RoleValidation::IsClient(PartyName());
+  std::vector<oc::block> set(set_size);
+  std::unordered_map<std::string, uint64_t> block_index;
+  if (is_union_) {
+    for (size_t i = 0; i < input.size(); i++) {
+      const auto& item = input[i];
+      uint64_t value{0};
+      auto [end, ec] = std::from_chars(item.data(), item.data() + item.size(),
+                                       value);
+      if (ec != std::errc() || end != item.data() + item.size() ||
+          (value & kDummyFlag)) {
+        LOG(ERROR) << "key of multi-party union must be integer in "
+                   << "[0, 2^63), invalid key: " << item;
+        return retcode::FAIL;
+      }
+      set[i] = oc::toBlock(value);
+    }
+    for (size_t i = input.size(); i < set_size; i++) {
+      set[i] = oc::toBlock(kDummyFlag | i);
+    }
+  } else {
+    oc::RandomOracle hash(sizeof(oc::block));
+    for (size_t i = 0; i < input.size(); i++) {
+      hash.Update(input[i].data(), input[i].size());
+      hash.Final(set[i]);
+      hash.Reset();
+      if (is_client) {
+        block_index[BlockKey(set[i])] = i;
+      }
+    }
+    oc::PRNG prng(oc::sysRandomSeed());
+    for (size_t i = input.size(); i < set_size; i++) {
+      set[i] = prng.get<oc::block>();
+    }
+  }
+  std::vector<coproto::Socket> chl;
+  auto ret = BuildSockets(parties, self_index, &chl);
+  if (ret != retcode::SUCCESS) {
+    return retcode::FAIL;
+  }
+  SCopedTimer timer;
+  std::vector<oc::block> output;
+  if (is_union_) {
+    output = mpsu::MPSUParty(self_index, parties.size(), set_size, set,
+                             ThreadNum(), chl, false, false);
+  } else {
+    output = mpsu::MPSIParty(self_index, parties.size(), set_size, set,
+                             ThreadNum(), chl, false, false);
+  }
+  VLOG(5) << "mpso online phase cost(ms): " << timer.timeElapse();
+  if (!is_client) {
+    return retcode::SUCCESS;
+  }
+  if (is_union_) {
+    // output begins with own set, elements of others follow
+    result->assign(input.begin(), input.end());
+    for (size_t i = set_size; i < output.size(); i++) {
+      uint64_t value = output[i].get<uint64_t>(0);
+      if (value & kDummyFlag) {
+        continue;
+      }
+      result->push_back(std::to_string(value));
+    }
+    return retcode::SUCCESS;
+  }
+  std::vector<uint64_t> intersection_index;
+  intersection_index.reserve(output.size());
+  for (const auto& item : output) {
+    auto it = block_index.find(BlockKey(item));
+    if (it != block_index.end()) {
+      intersection_index.push_back(it->second);
+    }
+  }
+  std::sort(intersection_index.begin(), intersection_index.end());
+  return GetResult(input, intersection_index, result);
+}
+}  // namespace primihub::psi
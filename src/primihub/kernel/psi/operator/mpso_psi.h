@@ -0,0 +1,91 @@
+/*
+ * Copyright (c) 2023 by PrimiHub
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      https://www.apache.org/licenses/
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef SRC_PRIMIHUB_KERNEL_PSI_OPERATOR_MPSO_PSI_H_
+#define SRC_PRIMIHUB_KERNEL_PSI_OPERATOR_MPSO_PSI_H_
+#include <string>
+#include <vector>
+
+#include <coproto/coproto.h>
+#include "src/primihub/kernel/psi/operator/base_psi.h"
+
+namespace primihub::psi {
+/**
+ * multi-party private set intersection and union
+ * based on third_party/MPSU (volePSI).
+ * data parties are ordered as protocol index, CLIENT is party 0 and
+ * gets the result, the others follow by party name.
+ * every set is padded to 2^mpso_log_set_size elements.
+ * offline phase:
+ *   DEALER generates share correlation of multi-party shuffle,
+ *   and sends each data party its own part;
+ *   for union, data parties also generate boolean triples pairwise.
+ * online phase consumes the correlated randomness in local data dir,
+ * the randomness of one offline phase is for one online phase.
+ * union supports integer keys in [0, 2^63) only,
+ * because elements of other parties are revealed by their encoding
+*/
+class MpsoPsiOperator : public BasePsiOperator {
+ public:
+  MpsoPsiOperator(const Options& options, bool is_union) :
+      BasePsiOperator(options), is_union_(is_union) {}
+  retcode OnExecute(const std::vector<std::string>& input,
+                    std::vector<std::string>* result) override;
+  retcode BroadcastPsiResult(std::vector<std::string>* result) override;
+
+ protected:
+  /**
+   * union holds elements of the other parties
+  */
+  bool ResultInPeerSet() override {
+    return !is_union_ && BasePsiOperator::ResultInPeerSet();
+  }
+  /**
+   * data parties ordered by protocol index
+  */
+  void DataParties(std::vector<std::string>* parties);
+  /**
+   * chl[i] is socket with party i for i < self_index,
+   * and with party i + 1 otherwise
+  */
+  retcode BuildSockets(const std::vector<std::string>& parties,
+                       size_t self_index,
+                       std::vector<coproto::Socket>* chl);
+  retcode DealShareCorrelation(const std::vector<std::string>& parties);
+  retcode RecvShareCorrelation(size_t self_index, size_t party_num);
+  retcode RunOffline(const std::vector<std::string>& parties,
+                     size_t self_index);
+  retcode RunOnline(const std::vector<std::string>& input,
+                    const std::vector<std::string>& parties,
+                    size_t self_index,
+                    std::vector<std::string>* result);
+  /**
+   * elements of multi-party shuffle
+  */
+  uint32_t ShuffleSize(size_t party_num) {
+    return is_union_ ? SetSize() * (party_num - 1) : SetSize();
+  }
+  uint32_t SetSize() {return 1u << options_.mpso_log_set_size;}
+  uint32_t ThreadNum();
+  std::string ShareCorrelationFile(size_t party_index, size_t party_num);
+
+ private:
+  static constexpr char kDataDir[] = "mpso_data";
+  static constexpr char kShareCorrelationKey[] = "mpso_share_correlation";
+  bool is_union_{false};
+  std::string data_dir_;
+};
+}  // namespace primihub::psi
+#endif  // SRC_PRIMIHUB_KERNEL_PSI_OPERATOR_MPSO_PSI_H_
@@ -0,0 +1,237 @@
+/*
+ * Copyright (c) 2023 by PrimiHub
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      https://www.apache.org/licenses/
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "src/primihub/kernel/psi/operator/result_codec.h"
+#include <glog/logging.h>
+#include <limits>
+
+namespace primihub::psi {
+namespace {
+constexpr uint64_t kNoSize = std::numeric_limits<uint64_t>::max();
+}  // namespace
+
+void IndexCodec::PutVarint(uint64_t value, std::string* out) {
+  while (value >= 0x80) {
+    out->push_back(static_cast<char>((value & 0x7f) | 0x80));
+    value >>= 7;
+  }
+  out->push_back(static_cast<char>(value));
+}
+
+bool IndexCodec::GetVarint(std::string_view* in, uint64_t* value) {
+  uint64_t result{0};
+  for (size_t i = 0; i < in->size() && i < 10; i++) {
+    uint64_t byte = static_cast<uint8_t>((*in)[i]);
+    result |= (byte & 0x7f) << (7 * i);
+    if ((byte & 0x80) == 0) {
+      *value = result;
+      in->remove_prefix(i + 1);
+      return true;
+    }
+  }
+  return false;
+}
+
+size_t IndexCodec::VarintSize(uint64_t value) {
+  size_t size{1};
+  while (value >= 0x80) {
+    value >>= 7;
+    size++;
+  }
+  return size;
+}
+
+uint64_t IndexCodec::DeltaSize(const std::vector<uint64_t>& sorted_index) {
+  uint64_t size{0};
+  uint64_t next{0};
+  for (auto index : sorted_index) {
+    size += VarintSize(index - next);
+    next = index + 1;
+  }
+  return size;
+}
+
+uint64_t IndexCodec::ComplementSize(const std::vector<uint64_t>& sorted_index,
+                                    uint64_t universe) {
+  // complement is walked index by index, it is a candidate
+  // only when it is not larger than the set
+  if (sorted_index.size() < universe - sorted_index.size()) {
+    return kNoSize;
+  }
+  uint64_t size{0};
+  uint64_t next{0};
+  size_t pos{0};
+  for (uint64_t i = 0; i < universe; i++) {
+    if (pos < sorted_index.size() && sorted_index[pos] == i) {
+      pos++;
+      continue;
+    }
+    size += VarintSize(i - next);
+    next = i + 1;
+  }
+  return size;
+}
+
+IndexCodec::Form IndexCodec::ChooseForm(
+    const std::vector<uint64_t>& sorted_index, uint64_t universe) {
+  auto form{Form::DELTA};
+  uint64_t min_size = DeltaSize(sorted_index);
+  uint64_t bitmap_size = universe / 8 + (universe % 8 ? 1 : 0);
+  if (bitmap_size < min_size) {
+    form = Form::BITMAP;
+    min_size = bitmap_size;
+  }
+  if (ComplementSize(sorted_index, universe) < min_size) {
+    form = Form::COMPLEMENT;
+  }
+  return form;
+}
+
+retcode IndexCodec::Encode(const std::vector<uint64_t>& sorted_index,
+                           uint64_t universe,
+                           std::string* encoded) {
+  for (size_t i = 0; i < sorted_index.size(); i++) {
+    if (sorted_index[i] >= universe ||
+        (i > 0 && sorted_index[i] <= sorted_index[i - 1])) {
+      LOG(ERROR) << "index to encode is not sorted unique in universe: "
+                 << universe;
+      return retcode::FAIL;
+    }
+  }
+  auto form = ChooseForm(sorted_index, universe);
+  encoded->clear();
+  encoded->push_back(static_cast<char>(form));
+  PutVarint(universe, encoded);
+  PutVarint(sorted_index.size(), encoded);
+  switch (form) {
+  case Form::DELTA: {
+    uint64_t next{0};
+    for (auto index : sorted_index) {
+      PutVarint(index - next, encoded);
+      next = index + 1;
+    }
+    break;
+  }
+  case Form::BITMAP: {
+    size_t header_size = encoded->size();
+    encoded->resize(header_size + universe / 8 + (universe % 8 ? 1 : 0), 0);
+    auto bitmap = reinterpret_cast<uint8_t*>(encoded->data() + header_size);
+    for (auto index : sorted_index) {
+      bitmap[index / 8] |= 1 << (index % 8);
+    }
+    break;
+  }
+  case Form::COMPLEMENT: {
+    uint64_t next{0};
+    size_t pos{0};
+    for (uint64_t i = 0; i < universe; i++) {
+      if (pos < sorted_index.size() && sorted_index[pos] == i) {
+        pos++;
+        continue;
+      }
+      PutVarint(i - next, encoded);
+      next = i + 1;
+    }
+    break;
+  }
+  }
+  VLOG(5) << "encode " << sorted_index.size() << " indices of universe: "
+          << universe << " form: " << static_cast<int>(form)
+          << " bytes: " << encoded->size();
+  return retcode::SUCCESS;
+}
+
+retcode IndexCodec::Decode(std::string_view encoded,
+                           uint64_t* universe,
+                           std::vector<uint64_t>* sorted_index) {
+  uint64_t count{0};
+  if (encoded.empty()) {
+    LOG(ERROR) << "encoded index is empty";
+    return retcode::FAIL;
+  }
+  auto form = static_cast<Form>(encoded[0]);
+  encoded.remove_prefix(1);
+  if (!GetVarint(&encoded, universe) || !GetVarint(&encoded, &count) ||
+      count > *universe) {
+    LOG(ERROR) << "invalid header of encoded index";
+    return retcode::FAIL;
+  }
+  sorted_index->clear();
+  switch (form) {
+  case Form::DELTA: {
+    sorted_index->reserve(count);
+    uint64_t next{0};
+    for (uint64_t i = 0; i < count; i++) {
+      uint64_t gap{0};
+      if (!GetVarint(&encoded, &gap) || gap >= *universe - next) {
+        LOG(ERROR) << "invalid gap of encoded index: " << i;
+        return retcode::FAIL;
+      }
+      sorted_index->push_back(next + gap);
+      next += gap + 1;
+    }
+    break;
+  }
+  case Form::BITMAP: {
+    if (encoded.size() != *universe / 8 + (*universe % 8 ? 1 : 0)) {
+      LOG(ERROR) << "size of bitmap mismatches universe: " << *universe;
+      return retcode::FAIL;
+    }
+    sorted_index->reserve(count);
+    auto bitmap = reinterpret_cast<const uint8_t*>(encoded.data());
+    for (uint64_t i = 0; i < *universe; i++) {
+      if (bitmap[i / 8] & (1 << (i % 8))) {
+        sorted_index->push_back(i);
+      }
+    }
+    encoded.remove_prefix(encoded.size());
+    break;
+  }
+  case Form::COMPLEMENT: {
+    // encoder uses complement only when it is not larger than the set
+    if (count < *universe - count) {
+      LOG(ERROR) << "invalid count of complement encoded index: " << count;
+      return retcode::FAIL;
+    }
+    sorted_index->reserve(count);
+    uint64_t next{0};
+    for (uint64_t i = 0; i < *universe - count; i++) {
+      uint64_t gap{0};
+      if (!GetVarint(&encoded, &gap) || gap >= *universe - next) {
+        LOG(ERROR) << "invalid gap of complement encoded index: " << i;
+        return retcode::FAIL;
+      }
+      for (uint64_t j = next; j < next + gap; j++) {
+        sorted_index->push_back(j);
+      }
+      next += gap + 1;
+    }
+    for (uint64_t j = next; j < *universe; j++) {
+      sorted_index->push_back(j);
+    }
+    break;
+  }
+  default:
+    LOG(ERROR) << "unknown form of encoded index: " << static_cast<int>(form);
+    return retcode::FAIL;
+  }
+  if (!encoded.empty() || sorted_index->size() != count) {
+    LOG(ERROR) << "encoded index is corrupted, expected count: " << count
+               << " decoded: " << sorted_index->size();
+    return retcode::FAIL;
+  }
+  return retcode::SUCCESS;
+}
+}  // namespace primihub::psi
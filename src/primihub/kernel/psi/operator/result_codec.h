@@ -0,0 +1,63 @@
+/*
+ * Copyright (c) 2023 by PrimiHub
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      https://www.apache.org/licenses/
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef SRC_PRIMIHUB_KERNEL_PSI_OPERATOR_RESULT_CODEC_H_
+#define SRC_PRIMIHUB_KERNEL_PSI_OPERATOR_RESULT_CODEC_H_
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "src/primihub/common/common.h"
+
+namespace primihub::psi {
+/**
+ * compact encoding of sorted unique indices in [0, universe),
+ * form is chosen by density of indices:
+ *   DELTA: gap between neighbouring indices as varint, for sparse set
+ *   BITMAP: one bit for each index of universe
+ *   COMPLEMENT: DELTA of indices absent from set, for nearly full set
+ * size of each candidate form is computed and the smallest one is used.
+ * encoded data: form(1 byte), varint of universe, varint of count, body
+*/
+class IndexCodec {
+ public:
+  enum class Form : uint8_t {
+    DELTA = 0,
+    BITMAP = 1,
+    COMPLEMENT = 2,
+  };
+  static retcode Encode(const std::vector<uint64_t>& sorted_index,
+                        uint64_t universe,
+                        std::string* encoded);
+  static retcode Decode(std::string_view encoded,
+                        uint64_t* universe,
+                        std::vector<uint64_t>* sorted_index);
+  static Form ChooseForm(const std::vector<uint64_t>& sorted_index,
+                         uint64_t universe);
+
+ protected:
+  static void PutVarint(uint64_t value, std::string* out);
+  static bool GetVarint(std::string_view* in, uint64_t* value);
+  static size_t VarintSize(uint64_t value);
+  /**
+   * bytes of gaps of sorted_index as varint
+  */
+  static uint64_t DeltaSize(const std::vector<uint64_t>& sorted_index);
+  static uint64_t ComplementSize(const std::vector<uint64_t>& sorted_index,
+                                 uint64_t universe);
+};
+}  // namespace primihub::psi
+#endif  // SRC_PRIMIHUB_KERNEL_PSI_OPERATOR_RESULT_CODEC_H_
@@ -15,6 +15,8 @@
  */
 #include "src/primihub/kernel/psi/util.h"
 #include <glog/logging.h>
+#include <charconv>
+#include <functional>
 #include <string>
 #include <set>
 #include <future>
@@ -27,6 +29,84 @@
 #include "src/primihub/common/value_check_util.h"
 
 namespace primihub::psi {
+namespace {
+template <typename ArrowType>
+std::string_view FormatNumeric(const arrow::Array& array,
+                               int64_t index, char* scratch) {
+  auto value =
+      static_cast<const arrow::NumericArray<ArrowType>&>(array).Value(index);
+  auto res = std::to_chars(scratch, scratch + ArrowKeyReader::kScratchSize,
+                           value);
+  return std::string_view(scratch, res.ptr - scratch);
+}
+}  // namespace
+
+bool ArrowKeyReader::IsValidType(const arrow::Type::type& type_id) {
+  switch (type_id) {
+  case arrow::Type::STRING:
+  case arrow::Type::BINARY:
+  case arrow::Type::LARGE_STRING:
+  case arrow::Type::LARGE_BINARY:
+  case arrow::Type::FIXED_SIZE_BINARY:
+  case arrow::Type::INT8:
+  case arrow::Type::UINT8:
+  case arrow::Type::INT16:
+  case arrow::Type::UINT16:
+  case arrow::Type::INT32:
+  case arrow::Type::UINT32:
+  case arrow::Type::INT64:
+  case arrow::Type::UINT64:
+    return true;
+  default:
+    return false;
+  }
+}
+
+std::string_view ArrowKeyReader::Value(int64_t index, char* scratch) const {
+  if (array_.IsNull(index)) {
+    return std::string_view();
+  }
+  switch (type_id_) {
+  case arrow::Type::STRING:
+  case arrow::Type::BINARY: {
+    int32_t len{0};
+    auto value =
+        static_cast<const arrow::BinaryArray&>(array_).GetValue(index, &len);
+    return std::string_view(reinterpret_cast<const char*>(value), len);
+  }
+  case arrow::Type::LARGE_STRING:
+  case arrow::Type::LARGE_BINARY: {
+    int64_t len{0};
+    auto value = static_cast<const arrow::LargeBinaryArray&>(array_)
+                     .GetValue(index, &len);
+    return std::string_view(reinterpret_cast<const char*>(value), len);
+  }
+  case arrow::Type::FIXED_SIZE_BINARY: {
+    auto& array = static_cast<const arrow::FixedSizeBinaryArray&>(array_);
+    return std::string_view(
+        reinterpret_cast<const char*>(array.GetValue(index)),
+        array.byte_width());
+  }
+  case arrow::Type::INT8:
+    return FormatNumeric<arrow::Int8Type>(array_, index, scratch);
+  case arrow::Type::UINT8:
+    return FormatNumeric<arrow::UInt8Type>(array_, index, scratch);
+  case arrow::Type::INT16:
+    return FormatNumeric<arrow::Int16Type>(array_, index, scratch);
+  case arrow::Type::UINT16:
+    return FormatNumeric<arrow::UInt16Type>(array_, index, scratch);
+  case arrow::Type::INT32:
+    return FormatNumeric<arrow::Int32Type>(array_, index, scratch);
+  case arrow::Type::UINT32:
+    return FormatNumeric<arrow::UInt32Type>(array_, index, scratch);
+  case arrow::Type::INT64:
+    return FormatNumeric<arrow::Int64Type>(array_, index, scratch);
+  case arrow::Type::UINT64:
+    return FormatNumeric<arrow::UInt64Type>(array_, index, scratch);
+  default:
+    return std::string_view();
+  }
+}
 
 bool PsiCommonUtil::isNumeric32Type(const arrow::Type::type& type_id) {
   static std::set<arrow::Type::type>
@@ -206,15 +286,22 @@ retcode PsiCommonUtil::LoadDatasetInternal(
     const std::vector<int>& col_index,
     std::vector<std::string>* col_data,
     std::vector<std::string>* col_names) {
-  auto cursor = driver->GetCursor(col_index);
-  if (cursor == nullptr) {
-    LOG(ERROR) << "get cursor for dataset failed";
+  std::shared_ptr<arrow::Table> table;
+  std::vector<std::string> table_col_names;
+  auto ret = LoadKeyTableInternal(driver, col_index, &table, &table_col_names);
+  if (ret != retcode::SUCCESS) {
     return retcode::FAIL;
   }
+  return LoadDatasetFromTable(table, col_index, col_data, col_names);
+}
+
+retcode PsiCommonUtil::KeySchema(std::shared_ptr<DataDriver>& driver,
+                                 const std::vector<int>& col_index,
+                                 std::vector<FieldType>* key_schema) {
   auto& schema = driver->dataSetAccessInfo()->Schema();
   // construct new schema and check data type for each selected columns,
   // float type is not allowed
-  std::decay_t<decltype(schema)> new_schema{};
+  key_schema->clear();
   for (const auto index : col_index) {
     auto filed = schema[index];
     auto& type = std::get<1>(filed);
@@ -226,20 +313,123 @@ retcode PsiCommonUtil::LoadDatasetInternal(
       RaiseException(ss.str());
     }
     type = arrow::Type::type::STRING;
-    new_schema.push_back(std::move(filed));
+    key_schema->push_back(std::move(filed));
   }
+  return retcode::SUCCESS;
+}
+
+retcode PsiCommonUtil::LoadKeyTableInternal(
+    std::shared_ptr<DataDriver>& driver,
+    const std::vector<int>& col_index,
+    std::shared_ptr<arrow::Table>* table,
+    std::vector<std::string>* col_names) {
+  auto cursor = driver->GetCursor(col_index);
+  if (cursor == nullptr) {
+    LOG(ERROR) << "get cursor for dataset failed";
+    return retcode::FAIL;
+  }
+  std::vector<FieldType> new_schema;
+  KeySchema(driver, col_index, &new_schema);
   auto ds = cursor->read(new_schema);
   if (ds == nullptr) {
     LOG(ERROR) << "get data failed";
     return retcode::FAIL;
   }
-  auto& table = std::get<std::shared_ptr<arrow::Table>>(ds->data);
-  int col_count = table->num_columns();
+  *table = std::get<std::shared_ptr<arrow::Table>>(ds->data);
+  int col_count = (*table)->num_columns();
   bool all_colum_valid = validationDataColum(col_index, col_count);
   if (!all_colum_valid) {
     return retcode::FAIL;
   }
-  return LoadDatasetFromTable(table, col_index, col_data, col_names);
+  col_names->clear();
+  for (int i = 0; i < col_count; i++) {
+    col_names->push_back((*table)->field(i)->name());
+  }
+  VLOG(0) << "data records loaded number: " << (*table)->num_rows();
+  return retcode::SUCCESS;
+}
+
+retcode PsiCommonUtil::LoadKeyTableByBatch(
+    std::shared_ptr<DataDriver>& driver,
+    const std::vector<int>& col_index,
+    int64_t batch_bytes,
+    const std::function<retcode(const arrow::Table&)>& consumer,
+    std::vector<std::string>* col_names) {
+  auto cursor = driver->GetCursor(col_index);
+  if (cursor == nullptr) {
+    LOG(ERROR) << "get cursor for dataset failed";
+    return retcode::FAIL;
+  }
+  std::vector<FieldType> new_schema;
+  KeySchema(driver, col_index, &new_schema);
+  col_names->clear();
+  for (const auto& field : new_schema) {
+    col_names->push_back(std::get<0>(field));
+  }
+  int64_t num_rows{0};
+  int64_t num_batches{0};
+  while (true) {
+    auto ds = cursor->ReadNextBatch(new_schema, batch_bytes);
+    if (ds == nullptr) {
+      break;
+    }
+    auto& table = std::get<std::shared_ptr<arrow::Table>>(ds->data);
+    if (!validationDataColum(col_index, table->num_columns())) {
+      return retcode::FAIL;
+    }
+    auto ret = consumer(*table);
+    if (ret != retcode::SUCCESS) {
+      LOG(ERROR) << "consume batch: " << num_batches << " failed";
+      return retcode::FAIL;
+    }
+    num_rows += table->num_rows();
+    num_batches++;
+  }
+  VLOG(0) << "data records loaded number: " << num_rows << " "
+          << "batches: " << num_batches;
+  return retcode::SUCCESS;
+}
+
+retcode PsiCommonUtil::ExtractRowsFromTable(
+    const arrow::Table& table,
+    const std::vector<int64_t>& rows,
+    std::vector<std::string>* col_data) {
+  col_data->clear();
+  col_data->resize(rows.size());
+  char scratch[ArrowKeyReader::kScratchSize];
+  for (int col_i = 0; col_i < table.num_columns(); col_i++) {
+    auto col_ptr = table.column(col_i);
+    if (!ArrowKeyReader::IsValidType(col_ptr->type()->id())) {
+      LOG(ERROR) << "Unsupported data type for Psi: type: "
+                 << col_ptr->type()->name();
+      return retcode::FAIL;
+    }
+    // first row of each chunk
+    std::vector<int64_t> chunk_start;
+    std::vector<ArrowKeyReader> readers;
+    int64_t num_rows{0};
+    for (const auto& chunk : col_ptr->chunks()) {
+      chunk_start.push_back(num_rows);
+      readers.emplace_back(*chunk);
+      num_rows += chunk->length();
+    }
+    for (size_t i = 0; i < rows.size(); i++) {
+      auto row = rows[i];
+      if (row < 0 || row >= num_rows) {
+        LOG(ERROR) << "row index: " << row << " is out of range: " << num_rows;
+        return retcode::FAIL;
+      }
+      auto it = std::upper_bound(chunk_start.begin(), chunk_start.end(), row);
+      size_t chunk_i = std::distance(chunk_start.begin(), it) - 1;
+      auto value = readers[chunk_i].Value(row - chunk_start[chunk_i], scratch);
+      auto& item = (*col_data)[i];
+      if (col_i != 0) {
+        item.append(DATA_RECORD_SEP);
+      }
+      item.append(value.data(), value.size());
+    }
+  }
+  return retcode::SUCCESS;
 }
 
 retcode PsiCommonUtil::LoadDatasetInternal(
@@ -264,9 +454,8 @@ retcode PsiCommonUtil::LoadDatasetInternal(
   return LoadDatasetFromTable(table, data_cols, col_array);
 }
 
-retcode PsiCommonUtil::SaveDataToCSVFile(
+std::shared_ptr<arrow::Table> PsiCommonUtil::MakeResultTable(
     const std::vector<std::string>& data,
-    const std::string& file_path,
     const std::vector<std::string>& col_names) {
   std::vector<std::shared_ptr<arrow::Array>> arrow_array;
   if (col_names.size() == 1) {
@@ -309,7 +498,14 @@ retcode PsiCommonUtil::SaveDataToCSVFile(
   }
   auto schema = std::make_shared<arrow::Schema>(schema_vector);
   // std::shared_ptr<arrow::Table>
-  auto table = arrow::Table::Make(schema, arrow_array);
+  return arrow::Table::Make(schema, arrow_array);
+}
+
+retcode PsiCommonUtil::SaveDataToCSVFile(
+    const std::vector<std::string>& data,
+    const std::string& file_path,
+    const std::vector<std::string>& col_names) {
+  auto table = MakeResultTable(data, col_names);
   auto driver = DataDirverFactory::getDriver("CSV", "test address");
   auto csv_driver = std::dynamic_pointer_cast<CSVDriver>(driver);
   if (ValidateDir(file_path)) {
@@ -327,6 +523,26 @@ retcode PsiCommonUtil::SaveDataToCSVFile(
   return retcode::SUCCESS;
 }
 
+retcode PsiCommonUtil::AppendDataToCSVFile(
+    const std::vector<std::string>& data,
+    const std::string& file_path,
+    const std::vector<std::string>& col_names) {
+  if (data.empty()) {
+    return retcode::SUCCESS;
+  }
+  auto table = MakeResultTable(data, col_names);
+  auto driver = DataDirverFactory::getDriver("CSV", "test address");
+  auto csv_driver = std::dynamic_pointer_cast<CSVDriver>(driver);
+  auto ret = csv_driver->Append(table, file_path);
+  if (ret != retcode::SUCCESS) {
+    std::stringstream ss;
+    ss << "Append PSI result to file " << file_path << " failed.";
+    RaiseException(ss.str());
+  }
+  VLOG(5) << "Append " << data.size() << " PSI result to " << file_path;
+  return retcode::SUCCESS;
+}
+
 retcode PsiCommonUtil::saveDataToCSVFile(
     const std::vector<std::string>& data,
     const std::string& file_path, const std::string& col_title) {
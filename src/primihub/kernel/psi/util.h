@@ -16,8 +16,10 @@
 
 #ifndef SRC_PRIMIHUB_KERNEL_PSI_UTIL_H_
 #define SRC_PRIMIHUB_KERNEL_PSI_UTIL_H_
+#include <functional>
 #include <memory>
 #include <string>
+#include <string_view>
 #include <vector>
 
 #include "src/primihub/common/common.h"
@@ -25,6 +27,29 @@
 #include "src/primihub/data_store/factory.h"
 
 namespace primihub::psi {
+/**
+ * read value of key column from arrow array without materializing string,
+ * numeric value is formatted to decimal in scratch, so that value is the
+ * same as the one read by string schema.
+ * null value is read as empty
+*/
+class ArrowKeyReader {
+ public:
+  static constexpr size_t kScratchSize = 24;
+  explicit ArrowKeyReader(const arrow::Array& array) :
+      array_(array), type_id_(array.type_id()) {}
+  static bool IsValidType(const arrow::Type::type& type_id);
+  /**
+   * scratch holds at least kScratchSize bytes, returned value refers to
+   * array buffer or scratch
+  */
+  std::string_view Value(int64_t index, char* scratch) const;
+
+ private:
+  const arrow::Array& array_;
+  arrow::Type::type type_id_;
+};
+
 class PsiCommonUtil {
  public:
   bool IsValidDataType(const arrow::Type::type& type_id);
@@ -48,6 +73,30 @@ class PsiCommonUtil {
                               const std::vector<int>& data_col,
                               std::vector<std::string>* col_data,
                               std::vector<std::string>* col_names);
+  /**
+   * load key columns as arrow table, values of columns are read as string
+  */
+  retcode LoadKeyTableInternal(std::shared_ptr<DataDriver>& driver,
+                               const std::vector<int>& col_index,
+                               std::shared_ptr<arrow::Table>* table,
+                               std::vector<std::string>* col_names);
+  /**
+   * load key columns batch by batch as LoadKeyTableInternal does,
+   * each batch is passed to consumer once it is read, so that memory
+   * is bounded by batch_bytes instead of the size of dataset
+  */
+  retcode LoadKeyTableByBatch(
+      std::shared_ptr<DataDriver>& driver,
+      const std::vector<int>& col_index,
+      int64_t batch_bytes,
+      const std::function<retcode(const arrow::Table&)>& consumer,
+      std::vector<std::string>* col_names);
+  /**
+   * materialize key of rows, multi-column key is joined by DATA_RECORD_SEP
+  */
+  retcode ExtractRowsFromTable(const arrow::Table& table,
+                               const std::vector<int64_t>& rows,
+                               std::vector<std::string>* col_data);
   retcode LoadDatasetInternal(const std::string& driver_name,
                               const std::string& conn_str,
                               const std::vector<int>& data_cols,
@@ -58,8 +107,27 @@ class PsiCommonUtil {
   retcode SaveDataToCSVFile(const std::vector<std::string>& data,
                             const std::string& file_path,
                             const std::vector<std::string>& col_title);
+  /**
+   * append data to csv file created by SaveDataToCSVFile,
+   * so that result is written part by part
+  */
+  retcode AppendDataToCSVFile(const std::vector<std::string>& data,
+                              const std::string& file_path,
+                              const std::vector<std::string>& col_title);
 
  protected:
+  /**
+   * schema of key columns, values are read as string
+  */
+  retcode KeySchema(std::shared_ptr<DataDriver>& driver,
+                    const std::vector<int>& col_index,
+                    std::vector<FieldType>* key_schema);
+  /**
+   * table of result, multi-column key is split by DATA_RECORD_SEP
+  */
+  std::shared_ptr<arrow::Table> MakeResultTable(
+      const std::vector<std::string>& data,
+      const std::vector<std::string>& col_names);
   /**
    * table with multi trunk
    * using multi-thread to process data for multi-trunk
@@ -36,6 +36,11 @@ using DatasetMeta = primihub::service::DatasetMeta;
 using DataBlock = primihub::DataServiceImpl::DataBlock;
 namespace pb_util = primihub::proto::util;
 namespace primihub {
+namespace {
+// blocks read ahead of the grpc writer
+constexpr uint64_t kDownloadBufferSize = 8 * LIMITED_PACKAGE_SIZE;
+}  // namespace
+
 grpc::Status DataServiceImpl::NewDataset(grpc::ServerContext *context,
                                           const rpc::NewDatasetRequest *request,
                                           rpc::NewDatasetResponse *response) {
@@ -100,13 +105,15 @@ grpc::Status DataServiceImpl::DownloadData(grpc::ServerContext* context,
   }
   // using pipeline mode to read and send data, make sure data sequence: fifo
   ThreadSafeQueue<DataBlock> resp_queue;
+  // reader is held back when writer is slower than disk
+  MemoryBudget read_budget(kDownloadBufferSize);
   std::atomic<bool> error{false};
   std::string error_msg;
   auto read_fut = std::async(
     std::launch::async,
     [&]() -> retcode {
       try {
-        auto ret = DownloadDataImpl(*request, &resp_queue);
+        auto ret = DownloadDataImpl(*request, &resp_queue, &read_budget);
         if (ret != retcode::SUCCESS) {
           LOG(ERROR) << "DownloadDataImpl encountes error";
           error.store(true);
@@ -119,12 +126,14 @@ grpc::Status DataServiceImpl::DownloadData(grpc::ServerContext* context,
         error_msg = e.what();
         error.store(true);
         resp_queue.shutdown();
+        return retcode::FAIL;
       }
     });
   // read data from
   do {
     DataBlock data_block;
     resp_queue.wait_and_pop(data_block);
+    read_budget.Release(data_block.data.size());
     if (data_block.is_last_block) {  // read end flag
       break;
     }
@@ -139,11 +148,17 @@ grpc::Status DataServiceImpl::DownloadData(grpc::ServerContext* context,
       resp.set_file_name(data_block.file_name);
       resp.set_data(data_block.data);
     }
-    writer->Write(resp);
+    if (!writer->Write(resp)) {
+      LOG(ERROR) << pb_util::TaskInfoToString(request_id)
+                 << "write data to client failed";
+      break;
+    }
     if (error.load(std::memory_order::memory_order_relaxed)) {
       break;
     }
   } while (true);
+  // unblock reader if writer stops early
+  read_budget.Shutdown();
   read_fut.get();
   return grpc::Status::OK;
 }
@@ -157,7 +172,8 @@ grpc::Status DataServiceImpl::UploadData(grpc::ServerContext* context,
 }
 
 retcode DataServiceImpl::DownloadDataImpl(const rpc::DownloadRequest& request,
-    ThreadSafeQueue<DataBlock>* data_queue) {
+    ThreadSafeQueue<DataBlock>* data_queue,
+    MemoryBudget* budget) {
   const auto& request_id = request.request_id();
   const auto& file_list = request.file_list();
   for (const auto& file_info : file_list) {
@@ -183,6 +199,11 @@ retcode DataServiceImpl::DownloadDataImpl(const rpc::DownloadRequest& request,
       size_t block_size = LIMITED_PACKAGE_SIZE;
       size_t block_bum = filesize / block_size;
       for (size_t i = 0 ; i < block_bum; i++) {
+        if (!budget->Acquire(block_size)) {
+          LOG(WARNING) << pb_util::TaskInfoToString(request_id)
+                       << "download is stopped";
+          return retcode::FAIL;
+        }
         DataBlock data_block;
         data_block.file_name = file_name;
         data_block.data.resize(block_size);
@@ -194,6 +215,11 @@ retcode DataServiceImpl::DownloadDataImpl(const rpc::DownloadRequest& request,
       LOG(INFO) << pb_util::TaskInfoToString(request_id)
                 << "last_block_size: " << last_block_size;
       if (last_block_size) {
+        if (!budget->Acquire(last_block_size)) {
+          LOG(WARNING) << pb_util::TaskInfoToString(request_id)
+                       << "download is stopped";
+          return retcode::FAIL;
+        }
         DataBlock data_block;
         data_block.file_name = file_name;
         data_block.data.resize(last_block_size);
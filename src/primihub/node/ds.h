@@ -33,6 +33,7 @@
 #include "src/primihub/data_store/factory.h"
 #include "src/primihub/common/config/server_config.h"
 #include "src/primihub/util/threadsafe_queue.h"
+#include "src/primihub/util/memory_budget.h"
 
 namespace primihub {
 class DataServiceImpl final: public rpc::DataSetService::Service {
@@ -63,8 +64,13 @@ class DataServiceImpl final: public rpc::DataSetService::Service {
                           rpc::UploadFileResponse* response);
 
  protected:
+  /**
+   * read blocks of requested files into data_queue,
+   * memory held by blocks not sent yet is bounded by budget
+  */
   retcode DownloadDataImpl(const rpc::DownloadRequest& request,
-                           ThreadSafeQueue<DataBlock>* data_queue);
+                           ThreadSafeQueue<DataBlock>* data_queue,
+                           MemoryBudget* budget);
   retcode UploadDataImpl(const rpc::DownloadRequest& request,
                          ThreadSafeQueue<DataBlock>* data_queue);
   retcode QueryResultImpl(const rpc::QueryResultRequest& request,
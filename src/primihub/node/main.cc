@@ -31,6 +31,7 @@
 #include "src/primihub/common/config/server_config.h"
 #include "src/primihub/service/dataset/service.h"
 #include "src/primihub/service/dataset/meta_service/factory.h"
+#include "src/primihub/util/network/grpc_channel_pool.h"
 #ifdef SGX
 #include "sgx/ra/service.h"
 #endif
@@ -86,6 +87,17 @@ void RunServer(primihub::VMNodeInterface* node_service,
 #endif
         // set the max message size to 128M
         builder->SetMaxReceiveMessageSize(128 * 1024 * 1024);
+        // accept keepalive ping of pooled channels of peers
+        auto& pool_cfg = server_config.getNodeConfig().link_cfg.channel_pool;
+        if (pool_cfg.enable) {
+          builder->AddChannelArgument(
+              GRPC_ARG_HTTP2_MIN_RECV_PING_INTERVAL_WITHOUT_DATA_MS,
+              pool_cfg.keepalive_time_ms);
+        }
+        if (pool_cfg.keepalive_without_calls) {
+          builder->AddChannelArgument(
+              GRPC_ARG_KEEPALIVE_PERMIT_WITHOUT_CALLS, 1);
+        }
     };
 
     if (host_config.use_tls()) {
@@ -146,6 +158,19 @@ int main(int argc, char **argv) {
     using DatasetService = primihub::service::DatasetService;
     auto dataset_manager = std::make_shared<DatasetService>(
         std::move(meta_service));
+    // grpc channels shared by tasks, connect to known peers in advance
+    auto& pool_cfg = node_cfg.link_cfg.channel_pool;
+    auto& channel_pool = primihub::network::GrpcChannelPool::GetInstance();
+    channel_pool.Init(pool_cfg);
+    if (host_config.use_tls()) {
+        grpc::SslCredentialsOptions ssl_opts;
+        ssl_opts.pem_root_certs = cert_config.rootCAContent();
+        ssl_opts.pem_private_key = cert_config.keyContent();
+        ssl_opts.pem_cert_chain = cert_config.certContent();
+        channel_pool.Warmup(pool_cfg.warmup_peers, &ssl_opts);
+    } else {
+        channel_pool.Warmup(pool_cfg.warmup_peers, nullptr);
+    }
     // service for task process
     auto node_service_impl = std::make_unique<primihub::VMNodeImpl>(
         config_file, dataset_manager);
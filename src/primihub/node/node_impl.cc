@@ -31,6 +31,7 @@
 #include "src/primihub/util/proto_log_helper.h"
 #include "uuid.h"                             // NOLINT
 #include "src/primihub/util/hash.h"
+#include "src/primihub/kernel/pir/operator/keyword_pir_impl/keyword_pir_serving.h"
 
 namespace pb_util = primihub::proto::util;
 namespace primihub {
@@ -70,6 +71,7 @@ retcode VMNodeImpl::Init() {
   ManageTaskOperatorThread();
   ProcessKillTaskThread();
   ReportAliveInfoThread();
+  PirServingThread();
   return retcode::SUCCESS;
 }
 void VMNodeImpl::ProcessKillTaskThread() {
@@ -159,6 +161,32 @@ static size_t WriteCallback(char* d, size_t n, size_t l, void* p) {
   return n * l;
 }
 
+void VMNodeImpl::PirServingThread() {
+  const auto& serving_cfg =
+      ServerConfig::getInstance().getNodeConfig().pir_serving;
+  if (!serving_cfg.enable) {
+    return;
+  }
+  pir::ConfigureResidentDb(serving_cfg.max_memory_bytes,
+                           serving_cfg.max_sessions_per_db,
+                           serving_cfg.admission_timeout_ms);
+  if (serving_cfg.preload_dbs.empty()) {
+    return;
+  }
+  pir_serving_fut_ = std::async(
+    std::launch::async,
+    []() -> void {
+      SET_THREAD_NAME("PreloadPirDb");
+      const auto& serving_cfg =
+          ServerConfig::getInstance().getNodeConfig().pir_serving;
+      auto ret = pir::PreloadResidentDb(serving_cfg.preload_dbs);
+      if (ret != retcode::SUCCESS) {
+        LOG(WARNING) << "some keyword pir dbs are not preloaded, "
+                     << "they are loaded by the first query";
+      }
+    });
+}
+
 void VMNodeImpl::ReportAliveInfoThread() {
   report_alive_info_fut_ = std::async(
     std::launch::async,
@@ -858,16 +886,16 @@ void VMNodeImpl::CleanFinishedSchedulerWorkerThread() {
 }
 
 // data communication related
-retcode VMNodeImpl::ProcessReceivedData(const rpc::TaskContext& task_info,
-                                        const std::string& key,
-                                        std::string&& data_buffer) {
+retcode VMNodeImpl::FetchWorkerLinkContext(const rpc::TaskContext& task_info,
+                                           std::shared_ptr<Worker>* worker,
+                                           network::LinkContext** link_ctx) {
   std::string worker_id = this->GetWorkerId(task_info);
-  auto finished_task = this->IsFinishedTask(worker_id);
   auto TASK_INFO_STR = pb_util::TaskInfoToString(task_info);
+  auto finished_task = this->IsFinishedTask(worker_id);
   if (std::get<0>(finished_task)) {
-    std::string err_msg = "Task Worker for ";
+    std::string err_msg;
     err_msg.append(TASK_INFO_STR)
-           .append("has finished");
+            .append("Task Worker has been finished");
     PH_LOG(ERROR, LogType::kTask) << err_msg;
     return retcode::FAIL;
   }
@@ -885,56 +913,89 @@ retcode VMNodeImpl::ProcessReceivedData(const rpc::TaskContext& task_info,
     PH_LOG(ERROR, LogType::kTask) << err_msg;
     return retcode::FAIL;
   }
-  auto& link_ctx = worker_ptr->getTask()->getTaskContext().getLinkContext();
-  if (link_ctx == nullptr) {
+  auto& link_ctx_ptr =
+      worker_ptr->getTask()->getTaskContext().getLinkContext();
+  if (link_ctx_ptr == nullptr) {
     std::string err_msg;
     err_msg.append(TASK_INFO_STR)
            .append("LinkContext is empty");
     PH_LOG(ERROR, LogType::kTask) << err_msg;
     return retcode::FAIL;
   }
-  size_t data_size = data_buffer.size();
-  auto& recv_queue = link_ctx->GetRecvQueue(key);
-  recv_queue.push(std::move(data_buffer));
-  PH_VLOG(5, LogType::kTask)
-      << TASK_INFO_STR
-      << "end of VMNodeImpl::Send, data total received size:" << data_size;
+  *link_ctx = link_ctx_ptr.get();
+  *worker = std::move(worker_ptr);
   return retcode::SUCCESS;
 }
 
-retcode VMNodeImpl::ProcessSendData(const rpc::TaskContext& task_info,
-                                    const std::string& key,
-                                    std::string* data_buffer) {
-  auto TASK_INFO_STR = pb_util::TaskInfoToString(task_info);
-  std::string worker_id = this->GetWorkerId(task_info);
-  auto finished_task = this->IsFinishedTask(worker_id);
-  if (std::get<0>(finished_task)) {
-    std::string err_msg;
-    err_msg.append(TASK_INFO_STR)
-            .append("Task Worker has been finished");
-    PH_LOG(ERROR, LogType::kTask) << err_msg;
+retcode VMNodeImpl::ProcessReceivedData(const rpc::TaskContext& task_info,
+                                        const std::string& key,
+                                        std::string&& data_buffer,
+                                        rpc::CompressType compress_type) {
+  std::shared_ptr<Worker> worker_ptr;
+  network::LinkContext* link_ctx{nullptr};
+  auto ret = FetchWorkerLinkContext(task_info, &worker_ptr, &link_ctx);
+  if (ret != retcode::SUCCESS) {
     return retcode::FAIL;
   }
-  auto ret = WaitUntilWorkerReady(worker_id, wait_worker_ready_timeout_ms_);
+  size_t data_size = data_buffer.size();
+  if (compress_type != rpc::CompressType::COMPRESS_NONE) {
+    std::string raw_data;
+    auto& compressor = link_ctx->compressor();
+    ret = compressor.Decompress(compress_type, data_buffer, &raw_data);
+    if (ret != retcode::SUCCESS) {
+      PH_LOG(ERROR, LogType::kTask)
+          << pb_util::TaskInfoToString(task_info)
+          << "decompress data for key: " << key << " failed";
+      return retcode::FAIL;
+    }
+    data_buffer = std::move(raw_data);
+    PH_VLOG(7, LogType::kTask)
+        << pb_util::TaskInfoToString(task_info)
+        << "key: " << key << " " << compressor.StatsToString();
+  }
+  ret = link_ctx->PushRecvData(key, std::move(data_buffer));
   if (ret != retcode::SUCCESS) {
     PH_LOG(ERROR, LogType::kTask)
-        << TASK_INFO_STR << "wati worker ready timeout";
+        << pb_util::TaskInfoToString(task_info)
+        << "buffer received data for key: " << key << " failed";
     return retcode::FAIL;
   }
-  auto worker_ptr = this->GetWorker(task_info);
-  if (worker_ptr == nullptr) {
-    std::string err_msg;
-    err_msg.append(TASK_INFO_STR)
-           .append("Task worker is not found");
-    PH_LOG(ERROR, LogType::kTask) << err_msg;
-    return retcode::FAIL;
+  PH_VLOG(5, LogType::kTask)
+      << pb_util::TaskInfoToString(task_info)
+      << "end of VMNodeImpl::Send, data total received size:" << data_size;
+  return retcode::SUCCESS;
+}
+
+bool VMNodeImpl::HasRecvBudget(const rpc::TaskContext& task_info,
+                               const std::string& key, size_t data_size) {
+  std::shared_ptr<Worker> worker_ptr;
+  network::LinkContext* link_ctx{nullptr};
+  auto ret = FetchWorkerLinkContext(task_info, &worker_ptr, &link_ctx);
+  if (ret != retcode::SUCCESS) {
+    // fails fast in ProcessReceivedData
+    return true;
   }
-  auto& link_ctx = worker_ptr->getTask()->getTaskContext().getLinkContext();
-  if (link_ctx == nullptr) {
-    std::string err_msg;
-    err_msg.append(TASK_INFO_STR)
-           .append("LinkContext is empty");
-    PH_LOG(ERROR, LogType::kTask) << err_msg;
+  return link_ctx->HasRecvBudget(key, data_size);
+}
+
+bool VMNodeImpl::WaitRecvBudget(const rpc::TaskContext& task_info,
+                                const std::string& key, size_t data_size) {
+  std::shared_ptr<Worker> worker_ptr;
+  network::LinkContext* link_ctx{nullptr};
+  auto ret = FetchWorkerLinkContext(task_info, &worker_ptr, &link_ctx);
+  if (ret != retcode::SUCCESS) {
+    return true;
+  }
+  return link_ctx->WaitRecvBudget(key, data_size);
+}
+
+retcode VMNodeImpl::ProcessSendData(const rpc::TaskContext& task_info,
+                                    const std::string& key,
+                                    std::string* data_buffer) {
+  std::shared_ptr<Worker> worker_ptr;
+  network::LinkContext* link_ctx{nullptr};
+  auto ret = FetchWorkerLinkContext(task_info, &worker_ptr, &link_ctx);
+  if (ret != retcode::SUCCESS) {
     return retcode::FAIL;
   }
   auto& send_queue = link_ctx->GetSendQueue(key);
@@ -948,40 +1009,19 @@ retcode VMNodeImpl::ProcessSendData(const rpc::TaskContext& task_info,
 retcode VMNodeImpl::ProcessForwardData(const rpc::TaskContext& task_info,
                                        const std::string& key,
                                        std::string* data_buffer) {
-  std::string worker_id = this->GetWorkerId(task_info);
-  auto TASK_INFO_STR = pb_util::TaskInfoToString(task_info);
-  auto finished_task = this->IsFinishedTask(worker_id);
-  if (std::get<0>(finished_task)) {
-    std::string err_msg;
-    err_msg.append(TASK_INFO_STR)
-            .append("Task Worker has been finished");
-    PH_LOG(ERROR, LogType::kTask) << err_msg;
-    return retcode::FAIL;
-  }
-  auto ret = WaitUntilWorkerReady(
-      worker_id, this->wait_worker_ready_timeout_ms_);
+  std::shared_ptr<Worker> worker_ptr;
+  network::LinkContext* link_ctx{nullptr};
+  auto ret = FetchWorkerLinkContext(task_info, &worker_ptr, &link_ctx);
   if (ret != retcode::SUCCESS) {
-    PH_LOG(ERROR, LogType::kTask)
-        << TASK_INFO_STR << ", wati worker ready is timeout";
-    return retcode::FAIL;
-  }
-  auto worker_ptr = this->GetWorker(task_info);
-  if (worker_ptr == nullptr) {
-    std::string err_msg;
-    err_msg.append(TASK_INFO_STR)
-           .append("Task worker is not found");
-    PH_LOG(ERROR, LogType::kTask) << err_msg;
     return retcode::FAIL;
   }
-  auto& link_ctx = worker_ptr->getTask()->getTaskContext().getLinkContext();
-  if (link_ctx == nullptr) {
-    std::string err_msg;
-    err_msg.append(TASK_INFO_STR).append("LinkContext is empty");
-    PH_LOG(ERROR, LogType::kTask) << err_msg;
+  auto& recv_queue = link_ctx->GetRecvQueue(key);
+  if (!recv_queue.wait_and_pop(*data_buffer)) {
+    PH_LOG(ERROR, LogType::kTask)
+        << pb_util::TaskInfoToString(task_info)
+        << "pop received data for key: " << key << " failed";
     return retcode::FAIL;
   }
-  auto& recv_queue = link_ctx->GetRecvQueue(key);
-  recv_queue.wait_and_pop(*data_buffer);
   auto& complete_queue = link_ctx->GetCompleteQueue(key);
   complete_queue.push(retcode::SUCCESS);
   return retcode::SUCCESS;
@@ -990,37 +1030,10 @@ retcode VMNodeImpl::ProcessForwardData(const rpc::TaskContext& task_info,
 retcode VMNodeImpl::ProcessCompleteStatus(const rpc::TaskContext& task_info,
                                           const std::string& key,
                                           uint64_t expected_complete_num) {
-//
-  std::string worker_id = this->GetWorkerId(task_info);
-  auto TASK_INFO_STR = pb_util::TaskInfoToString(task_info);
-  auto finished_task = this->IsFinishedTask(worker_id);
-  if (std::get<0>(finished_task)) {
-    std::string err_msg;
-    err_msg.append(TASK_INFO_STR)
-            .append("Task Worker has been finished");
-    PH_LOG(ERROR, LogType::kTask) << err_msg;
-    return retcode::FAIL;
-  }
-  auto ret = WaitUntilWorkerReady(
-      worker_id, this->wait_worker_ready_timeout_ms_);
+  std::shared_ptr<Worker> worker_ptr;
+  network::LinkContext* link_ctx{nullptr};
+  auto ret = FetchWorkerLinkContext(task_info, &worker_ptr, &link_ctx);
   if (ret != retcode::SUCCESS) {
-    PH_LOG(ERROR, LogType::kTask)
-        << TASK_INFO_STR << ", wati worker ready is timeout";
-    return retcode::FAIL;
-  }
-  auto worker_ptr = this->GetWorker(task_info);
-  if (worker_ptr == nullptr) {
-    std::string err_msg;
-    err_msg.append(TASK_INFO_STR)
-           .append("Task worker is not found");
-    PH_LOG(ERROR, LogType::kTask) << err_msg;
-    return retcode::FAIL;
-  }
-  auto& link_ctx = worker_ptr->getTask()->getTaskContext().getLinkContext();
-  if (link_ctx == nullptr) {
-    std::string err_msg;
-    err_msg.append(TASK_INFO_STR).append("LinkContext is empty");
-    PH_LOG(ERROR, LogType::kTask) << err_msg;
     return retcode::FAIL;
   }
   auto& complete_queue = link_ctx->GetCompleteQueue(key);
@@ -106,15 +106,46 @@ class VMNodeImpl {
   void ManageTaskOperatorThread();
   void ProcessKillTaskThread();
   void ReportAliveInfoThread();
+  /**
+   * configure resident keyword pir dbs and load preload_dbs in background
+  */
+  void PirServingThread();
 
   std::shared_ptr<service::DatasetService> GetDatasetService() {
     return dataset_service_;
   }
 
   // data process related
-  retcode ProcessReceivedData(const rpc::TaskContext& task_info,
-                              const std::string& key,
-                              std::string&& data_buffer);
+  /**
+   * find ready worker related to task_info and its link context,
+   * block until worker is ready or timeout.
+   * worker keeps link context alive as long as it is held by caller
+  */
+  retcode FetchWorkerLinkContext(const rpc::TaskContext& task_info,
+                                 std::shared_ptr<Worker>* worker,
+                                 network::LinkContext** link_ctx);
+  /**
+   * push data received from peer into recv queue,
+   * data compressed by peer is decompressed before pushed,
+   * never held back by flow control, see WaitRecvBudget
+  */
+  retcode ProcessReceivedData(
+      const rpc::TaskContext& task_info,
+      const std::string& key,
+      std::string&& data_buffer,
+      rpc::CompressType compress_type = rpc::CompressType::COMPRESS_NONE);
+  /**
+   * true if received data can be buffered without being held back
+   * by flow control
+  */
+  bool HasRecvBudget(const rpc::TaskContext& task_info,
+                     const std::string& key, size_t data_size);
+  /**
+   * block until received data can be buffered without exceeding
+   * flow control budget, return false if wait timeout
+  */
+  bool WaitRecvBudget(const rpc::TaskContext& task_info,
+                      const std::string& key, size_t data_size);
   retcode ProcessSendData(const rpc::TaskContext& task_info,
                           const std::string& key,
                           std::string* data_buffer);
@@ -184,6 +215,7 @@ class VMNodeImpl {
   ThreadSafeQueue<task_executor_container_t> kill_task_queue_;
   std::future<void> kill_task_queue_fut_;
   std::future<void> report_alive_info_fut_;
+  std::future<void> pir_serving_fut_;
   bool disable_report_{false};
 };
 }  // namespace primihub
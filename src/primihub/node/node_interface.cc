@@ -17,20 +17,753 @@
 #include "src/primihub/node/node_interface.h"
 #include <glog/logging.h>
 #include <algorithm>
+#include <atomic>
+#include <deque>
+#include <thread>
+#include <unordered_map>
 #include <utility>
 
 #include "src/primihub/util/util.h"
 #include "src/primihub/util/proto_log_helper.h"
 #include "src/primihub/util/log.h"
+#include "src/primihub/common/config/server_config.h"
+#include "src/primihub/util/network/task_request_codec.h"
+#include "src/primihub/util/network/link_compressor.h"
 
 namespace primihub {
+namespace {
+/**
+ * split data into LinkFrames of at most LIMITED_PACKAGE_SIZE bytes,
+ * a frame is sent even if data is empty
+*/
+void BuildLinkFrames(rpc::LinkFrame::FrameType type,
+                     uint64_t seq_no, const std::string& key,
+                     retcode ret_code, const std::string& msg_info,
+                     const std::string& data,
+                     std::deque<rpc::LinkFrame>* frames) {
+  size_t sended_size = 0;
+  size_t max_package_size = LIMITED_PACKAGE_SIZE;
+  size_t total_length = data.size();
+  do {
+    rpc::LinkFrame frame;
+    frame.set_type(type);
+    frame.set_seq_no(seq_no);
+    frame.set_key(key);
+    frame.set_data_len(total_length);
+    if (ret_code == retcode::SUCCESS) {
+      frame.set_ret_code(rpc::retcode::SUCCESS);
+    } else {
+      frame.set_ret_code(rpc::retcode::FAIL);
+      frame.set_msg_info(msg_info);
+    }
+    size_t data_len = std::min(max_package_size, total_length - sended_size);
+    frame.set_data(data.data() + sended_size, data_len);
+    sended_size += data_len;
+    frame.set_last(sended_size >= total_length);
+    frames->push_back(std::move(frame));
+  } while (sended_size < total_length);
+}
+}  // namespace
+
 VMNodeInterface::VMNodeInterface(std::unique_ptr<VMNodeImpl> node_impl) :
-    server_impl_(std::move(node_impl)) {}
+    server_impl_(std::move(node_impl)) {
+  StartSocketLinkServer();
+}
 
 VMNodeInterface::~VMNodeInterface() {
+  if (socket_link_server_ != nullptr) {
+    socket_link_server_->Stop();
+  }
+  // helper threads use server impl until they end
+  std::unique_lock<std::mutex> lck(helper_mtx_);
+  helper_cv_.wait(lck, [this]() {return helper_num_ == 0;});
+  lck.unlock();
   server_impl_.reset();
 }
 
+/**
+ * pop data from link queue of worker, the pop is parked in queue
+ * as continuation instead of blocking server thread.
+ * done is invoked exactly once unless Cancel returns true
+*/
+class VMNodeInterface::PendingLinkData :
+    public std::enable_shared_from_this<PendingLinkData> {
+ public:
+  enum class QueueType {
+    kSend = 0,
+    kRecv,
+  };
+  using Callback = std::function<void(retcode ret, std::string&& data)>;
+  PendingLinkData(VMNodeImpl* node_impl, QueueType queue_type,
+                  Callback done) :
+      node_impl_(node_impl), queue_type_(queue_type), done_(std::move(done)) {}
+
+  /**
+   * called when worker is ready
+  */
+  void Pop(const rpc::TaskContext& task_info, const std::string& key) {
+    std::shared_ptr<Worker> worker;
+    network::LinkContext* link_ctx{nullptr};
+    auto ret = node_impl_->FetchWorkerLinkContext(task_info, &worker,
+                                                  &link_ctx);
+    std::unique_lock<std::mutex> lck(mtx_);
+    if (state_ != State::kInit) {
+      return;
+    }
+    if (ret != retcode::SUCCESS) {
+      state_ = State::kDone;
+      lck.unlock();
+      done_(retcode::FAIL, std::string());
+      return;
+    }
+    // worker keeps link queue alive until data is popped
+    worker_ = std::move(worker);
+    complete_queue_ = &link_ctx->GetCompleteQueue(key);
+    queue_ = queue_type_ == QueueType::kSend ?
+        &link_ctx->GetSendQueue(key) : &link_ctx->GetRecvQueue(key);
+    state_ = State::kParked;
+    // callback may be invoked in place when data is available,
+    // it does not touch mtx_
+    pop_id_ = queue_->async_pop(
+        [self = shared_from_this()](bool ok, std::string&& data) {
+      self->OnPopped(ok, std::move(data));
+    });
+  }
+
+  /**
+   * return true if done will never be invoked
+  */
+  bool Cancel() {
+    std::lock_guard<std::mutex> lck(mtx_);
+    switch (state_) {
+    case State::kInit:
+      state_ = State::kCancelled;
+      return true;
+    case State::kParked:
+      if (queue_->cancel_async_pop(pop_id_)) {
+        state_ = State::kCancelled;
+        worker_.reset();
+        return true;
+      }
+      return false;
+    default:
+      return false;
+    }
+  }
+
+ protected:
+  void OnPopped(bool ok, std::string&& data) {
+    if (!ok) {
+      done_(retcode::FAIL, std::string());
+      return;
+    }
+    // make sure the send thread get the send data success
+    complete_queue_->push(retcode::SUCCESS);
+    done_(retcode::SUCCESS, std::move(data));
+  }
+
+ private:
+  enum class State {
+    kInit = 0,
+    kParked,
+    kDone,
+    kCancelled,
+  };
+  VMNodeImpl* node_impl_{nullptr};
+  QueueType queue_type_;
+  Callback done_;
+  std::mutex mtx_;
+  State state_{State::kInit};
+  std::shared_ptr<Worker> worker_{nullptr};
+  network::LinkContext::StringDataQueue* queue_{nullptr};
+  network::LinkContext::StatusDataQueue* complete_queue_{nullptr};
+  uint64_t pop_id_{0};
+};
+
+/**
+ * server streaming reactor which writes the data popped from link queue
+*/
+template <typename Response>
+class VMNodeInterface::LinkDataWriter :
+    public grpc::ServerWriteReactor<Response> {
+ public:
+  LinkDataWriter() = default;
+  void WaitData(std::shared_ptr<PendingLinkData> pending) {
+    pending_ = std::move(pending);
+  }
+  /**
+   * keep payload alive until all responses referring to it are written
+  */
+  std::string_view HoldPayload(std::string&& payload) {
+    payload_ = std::move(payload);
+    return std::string_view(payload_);
+  }
+  void WriteResponses(std::vector<std::unique_ptr<Response>>&& responses) {
+    responses_ = std::move(responses);
+    next_ = 0;
+    WriteNext();
+  }
+  void OnWriteDone(bool ok) override {
+    if (!ok) {
+      this->Finish(Status(grpc::StatusCode::UNAVAILABLE,
+                          "write response failed"));
+      return;
+    }
+    WriteNext();
+  }
+  void OnCancel() override {
+    if (pending_ != nullptr && pending_->Cancel()) {
+      this->Finish(Status::CANCELLED);
+    }
+  }
+  void OnDone() override {
+    delete this;
+  }
+
+ protected:
+  void WriteNext() {
+    if (next_ >= responses_.size()) {
+      this->Finish(Status::OK);
+      return;
+    }
+    this->StartWrite(responses_[next_++].get());
+  }
+
+ private:
+  std::shared_ptr<PendingLinkData> pending_{nullptr};
+  std::string payload_;
+  std::vector<std::unique_ptr<Response>> responses_;
+  size_t next_{0};
+};
+
+/**
+ * assemble TaskRequest chunks into preallocated buffer,
+ * then push the data into recv queue of worker
+*/
+class VMNodeInterface::SendReactor :
+    public grpc::ServerReadReactor<grpc::ByteBuffer> {
+ public:
+  SendReactor(VMNodeInterface* service, grpc::ByteBuffer* response) :
+      service_(service), response_(response) {
+    StartRead(&request_);
+  }
+  void OnReadDone(bool ok) override {
+    if (ok) {
+      auto ret = assembler_.Feed(&request_);
+      if (ret != retcode::SUCCESS) {
+        Finish(Status(grpc::StatusCode::INVALID_ARGUMENT,
+                      "decode TaskRequest failed"));
+        return;
+      }
+      StartRead(&request_);
+      return;
+    }
+    if (cancelled_.load()) {
+      Finish(Status::CANCELLED);
+      return;
+    }
+    std::string TASK_INFO_STR =
+        proto::util::TaskInfoToString(assembler_.task_info());
+    if (!assembler_.IsComplete()) {
+      PH_LOG(ERROR, LogType::kTask)
+          << TASK_INFO_STR << "data is incomplete, "
+          << "received: " << assembler_.data().size();
+      Finish(Status(grpc::StatusCode::DATA_LOSS, "data is incomplete"));
+      return;
+    }
+    if (assembler_.key().empty()) {
+      PH_LOG(WARNING, LogType::kTask)
+          << TASK_INFO_STR << "recv_key is not set";
+    }
+    service_->RunWhenRecvBufferReady(assembler_.task_info(), assembler_.key(),
+                                     assembler_.data().size(), [this]() {
+      this->ProcessData();
+    });
+  }
+  void OnCancel() override {
+    cancelled_.store(true);
+  }
+  void OnDone() override {
+    delete this;
+  }
+
+ protected:
+  void ProcessData() {
+    size_t data_size = assembler_.data().size();
+    auto ret = service_->ServerImpl()->ProcessReceivedData(
+        assembler_.task_info(), assembler_.key(),
+        std::move(assembler_.data()), assembler_.compress_type());
+    rpc::TaskResponse response;
+    if (ret != retcode::SUCCESS) {
+      response.set_ret_code(rpc::retcode::FAIL);
+      response.set_msg_info("ProcessReceivedData encountes error");
+    } else {
+      response.set_ret_code(rpc::retcode::SUCCESS);
+    }
+    bool own_buffer{false};
+    grpc::SerializationTraits<rpc::TaskResponse>::Serialize(
+        response, response_, &own_buffer);
+    PH_VLOG(5, LogType::kTask)
+        << proto::util::TaskInfoToString(assembler_.task_info())
+        << "end of VMNodeImpl::Send, data total received size:" << data_size;
+    Finish(Status::OK);
+  }
+
+ private:
+  VMNodeInterface* service_{nullptr};
+  grpc::ByteBuffer* response_{nullptr};
+  grpc::ByteBuffer request_;
+  network::TaskRequestAssembler assembler_;
+  std::atomic<bool> cancelled_{false};
+};
+
+/**
+ * read all data sent by client, then write the data popped from send queue
+*/
+class VMNodeInterface::SendRecvReactor :
+    public grpc::ServerBidiReactor<rpc::TaskRequest, rpc::TaskResponse> {
+ public:
+  explicit SendRecvReactor(VMNodeInterface* service) : service_(service) {
+    StartRead(&request_);
+  }
+  void OnReadDone(bool ok) override {
+    if (ok) {
+      if (!recv_meta_info_) {
+        task_info_.CopyFrom(request_.task_info());
+        TASK_INFO_STR_ = proto::util::TaskInfoToString(task_info_);
+        key_ = request_.role();
+        compress_type_ = request_.compress_type();
+        if (key_.empty()) {
+          PH_LOG(WARNING, LogType::kTask)
+              << TASK_INFO_STR_ << "send key is empty";
+        }
+        received_data_.reserve(request_.data_len());
+        recv_meta_info_ = true;
+        VLOG(5) << TASK_INFO_STR_ << "send key: " << key_;
+      }
+      received_data_.append(request_.data());
+      StartRead(&request_);
+      return;
+    }
+    {
+      std::lock_guard<std::mutex> lck(mtx_);
+      if (cancelled_) {
+        Finish(Status::CANCELLED);
+        return;
+      }
+    }
+    // all data has been received
+    service_->RunWhenRecvBufferReady(task_info_, key_, received_data_.size(),
+                                     [this]() {
+      this->ProcessRequest();
+    });
+  }
+  void OnWriteDone(bool ok) override {
+    if (!ok) {
+      Finish(Status(grpc::StatusCode::UNAVAILABLE, "write response failed"));
+      return;
+    }
+    WriteNext();
+  }
+  void OnCancel() override {
+    std::lock_guard<std::mutex> lck(mtx_);
+    cancelled_ = true;
+    if (pending_ != nullptr && pending_->Cancel()) {
+      Finish(Status::CANCELLED);
+    }
+  }
+  void OnDone() override {
+    delete this;
+  }
+
+ protected:
+  void ProcessRequest() {
+    auto ret = service_->ServerImpl()->ProcessReceivedData(
+        task_info_, key_, std::move(received_data_), compress_type_);
+    if (ret != retcode::SUCCESS) {
+      WriteError("ProcessReceivedData encountes error");
+      return;
+    }
+    // process send data
+    auto pending = std::make_shared<PendingLinkData>(
+        service_->ServerImpl(), PendingLinkData::QueueType::kSend,
+        [this](retcode ret, std::string&& send_data) {
+      if (ret != retcode::SUCCESS) {
+        PH_LOG(ERROR, LogType::kTask)
+            << TASK_INFO_STR_ << "no data is available for key: " << key_;
+        WriteError("no data is available for key:" + key_);
+        return;
+      }
+      service_->BuildTaskResponse(send_data, &responses_);
+      WriteNext();
+    });
+    {
+      std::lock_guard<std::mutex> lck(mtx_);
+      if (cancelled_) {
+        Finish(Status::CANCELLED);
+        return;
+      }
+      pending_ = pending;
+    }
+    pending->Pop(task_info_, key_);
+  }
+  void WriteError(std::string err_msg) {
+    auto response = std::make_unique<rpc::TaskResponse>();
+    response->set_ret_code(rpc::retcode::FAIL);
+    response->set_msg_info(std::move(err_msg));
+    responses_.clear();
+    responses_.push_back(std::move(response));
+    WriteNext();
+  }
+  void WriteNext() {
+    if (next_ >= responses_.size()) {
+      Finish(Status::OK);
+      return;
+    }
+    StartWrite(responses_[next_++].get());
+  }
+
+ private:
+  VMNodeInterface* service_{nullptr};
+  rpc::TaskRequest request_;
+  bool recv_meta_info_{false};
+  rpc::TaskContext task_info_;
+  std::string TASK_INFO_STR_;
+  std::string key_;
+  rpc::CompressType compress_type_{rpc::CompressType::COMPRESS_NONE};
+  std::string received_data_;
+  std::mutex mtx_;
+  bool cancelled_{false};
+  std::shared_ptr<PendingLinkData> pending_{nullptr};
+  std::vector<std::unique_ptr<rpc::TaskResponse>> responses_;
+  size_t next_{0};
+};
+
+/**
+ * DATA frames are reassembled per seq_no and buffered without waiting,
+ * so keys sharing the stream never block each other. the ack is held back
+ * until the key has recv budget again, which holds back its sender only.
+ * RECV frames park a pop in link queue and are answered with DATA frames
+ * when data is available, reading goes on meanwhile.
+ * stream finishes when client is done writing and every RECV is settled
+*/
+class VMNodeInterface::LinkStreamReactor :
+    public grpc::ServerBidiReactor<rpc::LinkFrame, rpc::LinkFrame> {
+ public:
+  LinkStreamReactor(VMNodeInterface* service, std::string peer) :
+      service_(service), peer_(std::move(peer)) {
+    StartRead(&frame_);
+  }
+  void OnReadDone(bool ok) override {
+    if (!ok) {
+      std::unique_lock<std::mutex> lck(mtx_);
+      read_done_ = true;
+      Flush(std::move(lck));
+      return;
+    }
+    if (frame_.has_task_info()) {
+      task_info_.CopyFrom(frame_.task_info());
+      TASK_INFO_STR_ = proto::util::TaskInfoToString(task_info_);
+      PH_VLOG(5, LogType::kTask)
+          << TASK_INFO_STR_ << "link stream opened by: " << peer_;
+    }
+    if (frame_.type() == rpc::LinkFrame::DATA) {
+      OnDataFrame();
+      return;
+    }
+    if (frame_.type() == rpc::LinkFrame::RECV) {
+      OnRecvFrame();
+    } else {
+      PH_LOG(WARNING, LogType::kTask)
+          << TASK_INFO_STR_ << "unexpected frame type: " << frame_.type();
+    }
+    StartRead(&frame_);
+  }
+  void OnWriteDone(bool ok) override {
+    std::unique_lock<std::mutex> lck(mtx_);
+    writing_ = false;
+    outgoing_.pop_front();
+    if (!ok) {
+      LOG(WARNING) << "write frame to link stream failed";
+      Break();
+    }
+    Flush(std::move(lck));
+  }
+  void OnCancel() override {
+    std::unique_lock<std::mutex> lck(mtx_);
+    Break();
+    Flush(std::move(lck));
+  }
+  void OnDone() override {
+    PH_VLOG(5, LogType::kTask) << TASK_INFO_STR_ << "link stream closed";
+    delete this;
+  }
+
+ protected:
+  void OnDataFrame() {
+    uint64_t seq_no = frame_.seq_no();
+    auto& received_data = partial_data_[seq_no];
+    if (received_data.empty()) {
+      received_data.reserve(frame_.data_len());
+    }
+    received_data.append(frame_.data());
+    if (!frame_.last()) {
+      StartRead(&frame_);
+      return;
+    }
+    data_buffer_ = std::move(received_data);
+    partial_data_.erase(seq_no);
+    {
+      std::lock_guard<std::mutex> lck(mtx_);
+      unacked_++;
+    }
+    // reading is paused only until task worker is ready
+    service_->RunWhenWorkerReady(task_info_, [this]() {
+      this->ProcessData();
+    });
+  }
+  void ProcessData() {
+    uint64_t seq_no = frame_.seq_no();
+    std::string key = frame_.key();
+    auto ret = service_->ServerImpl()->ProcessReceivedData(
+        task_info_, key, std::move(data_buffer_), frame_.compress_type());
+    std::string msg_info;
+    if (ret != retcode::SUCCESS) {
+      msg_info = "ProcessReceivedData encountes error";
+    }
+    auto ack = [this, seq_no, key, ret, msg_info]() {
+      std::deque<rpc::LinkFrame> frames;
+      BuildLinkFrames(rpc::LinkFrame::ACK, seq_no, key, ret, msg_info, "",
+                      &frames);
+      std::unique_lock<std::mutex> lck(mtx_);
+      unacked_--;
+      Enqueue(&frames);
+      Flush(std::move(lck));
+    };
+    if (ret == retcode::SUCCESS) {
+      service_->RunWhenRecvBufferReady(task_info_, key, 0, std::move(ack));
+    } else {
+      ack();
+    }
+    StartRead(&frame_);
+  }
+  void OnRecvFrame() {
+    uint64_t seq_no = frame_.seq_no();
+    auto key = frame_.key();
+    auto pending = std::make_shared<PendingLinkData>(
+        service_->ServerImpl(), PendingLinkData::QueueType::kRecv,
+        [this, seq_no, key](retcode ret, std::string&& recv_data) {
+      std::string msg_info;
+      if (ret != retcode::SUCCESS) {
+        msg_info = "no data is available for key:" + key;
+      }
+      std::deque<rpc::LinkFrame> frames;
+      BuildLinkFrames(rpc::LinkFrame::DATA, seq_no, key, ret, msg_info,
+                      recv_data, &frames);
+      std::unique_lock<std::mutex> lck(mtx_);
+      pending_recv_.erase(seq_no);
+      Enqueue(&frames);
+      Flush(std::move(lck));
+    });
+    {
+      std::lock_guard<std::mutex> lck(mtx_);
+      if (broken_) {
+        return;
+      }
+      pending_recv_[seq_no] = pending;
+    }
+    auto task_info = task_info_;
+    service_->RunWhenWorkerReady(task_info, [pending, task_info, key]() {
+      pending->Pop(task_info, key);
+    });
+  }
+  /**
+   * no more frames are written, parked pops are cancelled,
+   * caller holds the lock
+  */
+  void Break() {
+    broken_ = true;
+    for (auto it = pending_recv_.begin(); it != pending_recv_.end();) {
+      if (it->second->Cancel()) {
+        it = pending_recv_.erase(it);
+      } else {
+        ++it;
+      }
+    }
+    // the frame being written stays until its write is done
+    outgoing_.erase(outgoing_.begin() + (writing_ ? 1 : 0), outgoing_.end());
+  }
+  /**
+   * caller holds the lock
+  */
+  void Enqueue(std::deque<rpc::LinkFrame>* frames) {
+    if (broken_) {
+      return;
+    }
+    for (auto& frame : *frames) {
+      outgoing_.push_back(std::move(frame));
+    }
+  }
+  /**
+   * start next write or finish the stream if everything is settled.
+   * grpc may run reactions inline, so they are started without the lock
+  */
+  void Flush(std::unique_lock<std::mutex> lck) {
+    const rpc::LinkFrame* next{nullptr};
+    bool finish{false};
+    if (!writing_ && !finished_) {
+      if (!outgoing_.empty()) {
+        writing_ = true;
+        next = &outgoing_.front();
+      } else if (read_done_ && unacked_ == 0 && pending_recv_.empty()) {
+        finished_ = true;
+        finish = true;
+      }
+    }
+    auto status = broken_ ? Status::CANCELLED : Status::OK;
+    lck.unlock();
+    if (next != nullptr) {
+      StartWrite(next);
+    } else if (finish) {
+      Finish(status);
+    }
+  }
+
+ private:
+  VMNodeInterface* service_{nullptr};
+  std::string peer_;
+  // members below are used by read path only
+  rpc::LinkFrame frame_;
+  rpc::TaskContext task_info_;
+  std::string TASK_INFO_STR_;
+  // key: seq_no, value: partial received data
+  std::unordered_map<uint64_t, std::string> partial_data_;
+  std::string data_buffer_;
+  // members below are guarded by mtx_
+  std::mutex mtx_;
+  std::deque<rpc::LinkFrame> outgoing_;
+  std::unordered_map<uint64_t, std::shared_ptr<PendingLinkData>> pending_recv_;
+  bool read_done_{false};
+  // DATA frames whose ack is not enqueued yet
+  size_t unacked_{0};
+  bool writing_{false};
+  bool broken_{false};
+  bool finished_{false};
+};
+
+void VMNodeInterface::RunWhenWorkerReady(const rpc::TaskContext& task_info,
+                                         std::function<void()> func) {
+  auto worker_id = ServerImpl()->GetWorkerId(task_info);
+  if (ServerImpl()->IsTaskWorkerReady(worker_id)) {
+    func();
+    return;
+  }
+  // only happens before task worker started, waiting is bounded by
+  // wait_worker_ready_timeout
+  RunInHelperThread("WaitWorkerReady", std::move(func));
+}
+
+void VMNodeInterface::RunWhenRecvBufferReady(
+    const rpc::TaskContext& task_info, const std::string& key,
+    size_t data_size, std::function<void()> func) {
+  RunWhenWorkerReady(task_info,
+      [this, task_info, key, data_size, func = std::move(func)]() {
+    if (ServerImpl()->HasRecvBudget(task_info, key, data_size)) {
+      func();
+      return;
+    }
+    // func runs after wait timeout as well, data is buffered over budget
+    RunInHelperThread("WaitRecvBuffer",
+        [this, task_info, key, data_size, func]() {
+      ServerImpl()->WaitRecvBudget(task_info, key, data_size);
+      func();
+    });
+  });
+}
+
+void VMNodeInterface::RunInHelperThread(const char* name,
+                                        std::function<void()> func) {
+  {
+    std::lock_guard<std::mutex> lck(helper_mtx_);
+    helper_num_++;
+  }
+  std::thread helper([this, name, func = std::move(func)]() {
+    SET_THREAD_NAME(name);
+    func();
+    // notify under lock, service may be destroyed as soon as it is released
+    std::lock_guard<std::mutex> lck(helper_mtx_);
+    helper_num_--;
+    helper_cv_.notify_all();
+  });
+  helper.detach();
+}
+
+retcode VMNodeInterface::StartSocketLinkServer() {
+  auto& server_config = ServerConfig::getInstance();
+  auto& link_cfg = server_config.getNodeConfig().link_cfg;
+  if (link_cfg.mode != "raw_socket") {
+    return retcode::SUCCESS;
+  }
+  auto& host_cfg = server_config.getServiceConfig();
+  if (host_cfg.use_tls()) {
+    LOG(WARNING) << "raw socket link is plaintext only, it is not served "
+                 << "with tls, peers fall back to grpc stream over tls";
+    return retcode::SUCCESS;
+  }
+  auto data_handler = [this](const std::string& meta,
+                             const std::string& key,
+                             std::string&& data,
+                             uint8_t compress_type,
+                             network::SocketLinkServer::AckCallback ack) {
+    rpc::TaskContext task_info;
+    if (!task_info.ParseFromString(meta)) {
+      LOG(ERROR) << "parse task info from socket link failed";
+      ack(retcode::FAIL);
+      return;
+    }
+    auto ret = this->ServerImpl()->ProcessReceivedData(
+        task_info, key, std::move(data),
+        static_cast<rpc::CompressType>(compress_type));
+    if (ret != retcode::SUCCESS) {
+      ack(ret);
+      return;
+    }
+    // same as LinkStream, ack is held back while key is over budget
+    RunWhenRecvBufferReady(task_info, key, 0, [ack]() {
+      ack(retcode::SUCCESS);
+    });
+  };
+  // same as RECV frame of LinkStream, pop is parked in link queue
+  // and cancelled when the connection is closed
+  auto recv_handler = [this](const std::string& meta,
+                             const std::string& key,
+                             network::SocketLinkServer::RecvCallback done)
+      -> network::SocketLinkServer::CancelFunc {
+    rpc::TaskContext task_info;
+    if (!task_info.ParseFromString(meta)) {
+      LOG(ERROR) << "parse task info from socket link failed";
+      done(retcode::FAIL, std::string());
+      return nullptr;
+    }
+    auto pending = std::make_shared<PendingLinkData>(
+        ServerImpl(), PendingLinkData::QueueType::kRecv, std::move(done));
+    RunWhenWorkerReady(task_info, [pending, task_info, key]() {
+      pending->Pop(task_info, key);
+    });
+    return [pending]() {return pending->Cancel();};
+  };
+  socket_link_server_ = std::make_unique<network::SocketLinkServer>(
+      std::move(data_handler), std::move(recv_handler));
+  uint32_t port = host_cfg.port() + link_cfg.socket_port_offset;
+  auto ret = socket_link_server_->Start("0.0.0.0", port);
+  if (ret != retcode::SUCCESS) {
+    LOG(ERROR) << "start socket link server on port: " << port << " failed";
+    socket_link_server_.reset();
+    return retcode::FAIL;
+  }
+  return retcode::SUCCESS;
+}
+
 Status VMNodeInterface::SubmitTask(ServerContext *context,
                                    const rpc::PushTaskRequest *pushTaskRequest,
                                    rpc::PushTaskReply *pushTaskReply) {
@@ -127,128 +860,44 @@ Status VMNodeInterface::UpdateTaskStatus(ServerContext* context,
 }
 
 // communication interface
-Status VMNodeInterface::Send(ServerContext* context,
-                             ServerReader<rpc::TaskRequest>* reader,
-                             rpc::TaskResponse* response) {
-  bool recv_meta_info{false};
-  std::vector<std::string> recv_data;
-  rpc::TaskContext task_info;
-  std::string key;
-  std::string received_data;
-
-  rpc::TaskRequest request;
-  std::string TASK_INFO_STR;
-  while (reader->Read(&request)) {
-    if (!recv_meta_info) {
-      task_info.CopyFrom(request.task_info());
-      TASK_INFO_STR = proto::util::TaskInfoToString(task_info);
-      key = request.role();
-      if (key.empty()) {
-        PH_LOG(WARNING, LogType::kTask)
-            << TASK_INFO_STR << "recv_key is not set";
-      }
-      size_t data_len = request.data_len();
-      received_data.reserve(data_len);
-      recv_meta_info = true;
-      PH_VLOG(5, LogType::kTask)
-          << TASK_INFO_STR << "recv key: " << key;
-    }
-    received_data.append(request.data());
-  }
-  size_t data_size = received_data.size();
-  auto ret = this->ServerImpl()->ProcessReceivedData(task_info, key,
-                                                     std::move(received_data));
-  if (ret != retcode::SUCCESS) {
-    response->set_ret_code(rpc::retcode::FAIL);
-  }
-  PH_VLOG(5, LogType::kTask)
-      << TASK_INFO_STR
-      << "end of VMNodeImpl::Send, data total received size:" << data_size;
-  response->set_ret_code(rpc::retcode::SUCCESS);
-  return Status::OK;
+grpc::ServerReadReactor<grpc::ByteBuffer>* VMNodeInterface::Send(
+    CallbackServerContext* context, grpc::ByteBuffer* response) {
+  return new SendReactor(this, response);
 }
 
-Status VMNodeInterface::Recv(ServerContext* context,
-                             const rpc::TaskRequest* request,
-                             ServerWriter<rpc::TaskResponse>* writer) {
-  std::string send_data;
+grpc::ServerWriteReactor<rpc::TaskResponse>* VMNodeInterface::Recv(
+    CallbackServerContext* context, const rpc::TaskRequest* request) {
+  auto reactor = new LinkDataWriter<rpc::TaskResponse>();
   const auto& task_info = request->task_info();
   std::string key = request->role();
-  auto ret = this->ServerImpl()->ProcessSendData(task_info, key, &send_data);
-  if (ret != retcode::SUCCESS) {
-    std::string TASK_INFO_STR = proto::util::TaskInfoToString(task_info);
-    PH_LOG(ERROR, LogType::kTask)
-        << TASK_INFO_STR << "no data is available for key: " << key;
-    rpc::TaskResponse response;
-    std::string err_msg = "no data is available for key:" + key;
-    response.set_ret_code(rpc::retcode::FAIL);
-    response.set_msg_info(std::move(err_msg));
-    writer->Write(response);
-    return grpc::Status::OK;
-  }
-  std::vector<std::unique_ptr<rpc::TaskResponse>> response_data;
-  BuildTaskResponse(send_data, &response_data);
-  for (const auto& res : response_data) {
-    writer->Write(*res);
-  }
-  return grpc::Status::OK;
+  auto pending = std::make_shared<PendingLinkData>(
+      ServerImpl(), PendingLinkData::QueueType::kSend,
+      [this, reactor, task_info, key](retcode ret, std::string&& send_data) {
+    std::vector<std::unique_ptr<rpc::TaskResponse>> response_data;
+    if (ret != retcode::SUCCESS) {
+      std::string TASK_INFO_STR = proto::util::TaskInfoToString(task_info);
+      PH_LOG(ERROR, LogType::kTask)
+          << TASK_INFO_STR << "no data is available for key: " << key;
+      auto response = std::make_unique<rpc::TaskResponse>();
+      std::string err_msg = "no data is available for key:" + key;
+      response->set_ret_code(rpc::retcode::FAIL);
+      response->set_msg_info(std::move(err_msg));
+      response_data.push_back(std::move(response));
+    } else {
+      this->BuildTaskResponse(send_data, &response_data);
+    }
+    reactor->WriteResponses(std::move(response_data));
+  });
+  reactor->WaitData(pending);
+  RunWhenWorkerReady(task_info, [pending, task_info, key]() {
+    pending->Pop(task_info, key);
+  });
+  return reactor;
 }
 
-Status VMNodeInterface::SendRecv(ServerContext* context,
-    ServerReaderWriter<rpc::TaskResponse, rpc::TaskRequest>* stream) {
-  bool recv_meta_info{false};
-  std::vector<std::string> recv_data;
-  rpc::TaskContext task_info;
-  std::string key;
-  std::string received_data;
-  rpc::TaskRequest request;
-  std::string TASK_INFO_STR;
-  while (stream->Read(&request)) {
-    if (!recv_meta_info) {
-      task_info.CopyFrom(request.task_info());
-      TASK_INFO_STR = proto::util::TaskInfoToString(task_info);
-      key = request.role();
-      if (key.empty()) {
-        PH_LOG(WARNING, LogType::kTask)
-            << TASK_INFO_STR << "send key is empty";
-      }
-      size_t data_len = request.data_len();
-      received_data.reserve(data_len);
-      recv_meta_info = true;
-      VLOG(5) << TASK_INFO_STR << "send key: " << key;
-    }
-    received_data.append(request.data());
-  }
-  size_t data_size = received_data.size();
-  auto ret = this->ServerImpl()->ProcessReceivedData(task_info, key,
-                                                     std::move(received_data));
-  if (ret != retcode::SUCCESS) {
-    rpc::TaskResponse response;
-    std::string err_msg = "ProcessReceivedData encountes error";
-    response.set_ret_code(rpc::retcode::FAIL);
-    response.set_msg_info(std::move(err_msg));
-    stream->Write(response);
-    return Status::OK;
-  }
-  // process send data
-  std::string send_data;
-  ret = this->ServerImpl()->ProcessSendData(task_info, key, &send_data);
-  if (ret != retcode::SUCCESS) {
-    PH_LOG(ERROR, LogType::kTask)
-        << TASK_INFO_STR << "no data is available for key: " << key;
-    rpc::TaskResponse response;
-    std::string err_msg = "no data is available for key:" + key;
-    response.set_ret_code(rpc::retcode::FAIL);
-    response.set_msg_info(std::move(err_msg));
-    stream->Write(response);
-    return Status::OK;
-  }
-  std::vector<std::unique_ptr<rpc::TaskResponse>> response_data;
-  BuildTaskResponse(send_data, &response_data);
-  for (const auto& res : response_data) {
-    stream->Write(*res);
-  }
-  return Status::OK;
+grpc::ServerBidiReactor<rpc::TaskRequest, rpc::TaskResponse>*
+VMNodeInterface::SendRecv(CallbackServerContext* context) {
+  return new SendRecvReactor(this);
 }
 
 // for communication between different process
@@ -311,29 +960,47 @@ Status VMNodeInterface::ForwardSend(ServerContext* context,
 }
 
 // for communication between different process
-Status VMNodeInterface::ForwardRecv(ServerContext* context,
-                                    const rpc::TaskRequest* request,
-                                    ServerWriter<rpc::TaskRequest>* writer) {
+grpc::ServerWriteReactor<grpc::ByteBuffer>* VMNodeInterface::ForwardRecv(
+    CallbackServerContext* context, const grpc::ByteBuffer* request_buf) {
   // waiting for peer node send data
-  const auto& task_info = request->task_info();
-  std::string key = request->role();
-  std::string recv_data;
-  auto ret = this->ServerImpl()->ProcessForwardData(task_info, key, &recv_data);
-  if (ret != retcode::SUCCESS) {
-    rpc::TaskRequest response;
-    std::string TASK_INFO_STR = proto::util::TaskInfoToString(task_info);
-    std::string err_msg = "no data is available for key:" + key;
-    PH_LOG(ERROR, LogType::kTask)
-        << TASK_INFO_STR << err_msg;
-    writer->Write(response);
-    return Status::OK;
-  }
-  std::vector<std::unique_ptr<rpc::TaskRequest>> forward_recv_datas;
-  this->BuildTaskRequest(task_info, key, recv_data, &forward_recv_datas);
-  for (const auto& data_ : forward_recv_datas) {
-    writer->Write(*data_);
+  auto reactor = new LinkDataWriter<grpc::ByteBuffer>();
+  rpc::TaskRequest request;
+  grpc::ByteBuffer request_copy(*request_buf);
+  auto status = grpc::SerializationTraits<rpc::TaskRequest>::Deserialize(
+      &request_copy, &request);
+  if (!status.ok()) {
+    LOG(ERROR) << "parse ForwardRecv request failed";
+    reactor->Finish(status);
+    return reactor;
   }
-  return grpc::Status::OK;
+  const auto& task_info = request.task_info();
+  std::string key = request.role();
+  auto pending = std::make_shared<PendingLinkData>(
+      ServerImpl(), PendingLinkData::QueueType::kRecv,
+      [reactor, task_info, key](retcode ret, std::string&& recv_data) {
+    std::vector<grpc::ByteBuffer> chunks;
+    if (ret != retcode::SUCCESS) {
+      std::string TASK_INFO_STR = proto::util::TaskInfoToString(task_info);
+      std::string err_msg = "no data is available for key:" + key;
+      PH_LOG(ERROR, LogType::kTask) << TASK_INFO_STR << err_msg;
+      recv_data.clear();
+    }
+    // chunks refer to payload held by reactor
+    auto payload = reactor->HoldPayload(std::move(recv_data));
+    network::BuildTaskRequestChunks(task_info, key, payload, &chunks);
+    std::vector<std::unique_ptr<grpc::ByteBuffer>> forward_recv_datas;
+    forward_recv_datas.reserve(chunks.size());
+    for (auto& chunk : chunks) {
+      forward_recv_datas.push_back(
+          std::make_unique<grpc::ByteBuffer>(std::move(chunk)));
+    }
+    reactor->WriteResponses(std::move(forward_recv_datas));
+  });
+  reactor->WaitData(pending);
+  RunWhenWorkerReady(task_info, [pending, task_info, key]() {
+    pending->Pop(task_info, key);
+  });
+  return reactor;
 }
 
 Status VMNodeInterface::CompleteStatus(ServerContext* context,
@@ -349,6 +1016,30 @@ Status VMNodeInterface::CompleteStatus(ServerContext* context,
   return grpc::Status::OK;
 }
 
+grpc::ServerBidiReactor<rpc::LinkFrame, rpc::LinkFrame>*
+VMNodeInterface::LinkStream(CallbackServerContext* context) {
+  return new LinkStreamReactor(this, context->peer());
+}
+
+Status VMNodeInterface::NegotiateLink(ServerContext* context,
+                                      const rpc::LinkNegotiation* request,
+                                      rpc::LinkNegotiation* response) {
+  // every supported type is answered in the order offered by peer,
+  // the peer decides which one is used
+  auto supported_types = network::LinkCompressor::SupportedTypes();
+  for (const auto type : request->compress_types()) {
+    auto compress_type = static_cast<rpc::CompressType>(type);
+    auto it = std::find(supported_types.begin(), supported_types.end(),
+                        compress_type);
+    if (it != supported_types.end()) {
+      response->add_compress_types(compress_type);
+    }
+  }
+  VLOG(5) << "negotiate link with " << context->peer() << ", "
+          << "accepted compress types: " << response->compress_types_size();
+  return Status::OK;
+}
+
 retcode VMNodeInterface::WaitUntilWorkerReady(const std::string& worker_id,
                                               grpc::ServerContext* context,
                                               int timeout_ms) {
@@ -418,39 +1109,4 @@ retcode VMNodeInterface::BuildTaskResponse(const std::string& data,
   return retcode::SUCCESS;
 }
 
-retcode VMNodeInterface::BuildTaskRequest(const rpc::TaskContext& task_info,
-    const std::string& key,
-    const std::string& data,
-    std::vector<std::unique_ptr<rpc::TaskRequest>>* requests) {
-  size_t sended_size = 0;
-  size_t max_package_size = LIMITED_PACKAGE_SIZE;
-  size_t total_length = data.size();
-  size_t split_num = total_length / max_package_size;
-  if (total_length % max_package_size) {
-    split_num++;
-  }
-  requests->reserve(split_num);
-  char* send_buf = const_cast<char*>(data.c_str());
-  do {
-    // rpc::TaskRequest task_request;
-    auto task_request = std::make_unique<rpc::TaskRequest>();
-    auto task_info_ptr = task_request->mutable_task_info();
-    task_info_ptr->CopyFrom(task_info);
-    task_request->set_role(key);
-    task_request->set_data_len(total_length);
-    auto data_ptr = task_request->mutable_data();
-    data_ptr->reserve(max_package_size);
-    size_t data_len = std::min(max_package_size, total_length - sended_size);
-    data_ptr->append(send_buf + sended_size, data_len);
-    sended_size += data_len;
-    requests->emplace_back(std::move(task_request));
-    if (sended_size < total_length) {
-      continue;
-    } else {
-      break;
-    }
-  } while (true);
-  return retcode::SUCCESS;
-}
-
 }  // namespace primihub
@@ -22,8 +22,12 @@
 #include <grpcpp/server.h>
 #include <grpcpp/server_builder.h>
 #include <grpcpp/server_context.h>
+#include <grpcpp/support/server_callback.h>
 
+#include <condition_variable>
+#include <functional>
 #include <memory>
+#include <mutex>
 #include <thread>
 #include <string>
 #include <vector>
@@ -32,6 +36,7 @@
 #include "src/primihub/protos/common.pb.h"
 #include "src/primihub/node/node_impl.h"
 #include "src/primihub/common/common.h"
+#include "src/primihub/util/network/socket_link_server.h"
 
 using Server = grpc::Server;
 using ServerBuilder = grpc::ServerBuilder;
@@ -46,10 +51,24 @@ template<typename T>
 using ServerWriter = grpc::ServerWriter<T>;
 
 using Status = grpc::Status;
-
+using CallbackServerContext = grpc::CallbackServerContext;
 
 namespace primihub {
-class VMNodeInterface final : public rpc::VMNode::Service {
+/**
+ * Recv, SendRecv, ForwardRecv and LinkStream wait until peer data is
+ * available,
+ * they are served by callback api and the wait is parked in link queue
+ * as continuation, so pending receive does not occupy server thread.
+ * Send and ForwardRecv work on raw ByteBuffer, payload is assembled from
+ * or written as slices without protobuf copy
+*/
+using VMNodeService = rpc::VMNode::WithRawCallbackMethod_Send<
+    rpc::VMNode::WithCallbackMethod_Recv<
+    rpc::VMNode::WithCallbackMethod_SendRecv<
+    rpc::VMNode::WithCallbackMethod_LinkStream<
+    rpc::VMNode::WithRawCallbackMethod_ForwardRecv<rpc::VMNode::Service>>>>>;
+
+class VMNodeInterface final : public VMNodeService {
  public:
   explicit VMNodeInterface(std::unique_ptr<VMNodeImpl> node_impl);
   ~VMNodeInterface();
@@ -76,20 +95,18 @@ class VMNodeInterface final : public rpc::VMNode::Service {
                           const rpc::TaskStatus* request,
                           rpc::Empty* response) override;
 
-  Status Send(ServerContext* context,
-              ServerReader<rpc::TaskRequest>* reader,
-              rpc::TaskResponse* response) override;
+  grpc::ServerReadReactor<grpc::ByteBuffer>* Send(
+      CallbackServerContext* context,
+      grpc::ByteBuffer* response) override;
 
-  Status Recv(ServerContext* context,
-              const rpc::TaskRequest* request,
-              ServerWriter<rpc::TaskResponse>* writer) override;
+  grpc::ServerWriteReactor<rpc::TaskResponse>* Recv(
+      CallbackServerContext* context,
+      const rpc::TaskRequest* request) override;
   /**
-   * @param
-   *
+   * receive all data sent by client, then response with send data
   */
-  Status SendRecv(ServerContext* context,
-                  ServerReaderWriter<rpc::TaskResponse,
-                                     rpc::TaskRequest>* stream) override;
+  grpc::ServerBidiReactor<rpc::TaskRequest, rpc::TaskResponse>* SendRecv(
+      CallbackServerContext* context) override;
 
   // for communication between different process
   Status ForwardSend(ServerContext* context,
@@ -97,33 +114,77 @@ class VMNodeInterface final : public rpc::VMNode::Service {
                      rpc::TaskResponse* response) override;
 
   // for communication between different process
-  Status ForwardRecv(ServerContext* context,
-                     const rpc::TaskRequest* request,
-                     ServerWriter<rpc::TaskRequest>* writer) override;
+  grpc::ServerWriteReactor<grpc::ByteBuffer>* ForwardRecv(
+      CallbackServerContext* context,
+      const grpc::ByteBuffer* request) override;
   /**
    * wait until complete queue has filled expected number of complete status
   */
   Status CompleteStatus(ServerContext* context,
                         const rpc::CompleteStatusRequest* request,
                         rpc::Empty* response);
+  /**
+   * persistent multiplexed stream opened by GrpcStreamChannel,
+   * DATA frames are reassembled per seq_no and acked,
+   * RECV frames are answered asynchronously with DATA frames
+  */
+  grpc::ServerBidiReactor<rpc::LinkFrame, rpc::LinkFrame>* LinkStream(
+      CallbackServerContext* context) override;
+  /**
+   * answer the compress types offered by peer which are supported locally
+  */
+  Status NegotiateLink(ServerContext* context,
+                       const rpc::LinkNegotiation* request,
+                       rpc::LinkNegotiation* response) override;
 
   retcode WaitUntilWorkerReady(const std::string& worker_id,
                                ServerContext* context,
                                int timeout = -1);
 
  protected:
+  class PendingLinkData;
+  template <typename Response>
+  class LinkDataWriter;
+  class SendRecvReactor;
+  class SendReactor;
+  class LinkStreamReactor;
+  /**
+   * run func in current thread if worker is ready,
+   * otherwise in a helper thread waiting for worker ready
+  */
+  void RunWhenWorkerReady(const rpc::TaskContext& task_info,
+                          std::function<void()> func);
+  /**
+   * run func when data of size can be buffered for key, func is moved to
+   * a helper thread waiting for recv budget if it would be held back
+   * by flow control, so that callback thread of grpc is never blocked
+  */
+  void RunWhenRecvBufferReady(const rpc::TaskContext& task_info,
+                              const std::string& key, size_t data_size,
+                              std::function<void()> func);
+
+  /**
+   * run func in a helper thread, service waits for all helper threads
+   * before it is destroyed
+  */
+  void RunInHelperThread(const char* name, std::function<void()> func);
+
   retcode BuildTaskResponse(const std::string& data,
       std::vector<std::unique_ptr<rpc::TaskResponse>>* response);
 
-  retcode BuildTaskRequest(const rpc::TaskContext& task_info,
-      const std::string& key,
-      const std::string& data,
-      std::vector<std::unique_ptr<rpc::TaskRequest>>* requests);
-
   VMNodeImpl* ServerImpl() {return server_impl_.get();}
+  /**
+   * serve raw socket link if configured, DATA and RECV frames
+   * are processed in the same way as LinkStream
+  */
+  retcode StartSocketLinkServer();
 
  private:
   std::unique_ptr<VMNodeImpl> server_impl_;
+  std::unique_ptr<network::SocketLinkServer> socket_link_server_{nullptr};
+  std::mutex helper_mtx_;
+  std::condition_variable helper_cv_;
+  size_t helper_num_{0};
 };
 }  // namespace primihub
 #endif  // SRC_PRIMIHUB_NODE_NODE_INTERFACE_H_
@@ -15,13 +15,19 @@
  */
 
 #include "src/primihub/node/worker/worker.h"
+#include <unistd.h>
+#include <functional>
 #include <memory>
+#include <sstream>
 #include <string>
 #include "src/primihub/task/semantic/factory.h"
 #include "src/primihub/task/semantic/task.h"
+#include "src/primihub/task/semantic/pir_task.h"
 #include "base64.h"
+#include "src/primihub/util/file_util.h"
 #include "src/primihub/util/log.h"
 #include "src/primihub/util/proto_log_helper.h"
+#include "src/primihub/util/network/shm_link.h"
 #include "Poco/PipeStream.h"
 #include "Poco/StreamCopier.h"
 
@@ -31,6 +37,17 @@ using ProcessHandle = Poco::ProcessHandle;
 
 namespace pb_util = primihub::proto::util;
 namespace primihub {
+namespace {
+/**
+ * name of shared memory link to task process, unique in the host
+*/
+std::string ShmLinkName(const std::string& request_id) {
+  std::stringstream ss;
+  ss << "/primihub_" << getpid() << "_"
+     << std::hex << std::hash<std::string>{}(request_id);
+  return ss.str();
+}
+}  // namespace
 
 retcode Worker::waitForTaskReady() {
   bool ready = task_ready_future_.get();
@@ -70,6 +87,26 @@ Worker::TaskRunMode Worker::ExecuteMode(const PushTaskRequest& request) {
       return TaskRunMode::THREAD;
     }
   }
+  // resident keyword pir dbs are shared only by tasks in node process,
+  // tasks without db cache have nothing to share and keep their own process
+  const auto& serving_cfg =
+      ServerConfig::getInstance().getNodeConfig().pir_serving;
+  if (serving_cfg.enable &&
+      request.task().type() == rpc::TaskType::PIR_TASK &&
+      request.task().party_name() == PARTY_SERVER &&
+      map_info.find("DbInfo") == map_info.end()) {
+    int pir_type{rpc::PirType::KEY_PIR};
+    it = map_info.find("pirType");
+    if (it != map_info.end()) {
+      pir_type = it->second.value_int32();
+    }
+    if (pir_type == rpc::PirType::KEY_PIR) {
+      auto db_path = task::PirTask::ServerDbCachePath(request.task());
+      if (!db_path.empty() && FileExists(db_path)) {
+        return TaskRunMode::THREAD;
+      }
+    }
+  }
   return task_run_mode_;
 }
 
@@ -170,6 +207,23 @@ retcode Worker::ExecuteTaskByProcess(const PushTaskRequest* task_request) {
   args.push_back("--config_file=" + server_config.getConfigFile());
   args.push_back("--request=" + request_base64_str);
   args.push_back("--request_id=" + task_info.request_id());
+  // received data is delivered to task process by shared memory,
+  // ForwardRecv rpc is still served if task process can not attach it
+  std::unique_ptr<network::ShmLinkServer> shm_link{nullptr};
+  const auto& shm_cfg = server_config.getNodeConfig().link_cfg.shm;
+  if (shm_cfg.enable) {
+    auto& link_ctx = this->task_ptr->getTaskContext().getLinkContext();
+    shm_link = network::ShmLinkServer::Create(
+        ShmLinkName(task_info.request_id()),
+        shm_cfg.ring_size,
+        link_ctx.get());
+    if (shm_link != nullptr) {
+      args.push_back("--shm_link=" + shm_link->name());
+    } else {
+      LOG(WARNING) << TASK_INFO_STR
+                   << "create shared memory link failed, use grpc instead";
+    }
+  }
   // using POCO process
   Poco::Pipe outPipe;
   auto handle_ = Process::launch(execute_app, args, 0, &outPipe, &outPipe);
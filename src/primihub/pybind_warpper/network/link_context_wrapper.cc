@@ -38,7 +38,9 @@ PYBIND11_MODULE(linkcontext, m)
 {
     py::enum_<LinkMode>(m, "LinkMode", py::arithmetic())
         .value("GRPC", LinkMode::GRPC, "connection with grpc")
-        .value("RAW_SOCKET", LinkMode::RAW_SOCKET, "connect with socket");
+        .value("RAW_SOCKET", LinkMode::RAW_SOCKET, "connect with socket")
+        .value("GRPC_STREAM", LinkMode::GRPC_STREAM,
+               "multiplexed persistent grpc stream");
 
     py::class_<CertificateConfig>(m, "CertificateConfig")
         .def(py::init<const std::string&, const std::string&, const std::string&>());
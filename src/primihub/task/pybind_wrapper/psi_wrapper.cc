@@ -134,6 +134,10 @@ auto PsiExecutor::BuildPsiTaskRequest(const std::vector<std::string>& parties,
     psi_type.set_value_int32(static_cast<int>(rpc::KKRT));
   } else if (protocol == std::string("ECDH")) {
     psi_type.set_value_int32(static_cast<int>(rpc::ECDH));
+  } else if (protocol == std::string("CM20")) {
+    psi_type.set_value_int32(static_cast<int>(rpc::CM20));
+  } else if (protocol == std::string("MKKRT")) {
+    psi_type.set_value_int32(static_cast<int>(rpc::MKKRT));
   } else {
     std::stringstream ss;
     ss << "Unknown PSI protocol: " << protocol;
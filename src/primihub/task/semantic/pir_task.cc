@@ -30,6 +30,37 @@
 #include "src/primihub/common/value_check_util.h"
 
 namespace primihub::task {
+namespace {
+/**
+ * key columns of server in QueryConfig, duplicated column is skipped,
+ * column 0 is the default keyword if QueryConfig is not set
+*/
+std::vector<int> ParseServerKeyColumns(const rpc::Task& task_config) {
+  std::vector<int> key_columns;
+  const auto& param_map = task_config.params().param_map();
+  auto it = param_map.find("QueryConfig");
+  if (it == param_map.end()) {
+    key_columns.push_back(0);
+    return key_columns;
+  }
+  nlohmann::json query_conf = nlohmann::json::parse(it->second.value_string());
+  if (query_conf.contains(PARTY_SERVER)) {
+    auto& query_info = query_conf[PARTY_SERVER];
+    if (query_info.contains("key_columns")) {
+      std::set<int> dup;
+      for (auto& key_index : query_info["key_columns"]) {
+        if (dup.find(key_index) != dup.end()) {
+          continue;
+        }
+        dup.insert(key_index.get<int>());
+        key_columns.push_back(key_index);
+      }
+    }
+  }
+  return key_columns;
+}
+}  // namespace
+
 PirTask::PirTask(const TaskParam* task_param,
                  std::shared_ptr<DatasetService> dataset_service)
                  : TaskBase(task_param, dataset_service) {}
@@ -67,27 +98,56 @@ retcode PirTask::BuildOptions(const rpc::Task& task, pir::Options* options) {
         LOG(ERROR) << "dataset id is empty for party: " << party_name();
         return retcode::FAIL;
       }
-      options->db_path = db_cache_dir_ + "/";
+      std::string db_name;
       // check db cache exist or not
       if (is_dataset_detail_) {
         auto it = param_map.find(party_name());
         if (it != param_map.end()) {
-          options->db_path.append(it->second.value_string());
-
+          db_name = it->second.value_string();
         } else {
           LOG(ERROR) << "dateset id is not set";
           return retcode::FAIL;
         }
       } else {
-        options->db_path.append(this->dataset_id_);
-      }
-      for (const auto key_index : this->server_key_columns_) {
-        options->db_path.append("_").append(std::to_string(key_index));
+        db_name = this->dataset_id_;
       }
+      options->db_path = DbCachePath(db_name, pir_type_,
+                                     this->server_key_columns_);
 
       if (DbCacheAvailable(options->db_path)) {
         options->use_cache = true;
       }
+      if (pir_type_ == rpc::PirType::KEY_PIR) {
+        auto& node_cfg = ServerConfig::getInstance().getNodeConfig();
+        options->resident_db = node_cfg.pir_serving.enable;
+      }
+    }
+  }
+  // cpu budget of query processing
+  if (RoleValidation::IsServer(this->party_name())) {
+    const auto& param_map = task.params().param_map();
+    auto iter = param_map.find("queryThreadNum");
+    if (iter != param_map.end() && iter->second.value_int32() > 0) {
+      options->query_thread_num = iter->second.value_int32();
+    }
+    iter = param_map.find("numaNode");
+    if (iter != param_map.end()) {
+      options->numa_node = iter->second.value_int32();
+    }
+  }
+  if (pir_type_ == rpc::PirType::KEY_PIR) {
+    // both parties read the same depth from task params
+    const auto& param_map = task.params().param_map();
+    auto iter = param_map.find("pipelineDepth");
+    if (iter != param_map.end() && iter->second.value_int32() > 0) {
+      options->pipeline_depth = iter->second.value_int32();
+    }
+  }
+  if (pir_type_ == rpc::PirType::ID_PIR) {
+    const auto& param_map = task.params().param_map();
+    auto iter = param_map.find("idPirDownload");
+    if (iter != param_map.end()) {
+      options->id_pir_download = iter->second.value_int32() == 1;
     }
   }
   // peer node info
@@ -115,8 +175,62 @@ retcode PirTask::BuildOptions(const rpc::Task& task, pir::Options* options) {
   return retcode::SUCCESS;
 }
 
+std::string PirTask::DbCachePath(const std::string& db_name, int pir_type,
+                                 const std::vector<int>& key_columns) {
+  std::string db_path = std::string(kDbCacheDir) + "/" + db_name;
+  if (pir_type == rpc::PirType::ID_PIR) {
+    // row index is the key of id pir
+    db_path.append("_id");
+  } else {
+    for (const auto key_index : key_columns) {
+      db_path.append("_").append(std::to_string(key_index));
+    }
+  }
+  return db_path;
+}
+
+std::string PirTask::ServerDbCachePath(const rpc::Task& task_config) {
+  const auto& party_name = task_config.party_name();
+  const auto& param_map = task_config.params().param_map();
+  const auto& party_datasets = task_config.party_datasets();
+  auto dataset_it = party_datasets.find(party_name);
+  if (dataset_it == party_datasets.end()) {
+    return std::string();
+  }
+  std::string db_name;
+  if (dataset_it->second.dataset_detail()) {
+    auto it = param_map.find(party_name);
+    if (it != param_map.end()) {
+      db_name = it->second.value_string();
+    }
+  } else {
+    const auto& datasets_map = dataset_it->second.data();
+    auto it = datasets_map.find(party_name);
+    if (it != datasets_map.end()) {
+      db_name = it->second;
+    }
+  }
+  if (db_name.empty()) {
+    return std::string();
+  }
+  int pir_type{rpc::PirType::KEY_PIR};
+  auto it = param_map.find("pirType");
+  if (it != param_map.end()) {
+    pir_type = it->second.value_int32();
+  }
+  std::vector<int> key_columns;
+  try {
+    key_columns = ParseServerKeyColumns(task_config);
+  } catch (std::exception& e) {
+    LOG(WARNING) << "parse QueryConfig failed, " << e.what();
+    return std::string();
+  }
+  return DbCachePath(db_name, pir_type, key_columns);
+}
+
 retcode PirTask::ParseQueryConfig(const rpc::Task& task_config) {
   GetServerDataSetSchema(task_config);
+  this->server_key_columns_ = ParseServerKeyColumns(task_config);
   const auto& param_map = task_config.params().param_map();
   // parse key colum and label colums
   auto it = param_map.find("QueryConfig");
@@ -124,9 +238,6 @@ retcode PirTask::ParseQueryConfig(const rpc::Task& task_config) {
     LOG(WARNING) << "no QueryConfig found, "
                  << "Server side using column 0 as default keyword";
     // compatible with no queryconfig set
-    if (this->server_key_columns_.empty()) {
-      this->server_key_columns_.push_back(0);
-    }
     if (this->server_label_columns_.empty()) {
       size_t col_count = server_dataset_schema_.size();
       for (size_t i = 0; i < col_count; i++) {
@@ -142,19 +253,6 @@ retcode PirTask::ParseQueryConfig(const rpc::Task& task_config) {
   nlohmann::json query_conf = nlohmann::json::parse(conf_str);
   // get server query config
   if (query_conf.contains(PARTY_SERVER)) {
-    auto& query_info = query_conf[PARTY_SERVER];
-    // get key
-    if (query_info.contains("key_columns")) {
-      auto& keys = query_info["key_columns"];
-      std::set<int> dup;
-      for (auto& key_index : keys) {
-        if (dup.find(key_index) != dup.end()) {
-          continue;
-        }
-        dup.insert(key_index.get<int>());
-        this->server_key_columns_.push_back(key_index);
-      }
-    }
     // get label, label is all fields
     if (this->server_label_columns_.empty()) {
       size_t total_colums = server_dataset_schema_.size();
@@ -370,19 +468,28 @@ retcode PirTask::ServerLoadDataset() {
   auto& table = std::get<std::shared_ptr<arrow::Table>>(data_ptr->data);
   int col_count = table->num_columns();
   size_t row_count = table->num_rows();
-  if (col_count < 2) {
+  // row index is the key of id pir, a single label column is enough
+  if (col_count < 2 && pir_type_ != rpc::PirType::ID_PIR) {
     RaiseException("data for server must have label");
   }
-  auto& key_col = this->server_key_columns_;
-  if (key_col.empty()) {
-    RaiseException("no column selected for keyword");
-  }
-  auto key_array = GetSelectedContent(table, key_col);
   auto& value_col = this->server_label_columns_;
   if (value_col.empty()) {
     RaiseException("no column selected for label");
   }
   auto value_array = GetSelectedContent(table, value_col);
+  if (pir_type_ == rpc::PirType::ID_PIR) {
+    // row i is retrieved by index i
+    elements_.reserve(value_array.size());
+    for (size_t i = 0; i < value_array.size(); ++i) {
+      elements_[std::to_string(i)].push_back(std::move(value_array[i]));
+    }
+    return retcode::SUCCESS;
+  }
+  auto& key_col = this->server_key_columns_;
+  if (key_col.empty()) {
+    RaiseException("no column selected for keyword");
+  }
+  auto key_array = GetSelectedContent(table, key_col);
   elements_.reserve(key_array.size());
   for (size_t i = 0; i < key_array.size(); ++i) {
     auto& key = key_array[i];
@@ -32,6 +32,11 @@ class PirTask : public TaskBase {
           std::shared_ptr<DatasetService> dataset_service);
   ~PirTask() = default;
   int execute() override;
+  /**
+   * db cache of online pir task of server, which is built by DbInfo task,
+   * empty if dataset of server is not set
+  */
+  static std::string ServerDbCachePath(const rpc::Task& task_config);
 
  protected:
   retcode LoadParams(const rpc::Task& task);
@@ -40,6 +45,8 @@ class PirTask : public TaskBase {
   retcode ClientLoadDataset();
   retcode ServerLoadDataset();
   std::shared_ptr<Dataset> LoadDataSetInternal(const std::string& dataset_id);
+  static std::string DbCachePath(const std::string& db_name, int pir_type,
+                                 const std::vector<int>& key_columns);
   bool DbCacheAvailable(const std::string& db_file_cache) {
     return FileExists(db_file_cache);
   }
@@ -66,7 +73,7 @@ class PirTask : public TaskBase {
   primihub::pir::PirDataType elements_;
   primihub::pir::PirDataType result_;
   primihub::pir::Options options_;
-  std::string db_cache_dir_{"data/cache"};
+  static constexpr char kDbCacheDir[] = "data/cache";
   std::unique_ptr<BasePirOperator> operator_{nullptr};
   std::vector<std::string> server_dataset_schema_;
   std::vector<int> server_key_columns_;
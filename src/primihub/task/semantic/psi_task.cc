@@ -79,6 +79,51 @@ retcode PsiTask::BuildOptions(const rpc::Task& task, psi::Options* options) {
     options->psi_result_type =
         static_cast<psi::PsiResultType>(it->second.value_int32());
   }
+  it = param_map.find("stream_batch_size");
+  if (it != param_map.end() && it->second.value_int64() > 0) {
+    options->stream_batch_size = it->second.value_int64();
+  }
+  it = param_map.find("ecdh_thread_num");
+  if (it != param_map.end() && it->second.value_int32() > 0) {
+    options->ecdh_thread_num = it->second.value_int32();
+  }
+  it = param_map.find("ecdh_server_cache");
+  if (it != param_map.end()) {
+    options->ecdh_server_cache = it->second.value_int32() > 0;
+  }
+  it = param_map.find("psi_thread_num");
+  if (it != param_map.end() && it->second.value_int32() > 0) {
+    options->psi_thread_num = it->second.value_int32();
+  }
+  it = param_map.find("psi_shard_num");
+  if (it != param_map.end() && it->second.value_int32() > 0) {
+    options->psi_shard_num = it->second.value_int32();
+  }
+  it = param_map.find("psi_memory_limit_mb");
+  if (it != param_map.end() && it->second.value_int32() > 0) {
+    options->psi_memory_limit_mb = it->second.value_int32();
+  }
+  it = param_map.find("sync_result_fingerprint");
+  if (it != param_map.end()) {
+    options->sync_result_fingerprint = it->second.value_int32() > 0;
+  }
+  it = param_map.find("mpso_phase");
+  if (it != param_map.end()) {
+    options->mpso_offline = it->second.value_string() == "offline";
+  }
+  it = param_map.find("mpso_log_set_size");
+  if (it != param_map.end() && it->second.value_int32() > 0) {
+    options->mpso_log_set_size = it->second.value_int32();
+  }
+  // counts of batches, shards or parts reveal more than the size of
+  // intersection, cardinality is computed over the whole set in one run
+  if (options->psi_result_type == psi::PsiResultType::CARDINALITY &&
+      (options->stream_batch_size > 0 || options->psi_shard_num > 1 ||
+       options->psi_memory_limit_mb > 0)) {
+    LOG(ERROR) << "cardinality psi does not support stream_batch_size, "
+               << "psi_shard_num or psi_memory_limit_mb";
+    return retcode::FAIL;
+  }
   // end of build Options
   return retcode::SUCCESS;
 }
@@ -103,6 +148,11 @@ retcode PsiTask::LoadParams(const rpc::Task& task) {
     ss << "PsiTag is unknown, value: " << psi_type_;
     RaiseException(ss.str());
   }
+  if (CardinalityOnly() && !UseKeyTable() && psi_type_ != rpc::PsiTag::ECDH) {
+    LOG(ERROR) << "intersection size only is not supported by PsiTag: "
+               << psi_type_;
+    return retcode::FAIL;
+  }
   // get flag for remove duplicate data from origin dataset
   {
     auto it = param_map.find("UniqueValues");
@@ -110,6 +160,7 @@ retcode PsiTask::LoadParams(const rpc::Task& task) {
       unique_values_ = it->second.value_int32() > 0;
       VLOG(0) << "unique_values_: " << unique_values_;
     }
+    options_.filter_duplicate = unique_values_;
   }
 
   // broadcast result flag
@@ -162,7 +213,10 @@ retcode PsiTask::LoadParams(const rpc::Task& task) {
       data_index_.push_back(client_index.value_int32());
     }
   }
-  if (IsTeeCompute()) {
+  // identify cached server data
+  options_.dataset_id = dataset_id_;
+  options_.key_columns = data_index_;
+  if (IsTeeCompute() || IsDealer()) {
     return retcode::SUCCESS;
   }
   // parse result path
@@ -190,12 +244,26 @@ retcode PsiTask::LoadDataset(void) {
   if (dataset_id_.empty() || data_index_.empty()) {
     return retcode::SUCCESS;
   }
+  if (UseExternalPsi()) {
+    // keys are streamed into external psi operator during execution
+    return retcode::SUCCESS;
+  }
   auto driver = this->getDatasetService()->getDriver(this->dataset_id_,
                                                      is_dataset_detail_);
   if (driver == nullptr) {
     LOG(ERROR) << "get driver for data set: " << this->dataset_id_ << " failed";
     return retcode::FAIL;
   }
+  if (UseKeyTable()) {
+    // duplicated keys are filtered by operator after hashing
+    auto ret = LoadKeyTableInternal(driver, data_index_,
+                                    &key_table_, &data_colums_name_);
+    if (ret != retcode::SUCCESS) {
+      LOG(ERROR) << "Load key table for psi failed.";
+      return retcode::FAIL;
+    }
+    return retcode::SUCCESS;
+  }
   auto ret = LoadDatasetInternal(driver, data_index_,
                                  &elements_, &data_colums_name_);
   if (ret != retcode::SUCCESS) {
@@ -229,6 +297,13 @@ retcode PsiTask::LoadDataset(void) {
 
 retcode PsiTask::InitOperator() {
   auto type = static_cast<primihub::psi::PsiType>(psi_type_);
+  if (UseExternalPsi()) {
+    auto spill_dir = CompletePath("psi_spill") + "/" + job_id() + "_" +
+        task_id() + "_" + party_name();
+    external_operator_ = std::make_unique<primihub::psi::ExternalPsiOperator>(
+        options_, type, spill_dir);
+    return retcode::SUCCESS;
+  }
   this->psi_operator_ =
       primihub::psi::Factory::Create(type, options_, tee_executor_);
   if (this->psi_operator_ == nullptr) {
@@ -239,13 +314,68 @@ retcode PsiTask::InitOperator() {
 }
 
 retcode PsiTask::ExecuteOperator() {
+  if (external_operator_ != nullptr) {
+    return ExecuteExternalPsi();
+  }
+  if (key_table_ != nullptr) {
+    return psi_operator_->Execute(key_table_, broadcast_result_, &result_);
+  }
   return psi_operator_->Execute(elements_, broadcast_result_, &result_);
 }
 
+retcode PsiTask::ExecuteExternalPsi() {
+  if (dataset_id_.empty() || data_index_.empty()) {
+    LOG(ERROR) << "no dataset is set for external psi";
+    return retcode::FAIL;
+  }
+  auto driver = this->getDatasetService()->getDriver(this->dataset_id_,
+                                                     is_dataset_detail_);
+  if (driver == nullptr) {
+    LOG(ERROR) << "get driver for data set: " << this->dataset_id_ << " failed";
+    return retcode::FAIL;
+  }
+  SCopedTimer timer;
+  auto ret = LoadKeyTableByBatch(driver, data_index_,
+      external_operator_->BatchBytes(),
+      [&](const arrow::Table& batch) -> retcode {
+        return external_operator_->Spill(batch);
+      },
+      &data_colums_name_);
+  if (ret != retcode::SUCCESS) {
+    LOG(ERROR) << "spill dataset for external psi failed";
+    return retcode::FAIL;
+  }
+  VLOG(5) << "spill dataset time cost(ms): " << timer.timeElapse();
+  bool save_result = NeedSaveResult() && !CardinalityOnly();
+  if (save_result) {
+    // csv title first, result of each part is appended
+    ret = SaveDataToCSVFile({}, result_file_path_, data_colums_name_);
+    if (ret != retcode::SUCCESS) {
+      LOG(ERROR) << "create result file " << result_file_path_ << " failed";
+      return retcode::FAIL;
+    }
+  }
+  return external_operator_->Execute(broadcast_result_,
+      [&](const std::vector<std::string>& result) -> retcode {
+        if (!save_result) {
+          return retcode::SUCCESS;
+        }
+        return AppendDataToCSVFile(result, result_file_path_,
+                                   data_colums_name_);
+      });
+}
+
 retcode PsiTask::SaveResult() {
   if (!NeedSaveResult()) {
     return retcode::SUCCESS;
   }
+  if (CardinalityOnly()) {
+    return SaveCardinality();
+  }
+  if (external_operator_ != nullptr) {
+    // result has been written during execution
+    return retcode::SUCCESS;
+  }
   auto ret = SaveDataToCSVFile(result_, result_file_path_, data_colums_name_);
   if (ret != retcode::SUCCESS) {
     LOG(ERROR) << "save result to " << result_file_path_ << " failed";
@@ -301,17 +431,69 @@ retcode PsiTask::ExecuteTask(const std::vector<std::string>& input,
     std::string error_msg;
     auto ret = LoadParams(task_param_);
     BREAK_LOOP_BY_RETCODE(ret, "Psi load task params failed.")
+    // input of caller is in memory already
+    options_.psi_memory_limit_mb = 0;
     ret = InitOperator();
     BREAK_LOOP_BY_RETCODE(ret, "Psi init operator failed.")
     psi_operator_->Execute(input, broadcast_result_, result);
     BREAK_LOOP_BY_RETCODE(ret, "Psi execute operator failed.")
+    if (CardinalityOnly()) {
+      result->push_back(std::to_string(psi_operator_->Cardinality()));
+    }
     LOG(INFO) << "ExecuteTask result size: " << result->size();
   } while (0);
   return retcode::SUCCESS;
 }
 
+bool PsiTask::UseKeyTable() {
+  switch (psi_type_) {
+  case rpc::PsiTag::KKRT:
+  case rpc::PsiTag::CM20:
+  case rpc::PsiTag::MKKRT:
+    return true;
+  default:
+    return false;
+  }
+}
+
+retcode PsiTask::SaveCardinality() {
+  uint64_t cardinality{0};
+  if (external_operator_ != nullptr) {
+    cardinality = external_operator_->Cardinality();
+  } else {
+    cardinality = psi_operator_->Cardinality();
+  }
+  LOG(INFO) << "psi intersection size: " << cardinality;
+  if (result_file_path_.empty()) {
+    return retcode::SUCCESS;
+  }
+  return SaveDataToCSVFile({std::to_string(cardinality)}, result_file_path_,
+                           {"intersection_size"});
+}
+
+bool PsiTask::CardinalityOnly() {
+  return options_.psi_result_type == psi::PsiResultType::CARDINALITY;
+}
+
+bool PsiTask::UseExternalPsi() {
+  if (options_.psi_memory_limit_mb == 0) {
+    return false;
+  }
+  switch (psi_type_) {
+  case rpc::PsiTag::ECDH:
+  case rpc::PsiTag::KKRT:
+  case rpc::PsiTag::CM20:
+  case rpc::PsiTag::MKKRT:
+    return true;
+  default:
+    LOG(WARNING) << "external psi is not supported by psi type: "
+                 << psi_type_ << ", keys are loaded in memory";
+    return false;
+  }
+}
+
 bool PsiTask::NeedSaveResult() {
-  if (IsTeeCompute()) {
+  if (IsTeeCompute() || IsDealer() || options_.mpso_offline) {
     return false;
   }
   if (IsServer() && !broadcast_result_) {
@@ -331,9 +513,12 @@ bool PsiTask::IsClient() {
 bool PsiTask::IsServer() {
   if (party_name() == PARTY_SERVER) {
     return true;
-  } else {
+  }
+  // data parties of multi-party psi other than client act as server
+  if (IsClient() || IsTeeCompute() || IsDealer()) {
     return false;
   }
+  return true;
 }
 bool PsiTask::IsTeeCompute() {
   if (party_name() == PARTY_TEE_COMPUTE) {
@@ -342,4 +527,11 @@ bool PsiTask::IsTeeCompute() {
     return false;
   }
 }
+bool PsiTask::IsDealer() {
+  if (party_name() == PARTY_DEALER) {
+    return true;
+  } else {
+    return false;
+  }
+}
 }  // namespace primihub::task
@@ -28,6 +28,7 @@
 #include "src/primihub/task/semantic/task.h"
 #include "src/primihub/common/common.h"
 #include "src/primihub/kernel/psi/operator/base_psi.h"
+#include "src/primihub/kernel/psi/operator/external_psi.h"
 #include "src/primihub/kernel/psi/util.h"
 
 namespace rpc = primihub::rpc;
@@ -60,6 +61,24 @@ class PsiTask : public TaskBase, public primihub::psi::PsiCommonUtil {
   bool IsClient();
   bool IsServer();
   bool IsTeeCompute();
+  bool IsDealer();
+  /**
+   * operators hashing keys from arrow table take key table as input,
+   * keys are not materialized as string before psi
+  */
+  bool UseKeyTable();
+  /**
+   * dataset larger than memory limit runs by external psi,
+   * keys are streamed to disk and result is written part by part
+  */
+  bool UseExternalPsi();
+  retcode ExecuteExternalPsi();
+  /**
+   * only intersection size is computed, no element of intersection
+   * is reconstructed, broadcast or written
+  */
+  bool CardinalityOnly();
+  retcode SaveCardinality();
 
  private:
   std::vector<int> data_index_;
@@ -69,9 +88,12 @@ class PsiTask : public TaskBase, public primihub::psi::PsiCommonUtil {
   std::string dataset_id_;
   std::string result_file_path_;
   std::vector<std::string> elements_;
+  std::shared_ptr<arrow::Table> key_table_{nullptr};
   std::vector<std::string> result_;
   bool broadcast_result_{false};
   std::unique_ptr<BasePsiOperator> psi_operator_{nullptr};
+  std::unique_ptr<primihub::psi::ExternalPsiOperator> external_operator_{
+      nullptr};
   primihub::psi::Options options_;
   bool unique_values_{true};
   bool load_dataset_{true};
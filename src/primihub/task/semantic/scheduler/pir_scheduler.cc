@@ -14,6 +14,8 @@
  limitations under the License.
  */
 #include "src/primihub/task/semantic/scheduler/pir_scheduler.h"
+#include <algorithm>
+#include <cctype>
 #include <utility>
 
 #include "absl/memory/memory.h"
@@ -89,11 +91,31 @@ retcode PIRScheduler::dispatch(const PushTaskRequest *pushTaskRequest) {
       node2PbNode(local_node, &party_info);
     }
   }
-  int pirType = PirType::ID_PIR;
+  int pirType = PirType::KEY_PIR;
   auto param_it = params.find("pirType");
   if (param_it != params.end()) {
     pirType = param_it->second.value_int32();
   }
+  if (pirType == PirType::ID_PIR && it != params.end()) {
+    // id pir queries rows by index
+    const auto& pv_client_data = it->second;
+    std::vector<std::string> items;
+    if (pv_client_data.is_array()) {
+      const auto& arr = pv_client_data.value_string_array();
+      items.assign(arr.value_string_array().begin(),
+                   arr.value_string_array().end());
+    } else {
+      items.push_back(pv_client_data.value_string());
+    }
+    for (const auto& item : items) {
+      if (item.empty() ||
+          !std::all_of(item.begin(), item.end(),
+                       [](unsigned char c) {return std::isdigit(c);})) {
+        RaiseException("row index of id pir must be non-negative integer, "
+                       "but get: " + item);
+      }
+    }
+  }
   const auto& participate_node = push_request.task().party_access_info();
   do {
     auto it = params.find("DbInfo");
@@ -72,7 +72,10 @@ retcode TaskBase::recv(const std::string& key, std::string* recv_buff) {
   CHECK_NULLPOINTER_WITH_ERROR_MSG(link_ctx, "LinkContext is empty");
   auto& recv_queue = link_ctx->GetRecvQueue(key);
   std::string recv_data;
-  recv_queue.wait_and_pop(recv_data);
+  if (!recv_queue.wait_and_pop(recv_data)) {
+    LOG(ERROR) << "recv data of key: " << key << " failed";
+    return retcode::FAIL;
+  }
   *recv_buff = std::move(recv_data);
   return retcode::SUCCESS;
 }
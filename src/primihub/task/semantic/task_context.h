@@ -36,12 +36,17 @@ namespace primihub::task {
 class TaskContext {
  public:
   TaskContext() {
-    auto link_mode = primihub::network::LinkMode::GRPC;
-    link_ctx_ = primihub::network::LinkFactory::createLinkContext(link_mode);
+    using LinkFactory = primihub::network::LinkFactory;
     auto& server_config = primihub::ServerConfig::getInstance();
     if (!server_config.IsInitFlag()) {
       LOG(WARNING) << "instance is not init";
     }
+    auto& link_cfg = server_config.getNodeConfig().link_cfg;
+    auto link_mode = LinkFactory::LinkModeFromString(link_cfg.mode);
+    link_ctx_ = LinkFactory::createLinkContext(link_mode);
+    link_ctx_->compressor().Init(link_cfg.compress);
+    link_ctx_->initFlowControl(link_cfg.flow_control);
+    link_ctx_->initCoalesce(link_cfg.coalesce);
 
     auto& host_cfg = server_config.getServiceConfig();
     if (host_cfg.use_tls()) {
@@ -53,6 +58,10 @@ class TaskContext {
   explicit TaskContext(primihub::network::LinkMode mode) {
     link_ctx_ = primihub::network::LinkFactory::createLinkContext(mode);
     auto& server_config = primihub::ServerConfig::getInstance();
+    auto& link_cfg = server_config.getNodeConfig().link_cfg;
+    link_ctx_->compressor().Init(link_cfg.compress);
+    link_ctx_->initFlowControl(link_cfg.flow_control);
+    link_ctx_->initCoalesce(link_cfg.coalesce);
     auto& host_cfg = server_config.getServiceConfig();
     if (host_cfg.use_tls()) {
       LOG(ERROR) << "link_ctx_->initCertificate";
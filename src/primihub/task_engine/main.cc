@@ -26,6 +26,8 @@ DEFINE_string(config_file, "./config/node1.yaml", "server config file");
 DEFINE_string(request, "", "task request, serialized by rpc::Task");
 DEFINE_string(request_id, "", "task request, serialized by rpc::Task");
 DEFINE_string(log_path, "", "log path");
+DEFINE_string(shm_link, "",
+              "shared memory link to node daemon, empty means using grpc");
 
 int main(int argc, char **argv) {
   gflags::ParseCommandLineFlags(&argc, &argv, true);
@@ -57,7 +59,8 @@ int main(int argc, char **argv) {
   }
   auto& service_cfg = server_cfg.getServiceConfig();
   auto task_engine = std::make_unique<primihub::task_engine::TaskEngine>();
-  ret = task_engine->Init(service_cfg.id(), config_file, task_request_str);
+  ret = task_engine->Init(service_cfg.id(), config_file, task_request_str,
+                          FLAGS_shm_link);
   if (ret != primihub::retcode::SUCCESS) {
     LOG(ERROR) << "init py executor failed";
     return -1;
@@ -19,11 +19,14 @@
 #include "src/primihub/common/config/server_config.h"
 #include "src/primihub/service/dataset/meta_service/factory.h"
 #include "src/primihub/task/semantic/factory.h"
+#include "src/primihub/util/network/shm_link.h"
+#include "src/primihub/util/network/grpc_channel_pool.h"
 
 namespace primihub::task_engine {
 retcode TaskEngine::Init(const std::string& server_id,
                          const std::string& config_file,
-                         const std::string& request) {
+                         const std::string& request,
+                         const std::string& shm_link) {
   this->node_id_ = server_id;
   this->config_file_ = config_file;
   VLOG(5) << "ParseTaskRequest";
@@ -48,6 +51,7 @@ retcode TaskEngine::Init(const std::string& server_id,
     LOG(ERROR) << "CreateTask failed";
     return retcode::FAIL;
   }
+  InitLocalLink(shm_link);
   return retcode::SUCCESS;
 }
 retcode TaskEngine::ParseTaskRequest(const std::string& request_str) {
@@ -70,6 +74,9 @@ retcode TaskEngine::InitCommunication() {
   if (host_cfg.use_tls()) {
     link_ctx_->initCertificate(server_config.getCertificateConfig());
   }
+  // channels to the same peer are shared by links of this task
+  auto& link_cfg = server_config.getNodeConfig().link_cfg;
+  network::GrpcChannelPool::GetInstance().Init(link_cfg.channel_pool);
   return retcode::SUCCESS;
 }
 
@@ -145,6 +152,24 @@ retcode TaskEngine::CreateTask() {
   return retcode::SUCCESS;
 }
 
+retcode TaskEngine::InitLocalLink(const std::string& shm_link) {
+  if (shm_link.empty()) {
+    return retcode::SUCCESS;
+  }
+  auto local_link = network::ShmLinkClient::Connect(shm_link);
+  if (local_link == nullptr) {
+    LOG(WARNING) << "attach shared memory link: " << shm_link
+                 << " failed, use grpc instead";
+    return retcode::FAIL;
+  }
+  auto& server_config = primihub::ServerConfig::getInstance();
+  auto& link_ctx = task_->getTaskContext().getLinkContext();
+  link_ctx->AttachLocalLink(std::move(local_link),
+                            server_config.getServiceConfig());
+  VLOG(3) << "received data is delivered by shared memory link: " << shm_link;
+  return retcode::SUCCESS;
+}
+
 retcode TaskEngine::Execute() {
   if (task_ == nullptr) {
     LOG(ERROR) << "task is not available";
@@ -36,9 +36,14 @@ class TaskEngine {
  public:
   TaskEngine() = default;
   ~TaskEngine() = default;
+  /**
+   * shm_link: name of shared memory link created by node daemon,
+   *           received data is pulled by grpc if it is empty
+  */
   retcode Init(const std::string& server_id,
                const std::string& server_config_file,
-               const std::string& request);
+               const std::string& request,
+               const std::string& shm_link = "");
   retcode Execute();
 
   retcode GetScheduleNode();
@@ -50,6 +55,7 @@ class TaskEngine {
   retcode InitCommunication();
   retcode InitDatasetSerivce();
   retcode CreateTask();
+  retcode InitLocalLink(const std::string& shm_link);
  private:
   TaskRequestPtr task_request_{nullptr};
   std::string node_id_;
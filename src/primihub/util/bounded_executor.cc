@@ -0,0 +1,141 @@
+// Copyright [2023] <primihub.com>
+#include "src/primihub/util/bounded_executor.h"
+#include <glog/logging.h>
+#include <pthread.h>
+#include <sched.h>
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+
+namespace primihub {
+BoundedExecutor::BoundedExecutor(size_t thread_num, size_t queue_capacity,
+                                 int numa_node) {
+  thread_num_ = thread_num > 0 ? thread_num : DefaultThreadNum();
+  queue_capacity_ = queue_capacity > 0 ? queue_capacity : 2 * thread_num_;
+  std::vector<int> cpus;
+  if (numa_node >= 0) {
+    cpus = NumaNodeCpus(numa_node);
+    if (cpus.empty()) {
+      LOG(WARNING) << "no cpu found for numa node: " << numa_node << ", "
+                   << "workers are not pinned";
+    }
+  }
+  workers_.reserve(thread_num_);
+  for (size_t i = 0; i < thread_num_; i++) {
+    workers_.emplace_back(&BoundedExecutor::WorkLoop, this);
+    if (cpus.empty()) {
+      continue;
+    }
+    cpu_set_t cpu_set;
+    CPU_ZERO(&cpu_set);
+    for (auto cpu : cpus) {
+      CPU_SET(cpu, &cpu_set);
+    }
+    int ret = pthread_setaffinity_np(workers_.back().native_handle(),
+                                     sizeof(cpu_set), &cpu_set);
+    if (ret != 0) {
+      LOG(WARNING) << "pin worker to numa node: " << numa_node << " failed, "
+                   << "error: " << ret;
+    }
+  }
+  VLOG(5) << "executor threads: " << thread_num_ << " "
+          << "queue capacity: " << queue_capacity_ << " "
+          << "numa node: " << numa_node;
+}
+
+BoundedExecutor::~BoundedExecutor() {
+  Shutdown();
+}
+
+void BoundedExecutor::Shutdown() {
+  {
+    std::lock_guard<std::mutex> lck(mtx_);
+    if (stop_ && workers_.empty()) {
+      return;
+    }
+    stop_ = true;
+  }
+  not_empty_cv_.notify_all();
+  not_full_cv_.notify_all();
+  for (auto& worker : workers_) {
+    if (worker.joinable()) {
+      worker.join();
+    }
+  }
+  std::lock_guard<std::mutex> lck(mtx_);
+  workers_.clear();
+}
+
+void BoundedExecutor::WorkLoop() {
+  for (;;) {
+    Item item;
+    {
+      std::unique_lock<std::mutex> lck(mtx_);
+      not_empty_cv_.wait(lck, [&]() {return stop_ || !queue_.empty();});
+      if (queue_.empty()) {
+        return;
+      }
+      item = std::move(queue_.front());
+      queue_.pop_front();
+      stats_.queue_depth = queue_.size();
+      std::chrono::duration<double, std::milli> wait =
+          std::chrono::steady_clock::now() - item.enqueue_time;
+      stats_.total_wait_ms += wait.count();
+      stats_.max_wait_ms = std::max(stats_.max_wait_ms, wait.count());
+    }
+    not_full_cv_.notify_one();
+    // exception is kept in the future of the task
+    item.fn();
+    std::lock_guard<std::mutex> lck(mtx_);
+    stats_.completed++;
+  }
+}
+
+BoundedExecutor::Stats BoundedExecutor::stats() const {
+  std::lock_guard<std::mutex> lck(mtx_);
+  return stats_;
+}
+
+std::string BoundedExecutor::StatsString() const {
+  auto s = stats();
+  std::stringstream ss;
+  ss << "threads: " << thread_num_ << " "
+     << "submitted: " << s.submitted << " "
+     << "completed: " << s.completed << " "
+     << "queue depth: " << s.queue_depth << " "
+     << "max queue depth: " << s.max_queue_depth << "/" << queue_capacity_
+     << " avg wait(ms): "
+     << (s.submitted > 0 ? s.total_wait_ms / s.submitted : 0) << " "
+     << "max wait(ms): " << s.max_wait_ms;
+  return ss.str();
+}
+
+size_t BoundedExecutor::DefaultThreadNum() {
+  return std::max<size_t>(std::thread::hardware_concurrency() / 2, 1);
+}
+
+std::vector<int> BoundedExecutor::NumaNodeCpus(int numa_node) {
+  // format of cpulist: 0-3,8,10-11
+  std::vector<int> cpus;
+  std::ifstream in("/sys/devices/system/node/node" +
+                   std::to_string(numa_node) + "/cpulist");
+  std::string range;
+  while (std::getline(in, range, ',')) {
+    int first{0};
+    int last{0};
+    char dash{0};
+    std::stringstream ss(range);
+    if (!(ss >> first)) {
+      break;
+    }
+    last = first;
+    if (ss >> dash && dash == '-' && !(ss >> last)) {
+      break;
+    }
+    for (int cpu = first; cpu <= last; cpu++) {
+      cpus.push_back(cpu);
+    }
+  }
+  return cpus;
+}
+}  // namespace primihub
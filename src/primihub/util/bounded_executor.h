@@ -0,0 +1,109 @@
+// Copyright [2023] <primihub.com>
+#ifndef SRC_PRIMIHUB_UTIL_BOUNDED_EXECUTOR_H_
+#define SRC_PRIMIHUB_UTIL_BOUNDED_EXECUTOR_H_
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace primihub {
+/**
+ * fixed-size worker pool owned by one task.
+ * at most thread_num tasks run at the same time and at most
+ * queue_capacity tasks wait, Submit blocks while the queue is full,
+ * so a producer never runs ahead of the workers and the cpu used by
+ * a task is bounded by its budget instead of the size of its input.
+ * with numa_node >= 0 workers are pinned to cpus of that node,
+ * data touched by them stays in local memory.
+*/
+class BoundedExecutor {
+ public:
+  struct Stats {
+    uint64_t submitted{0};
+    uint64_t completed{0};
+    size_t queue_depth{0};
+    size_t max_queue_depth{0};
+    // time from submit to start of tasks
+    double total_wait_ms{0};
+    double max_wait_ms{0};
+  };
+
+  /**
+   * thread_num 0 means half of the cores, queue_capacity 0 means
+   * twice of thread_num
+  */
+  explicit BoundedExecutor(size_t thread_num, size_t queue_capacity = 0,
+                           int numa_node = -1);
+  ~BoundedExecutor();
+
+  template <typename Fn>
+  std::future<void> Submit(Fn&& fn) {
+    auto task = std::make_shared<std::packaged_task<void()>>(
+        std::forward<Fn>(fn));
+    auto fut = task->get_future();
+    {
+      std::unique_lock<std::mutex> lck(mtx_);
+      not_full_cv_.wait(lck, [&]() {
+        return stop_ || queue_.size() < queue_capacity_;
+      });
+      if (stop_) {
+        // the task is dropped, its future reports broken promise
+        return fut;
+      }
+      queue_.push_back({[task]() {(*task)();},
+                        std::chrono::steady_clock::now()});
+      stats_.submitted++;
+      stats_.queue_depth = queue_.size();
+      if (stats_.queue_depth > stats_.max_queue_depth) {
+        stats_.max_queue_depth = stats_.queue_depth;
+      }
+    }
+    not_empty_cv_.notify_one();
+    return fut;
+  }
+
+  /**
+   * queued tasks are finished before workers exit,
+   * following Submit fails
+  */
+  void Shutdown();
+  Stats stats() const;
+  std::string StatsString() const;
+  size_t thread_num() const {return thread_num_;}
+
+  /**
+   * cpus of numa node, empty if it is unknown
+  */
+  static std::vector<int> NumaNodeCpus(int numa_node);
+  static size_t DefaultThreadNum();
+
+ protected:
+  void WorkLoop();
+
+ private:
+  struct Item {
+    std::function<void()> fn;
+    std::chrono::steady_clock::time_point enqueue_time;
+  };
+  size_t thread_num_{1};
+  size_t queue_capacity_{2};
+  std::vector<std::thread> workers_;
+  std::deque<Item> queue_;
+  Stats stats_;
+  bool stop_{false};
+  mutable std::mutex mtx_;
+  std::condition_variable not_empty_cv_;
+  std::condition_variable not_full_cv_;
+};
+}  // namespace primihub
+#endif  // SRC_PRIMIHUB_UTIL_BOUNDED_EXECUTOR_H_
@@ -0,0 +1,118 @@
+/*
+* Copyright (c) 2023 by PrimiHub
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      https://www.apache.org/licenses/
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#include "src/primihub/util/mapped_file.h"
+#include <fcntl.h>
+#include <glog/logging.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+
+namespace primihub {
+std::unique_ptr<MappedFile> MappedFile::Open(const std::string& file_path) {
+  int fd = open(file_path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    LOG(ERROR) << "open file: " << file_path << " failed, "
+               << strerror(errno);
+    return nullptr;
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0) {
+    LOG(ERROR) << "stat file: " << file_path << " failed, "
+               << strerror(errno);
+    close(fd);
+    return nullptr;
+  }
+  size_t map_size = st.st_size;
+  if (map_size == 0) {
+    close(fd);
+    return std::unique_ptr<MappedFile>(new MappedFile(nullptr, 0));
+  }
+  void* addr = mmap(nullptr, map_size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (addr == MAP_FAILED) {
+    LOG(ERROR) << "map file: " << file_path << " failed, "
+               << strerror(errno);
+    return nullptr;
+  }
+  return std::unique_ptr<MappedFile>(
+      new MappedFile(reinterpret_cast<const char*>(addr), map_size));
+}
+
+MappedFile::~MappedFile() {
+  if (data_ != nullptr) {
+    munmap(const_cast<char*>(data_), size_);
+  }
+}
+
+void MappedFile::Advise(Advice advice, size_t offset, size_t length) const {
+  if (data_ == nullptr || offset >= size_) {
+    return;
+  }
+  int flag{MADV_NORMAL};
+  switch (advice) {
+  case Advice::SEQUENTIAL:
+    flag = MADV_SEQUENTIAL;
+    break;
+  case Advice::WILLNEED:
+    flag = MADV_WILLNEED;
+    break;
+  case Advice::RANDOM:
+    flag = MADV_RANDOM;
+    break;
+  default:
+    break;
+  }
+  // madvise requires page aligned address
+  size_t page_size = sysconf(_SC_PAGESIZE);
+  size_t begin = offset / page_size * page_size;
+  size_t end = (length == 0 || offset + length > size_) ? size_
+                                                        : offset + length;
+  if (madvise(const_cast<char*>(data_) + begin, end - begin, flag) != 0) {
+    VLOG(5) << "madvise failed, " << strerror(errno);
+  }
+}
+
+MemoryStreamBuf::MemoryStreamBuf(std::string_view data) {
+  auto begin = const_cast<char*>(data.data());
+  setg(begin, begin, begin + data.size());
+}
+
+MemoryStreamBuf::pos_type MemoryStreamBuf::seekoff(
+    off_type off, std::ios_base::seekdir dir, std::ios_base::openmode which) {
+  if (!(which & std::ios_base::in)) {
+    return pos_type(off_type(-1));
+  }
+  off_type base{0};
+  if (dir == std::ios_base::cur) {
+    base = gptr() - eback();
+  } else if (dir == std::ios_base::end) {
+    base = egptr() - eback();
+  }
+  off_type pos = base + off;
+  if (pos < 0 || pos > egptr() - eback()) {
+    return pos_type(off_type(-1));
+  }
+  setg(eback(), eback() + pos, egptr());
+  return pos_type(pos);
+}
+
+MemoryStreamBuf::pos_type MemoryStreamBuf::seekpos(
+    pos_type pos, std::ios_base::openmode which) {
+  return seekoff(off_type(pos), std::ios_base::beg, which);
+}
+}  // namespace primihub
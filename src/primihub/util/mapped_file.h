@@ -0,0 +1,69 @@
+/*
+* Copyright (c) 2023 by PrimiHub
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      https://www.apache.org/licenses/
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#ifndef SRC_PRIMIHUB_UTIL_MAPPED_FILE_H_
+#define SRC_PRIMIHUB_UTIL_MAPPED_FILE_H_
+#include <cstddef>
+#include <memory>
+#include <streambuf>
+#include <string>
+#include <string_view>
+
+namespace primihub {
+/**
+ * read-only shared mapping of a whole file.
+ * pages come from the page cache and are faulted in on first access,
+ * so opening is cheap whatever the file size is, and processes mapping
+ * the same file share one copy of it in memory
+*/
+class MappedFile {
+ public:
+  enum class Advice {
+    NORMAL = 0,
+    SEQUENTIAL,   // read ahead aggressively, drop pages behind
+    WILLNEED,     // start reading the whole file in background
+    RANDOM,       // no read ahead
+  };
+  static std::unique_ptr<MappedFile> Open(const std::string& file_path);
+  ~MappedFile();
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+
+  const char* data() const {return data_;}
+  size_t size() const {return size_;}
+  std::string_view view() const {return std::string_view(data_, size_);}
+  void Advise(Advice advice, size_t offset = 0, size_t length = 0) const;
+
+ private:
+  MappedFile(const char* data, size_t size) : data_(data), size_(size) {}
+  const char* data_{nullptr};
+  size_t size_{0};
+};
+
+/**
+ * std::istream source over memory without copying it,
+ * e.g. deserializing from MappedFile
+*/
+class MemoryStreamBuf : public std::streambuf {
+ public:
+  explicit MemoryStreamBuf(std::string_view data);
+
+ protected:
+  pos_type seekoff(off_type off, std::ios_base::seekdir dir,
+                   std::ios_base::openmode which) override;
+  pos_type seekpos(pos_type pos, std::ios_base::openmode which) override;
+};
+}  // namespace primihub
+#endif  // SRC_PRIMIHUB_UTIL_MAPPED_FILE_H_
@@ -0,0 +1,182 @@
+// Copyright [2023] <primihub.com>
+#ifndef SRC_PRIMIHUB_UTIL_MEMORY_BUDGET_H_
+#define SRC_PRIMIHUB_UTIL_MEMORY_BUDGET_H_
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+
+namespace primihub {
+/**
+ * bytes budget shared by producer and consumer of buffered data,
+ * producer acquires before buffering and consumer releases after consumed,
+ * so memory held by fast producer is bounded and the producer is blocked
+ * until consumer catches up.
+ * budget with parent also charges the parent, e.g. per-key budget
+ * inside per-task budget.
+ * limit 0 means unlimited, request larger than limit is granted
+ * when nothing is held, otherwise it would never be satisfied
+*/
+class MemoryBudget {
+ public:
+  explicit MemoryBudget(uint64_t limit = 0,
+                        std::shared_ptr<MemoryBudget> parent = nullptr) :
+      limit_(limit), parent_(std::move(parent)) {}
+  ~MemoryBudget() {
+    Shutdown();
+  }
+
+  bool TryAcquire(uint64_t size) {
+    {
+      std::lock_guard<std::mutex> lck(mtx_);
+      if (stop_ || !Fits(size)) {
+        return false;
+      }
+      used_ += size;
+    }
+    if (parent_ != nullptr && !parent_->TryAcquire(size)) {
+      ReleaseLocal(size);
+      return false;
+    }
+    return true;
+  }
+
+  /**
+   * block until size bytes are available,
+   * timeout_ms < 0 means waiting forever.
+   * return false if timeout or shutdown
+  */
+  bool Acquire(uint64_t size, int32_t timeout_ms = -1) {
+    auto deadline = std::chrono::steady_clock::now() +
+                    std::chrono::milliseconds(timeout_ms);
+    {
+      std::unique_lock<std::mutex> lck(mtx_);
+      auto ready = [&]() {return stop_ || Fits(size);};
+      if (timeout_ms < 0) {
+        cv_.wait(lck, ready);
+      } else if (!cv_.wait_until(lck, deadline, ready)) {
+        return false;
+      }
+      if (stop_) {
+        return false;
+      }
+      used_ += size;
+    }
+    if (parent_ == nullptr) {
+      return true;
+    }
+    int32_t remain_ms{-1};
+    if (timeout_ms >= 0) {
+      remain_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+          deadline - std::chrono::steady_clock::now()).count();
+      remain_ms = remain_ms < 0 ? 0 : remain_ms;
+    }
+    if (!parent_->Acquire(size, remain_ms)) {
+      ReleaseLocal(size);
+      return false;
+    }
+    return true;
+  }
+
+  /**
+   * charge size beyond limit without waiting, only if the limit is not
+   * exceeded yet, so at most one oversized charge is outstanding and
+   * usage stays below limit plus one request.
+   * return false if limit is exceeded already or shutdown
+  */
+  bool TryOvercommit(uint64_t size) {
+    {
+      std::lock_guard<std::mutex> lck(mtx_);
+      if (stop_ || (limit_ != 0 && used_ > limit_)) {
+        return false;
+      }
+      used_ += size;
+    }
+    if (parent_ != nullptr && !parent_->TryOvercommit(size)) {
+      ReleaseLocal(size);
+      return false;
+    }
+    return true;
+  }
+
+  /**
+   * block until size bytes would fit without acquiring them,
+   * timeout_ms < 0 means waiting forever.
+   * return false if timeout or shutdown
+  */
+  bool WaitFits(uint64_t size, int32_t timeout_ms = -1) {
+    auto deadline = std::chrono::steady_clock::now() +
+                    std::chrono::milliseconds(timeout_ms);
+    {
+      std::unique_lock<std::mutex> lck(mtx_);
+      auto ready = [&]() {return stop_ || Fits(size);};
+      if (timeout_ms < 0) {
+        cv_.wait(lck, ready);
+      } else if (!cv_.wait_until(lck, deadline, ready)) {
+        return false;
+      }
+      if (stop_) {
+        return false;
+      }
+    }
+    if (parent_ == nullptr) {
+      return true;
+    }
+    int32_t remain_ms{-1};
+    if (timeout_ms >= 0) {
+      remain_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+          deadline - std::chrono::steady_clock::now()).count();
+      remain_ms = remain_ms < 0 ? 0 : remain_ms;
+    }
+    return parent_->WaitFits(size, remain_ms);
+  }
+
+  void Release(uint64_t size) {
+    ReleaseLocal(size);
+    if (parent_ != nullptr) {
+      parent_->Release(size);
+    }
+  }
+
+  /**
+   * wake up all blocked producers, following acquisition fails
+  */
+  void Shutdown() {
+    {
+      std::lock_guard<std::mutex> lck(mtx_);
+      stop_ = true;
+    }
+    cv_.notify_all();
+  }
+
+  uint64_t limit() const {return limit_;}
+  uint64_t used() const {
+    std::lock_guard<std::mutex> lck(mtx_);
+    return used_;
+  }
+
+ protected:
+  bool Fits(uint64_t size) const {
+    return limit_ == 0 || used_ == 0 || used_ + size <= limit_;
+  }
+
+  void ReleaseLocal(uint64_t size) {
+    {
+      std::lock_guard<std::mutex> lck(mtx_);
+      used_ = size > used_ ? 0 : used_ - size;
+    }
+    cv_.notify_all();
+  }
+
+ private:
+  uint64_t limit_{0};
+  std::shared_ptr<MemoryBudget> parent_{nullptr};
+  uint64_t used_{0};
+  bool stop_{false};
+  mutable std::mutex mtx_;
+  std::condition_variable cv_;
+};
+}  // namespace primihub
+#endif  // SRC_PRIMIHUB_UTIL_MEMORY_BUDGET_H_
@@ -0,0 +1,174 @@
+/*
+* Copyright (c) 2023 by PrimiHub
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      https://www.apache.org/licenses/
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#include "src/primihub/util/network/grpc_channel_pool.h"
+#include <glog/logging.h>
+#include <grpcpp/create_channel.h>
+#include <grpcpp/support/channel_arguments.h>
+
+#include <sstream>
+
+namespace primihub::network {
+GrpcChannelPool& GrpcChannelPool::GetInstance() {
+  static GrpcChannelPool ins;
+  return ins;
+}
+
+void GrpcChannelPool::Init(const common::ChannelPoolConfig& cfg) {
+  std::lock_guard<std::mutex> lck(mtx_);
+  config_ = cfg;
+  channels_.clear();
+  enabled_.store(cfg.enable);
+  VLOG(3) << "grpc channel pool enable: " << cfg.enable << " "
+          << "keepalive_time_ms: " << cfg.keepalive_time_ms << " "
+          << "idle_timeout_s: " << cfg.idle_timeout_s;
+}
+
+std::string GrpcChannelPool::PoolKey(
+    const std::string& address,
+    const grpc::SslCredentialsOptions* ssl_opts) {
+  if (ssl_opts == nullptr) {
+    return address + "|insecure";
+  }
+  // full pem contents, channel with credentials of another party
+  // must never be handed out. length prefix keeps fields unambiguous
+  std::string key = address + "|tls";
+  for (const auto* pem : {&ssl_opts->pem_root_certs,
+                          &ssl_opts->pem_private_key,
+                          &ssl_opts->pem_cert_chain}) {
+    key.append("|").append(std::to_string(pem->size()))
+       .append(":").append(*pem);
+  }
+  return key;
+}
+
+std::shared_ptr<grpc::Channel> GrpcChannelPool::BuildChannel(
+    const std::string& address,
+    const grpc::SslCredentialsOptions* ssl_opts) {
+  std::shared_ptr<grpc::ChannelCredentials> creds{nullptr};
+  if (ssl_opts != nullptr) {
+    creds = grpc::SslCredentials(*ssl_opts);
+  } else {
+    creds = grpc::InsecureChannelCredentials();
+  }
+  grpc::ChannelArguments channel_args;
+  if (enabled()) {
+    // shared channel outlives tasks, keep its connection alive
+    // and detect dead peer while it is idle
+    channel_args.SetInt(GRPC_ARG_KEEPALIVE_TIME_MS, config_.keepalive_time_ms);
+    channel_args.SetInt(GRPC_ARG_KEEPALIVE_TIMEOUT_MS,
+                        config_.keepalive_timeout_ms);
+    // peer accepts pings without active call only if it is configured
+    if (config_.keepalive_without_calls) {
+      channel_args.SetInt(GRPC_ARG_KEEPALIVE_PERMIT_WITHOUT_CALLS, 1);
+      channel_args.SetInt(GRPC_ARG_HTTP2_MAX_PINGS_WITHOUT_DATA, 0);
+    }
+  }
+  return grpc::CreateCustomChannel(address, creds, channel_args);
+}
+
+void GrpcChannelPool::EvictIdle(std::chrono::steady_clock::time_point now) {
+  if (config_.idle_timeout_s <= 0) {
+    return;
+  }
+  auto idle_timeout = std::chrono::seconds(config_.idle_timeout_s);
+  for (auto it = channels_.begin(); it != channels_.end();) {
+    // borrowed channel is also held by stubs of some task
+    if (it->second.channel.use_count() == 1 &&
+        now - it->second.last_used > idle_timeout) {
+      VLOG(5) << "release idle grpc channel: " << it->first;
+      it = channels_.erase(it);
+      stats_.evicted++;
+    } else {
+      ++it;
+    }
+  }
+}
+
+std::shared_ptr<grpc::Channel> GrpcChannelPool::GetChannel(
+    const std::string& address,
+    const grpc::SslCredentialsOptions* ssl_opts) {
+  if (!enabled()) {
+    return BuildChannel(address, ssl_opts);
+  }
+  auto key = PoolKey(address, ssl_opts);
+  auto now = std::chrono::steady_clock::now();
+  std::lock_guard<std::mutex> lck(mtx_);
+  EvictIdle(now);
+  auto it = channels_.find(key);
+  if (it != channels_.end()) {
+    auto state = it->second.channel->GetState(false);
+    if (state != GRPC_CHANNEL_TRANSIENT_FAILURE &&
+        state != GRPC_CHANNEL_SHUTDOWN) {
+      stats_.hit++;
+      it->second.last_used = now;
+      return it->second.channel;
+    }
+    // start over instead of waiting for reconnect backoff,
+    // task still holding the broken channel keeps it
+    VLOG(3) << "grpc channel to " << address << " is unhealthy, "
+            << "state: " << state << ", rebuild it";
+    stats_.rebuild++;
+  } else {
+    stats_.miss++;
+  }
+  auto& entry = channels_[key];
+  entry.channel = BuildChannel(address, ssl_opts);
+  entry.last_used = now;
+  stats_.size = channels_.size();
+  return entry.channel;
+}
+
+size_t GrpcChannelPool::Warmup(const std::vector<std::string>& peers,
+                               const grpc::SslCredentialsOptions* ssl_opts) {
+  if (!enabled()) {
+    return 0;
+  }
+  size_t count{0};
+  for (const auto& peer : peers) {
+    auto channel = GetChannel(peer, ssl_opts);
+    // try to connect in background
+    channel->GetState(true);
+    count++;
+    VLOG(3) << "warm up grpc channel to " << peer;
+  }
+  return count;
+}
+
+GrpcChannelPool::Stats GrpcChannelPool::GetStats() {
+  std::lock_guard<std::mutex> lck(mtx_);
+  stats_.size = channels_.size();
+  return stats_;
+}
+
+std::string GrpcChannelPool::StatsToString() {
+  auto stats = GetStats();
+  uint64_t total = stats.hit + stats.miss + stats.rebuild;
+  double hit_rate = total == 0 ? 0 : static_cast<double>(stats.hit) / total;
+  std::ostringstream ss;
+  ss << "grpc channel pool size: " << stats.size << " "
+     << "hit: " << stats.hit << " "
+     << "miss: " << stats.miss << " "
+     << "rebuild: " << stats.rebuild << " "
+     << "evicted: " << stats.evicted << " "
+     << "hit rate: " << hit_rate;
+  return ss.str();
+}
+
+void GrpcChannelPool::Clear() {
+  std::lock_guard<std::mutex> lck(mtx_);
+  channels_.clear();
+}
+}  // namespace primihub::network
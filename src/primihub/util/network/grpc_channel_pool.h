@@ -0,0 +1,98 @@
+/*
+* Copyright (c) 2023 by PrimiHub
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      https://www.apache.org/licenses/
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#ifndef SRC_PRIMIHUB_UTIL_NETWORK_GRPC_CHANNEL_POOL_H_
+#define SRC_PRIMIHUB_UTIL_NETWORK_GRPC_CHANNEL_POOL_H_
+#include <grpcpp/channel.h>
+#include <grpcpp/security/credentials.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "src/primihub/common/config/config.h"
+
+namespace primihub::network {
+/**
+ * process wide cache of grpc channels,
+ * tasks talking to the same peer borrow one channel instead of
+ * building a new connection and tls handshake for every task.
+ * channel is keyed by peer address and full tls config,
+ * channel in TRANSIENT_FAILURE or SHUTDOWN is rebuilt when borrowed,
+ * channel not borrowed for idle_timeout_s is released.
+ * pool is disabled until Init is called with enabled config,
+ * GetChannel builds a private channel in that case
+*/
+class GrpcChannelPool {
+ public:
+  struct Stats {
+    uint64_t hit{0};
+    uint64_t miss{0};
+    uint64_t rebuild{0};
+    uint64_t evicted{0};
+    size_t size{0};
+  };
+  static GrpcChannelPool& GetInstance();
+  void Init(const common::ChannelPoolConfig& cfg);
+  bool enabled() const {return enabled_.load();}
+  /**
+   * ssl_opts: nullptr means insecure channel
+  */
+  std::shared_ptr<grpc::Channel> GetChannel(
+      const std::string& address,
+      const grpc::SslCredentialsOptions* ssl_opts);
+  /**
+   * start connecting to peers "ip:port" without waiting,
+   * return number of channels created
+  */
+  size_t Warmup(const std::vector<std::string>& peers,
+                const grpc::SslCredentialsOptions* ssl_opts);
+  Stats GetStats();
+  std::string StatsToString();
+  /**
+   * drop all cached channels, borrowed channels stay valid
+  */
+  void Clear();
+
+ protected:
+  GrpcChannelPool() = default;
+  struct Entry {
+    std::shared_ptr<grpc::Channel> channel;
+    std::chrono::steady_clock::time_point last_used;
+  };
+  static std::string PoolKey(const std::string& address,
+                             const grpc::SslCredentialsOptions* ssl_opts);
+  std::shared_ptr<grpc::Channel> BuildChannel(
+      const std::string& address,
+      const grpc::SslCredentialsOptions* ssl_opts);
+  /**
+   * caller holds mtx_
+  */
+  void EvictIdle(std::chrono::steady_clock::time_point now);
+
+ private:
+  std::atomic<bool> enabled_{false};
+  std::mutex mtx_;
+  common::ChannelPoolConfig config_;
+  std::unordered_map<std::string, Entry> channels_;
+  Stats stats_;
+};
+}  // namespace primihub::network
+#endif  // SRC_PRIMIHUB_UTIL_NETWORK_GRPC_CHANNEL_POOL_H_
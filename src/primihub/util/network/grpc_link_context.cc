@@ -1,6 +1,9 @@
 // Copyright [2022] <primihub.com>
 #include "src/primihub/util/network/grpc_link_context.h"
 #include <glog/logging.h>
+#include <grpcpp/impl/codegen/client_context.h>
+#include <grpcpp/impl/codegen/rpc_method.h>
+#include <grpcpp/impl/codegen/sync_stream.h>
 #include <vector>
 #include <algorithm>
 #include <utility>
@@ -9,9 +12,29 @@
 #include "src/primihub/util/util.h"
 #include "src/primihub/util/log.h"
 #include "src/primihub/util/proto_log_helper.h"
+#include "src/primihub/util/network/task_request_codec.h"
+#include "src/primihub/util/network/grpc_channel_pool.h"
 
 namespace pb_util = primihub::proto::util;
 namespace primihub::network {
+namespace {
+using grpc::internal::RpcMethod;
+/**
+ * data methods of VMNode invoked with raw ByteBuffer,
+ * so that payload is written and read without protobuf copy
+*/
+const std::string& RawMethodName(const std::string& method) {
+  static std::unordered_map<std::string, std::string> method_names = {
+    {"Send", "/" + std::string(rpc::VMNode::service_full_name()) + "/Send"},
+    {"SendRecv",
+        "/" + std::string(rpc::VMNode::service_full_name()) + "/SendRecv"},
+    {"ForwardRecv",
+        "/" + std::string(rpc::VMNode::service_full_name()) + "/ForwardRecv"},
+  };
+  return method_names.at(method);
+}
+}  // namespace
+
 GrpcChannel::GrpcChannel(const primihub::Node& node, LinkContext* link_ctx) :
     IChannel(link_ctx) {
   dest_node_ = node;
@@ -33,12 +56,67 @@ retcode GrpcChannel::BuildTaskInfo(rpc::TaskContext* task_info) {
   return retcode::SUCCESS;
 }
 
+rpc::CompressType GrpcChannel::NegotiateCompressType() {
+  std::call_once(negotiate_flag_, [this]() {
+    auto& compressor = this->getLinkContext()->compressor();
+    auto preferred_type = compressor.PreferredType();
+    if (preferred_type == rpc::CompressType::COMPRESS_NONE) {
+      return;
+    }
+    rpc::LinkNegotiation request;
+    rpc::LinkNegotiation reply;
+    request.add_compress_types(preferred_type);
+    grpc::ClientContext context;
+    auto send_tiemout_ms = this->getLinkContext()->sendTimeout();
+    if (send_tiemout_ms > 0) {
+      auto deadline = std::chrono::system_clock::now() +
+        std::chrono::milliseconds(send_tiemout_ms);
+      context.set_deadline(deadline);
+    }
+    grpc::Status status = stub_->NegotiateLink(&context, request, &reply);
+    if (!status.ok()) {
+      PH_LOG(WARNING, LogType::kTask)
+          << "negotiate link with [" << dest_node_.to_string() << "] "
+          << "failed, data is sent without compression, "
+          << "error message: " << status.error_message();
+      return;
+    }
+    std::vector<rpc::CompressType> accepted_types;
+    for (const auto type : reply.compress_types()) {
+      accepted_types.push_back(static_cast<rpc::CompressType>(type));
+    }
+    compress_type_ = LinkCompressor::Choose(accepted_types);
+    PH_VLOG(5, LogType::kTask)
+        << "link to [" << dest_node_.to_string() << "] use compress type: "
+        << LinkCompressor::TypeToString(compress_type_);
+  });
+  return compress_type_;
+}
+
+rpc::CompressType GrpcChannel::CompressData(const std::string& key,
+                                            std::string_view* data,
+                                            std::string* compressed_buf) {
+  auto compress_type = NegotiateCompressType();
+  if (compress_type == rpc::CompressType::COMPRESS_NONE) {
+    return rpc::CompressType::COMPRESS_NONE;
+  }
+  auto& compressor = this->getLinkContext()->compressor();
+  if (!compressor.ShouldCompress(key, data->size())) {
+    compressor.RecordSkipped(data->size());
+    return rpc::CompressType::COMPRESS_NONE;
+  }
+  auto ret = compressor.Compress(compress_type, *data, compressed_buf);
+  if (ret != retcode::SUCCESS) {
+    return rpc::CompressType::COMPRESS_NONE;
+  }
+  *data = std::string_view(compressed_buf->data(), compressed_buf->size());
+  return compress_type;
+}
+
 std::shared_ptr<grpc::Channel> GrpcChannel::buildChannel(
     std::string& server_address,
     bool use_tls) {
-  std::shared_ptr<grpc::ChannelCredentials> creds{nullptr};
-  grpc::ChannelArguments channel_args;
-  // channel_args.SetMaxReceiveMessageSize(128*1024*1024);
+  auto& channel_pool = GrpcChannelPool::GetInstance();
   if (use_tls) {
     auto link_context = this->getLinkContext();
     auto& cert_config = link_context->getCertificateConfig();
@@ -46,12 +124,10 @@ std::shared_ptr<grpc::Channel> GrpcChannel::buildChannel(
     ssl_opts.pem_root_certs = cert_config.rootCAContent();
     ssl_opts.pem_private_key = cert_config.keyContent();
     ssl_opts.pem_cert_chain = cert_config.certContent();
-    creds = grpc::SslCredentials(ssl_opts);
+    grpc_channel_ = channel_pool.GetChannel(server_address, &ssl_opts);
   } else {
-    creds = grpc::InsecureChannelCredentials();
+    grpc_channel_ = channel_pool.GetChannel(server_address, nullptr);
   }
-  grpc_channel_ = grpc::CreateCustomChannel(server_address,
-                                            creds, channel_args);
   return grpc_channel_;
 }
 
@@ -65,24 +141,41 @@ retcode GrpcChannel::sendRecv(const std::string& role,
     context.set_deadline(deadline);
   }
   using reader_writer_t =
-      grpc::ClientReaderWriter<rpc::TaskRequest, rpc::TaskResponse>;
-  std::shared_ptr<reader_writer_t> client_stream(stub_->SendRecv(&context));
-  std::vector<rpc::TaskRequest> send_requests;
-  buildTaskRequest(role, send_data, &send_requests);
-  std::string TASK_INFO_STR;
-  if (!send_requests.empty()) {
-    auto& task_info = send_requests[0].task_info();
-    TASK_INFO_STR = pb_util::TaskInfoToString(task_info);
-  }
+      grpc::ClientReaderWriter<grpc::ByteBuffer, grpc::ByteBuffer>;
+  RpcMethod method(RawMethodName("SendRecv").c_str(),
+                   RpcMethod::BIDI_STREAMING);
+  std::unique_ptr<reader_writer_t> client_stream(
+      grpc::internal::ClientReaderWriterFactory<
+          grpc::ByteBuffer, grpc::ByteBuffer>::Create(
+              grpc_channel_.get(), method, &context));
+  rpc::TaskContext task_info;
+  BuildTaskInfo(&task_info);
+  std::string TASK_INFO_STR = pb_util::TaskInfoToString(task_info);
+  std::string compressed_buf;
+  auto compress_type = CompressData(role, &send_data, &compressed_buf);
+  std::vector<grpc::ByteBuffer> send_requests;
+  BuildTaskRequestChunks(task_info, role, send_data, &send_requests,
+                         compress_type);
   for (const auto& request : send_requests) {
     client_stream->Write(request);
   }
   client_stream->WritesDone();
   // waiting for response
-  rpc::TaskResponse recv_response;
-  while (client_stream->Read(&recv_response)) {
-    auto data = recv_response.data();
-    recv_data->append(data);
+  grpc::ByteBuffer recv_buffer;
+  while (client_stream->Read(&recv_buffer)) {
+    rpc::TaskResponse recv_response;
+    auto status = grpc::SerializationTraits<rpc::TaskResponse>::Deserialize(
+        &recv_buffer, &recv_response);
+    if (!status.ok()) {
+      // data without this chunk is corrupted, abort the call
+      PH_LOG(ERROR, LogType::kTask)
+          << TASK_INFO_STR << "parse TaskResponse failed";
+      context.TryCancel();
+      client_stream->Finish();
+      recv_data->clear();
+      return retcode::FAIL;
+    }
+    recv_data->append(recv_response.data());
   }
   grpc::Status status = client_stream->Finish();
   if (!status.ok()) {
@@ -137,15 +230,19 @@ retcode GrpcChannel::send(const std::string& role, const std::string& data) {
 
 retcode GrpcChannel::send(const std::string& role, std::string_view data_sv) {
   // VLOG(5) << "GrpcChannel::send begin to send, use key: " << role;
-  std::vector<rpc::TaskRequest> send_requests;
-  buildTaskRequest(role, data_sv, &send_requests);
+  // chunks refer to data_sv, it is valid until the rpc finished
+  rpc::TaskContext task_info;
+  BuildTaskInfo(&task_info);
+  std::string compressed_buf;
+  auto compress_type = CompressData(role, &data_sv, &compressed_buf);
+  std::vector<grpc::ByteBuffer> send_requests;
+  BuildTaskRequestChunks(task_info, role, data_sv, &send_requests,
+                         compress_type);
   auto send_tiemout_ms = this->getLinkContext()->sendTimeout();
   int retry_time{0};
-  std::string TASK_INFO_STR;
-  if (!send_requests.empty()) {
-    const auto& task_info = send_requests[0].task_info();
-    TASK_INFO_STR = pb_util::TaskInfoToString(task_info);
-  }
+  std::string TASK_INFO_STR = pb_util::TaskInfoToString(task_info);
+  RpcMethod method(RawMethodName("Send").c_str(),
+                   RpcMethod::CLIENT_STREAMING);
   do {
     grpc::ClientContext context;
     if (send_tiemout_ms > 0) {
@@ -154,8 +251,10 @@ retcode GrpcChannel::send(const std::string& role, std::string_view data_sv) {
       context.set_deadline(deadline);
     }
     rpc::TaskResponse task_response;
-    using writer_t = grpc::ClientWriter<rpc::TaskRequest>;
-    std::unique_ptr<writer_t> writer(stub_->Send(&context, &task_response));
+    using writer_t = grpc::ClientWriter<grpc::ByteBuffer>;
+    std::unique_ptr<writer_t> writer(
+        grpc::internal::ClientWriterFactory<grpc::ByteBuffer>::Create(
+            grpc_channel_.get(), method, &context, &task_response));
     for (const auto& request : send_requests) {
       writer->Write(request);
     }
@@ -193,47 +292,19 @@ retcode GrpcChannel::send(const std::string& role, std::string_view data_sv) {
   return retcode::SUCCESS;
 }
 
-retcode GrpcChannel::buildTaskRequest(const std::string& role,
-    const std::string& data, std::vector<rpc::TaskRequest>* send_pb_data) {
-  std::string_view data_sv(data.c_str(), data.length());
-  return buildTaskRequest(role, data_sv, send_pb_data);
-}
-
-retcode GrpcChannel::buildTaskRequest(const std::string& role,
-    std::string_view data_sv, std::vector<rpc::TaskRequest>* send_pb_data) {
-  size_t sended_size = 0;
-  size_t max_package_size = LIMITED_PACKAGE_SIZE;  // limit data size 4M
-  size_t total_length = data_sv.size();
-  char* send_buf = const_cast<char*>(data_sv.data());
-  // VLOG(5) << "job_id: " << job_id << " "
-  //     << "task_id: " << task_id << " "
-  //     << "request id: " << request_id << " "
-  //     << "key: " << role << " "
-  //     << "send data length: " << total_length;
-  do {
-    rpc::TaskRequest task_request;
-    auto task_info = task_request.mutable_task_info();
-    BuildTaskInfo(task_info);
-    task_request.set_role(role);
-    task_request.set_data_len(total_length);
-    auto data_ptr = task_request.mutable_data();
-    data_ptr->reserve(max_package_size);
-    size_t data_len = std::min(max_package_size, total_length - sended_size);
-    data_ptr->append(send_buf + sended_size, data_len);
-    sended_size += data_len;
-    // VLOG(5) << "sended_size: " << sended_size << " data_len: " << data_len;
-    send_pb_data->emplace_back(std::move(task_request));
-    if (sended_size < total_length) {
-      continue;
-    } else {
-      break;
-    }
-  } while (true);
-  return retcode::SUCCESS;
-}
-
 std::string GrpcChannel::forwardRecv(const std::string& role) {
   SCopedTimer timer;
+  if (this->getLinkContext()->UseLocalLink(dest_node_)) {
+    std::string recv_data;
+    auto ret = this->getLinkContext()->RecvByLocalLink(role, &recv_data);
+    if (ret == retcode::SUCCESS) {
+      return recv_data;
+    }
+    // data of timed out local recv is left in daemon for grpc
+    PH_LOG(WARNING, LogType::kTask)
+        << "recv key: " << role << " by local link failed, "
+        << "fall back to grpc";
+  }
   grpc::ClientContext context;
   auto send_tiemout_ms = this->getLinkContext()->sendTimeout();
   if (send_tiemout_ms > 0) {
@@ -251,24 +322,25 @@ std::string GrpcChannel::forwardRecv(const std::string& role) {
   //         << " request id: " << this->getLinkContext()->request_id()
   //         << " recv key: " << role
   //         << " nodeinfo: " << this->dest_node_.to_string();
-  // using reader_t = grpc::ClientReader<rpc::TaskRequest>;
-  auto client_reader = this->stub_->ForwardRecv(&context, send_request);
+  using reader_t = grpc::ClientReader<grpc::ByteBuffer>;
+  RpcMethod method(RawMethodName("ForwardRecv").c_str(),
+                   RpcMethod::SERVER_STREAMING);
+  std::unique_ptr<reader_t> client_reader(
+      grpc::internal::ClientReaderFactory<grpc::ByteBuffer>::Create(
+          grpc_channel_.get(), method, &context, send_request));
 
-  // waiting for response
-  std::string tmp_buff;
-  rpc::TaskRequest recv_response;
+  // waiting for response, data is assembled into preallocated buffer
+  TaskRequestAssembler assembler;
+  grpc::ByteBuffer recv_buffer;
   std::string TASK_INFO_STR = pb_util::TaskInfoToString(*task_info);
-  bool init_flag{false};
-  while (client_reader->Read(&recv_response)) {
-    auto data = recv_response.data();
-    if (!init_flag) {
-      size_t data_len = recv_response.data_len();
-      tmp_buff.reserve(data_len);
-      init_flag = true;
+  while (client_reader->Read(&recv_buffer)) {
+    auto ret = assembler.Feed(&recv_buffer);
+    if (ret != retcode::SUCCESS) {
+      PH_LOG(ERROR, LogType::kTask)
+          << TASK_INFO_STR << "decode received data failed";
+      context.TryCancel();
+      break;
     }
-    PH_VLOG(5, LogType::kTask)
-        << "data length: " << data.size();
-    tmp_buff.append(data);
   }
 
   grpc::Status status = client_reader->Finish();
@@ -278,11 +350,11 @@ std::string GrpcChannel::forwardRecv(const std::string& role) {
         << status.error_code() << ": " << status.error_message();
     return std::string("");
   }
-  // VLOG(5) << "recv data success, data size: " << tmp_buff.size();
   auto time_cost = timer.timeElapse();
   PH_VLOG(5, LogType::kTask)
-      << "forwardRecv time cost(ms): " << time_cost;
-  return tmp_buff;
+      << "forwardRecv time cost(ms): " << time_cost << " "
+      << "data size: " << assembler.data().size();
+  return std::move(assembler.data());
 }
 
 retcode GrpcChannel::submitTask(const rpc::PushTaskRequest& request,
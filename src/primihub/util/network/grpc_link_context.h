@@ -10,6 +10,7 @@
 #include <unordered_map>
 #include <vector>
 #include <memory>
+#include <mutex>
 
 #include "src/primihub/util/network/link_context.h"
 #include "src/primihub/common/common.h"
@@ -45,12 +46,6 @@ class GrpcChannel : public IChannel {
   retcode fetchTaskStatus(const rpc::TaskContext& request,
                           rpc::TaskStatusReply* reply) override;
   std::string forwardRecv(const std::string& role) override;
-  retcode buildTaskRequest(const std::string& role,
-                           const std::string& data,
-                           std::vector<rpc::TaskRequest>* send_pb_data);
-  retcode buildTaskRequest(const std::string& role,
-                           std::string_view sv_data,
-                           std::vector<rpc::TaskRequest>* send_pb_data);
   std::shared_ptr<grpc::Channel> buildChannel(std::string& server_addr,
                                               bool use_tls);
   // data set related operation
@@ -63,21 +58,34 @@ class GrpcChannel : public IChannel {
 
  protected:
   retcode BuildTaskInfo(rpc::TaskContext* task_info);
-
- private:
+  /**
+   * negotiate compress type with peer on first use,
+   * peer which does not support negotiation gets raw data
+  */
+  rpc::CompressType NegotiateCompressType();
+  /**
+   * compress data sent with key if negotiated and worthwhile,
+   * on success data refers to compressed_buf.
+   * return compress type actually applied to data
+  */
+  rpc::CompressType CompressData(const std::string& key,
+                                 std::string_view* data,
+                                 std::string* compressed_buf);
   std::unique_ptr<rpc::VMNode::Stub> stub_{nullptr};
   std::unique_ptr<rpc::DataSetService::Stub> dataset_stub_{nullptr};
   std::shared_ptr<grpc::Channel> grpc_channel_{nullptr};
   primihub::Node dest_node_;
   int retry_max_times_{3};
+  std::once_flag negotiate_flag_;
+  rpc::CompressType compress_type_{rpc::CompressType::COMPRESS_NONE};
 };
 
 class GrpcLinkContext : public LinkContext {
  public:
   GrpcLinkContext() = default;
   virtual ~GrpcLinkContext() = default;
-  std::shared_ptr<IChannel> buildChannel(const primihub::Node& node,
-                                         LinkContext* link_ctx);
+  virtual std::shared_ptr<IChannel> buildChannel(const primihub::Node& node,
+                                                 LinkContext* link_ctx);
   std::shared_ptr<IChannel> getChannel(const primihub::Node& node) override;
 };
 
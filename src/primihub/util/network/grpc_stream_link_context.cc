@@ -0,0 +1,306 @@
+/*
+* Copyright (c) 2023 by PrimiHub
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      https://www.apache.org/licenses/
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#include "src/primihub/util/network/grpc_stream_link_context.h"
+#include <glog/logging.h>
+#include <algorithm>
+#include <chrono>
+#include <utility>
+
+#include "src/primihub/util/util.h"
+#include "src/primihub/util/log.h"
+#include "src/primihub/util/proto_log_helper.h"
+
+namespace pb_util = primihub::proto::util;
+namespace primihub::network {
+GrpcStreamChannel::GrpcStreamChannel(const primihub::Node& node,
+                                     LinkContext* link_ctx) :
+    GrpcChannel(node, link_ctx) {}
+
+GrpcStreamChannel::~GrpcStreamChannel() {
+  std::lock_guard<std::mutex> lck(stream_mtx_);
+  CloseStream();
+}
+
+retcode GrpcStreamChannel::OpenStream() {
+  if (!stream_broken_.load(std::memory_order_relaxed)) {
+    return retcode::SUCCESS;
+  }
+  CloseStream();
+  stream_context_ = std::make_unique<grpc::ClientContext>();
+  stream_ = stub_->LinkStream(stream_context_.get());
+  if (stream_ == nullptr) {
+    PH_LOG(ERROR, LogType::kTask)
+        << "open link stream to [" << dest_node_.to_string() << "] failed";
+    return retcode::FAIL;
+  }
+  task_info_sent_ = false;
+  stream_broken_.store(false);
+  auto stream = stream_;
+  read_fut_ = std::async(std::launch::async, [this, stream]() {
+    this->ReadLoop(stream);
+  });
+  PH_VLOG(5, LogType::kTask)
+      << "open link stream to [" << dest_node_.to_string() << "] success";
+  return retcode::SUCCESS;
+}
+
+void GrpcStreamChannel::CloseStream() {
+  if (stream_ == nullptr) {
+    return;
+  }
+  if (!stream_broken_.load()) {
+    stream_->WritesDone();
+  }
+  // pending RECV on peer may never be answered, so cancel instead of waiting
+  stream_context_->TryCancel();
+  if (read_fut_.valid()) {
+    read_fut_.get();
+  }
+  grpc::Status status = stream_->Finish();
+  if (!status.ok() && status.error_code() != grpc::StatusCode::CANCELLED) {
+    PH_LOG(WARNING, LogType::kTask)
+        << "link stream to [" << dest_node_.to_string() << "] finished with "
+        << status.error_code() << ": " << status.error_message();
+  }
+  stream_.reset();
+  stream_context_.reset();
+  stream_broken_.store(true);
+}
+
+std::shared_ptr<GrpcStreamChannel::PendingMessage>
+GrpcStreamChannel::AddPending(uint64_t seq_no) {
+  auto pending = std::make_shared<PendingMessage>();
+  pending->result = pending->done.get_future();
+  std::lock_guard<std::mutex> lck(pending_mtx_);
+  pending_[seq_no] = pending;
+  return pending;
+}
+
+bool GrpcStreamChannel::RemovePending(uint64_t seq_no) {
+  std::lock_guard<std::mutex> lck(pending_mtx_);
+  return pending_.erase(seq_no) != 0;
+}
+
+void GrpcStreamChannel::FailAllPending(const std::string& reason) {
+  std::unordered_map<uint64_t, std::shared_ptr<PendingMessage>> pending;
+  {
+    std::lock_guard<std::mutex> lck(pending_mtx_);
+    pending.swap(pending_);
+    for (auto& [seq_no, message] : pending) {
+      message->msg_info = reason;
+    }
+  }
+  for (auto& [seq_no, message] : pending) {
+    message->done.set_value(retcode::FAIL);
+  }
+}
+
+retcode GrpcStreamChannel::WaitPending(uint64_t seq_no,
+                                       std::shared_ptr<PendingMessage> pending,
+                                       int32_t timeout_ms) {
+  if (timeout_ms > 0) {
+    auto status = pending->result.wait_for(
+        std::chrono::milliseconds(timeout_ms));
+    if (status != std::future_status::ready) {
+      std::lock_guard<std::mutex> lck(pending_mtx_);
+      // response may arrive right after timeout, it completes the pending
+      if (pending_.erase(seq_no) != 0) {
+        pending->msg_info = "wait for peer response timeout";
+        return retcode::FAIL;
+      }
+    }
+  }
+  // completed pending has been removed by whom completed it
+  return pending->result.get();
+}
+
+void GrpcStreamChannel::DispatchResponse(uint64_t seq_no,
+                                         bool is_data, bool last,
+                                         uint64_t data_len, bool success,
+                                         const std::string& msg_info,
+                                         std::string_view data) {
+  std::shared_ptr<PendingMessage> pending{nullptr};
+  {
+    std::lock_guard<std::mutex> lck(pending_mtx_);
+    auto it = pending_.find(seq_no);
+    if (it == pending_.end()) {
+      PH_LOG(WARNING, LogType::kTask)
+          << "no pending message found for seq_no: " << seq_no << ", "
+          << "may be timeout";
+      return;
+    }
+    pending = it->second;
+    if (is_data && !last) {
+      if (pending->data.empty()) {
+        pending->data.reserve(data_len);
+      }
+      pending->data.append(data);
+      return;
+    }
+    // only the one who removes it from pending_ is allowed to complete it
+    pending_.erase(it);
+    if (is_data) {
+      pending->data.append(data);
+    }
+    pending->msg_info = msg_info;
+    pending->peer_error = !success;
+  }
+  pending->done.set_value(success ? retcode::SUCCESS : retcode::FAIL);
+}
+
+void GrpcStreamChannel::ReadLoop(std::shared_ptr<stream_t> stream) {
+  rpc::LinkFrame frame;
+  while (stream->Read(&frame)) {
+    const auto& data = frame.data();
+    DispatchResponse(frame.seq_no(), frame.type() == rpc::LinkFrame::DATA,
+                     frame.last(), frame.data_len(),
+                     frame.ret_code() == rpc::retcode::SUCCESS,
+                     frame.msg_info(),
+                     std::string_view(data.data(), data.size()));
+  }
+  stream_broken_.store(true);
+  FailAllPending("link stream is closed");
+}
+
+retcode GrpcStreamChannel::WriteMessage(rpc::LinkFrame::FrameType type,
+                                        const std::string& key,
+                                        std::string_view data,
+                                        uint64_t seq_no,
+                                        rpc::CompressType compress_type) {
+  std::lock_guard<std::mutex> lck(stream_mtx_);
+  auto ret = OpenStream();
+  if (ret != retcode::SUCCESS) {
+    return retcode::FAIL;
+  }
+  size_t max_package_size = LIMITED_PACKAGE_SIZE;
+  size_t total_length = data.size();
+  size_t sended_size = 0;
+  do {
+    rpc::LinkFrame frame;
+    frame.set_type(type);
+    frame.set_seq_no(seq_no);
+    frame.set_key(key);
+    frame.set_data_len(total_length);
+    frame.set_compress_type(compress_type);
+    if (!task_info_sent_) {
+      BuildTaskInfo(frame.mutable_task_info());
+      task_info_sent_ = true;
+    }
+    size_t data_len = std::min(max_package_size, total_length - sended_size);
+    frame.set_data(data.data() + sended_size, data_len);
+    sended_size += data_len;
+    frame.set_last(sended_size >= total_length);
+    if (!stream_->Write(frame)) {
+      PH_LOG(WARNING, LogType::kTask)
+          << "write frame to link stream [" << dest_node_.to_string() << "] "
+          << "failed, key: " << key;
+      CloseStream();
+      return retcode::FAIL;
+    }
+  } while (sended_size < total_length);
+  return retcode::SUCCESS;
+}
+
+retcode GrpcStreamChannel::send(const std::string& key,
+                                const std::string& data) {
+  std::string_view data_sv(data.c_str(), data.length());
+  return send(key, data_sv);
+}
+
+retcode GrpcStreamChannel::send(const std::string& key,
+                                std::string_view data_sv) {
+  auto send_tiemout_ms = this->getLinkContext()->sendTimeout();
+  std::string compressed_buf;
+  auto compress_type = CompressData(key, &data_sv, &compressed_buf);
+  int retry_time{0};
+  do {
+    uint64_t seq_no = seq_no_.fetch_add(1);
+    auto pending = AddPending(seq_no);
+    auto ret = WriteMessage(rpc::LinkFrame::DATA, key, data_sv, seq_no,
+                            compress_type);
+    if (ret != retcode::SUCCESS) {
+      RemovePending(seq_no);
+      // peer processes a message only after its last frame arrives,
+      // a message not fully written is resent on a new stream safely
+      retry_time++;
+      if (retry_time < retry_max_times_) {
+        PH_LOG(WARNING, LogType::kTask)
+            << "send data to [" << dest_node_.to_string() << "] failed, "
+            << "key: " << key << " retry: " << retry_time;
+        continue;
+      }
+      PH_LOG(ERROR, LogType::kTask)
+          << "send data to [" << dest_node_.to_string() << "] failed, "
+          << "key: " << key;
+      return retcode::FAIL;
+    }
+    ret = WaitPending(seq_no, pending, send_tiemout_ms);
+    if (ret == retcode::SUCCESS) {
+      break;
+    }
+    // message may have been delivered, resending could duplicate it
+    PH_LOG(ERROR, LogType::kTask)
+        << "send data to [" << dest_node_.to_string() << "] "
+        << (pending->peer_error ? "return failed" : "failed") << ", "
+        << "key: " << key << " "
+        << "error message: " << pending->msg_info;
+    return retcode::FAIL;
+  } while (true);
+  return retcode::SUCCESS;
+}
+
+std::string GrpcStreamChannel::forwardRecv(const std::string& key) {
+  SCopedTimer timer;
+  if (this->getLinkContext()->UseLocalLink(dest_node_)) {
+    std::string recv_data;
+    auto ret = this->getLinkContext()->RecvByLocalLink(key, &recv_data);
+    if (ret == retcode::SUCCESS) {
+      return recv_data;
+    }
+    // data of timed out local recv is left in daemon for link stream
+    PH_LOG(WARNING, LogType::kTask)
+        << "recv key: " << key << " by local link failed, "
+        << "fall back to link stream";
+  }
+  auto send_tiemout_ms = this->getLinkContext()->sendTimeout();
+  uint64_t seq_no = seq_no_.fetch_add(1);
+  auto pending = AddPending(seq_no);
+  auto ret = WriteMessage(rpc::LinkFrame::RECV, key,
+                          std::string_view(), seq_no);
+  if (ret == retcode::SUCCESS) {
+    ret = WaitPending(seq_no, pending, send_tiemout_ms);
+  } else {
+    RemovePending(seq_no);
+    pending->msg_info = "write RECV frame failed";
+  }
+  if (ret != retcode::SUCCESS) {
+    PH_LOG(ERROR, LogType::kTask)
+        << "recv data for key: " << key << " encountes error, detail: "
+        << pending->msg_info;
+    return std::string("");
+  }
+  auto time_cost = timer.timeElapse();
+  PH_VLOG(5, LogType::kTask)
+      << "forwardRecv time cost(ms): " << time_cost;
+  return std::move(pending->data);
+}
+
+std::shared_ptr<IChannel> GrpcStreamLinkContext::buildChannel(
+    const primihub::Node& node,
+    LinkContext* link_ctx) {
+  return std::make_shared<GrpcStreamChannel>(node, link_ctx);
+}
+}  // namespace primihub::network
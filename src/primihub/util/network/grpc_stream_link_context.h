@@ -0,0 +1,120 @@
+/*
+* Copyright (c) 2023 by PrimiHub
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      https://www.apache.org/licenses/
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#ifndef SRC_PRIMIHUB_UTIL_NETWORK_GRPC_STREAM_LINK_CONTEXT_H_
+#define SRC_PRIMIHUB_UTIL_NETWORK_GRPC_STREAM_LINK_CONTEXT_H_
+#include <atomic>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+#include "src/primihub/util/network/grpc_link_context.h"
+
+namespace primihub::network {
+/**
+ * GrpcStreamChannel
+ * all data exchanged with peer is multiplexed over one long-lived
+ * bidirectional LinkStream rpc, so the rpc setup cost is paid once per task
+ * instead of once per message.
+ * logical message is identified by seq_no and split into LinkFrame,
+ * task info is only carried by the first frame of the stream.
+ * control command still uses unary rpc provided by GrpcChannel
+*/
+class GrpcStreamChannel : public GrpcChannel {
+ public:
+  using stream_t = grpc::ClientReaderWriter<rpc::LinkFrame, rpc::LinkFrame>;
+  GrpcStreamChannel(const primihub::Node& node, LinkContext* link_ctx);
+  virtual ~GrpcStreamChannel();
+  retcode send(const std::string& key, const std::string& data) override;
+  retcode send(const std::string& key, std::string_view sv_data) override;
+  std::string forwardRecv(const std::string& key) override;
+
+ protected:
+  /**
+   * pending logical message waiting for ACK or DATA from peer,
+   * fields are written under pending_mtx_ by the one who removes it from
+   * pending list, and read by the waiter after it is completed or removed
+  */
+  struct PendingMessage {
+    std::string data;
+    std::string msg_info;
+    bool peer_error{false};     // failure reported by peer, no need to retry
+    std::promise<retcode> done;
+    std::future<retcode> result;
+  };
+  /**
+   * open stream if not opened or broken,
+   * caller must hold stream_mtx_
+  */
+  virtual retcode OpenStream();
+  virtual void CloseStream();
+  /**
+   * compress_type: how data has been compressed, carried by every frame
+  */
+  virtual retcode WriteMessage(
+      rpc::LinkFrame::FrameType type,
+      const std::string& key,
+      std::string_view data,
+      uint64_t seq_no,
+      rpc::CompressType compress_type = rpc::CompressType::COMPRESS_NONE);
+  /**
+   * wait for response of seq_no, pending is removed when it returns
+  */
+  retcode WaitPending(uint64_t seq_no,
+                      std::shared_ptr<PendingMessage> pending,
+                      int32_t timeout_ms);
+  std::shared_ptr<PendingMessage> AddPending(uint64_t seq_no);
+  /**
+   * return false if pending has been completed by someone else
+  */
+  bool RemovePending(uint64_t seq_no);
+  void FailAllPending(const std::string& reason);
+  /**
+   * deliver response frame from peer to pending message
+   * is_data: DATA frame answering RECV, otherwise ACK
+  */
+  void DispatchResponse(uint64_t seq_no, bool is_data, bool last,
+                        uint64_t data_len, bool success,
+                        const std::string& msg_info, std::string_view data);
+  // dispatch frames received from peer to pending message
+  void ReadLoop(std::shared_ptr<stream_t> stream);
+
+ protected:
+  std::mutex stream_mtx_;
+  bool task_info_sent_{false};
+  std::atomic<bool> stream_broken_{true};
+  std::future<void> read_fut_;
+
+ private:
+  std::unique_ptr<grpc::ClientContext> stream_context_{nullptr};
+  std::shared_ptr<stream_t> stream_{nullptr};
+  std::atomic<uint64_t> seq_no_{0};
+  std::mutex pending_mtx_;
+  std::unordered_map<uint64_t, std::shared_ptr<PendingMessage>> pending_;
+};
+
+class GrpcStreamLinkContext : public GrpcLinkContext {
+ public:
+  GrpcStreamLinkContext() = default;
+  virtual ~GrpcStreamLinkContext() = default;
+  std::shared_ptr<IChannel> buildChannel(const primihub::Node& node,
+                                         LinkContext* link_ctx) override;
+};
+
+}  // namespace primihub::network
+#endif  // SRC_PRIMIHUB_UTIL_NETWORK_GRPC_STREAM_LINK_CONTEXT_H_
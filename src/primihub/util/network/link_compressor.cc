@@ -0,0 +1,245 @@
+/*
+* Copyright (c) 2023 by PrimiHub
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      https://www.apache.org/licenses/
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#include "src/primihub/util/network/link_compressor.h"
+#include <glog/logging.h>
+#include <lz4.h>
+#include <zstd.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <mutex>
+#include <sstream>
+
+#include "src/primihub/util/endian_util.h"
+
+namespace primihub::network {
+namespace {
+constexpr size_t kRawSizeLength = sizeof(uint64_t);
+
+uint64_t ElapseUs(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+      std::chrono::steady_clock::now() - start).count();
+}
+}  // namespace
+
+LinkCompressor::LinkCompressor(const common::CompressConfig& compress_cfg) {
+  Init(compress_cfg);
+}
+
+void LinkCompressor::Init(const common::CompressConfig& compress_cfg) {
+  preferred_type_ = TypeFromString(compress_cfg.algorithm);
+  level_ = compress_cfg.level;
+  min_size_ = compress_cfg.min_size;
+  std::unique_lock<std::shared_mutex> lck(exclude_mtx_);
+  exclude_keys_.clear();
+  exclude_keys_.insert(compress_cfg.exclude_keys.begin(),
+                       compress_cfg.exclude_keys.end());
+}
+
+rpc::CompressType LinkCompressor::TypeFromString(
+    const std::string& algorithm) {
+  if (algorithm == "zstd") {
+    return rpc::CompressType::COMPRESS_ZSTD;
+  } else if (algorithm == "lz4") {
+    return rpc::CompressType::COMPRESS_LZ4;
+  } else if (!algorithm.empty() && algorithm != "none") {
+    LOG(WARNING) << "unsupported compress algorithm: " << algorithm << ", "
+                 << "link data is not compressed";
+  }
+  return rpc::CompressType::COMPRESS_NONE;
+}
+
+std::string LinkCompressor::TypeToString(rpc::CompressType type) {
+  switch (type) {
+  case rpc::CompressType::COMPRESS_ZSTD:
+    return "zstd";
+  case rpc::CompressType::COMPRESS_LZ4:
+    return "lz4";
+  default:
+    return "none";
+  }
+}
+
+std::vector<rpc::CompressType> LinkCompressor::SupportedTypes() {
+  return {rpc::CompressType::COMPRESS_ZSTD, rpc::CompressType::COMPRESS_LZ4};
+}
+
+rpc::CompressType LinkCompressor::Choose(
+    const std::vector<rpc::CompressType>& offered_types) {
+  auto supported_types = SupportedTypes();
+  for (const auto type : offered_types) {
+    auto it = std::find(supported_types.begin(), supported_types.end(), type);
+    if (it != supported_types.end()) {
+      return type;
+    }
+  }
+  return rpc::CompressType::COMPRESS_NONE;
+}
+
+void LinkCompressor::DisableCompression(const std::string& key) {
+  std::unique_lock<std::shared_mutex> lck(exclude_mtx_);
+  exclude_keys_.insert(key);
+}
+
+bool LinkCompressor::ShouldCompress(const std::string& key,
+                                    size_t data_size) {
+  if (data_size < min_size_) {
+    return false;
+  }
+  std::shared_lock<std::shared_mutex> lck(exclude_mtx_);
+  return exclude_keys_.find(key) == exclude_keys_.end();
+}
+
+retcode LinkCompressor::Compress(rpc::CompressType type,
+                                 std::string_view data,
+                                 std::string* compressed) {
+  auto start = std::chrono::steady_clock::now();
+  if (data.size() > kMaxRawSize) {
+    RecordSkipped(data.size());
+    return retcode::FAIL;
+  }
+  size_t bound{0};
+  switch (type) {
+  case rpc::CompressType::COMPRESS_ZSTD:
+    bound = ZSTD_compressBound(data.size());
+    break;
+  case rpc::CompressType::COMPRESS_LZ4:
+    if (data.size() > static_cast<size_t>(LZ4_MAX_INPUT_SIZE)) {
+      return retcode::FAIL;
+    }
+    bound = LZ4_compressBound(data.size());
+    break;
+  default:
+    return retcode::FAIL;
+  }
+  compressed->resize(kRawSizeLength + bound);
+  uint64_t be_raw_size = htonll(data.size());
+  memcpy(compressed->data(), &be_raw_size, kRawSizeLength);
+  char* dest = compressed->data() + kRawSizeLength;
+  size_t compressed_size{0};
+  if (type == rpc::CompressType::COMPRESS_ZSTD) {
+    compressed_size = ZSTD_compress(dest, bound, data.data(), data.size(),
+                                    level_);
+    if (ZSTD_isError(compressed_size)) {
+      LOG(ERROR) << "zstd compress failed, "
+                 << "error: " << ZSTD_getErrorName(compressed_size);
+      return retcode::FAIL;
+    }
+  } else {
+    int n = LZ4_compress_default(data.data(), dest, data.size(), bound);
+    if (n <= 0) {
+      LOG(ERROR) << "lz4 compress failed";
+      return retcode::FAIL;
+    }
+    compressed_size = n;
+  }
+  compressed->resize(kRawSizeLength + compressed_size);
+  if (compressed->size() >= data.size()) {
+    // incompressible, e.g. random or encrypted data
+    RecordSkipped(data.size());
+    return retcode::FAIL;
+  }
+  stats_.raw_bytes.fetch_add(data.size(), std::memory_order_relaxed);
+  stats_.compressed_bytes.fetch_add(compressed->size(),
+                                    std::memory_order_relaxed);
+  stats_.compress_us.fetch_add(ElapseUs(start), std::memory_order_relaxed);
+  return retcode::SUCCESS;
+}
+
+retcode LinkCompressor::Decompress(rpc::CompressType type,
+                                   std::string_view data,
+                                   std::string* decompressed) {
+  auto start = std::chrono::steady_clock::now();
+  if (data.size() < kRawSizeLength) {
+    LOG(ERROR) << "compressed data is too short: " << data.size();
+    return retcode::FAIL;
+  }
+  uint64_t be_raw_size{0};
+  memcpy(&be_raw_size, data.data(), kRawSizeLength);
+  uint64_t raw_size = ntohll(be_raw_size);
+  const char* src = data.data() + kRawSizeLength;
+  size_t src_size = data.size() - kRawSizeLength;
+  // raw size comes from peer, check it before allocation
+  if (raw_size > kMaxRawSize) {
+    LOG(ERROR) << "raw size of compressed data is too large: " << raw_size;
+    return retcode::FAIL;
+  }
+  switch (type) {
+  case rpc::CompressType::COMPRESS_ZSTD: {
+    auto content_size = ZSTD_getFrameContentSize(src, src_size);
+    if (content_size != raw_size) {
+      LOG(ERROR) << "zstd frame content size does not match raw size: "
+                 << raw_size;
+      return retcode::FAIL;
+    }
+    decompressed->resize(raw_size);
+    size_t n = ZSTD_decompress(decompressed->data(), raw_size, src, src_size);
+    if (ZSTD_isError(n) || n != raw_size) {
+      LOG(ERROR) << "zstd decompress failed, expected size: " << raw_size;
+      return retcode::FAIL;
+    }
+    break;
+  }
+  case rpc::CompressType::COMPRESS_LZ4: {
+    if (raw_size > static_cast<uint64_t>(LZ4_MAX_INPUT_SIZE) ||
+        raw_size > src_size * kLz4MaxRatio) {
+      LOG(ERROR) << "lz4 raw size: " << raw_size << " is impossible for "
+                 << "compressed size: " << src_size;
+      return retcode::FAIL;
+    }
+    decompressed->resize(raw_size);
+    int n = LZ4_decompress_safe(src, decompressed->data(), src_size, raw_size);
+    if (n < 0 || static_cast<uint64_t>(n) != raw_size) {
+      LOG(ERROR) << "lz4 decompress failed, expected size: " << raw_size;
+      return retcode::FAIL;
+    }
+    break;
+  }
+  default:
+    LOG(ERROR) << "unsupported compress type: " << static_cast<int>(type);
+    return retcode::FAIL;
+  }
+  stats_.decompress_bytes.fetch_add(raw_size, std::memory_order_relaxed);
+  stats_.decompress_us.fetch_add(ElapseUs(start), std::memory_order_relaxed);
+  return retcode::SUCCESS;
+}
+
+void LinkCompressor::RecordSkipped(size_t data_size) {
+  stats_.skipped_bytes.fetch_add(data_size, std::memory_order_relaxed);
+}
+
+double LinkCompressor::CompressRatio() const {
+  auto raw_bytes = stats_.raw_bytes.load(std::memory_order_relaxed);
+  if (raw_bytes == 0) {
+    return 1.0;
+  }
+  auto compressed_bytes =
+      stats_.compressed_bytes.load(std::memory_order_relaxed);
+  return static_cast<double>(compressed_bytes) / raw_bytes;
+}
+
+std::string LinkCompressor::StatsToString() const {
+  std::stringstream ss;
+  ss << "compress raw bytes: " << stats_.raw_bytes.load() << " "
+     << "compressed bytes: " << stats_.compressed_bytes.load() << " "
+     << "ratio: " << CompressRatio() << " "
+     << "skipped bytes: " << stats_.skipped_bytes.load() << " "
+     << "compress time(us): " << stats_.compress_us.load() << " "
+     << "decompress bytes: " << stats_.decompress_bytes.load() << " "
+     << "decompress time(us): " << stats_.decompress_us.load();
+  return ss.str();
+}
+}  // namespace primihub::network
@@ -0,0 +1,104 @@
+/*
+* Copyright (c) 2023 by PrimiHub
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      https://www.apache.org/licenses/
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#ifndef SRC_PRIMIHUB_UTIL_NETWORK_LINK_COMPRESSOR_H_
+#define SRC_PRIMIHUB_UTIL_NETWORK_LINK_COMPRESSOR_H_
+#include <atomic>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_set>
+#include <vector>
+
+#include "src/primihub/common/common.h"
+#include "src/primihub/common/config/config.h"
+#include "src/primihub/protos/worker.pb.h"
+
+namespace primihub::network {
+/**
+ * payload compression of data link
+ * compress type is negotiated with peer once per channel,
+ * message smaller than min_size or sent with excluded key is sent raw.
+ * compressed layout: | raw_size(8, network byte order) | compressed |
+*/
+class LinkCompressor {
+ public:
+  struct Stats {
+    std::atomic<uint64_t> raw_bytes{0};         // input of compressed message
+    std::atomic<uint64_t> compressed_bytes{0};  // output of compressed message
+    std::atomic<uint64_t> skipped_bytes{0};     // message sent raw
+    std::atomic<uint64_t> compress_us{0};
+    std::atomic<uint64_t> decompress_bytes{0};
+    std::atomic<uint64_t> decompress_us{0};
+  };
+  LinkCompressor() = default;
+  explicit LinkCompressor(const common::CompressConfig& compress_cfg);
+  void Init(const common::CompressConfig& compress_cfg);
+
+  static rpc::CompressType TypeFromString(const std::string& algorithm);
+  static std::string TypeToString(rpc::CompressType type);
+  /**
+   * compress types supported by this build, preferred first
+  */
+  static std::vector<rpc::CompressType> SupportedTypes();
+  /**
+   * choose the first type offered by peer which is supported locally
+  */
+  static rpc::CompressType Choose(
+      const std::vector<rpc::CompressType>& offered_types);
+  /**
+   * compress type configured locally, offered to peer during negotiation
+  */
+  rpc::CompressType PreferredType() const {return preferred_type_;}
+  /**
+   * data sent with the key is never compressed, e.g. ciphertext
+  */
+  void DisableCompression(const std::string& key);
+  bool ShouldCompress(const std::string& key, size_t data_size);
+  /**
+   * return FAIL if data is incompressible or larger than kMaxRawSize,
+   * caller should send it raw
+  */
+  retcode Compress(rpc::CompressType type, std::string_view data,
+                   std::string* compressed);
+  retcode Decompress(rpc::CompressType type, std::string_view data,
+                     std::string* decompressed);
+  void RecordSkipped(size_t data_size);
+  const Stats& stats() const {return stats_;}
+  /**
+   * compressed size / raw size of compressed message
+  */
+  double CompressRatio() const;
+  std::string StatsToString() const;
+  /**
+   * raw size claimed by compressed data is checked against it before
+   * any allocation, larger message is sent raw
+  */
+  static constexpr uint64_t kMaxRawSize = 4ULL * 1024 * 1024 * 1024;
+  /**
+   * lz4 encodes at most 255 bytes per byte of input
+  */
+  static constexpr uint64_t kLz4MaxRatio = 255;
+
+ private:
+  rpc::CompressType preferred_type_{rpc::CompressType::COMPRESS_NONE};
+  int level_{1};
+  uint64_t min_size_{4096};
+  std::shared_mutex exclude_mtx_;
+  std::unordered_set<std::string> exclude_keys_;
+  Stats stats_;
+};
+}  // namespace primihub::network
+#endif  // SRC_PRIMIHUB_UTIL_NETWORK_LINK_COMPRESSOR_H_
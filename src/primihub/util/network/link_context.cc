@@ -17,6 +17,9 @@
 #include "src/primihub/util/network/link_context.h"
 #include <utility>
 
+#include "src/primihub/util/network/shm_link.h"
+#include "src/primihub/util/network/grpc_channel_pool.h"
+
 namespace primihub::network {
 void LinkContext::Clean() {
   stop_.store(true);
@@ -41,6 +44,78 @@ void LinkContext::Clean() {
       it->second.shutdown();
     }
   }
+  {
+    // wake up sender held back by flow control
+    std::lock_guard<std::mutex> lck(in_queue_mtx);
+    for (auto& [key, budget] : key_recv_budget_) {
+      budget->Shutdown();
+    }
+    if (task_recv_budget_ != nullptr) {
+      task_recv_budget_->Shutdown();
+    }
+  }
+  if (compressor_.PreferredType() != rpc::CompressType::COMPRESS_NONE) {
+    LOG(INFO) << "link " << compressor_.StatsToString();
+  }
+  if (coalesce_cfg_.enable) {
+    LOG(INFO) << "link coalesced messages: " << coalesced_message_count_
+              << " saved wire messages: " << coalesced_saved_count_;
+  }
+  auto& channel_pool = GrpcChannelPool::GetInstance();
+  if (channel_pool.enabled()) {
+    VLOG(3) << channel_pool.StatsToString();
+  }
+}
+
+void LinkContext::RegisterCoalescer(MessageCoalescer* coalescer) {
+  std::lock_guard<std::mutex> lck(coalescer_mtx_);
+  coalescers_.insert(coalescer);
+}
+
+void LinkContext::UnregisterCoalescer(MessageCoalescer* coalescer) {
+  {
+    std::lock_guard<std::mutex> lck(coalescer_mtx_);
+    coalescers_.erase(coalescer);
+  }
+  coalescer->Flush();
+  coalesced_message_count_.fetch_add(coalescer->message_count());
+  coalesced_saved_count_.fetch_add(coalescer->saved_count());
+}
+
+void LinkContext::AttachLocalLink(std::shared_ptr<ShmLinkClient> local_link,
+                                  const Node& local_node) {
+  local_link_ = std::move(local_link);
+  local_node_ = local_node;
+}
+
+bool LinkContext::UseLocalLink(const Node& dest_node) const {
+  if (local_link_ == nullptr) {
+    return false;
+  }
+  if (!dest_node.id_.empty() && dest_node.id_ == local_node_.id_) {
+    return true;
+  }
+  return dest_node.ip_ == local_node_.ip_ &&
+         dest_node.port_ == local_node_.port_;
+}
+
+retcode LinkContext::RecvByLocalLink(const std::string& key,
+                                     std::string* recv_buf) {
+  if (local_link_ == nullptr) {
+    return retcode::FAIL;
+  }
+  return local_link_->Recv(key, recv_buf, send_timeout_ms_);
+}
+
+retcode LinkContext::FlushCoalescers() {
+  retcode result{retcode::SUCCESS};
+  std::lock_guard<std::mutex> lck(coalescer_mtx_);
+  for (auto coalescer : coalescers_) {
+    if (coalescer->Flush() != retcode::SUCCESS) {
+      result = retcode::FAIL;
+    }
+  }
+  return result;
 }
 
 LinkContext::StringDataQueue& LinkContext::GetRecvQueue(
@@ -50,14 +125,127 @@ LinkContext::StringDataQueue& LinkContext::GetRecvQueue(
   if (it != in_data_queue.end()) {
     return it->second;
   } else {
-    in_data_queue[key];
+    auto& recv_queue = in_data_queue[key];
+    if (flow_control_enable_) {
+      auto key_budget = std::make_shared<MemoryBudget>(
+          flow_cfg_.key_memory_budget, task_recv_budget_);
+      key_recv_budget_[key] = key_budget;
+      // memory is released when data is consumed,
+      // spilled data is loaded back when it is consumed,
+      // the pop fails if it can not be loaded
+      recv_queue.set_pop_hook([this, key, key_budget](std::string& item) {
+        if (spill_store_ != nullptr && spill_store_->IsPlaceholder(item)) {
+          if (spill_store_->Load(&item) != retcode::SUCCESS) {
+            LOG(ERROR) << "load spilled data of key: " << key << " failed";
+            item.clear();
+            return false;
+          }
+          return true;
+        }
+        key_budget->Release(item.size());
+        return true;
+      });
+    }
     if (stop_.load(std::memory_order::memory_order_relaxed)) {
-      in_data_queue[key].shutdown();
+      recv_queue.shutdown();
     }
-    return in_data_queue[key];
+    return recv_queue;
   }
 }
 
+void LinkContext::initFlowControl(
+    const primihub::common::FlowControlConfig& flow_cfg) {
+  flow_cfg_ = flow_cfg;
+  flow_control_enable_ = flow_cfg.task_memory_budget > 0 ||
+                         flow_cfg.key_memory_budget > 0 ||
+                         flow_cfg.spill_enable;
+  if (!flow_control_enable_) {
+    return;
+  }
+  task_recv_budget_ =
+      std::make_shared<MemoryBudget>(flow_cfg.task_memory_budget);
+  if (flow_cfg.spill_enable) {
+    spill_store_ = std::make_unique<SpillStore>(flow_cfg.spill_dir);
+  }
+}
+
+std::shared_ptr<MemoryBudget> LinkContext::GetRecvBudget(
+    const std::string& key) {
+  GetRecvQueue(key);
+  std::lock_guard<std::mutex> lck(in_queue_mtx);
+  return key_recv_budget_[key];
+}
+
+bool LinkContext::HasRecvBudget(const std::string& key, size_t size) {
+  if (!flow_control_enable_) {
+    return true;
+  }
+  auto budget = GetRecvBudget(key);
+  if (budget->TryAcquire(size)) {
+    budget->Release(size);
+    return true;
+  }
+  return false;
+}
+
+bool LinkContext::WaitRecvBudget(const std::string& key, size_t size) {
+  if (!flow_control_enable_) {
+    return true;
+  }
+  auto budget = GetRecvBudget(key);
+  if (budget->WaitFits(size, flow_cfg_.wait_timeout_ms)) {
+    return true;
+  }
+  LOG(WARNING) << "wait recv buffer of key: " << key << " timeout, "
+               << "used: " << budget->used();
+  return false;
+}
+
+retcode LinkContext::PushRecvData(const std::string& key,
+                                  std::string&& data) {
+  auto& recv_queue = GetRecvQueue(key);
+  if (!flow_control_enable_) {
+    recv_queue.push(std::move(data));
+    return retcode::SUCCESS;
+  }
+  if (HasStopped()) {
+    LOG(ERROR) << "link context has been closed, drop data of key: " << key;
+    return retcode::FAIL;
+  }
+  // the reader is shared by other keys, so it is never held back here,
+  // data beyond budget is spilled, or buffered over budget only while
+  // the budget is not exceeded yet, otherwise it is rejected
+  bool spill = spill_store_ != nullptr &&
+               data.size() >= flow_cfg_.spill_threshold;
+  if (!spill) {
+    auto budget = GetRecvBudget(key);
+    if (budget->TryAcquire(data.size())) {
+      recv_queue.push(std::move(data));
+      return retcode::SUCCESS;
+    }
+    if (spill_store_ == nullptr) {
+      if (!budget->TryOvercommit(data.size())) {
+        LOG(ERROR) << "recv buffer of key: " << key << " is exceeded, "
+                   << "reject data, used: " << budget->used() << " "
+                   << "data size: " << data.size();
+        return retcode::FAIL;
+      }
+      VLOG(5) << "recv buffer of key: " << key << " is full, "
+              << "used: " << budget->used() << " "
+              << "data size: " << data.size();
+      recv_queue.push(std::move(data));
+      return retcode::SUCCESS;
+    }
+  }
+  // spilled data does not hold memory budget
+  auto ret = spill_store_->Spill(&data);
+  if (ret != retcode::SUCCESS) {
+    return retcode::FAIL;
+  }
+  recv_queue.push(std::move(data));
+  return retcode::SUCCESS;
+}
+
 LinkContext::StringDataQueue& LinkContext::GetSendQueue(
     const std::string& key) {
   std::unique_lock<std::mutex> lck(this->out_queue_mtx);
@@ -104,7 +292,10 @@ retcode LinkContext::Send(const std::string& key,
 retcode LinkContext::Recv(const std::string& key, std::string* recv_buf) {
   std::string recv_buf_tmp;
   auto& recv_queue = GetRecvQueue(key);
-  recv_queue.wait_and_pop(recv_buf_tmp);
+  if (!recv_queue.wait_and_pop(recv_buf_tmp)) {
+    LOG(ERROR) << "recv data of key: " << key << " failed";
+    return retcode::FAIL;
+  }
   *recv_buf = std::move(recv_buf_tmp);
   return retcode::SUCCESS;
 }
@@ -113,7 +304,10 @@ retcode LinkContext::Recv(const std::string& key,
                           char* recv_buf, size_t recv_size) {
   std::string recv_buf_tmp;
   auto& recv_queue = GetRecvQueue(key);
-  recv_queue.wait_and_pop(recv_buf_tmp);
+  if (!recv_queue.wait_and_pop(recv_buf_tmp)) {
+    LOG(ERROR) << "recv data of key: " << key << " failed";
+    return retcode::FAIL;
+  }
   if (recv_size != recv_buf_tmp.size()) {
     LOG(ERROR) << "recv data does not match, expected: " << recv_size
         << " but get: " << recv_buf_tmp.size();
@@ -188,12 +382,16 @@ retcode LinkContext::SendRecv(const std::string& key,
                               std::string* recv_buf) {
   std::string recv_buf_tmp;
   auto& recv_queue = this->GetRecvQueue(key);
-  recv_queue.wait_and_pop(recv_buf_tmp);
+  bool ok = recv_queue.wait_and_pop(recv_buf_tmp);
   *recv_buf = std::move(recv_buf_tmp);
   if (HasStopped()) {
     LOG(ERROR) << "link context has been closed";
     return retcode::FAIL;
   }
+  if (!ok) {
+    LOG(ERROR) << "recv data of key: " << key << " failed";
+    return retcode::FAIL;
+  }
   auto& send_queue = this->GetSendQueue(key);
   send_queue.push(send_buf);
   auto& complete_queue = this->GetCompleteQueue(key);
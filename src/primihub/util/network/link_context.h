@@ -6,16 +6,22 @@
 #include <unordered_map>
 #include <shared_mutex>
 #include <memory>
+#include <unordered_set>
 
 #include "src/primihub/common/common.h"
 #include "src/primihub/common/config/config.h"
 #include "src/primihub/protos/worker.pb.h"
 #include "src/primihub/protos/service.pb.h"
 #include "src/primihub/util/threadsafe_queue.h"
+#include "src/primihub/util/memory_budget.h"
+#include "src/primihub/util/network/link_compressor.h"
+#include "src/primihub/util/network/message_coalescer.h"
+#include "src/primihub/util/network/spill_store.h"
 
 namespace primihub::network {
 namespace rpc = primihub::rpc;
 class IChannel;
+class ShmLinkClient;
 /**
  * link connection manager
  * manage channel create by node info
@@ -86,6 +92,30 @@ class LinkContext {
   }
 
   StringDataQueue& GetRecvQueue(const std::string& key = "default");
+  /**
+   * bound memory held by data received from peers, see FlowControlConfig.
+   * must be called before any recv queue is created
+  */
+  void initFlowControl(const primihub::common::FlowControlConfig& flow_cfg);
+  /**
+   * push data received from peer into recv queue of key without waiting,
+   * data beyond memory budget is spilled to disk if configured,
+   * otherwise it is buffered over budget only if the budget is not
+   * exceeded yet, so memory stays below budget plus one payload.
+   * the sender of key is held back by delaying its ack until
+   * WaitRecvBudget returns.
+   * return FAIL if data can not be buffered
+  */
+  retcode PushRecvData(const std::string& key, std::string&& data);
+  /**
+   * true if data of size can be buffered for key without waiting
+  */
+  bool HasRecvBudget(const std::string& key, size_t size);
+  /**
+   * block until data of size can be buffered for key,
+   * return false if it is not ready within wait timeout
+  */
+  bool WaitRecvBudget(const std::string& key, size_t size);
   StringDataQueue& GetSendQueue(const std::string& key = "default");
   StatusDataQueue& GetCompleteQueue(const std::string& role = "default");
 
@@ -127,8 +157,45 @@ class LinkContext {
   retcode CheckSendCompleteStatus(const std::string& key,
                                   const Node& dest_node,
                                   uint64_t expected_complete_num);
+  /**
+   * payload compression shared by all channels of the link,
+   * task can opt incompressible key out by DisableCompression
+  */
+  LinkCompressor& compressor() {return compressor_;}
+  /**
+   * small message coalescing of mpc channels, see CoalesceConfig
+  */
+  void initCoalesce(const primihub::common::CoalesceConfig& coalesce_cfg) {
+    coalesce_cfg_ = coalesce_cfg;
+  }
+  const primihub::common::CoalesceConfig& coalesceConfig() const {
+    return coalesce_cfg_;
+  }
+  void RegisterCoalescer(MessageCoalescer* coalescer);
+  /**
+   * coalescer is flushed and its statistics is merged into link
+  */
+  void UnregisterCoalescer(MessageCoalescer* coalescer);
+  /**
+   * send messages pending in all coalescers of the link,
+   * must be called before waiting for peer, which may be waiting for
+   * the pending messages of any channel
+  */
+  retcode FlushCoalescers();
+  /**
+   * task process receives data buffered by its local node daemon
+   * through shared memory instead of loopback grpc, see ShmLinkClient
+  */
+  void AttachLocalLink(std::shared_ptr<ShmLinkClient> local_link,
+                       const Node& local_node);
+  /**
+   * true if data pulled from dest_node can be received by local link
+  */
+  bool UseLocalLink(const Node& dest_node) const;
+  retcode RecvByLocalLink(const std::string& key, std::string* recv_buf);
 
  protected:
+  std::shared_ptr<MemoryBudget> GetRecvBudget(const std::string& key);
   bool HasStopped() {
     return stop_.load(std::memory_order::memory_order_relaxed);
   }
@@ -151,6 +218,24 @@ class LinkContext {
   std::mutex complete_queue_mtx;
   StatusDataContainer complete_queue;
   std::atomic<bool> stop_{false};
+  LinkCompressor compressor_;
+  // flow control of recv queues
+  bool flow_control_enable_{false};
+  primihub::common::FlowControlConfig flow_cfg_;
+  std::shared_ptr<MemoryBudget> task_recv_budget_{nullptr};
+  // key: recv key, guarded by in_queue_mtx
+  std::unordered_map<std::string,
+                     std::shared_ptr<MemoryBudget>> key_recv_budget_;
+  std::unique_ptr<SpillStore> spill_store_{nullptr};
+  // small message coalescing
+  primihub::common::CoalesceConfig coalesce_cfg_;
+  std::mutex coalescer_mtx_;
+  std::unordered_set<MessageCoalescer*> coalescers_;
+  std::atomic<uint64_t> coalesced_message_count_{0};
+  std::atomic<uint64_t> coalesced_saved_count_{0};
+  // shared memory link to local node daemon
+  std::shared_ptr<ShmLinkClient> local_link_{nullptr};
+  Node local_node_;
 };
 
 class IChannel {
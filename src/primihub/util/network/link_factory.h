@@ -17,13 +17,17 @@
 #define SRC_PRIMIHUB_UTIL_NETWORK_LINK_FACTORY_H_
 #include <glog/logging.h>
 #include <memory>
+#include <string>
 #include "src/primihub/util/network/link_context.h"
 #include "src/primihub/util/network/grpc_link_context.h"
+#include "src/primihub/util/network/grpc_stream_link_context.h"
+#include "src/primihub/util/network/socket_link_context.h"
 
 namespace primihub::network {
 enum class LinkMode {
     GRPC = 0,
     RAW_SOCKET,
+    GRPC_STREAM,    // one persistent multiplexed stream per peer
 };
 
 class LinkFactory {
@@ -32,11 +36,30 @@ class LinkFactory {
       LinkMode mode = LinkMode::GRPC) {
     if (mode == LinkMode::GRPC) {
       return std::make_unique<GrpcLinkContext>();
+    } else if (mode == LinkMode::GRPC_STREAM) {
+      return std::make_unique<GrpcStreamLinkContext>();
+    } else if (mode == LinkMode::RAW_SOCKET) {
+      return std::make_unique<SocketLinkContext>();
     } else {
       LOG(ERROR) << "Unimplement Mode: " << static_cast<int>(mode);
     }
     return nullptr;
   }
+
+  /**
+   * convert link mode configured in node config to LinkMode
+   * unknown mode falls back to GRPC
+  */
+  static LinkMode LinkModeFromString(const std::string& mode_str) {
+    if (mode_str == "grpc_stream") {
+      return LinkMode::GRPC_STREAM;
+    } else if (mode_str == "raw_socket") {
+      return LinkMode::RAW_SOCKET;
+    } else if (!mode_str.empty() && mode_str != "grpc") {
+      LOG(WARNING) << "unknown link mode: " << mode_str << ", use grpc";
+    }
+    return LinkMode::GRPC;
+  }
 };
 }  // namespace primihub::network
 #endif  // SRC_PRIMIHUB_UTIL_NETWORK_LINK_FACTORY_H_
@@ -0,0 +1,196 @@
+/*
+* Copyright (c) 2023 by PrimiHub
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      https://www.apache.org/licenses/
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#include "src/primihub/util/network/message_coalescer.h"
+#include <arpa/inet.h>
+#include <glog/logging.h>
+#include <cstring>
+#include <utility>
+
+namespace primihub::network {
+namespace {
+constexpr char kBatchMagic[] = "PHMSGBAT";
+constexpr size_t kMagicSize = sizeof(kBatchMagic) - 1;
+constexpr size_t kBatchHeaderSize = kMagicSize + sizeof(uint32_t);
+
+void AppendUint32(uint32_t value, std::string* buf) {
+  uint32_t be_value = htonl(value);
+  buf->append(reinterpret_cast<char*>(&be_value), sizeof(be_value));
+}
+
+uint32_t ReadUint32(const char* ptr) {
+  uint32_t be_value{0};
+  memcpy(&be_value, ptr, sizeof(be_value));
+  return ntohl(be_value);
+}
+
+void AppendMessage(std::string_view message, std::string* buf) {
+  AppendUint32(static_cast<uint32_t>(message.size()), buf);
+  buf->append(message.data(), message.size());
+}
+}  // namespace
+
+MessageCoalescer::MessageCoalescer(const common::CoalesceConfig& coalesce_cfg,
+                                   SendFunc send_func) :
+    coalesce_cfg_(coalesce_cfg), send_func_(std::move(send_func)) {
+  batch_buf_.reserve(kBatchHeaderSize + coalesce_cfg_.max_batch_size);
+  batch_buf_.append(kBatchMagic, kMagicSize);
+  AppendUint32(0, &batch_buf_);
+  flush_thread_ = std::thread([this]() {FlushLoop();});
+}
+
+MessageCoalescer::~MessageCoalescer() {
+  {
+    std::lock_guard<std::mutex> lck(mtx_);
+    stop_ = true;
+  }
+  cv_.notify_all();
+  if (flush_thread_.joinable()) {
+    flush_thread_.join();
+  }
+  Flush();
+  VLOG(3) << "message coalescer, messages: " << message_count()
+          << " wire messages: " << wire_message_count()
+          << " saved: " << saved_count();
+}
+
+retcode MessageCoalescer::Append(std::string_view message) {
+  std::unique_lock<std::mutex> lck(mtx_);
+  if (send_failed_) {
+    return retcode::FAIL;
+  }
+  message_count_.fetch_add(1);
+  // message itself looks like a batch, wrap it to avoid misreading
+  bool need_wrap = IsBatch(message);
+  if (message.size() >= coalesce_cfg_.max_message_size && !need_wrap) {
+    auto ret = FlushLocked();
+    if (ret != retcode::SUCCESS) {
+      return ret;
+    }
+    wire_message_count_.fetch_add(1);
+    ret = send_func_(message);
+    if (ret != retcode::SUCCESS) {
+      send_failed_ = true;
+    }
+    return ret;
+  }
+  bool was_empty = batch_count_ == 0;
+  AppendMessage(message, &batch_buf_);
+  batch_count_++;
+  if (batch_buf_.size() - kBatchHeaderSize >= coalesce_cfg_.max_batch_size) {
+    return FlushLocked();
+  }
+  if (was_empty) {
+    first_pending_ = std::chrono::steady_clock::now();
+    lck.unlock();
+    cv_.notify_one();
+  }
+  return retcode::SUCCESS;
+}
+
+retcode MessageCoalescer::Flush() {
+  std::lock_guard<std::mutex> lck(mtx_);
+  return FlushLocked();
+}
+
+retcode MessageCoalescer::FlushLocked() {
+  if (batch_count_ == 0) {
+    return send_failed_ ? retcode::FAIL : retcode::SUCCESS;
+  }
+  retcode ret{retcode::SUCCESS};
+  if (!send_failed_) {
+    wire_message_count_.fetch_add(1);
+    std::string_view single_message(batch_buf_.data() + kBatchHeaderSize +
+                                        sizeof(uint32_t),
+                                    batch_buf_.size() - kBatchHeaderSize -
+                                        sizeof(uint32_t));
+    if (batch_count_ == 1 && !IsBatch(single_message)) {
+      // nothing to coalesce, send it as is
+      ret = send_func_(single_message);
+    } else {
+      uint32_t be_count = htonl(batch_count_);
+      memcpy(&batch_buf_[kMagicSize], &be_count, sizeof(be_count));
+      ret = send_func_(batch_buf_);
+    }
+    if (ret != retcode::SUCCESS) {
+      LOG(ERROR) << "send coalesced messages failed, count: " << batch_count_;
+      send_failed_ = true;
+    }
+  } else {
+    ret = retcode::FAIL;
+  }
+  batch_buf_.resize(kBatchHeaderSize);
+  batch_count_ = 0;
+  return ret;
+}
+
+void MessageCoalescer::FlushLoop() {
+  auto window = std::chrono::microseconds(coalesce_cfg_.flush_window_us);
+  std::unique_lock<std::mutex> lck(mtx_);
+  while (!stop_) {
+    if (batch_count_ == 0) {
+      cv_.wait(lck, [&]() {return stop_ || batch_count_ > 0;});
+      continue;
+    }
+    auto deadline = first_pending_ + window;
+    if (std::chrono::steady_clock::now() >= deadline) {
+      FlushLocked();
+      continue;
+    }
+    cv_.wait_until(lck, deadline);
+  }
+}
+
+bool MessageCoalescer::IsBatch(std::string_view data) {
+  return data.size() >= kBatchHeaderSize &&
+         memcmp(data.data(), kBatchMagic, kMagicSize) == 0;
+}
+
+retcode MessageCoalescer::Decode(std::string&& data,
+                                 std::vector<std::string>* messages) {
+  if (!IsBatch(data)) {
+    messages->push_back(std::move(data));
+    return retcode::SUCCESS;
+  }
+  uint32_t count = ReadUint32(data.data() + kMagicSize);
+  size_t offset = kBatchHeaderSize;
+  std::vector<std::string> decoded;
+  for (uint32_t i = 0; i < count; i++) {
+    if (data.size() - offset < sizeof(uint32_t)) {
+      LOG(ERROR) << "truncated message batch, count: " << count
+                 << " decoded: " << i;
+      return retcode::FAIL;
+    }
+    uint32_t len = ReadUint32(data.data() + offset);
+    offset += sizeof(uint32_t);
+    if (data.size() - offset < len) {
+      LOG(ERROR) << "truncated message batch, count: " << count
+                 << " decoded: " << i;
+      return retcode::FAIL;
+    }
+    decoded.emplace_back(data.data() + offset, len);
+    offset += len;
+  }
+  if (offset != data.size()) {
+    LOG(ERROR) << "message batch has " << data.size() - offset
+               << " bytes beyond " << count << " messages";
+    return retcode::FAIL;
+  }
+  for (auto& item : decoded) {
+    messages->push_back(std::move(item));
+  }
+  return retcode::SUCCESS;
+}
+}  // namespace primihub::network
@@ -0,0 +1,97 @@
+/*
+* Copyright (c) 2023 by PrimiHub
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      https://www.apache.org/licenses/
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#ifndef SRC_PRIMIHUB_UTIL_NETWORK_MESSAGE_COALESCER_H_
+#define SRC_PRIMIHUB_UTIL_NETWORK_MESSAGE_COALESCER_H_
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "src/primihub/common/common.h"
+#include "src/primihub/common/config/config.h"
+
+namespace primihub::network {
+/**
+ * batch small messages sent with the same key into one wire message.
+ * pending messages are flushed when max_batch_size is reached,
+ * when flush window expires, or explicitly before caller waits for peer,
+ * so message order of the key is kept.
+ * batch layout:
+ * | magic(8) | count(4) | len(4) | message | len(4) | message | ...
+ * integers are in network byte order
+*/
+class MessageCoalescer {
+ public:
+  using SendFunc = std::function<retcode(std::string_view data)>;
+  MessageCoalescer(const common::CoalesceConfig& coalesce_cfg,
+                   SendFunc send_func);
+  ~MessageCoalescer();
+
+  /**
+   * queue message for sending, large message is sent directly
+   * after pending messages.
+   * return FAIL if any previous send failed
+  */
+  retcode Append(std::string_view message);
+  /**
+   * send all pending messages
+  */
+  retcode Flush();
+  /**
+   * split wire message into messages,
+   * data which is not a batch is returned as single message.
+   * return FAIL and append nothing if the batch is truncated
+   * or its size does not match the message count
+  */
+  static retcode Decode(std::string&& data,
+                        std::vector<std::string>* messages);
+  static bool IsBatch(std::string_view data);
+
+  uint64_t message_count() const {return message_count_.load();}
+  uint64_t wire_message_count() const {return wire_message_count_.load();}
+  /**
+   * number of wire messages saved by coalescing
+  */
+  uint64_t saved_count() const {
+    return message_count() - wire_message_count();
+  }
+
+ protected:
+  // mtx_ must be held, send under the lock keeps message order
+  retcode FlushLocked();
+  void FlushLoop();
+
+ private:
+  common::CoalesceConfig coalesce_cfg_;
+  SendFunc send_func_;
+  std::mutex mtx_;
+  std::condition_variable cv_;
+  std::string batch_buf_;
+  uint32_t batch_count_{0};
+  std::chrono::steady_clock::time_point first_pending_;
+  bool stop_{false};
+  bool send_failed_{false};
+  std::thread flush_thread_;
+  std::atomic<uint64_t> message_count_{0};
+  std::atomic<uint64_t> wire_message_count_{0};
+};
+}  // namespace primihub::network
+#endif  // SRC_PRIMIHUB_UTIL_NETWORK_MESSAGE_COALESCER_H_
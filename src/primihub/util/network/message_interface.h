@@ -60,11 +60,26 @@ class TaskMessagePassInterface : public SocketInterface {
     Init(local_node_id, peer_node_id, link_context, send_channel, recv_channel);
   }
 
+  /**
+   * channel_tag distinguishes parallel channels between the same parties
+   * of one task, messages of each tag go to its own queue
+  */
+  TaskMessagePassInterface(const std::string &local_node_id,
+                           const std::string &peer_node_id,
+                           LinkContext *link_context,
+                           std::shared_ptr<network::IChannel> send_channel,
+                           std::shared_ptr<network::IChannel> recv_channel,
+                           const std::string& channel_tag) {
+    Init(local_node_id, peer_node_id, link_context, send_channel, recv_channel,
+         channel_tag);
+  }
+
   void Init(const std::string& local_party,
             const std::string remote_party,
             LinkContext* link_context,
             std::shared_ptr<network::IChannel> send_channel,
-            std::shared_ptr<network::IChannel> recv_channel = nullptr) {
+            std::shared_ptr<network::IChannel> recv_channel = nullptr,
+            const std::string& channel_tag = "") {
     job_id_ = link_context->job_id();
     task_id_ = link_context->task_id();
     request_id_ = link_context->request_id();
@@ -79,13 +94,15 @@ class TaskMessagePassInterface : public SocketInterface {
     ss_send << request_id_ << "_"
             << sub_task_id_ << "_"
             << local_node_id_ << "_"
-            << peer_node_id_;
+            << peer_node_id_
+            << channel_tag;
     send_key_ = ss_send.str();
     std::stringstream ss_recv;
     ss_recv << request_id_ << "_"
             << sub_task_id_ << "_"
             << peer_node_id_ << "_"
-            << local_node_id_;
+            << local_node_id_
+            << channel_tag;
     recv_key_ = ss_recv.str();
     send_count_.store(0);
     recv_count_.store(0);
@@ -6,6 +6,7 @@
 #include <functional>
 #include <utility>
 #include <cstring>
+#include <vector>
 
 namespace primihub::network {
 
@@ -19,8 +20,62 @@ ph_link::retcode MPCTaskChannel::SendImpl(const char* buff, size_t size) {
   return SendImpl(send_sv);
 }
 
+void MPCTaskChannel::InitCoalescer() {
+  if (link_context_ == nullptr || !link_context_->coalesceConfig().enable) {
+    return;
+  }
+  auto send_channel = send_channel_;
+  auto send_key = send_key_;
+  coalescer_ = std::make_unique<MessageCoalescer>(
+      link_context_->coalesceConfig(),
+      [send_channel, send_key](std::string_view data) -> retcode {
+        return send_channel->send(send_key, data);
+      });
+  link_context_->RegisterCoalescer(coalescer_.get());
+}
+
+retcode MPCTaskChannel::RecvMessage(std::string* message) {
+  if (coalescer_ == nullptr) {
+    *message = recv_channel_->forwardRecv(recv_key_);
+    return retcode::SUCCESS;
+  }
+  std::lock_guard<std::mutex> lck(recv_mtx_);
+  if (recv_pending_.empty()) {
+    // peer may be waiting for messages still pending locally
+    auto ret = link_context_->FlushCoalescers();
+    if (ret != retcode::SUCCESS) {
+      LOG(ERROR) << "flush pending messages before recv failed, "
+                 << "recv key: " << recv_key_;
+      return ret;
+    }
+    std::vector<std::string> messages;
+    ret = MessageCoalescer::Decode(recv_channel_->forwardRecv(recv_key_),
+                                   &messages);
+    if (ret != retcode::SUCCESS) {
+      LOG(ERROR) << "decode coalesced messages failed, "
+                 << "recv key: " << recv_key_;
+      return ret;
+    }
+    for (auto& item : messages) {
+      recv_pending_.push_back(std::move(item));
+    }
+    if (recv_pending_.empty()) {
+      LOG(ERROR) << "no message is decoded, recv key: " << recv_key_;
+      return retcode::FAIL;
+    }
+  }
+  *message = std::move(recv_pending_.front());
+  recv_pending_.pop_front();
+  return retcode::SUCCESS;
+}
+
 ph_link::retcode MPCTaskChannel::SendImpl(std::string_view send_buff_sv) {
-  auto ret = send_channel_->send(send_key_, send_buff_sv);
+  retcode ret{retcode::SUCCESS};
+  if (coalescer_ != nullptr) {
+    ret = coalescer_->Append(send_buff_sv);
+  } else {
+    ret = send_channel_->send(send_key_, send_buff_sv);
+  }
   if (ret != retcode::SUCCESS) {
     std::stringstream ss;
     ss << "Send message to " << peer_node_id_ << " failed, size "
@@ -43,7 +98,9 @@ ph_link::retcode MPCTaskChannel::SendImpl(std::string_view send_buff_sv) {
 }
 
 ph_link::retcode MPCTaskChannel::RecvImpl(std::string* recv_buf) {
-  *recv_buf = recv_channel_->forwardRecv(recv_key_);
+  if (RecvMessage(recv_buf) != retcode::SUCCESS) {
+    return ph_link::retcode::FAIL;
+  }
   if (VLOG_IS_ON(8)) {
     std::string recv_data;
     for (const auto& ch : *recv_buf) {
@@ -58,7 +115,10 @@ ph_link::retcode MPCTaskChannel::RecvImpl(std::string* recv_buf) {
 }
 
 ph_link::retcode MPCTaskChannel::RecvImpl(char* recv_buf, size_t recv_size) {
-  std::string tmp_recv_buf = recv_channel_->forwardRecv(recv_key_);
+  std::string tmp_recv_buf;
+  if (RecvMessage(&tmp_recv_buf) != retcode::SUCCESS) {
+    return ph_link::retcode::FAIL;
+  }
   if (tmp_recv_buf.size() != recv_size) {
     LOG(ERROR) << "data length does not match: " << " "
                << "expected: " << recv_size << " "
@@ -81,6 +141,9 @@ ph_link::retcode MPCTaskChannel::RecvImpl(char* recv_buf, size_t recv_size) {
 }
 
 void MPCTaskChannel::close() {
+  if (coalescer_ != nullptr) {
+    coalescer_->Flush();
+  }
 }
 
 void MPCTaskChannel::cancel() {
@@ -17,7 +17,9 @@
 #define SRC_PRIMIHUB_UTIL_NETWORK_MPC_CHANNEL_H_
 #include <string>
 #include <queue>
+#include <deque>
 #include <memory>
+#include <mutex>
 #include <atomic>
 #include <utility>
 
@@ -25,6 +27,7 @@
 #include "cryptoTools/Network/SocketAdapter.h"
 #include "src/primihub/util/network/grpc_link_context.h"
 #include "src/primihub/util/network/link_context.h"
+#include "src/primihub/util/network/message_coalescer.h"
 #include "src/primihub/util/threadsafe_queue.h"
 #include "network/base_channel.h"
 
@@ -64,6 +67,7 @@ class MPCTaskChannel : public ph_link::ChannelBase {
             << ", request_id " << request_id_
             << ", local_node " << local_node_id_ << ", peer node "
             << peer_node_id_;
+    InitCoalescer();
   }
 
   MPCTaskChannel(const std::string &local_node_id,
@@ -95,6 +99,7 @@ class MPCTaskChannel : public ph_link::ChannelBase {
             << ", request_id " << request_id_
             << ", local_node " << local_node_id_ << ", peer node "
             << peer_node_id_;
+    InitCoalescer();
   }
 
   MPCTaskChannel(const std::string &local_node_id,
@@ -125,9 +130,14 @@ class MPCTaskChannel : public ph_link::ChannelBase {
             << "request_id " << request_id_ << ", "
             << "local_node " << local_node_id_ << ", peer node "
             << peer_node_id_;
+    InitCoalescer();
   }
 
-  ~MPCTaskChannel() {}
+  ~MPCTaskChannel() {
+    if (coalescer_ != nullptr) {
+      link_context_->UnregisterCoalescer(coalescer_.get());
+    }
+  }
   ph_link::retcode SendImpl(const std::string& send_buf) override;
   ph_link::retcode SendImpl(std::string_view send_buff_sv) override;
   ph_link::retcode SendImpl(const char* buff, size_t size) override;
@@ -136,6 +146,16 @@ class MPCTaskChannel : public ph_link::ChannelBase {
   void close() override;
   void cancel() override;
 
+ protected:
+  /**
+   * batch small messages of send key if coalescing is enabled for link
+  */
+  void InitCoalescer();
+  /**
+   * next message from peer, batch sent by peer coalescer is split
+  */
+  retcode RecvMessage(std::string* message);
+
  private:
   std::atomic<bool> cancel_{false};
   std::string job_id_;
@@ -149,6 +169,9 @@ class MPCTaskChannel : public ph_link::ChannelBase {
   network::LinkContext* link_context_{nullptr};
   std::string send_key_;
   std::string recv_key_;
+  std::unique_ptr<MessageCoalescer> coalescer_{nullptr};
+  std::mutex recv_mtx_;
+  std::deque<std::string> recv_pending_;
 };
 }  // namespace primihub::network
 #endif  // SRC_PRIMIHUB_UTIL_NETWORK_MPC_CHANNEL_H_
@@ -0,0 +1,250 @@
+/*
+* Copyright (c) 2023 by PrimiHub
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      https://www.apache.org/licenses/
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#include "src/primihub/util/network/shm_link.h"
+#include <glog/logging.h>
+#include <chrono>
+#include <utility>
+
+#include "src/primihub/util/network/link_context.h"
+
+namespace primihub::network {
+namespace {
+// data of request, recv request carries no data
+constexpr char kCancelRequest[] = "cancel";
+}  // namespace
+
+ShmLinkServer::ShmLinkServer(const std::string& name,
+                             std::shared_ptr<State> state,
+                             LinkContext* link_ctx) :
+    name_(name), state_(std::move(state)), link_ctx_(link_ctx) {
+  request_thread_ = std::thread([this]() {ServeRequests();});
+  response_thread_ = std::thread([this]() {WriteResponses();});
+}
+
+ShmLinkServer::~ShmLinkServer() {
+  Stop();
+}
+
+std::unique_ptr<ShmLinkServer> ShmLinkServer::Create(const std::string& name,
+                                                     uint64_t ring_size,
+                                                     LinkContext* link_ctx) {
+  auto state = std::make_shared<State>();
+  // request carries key only
+  constexpr uint64_t kRequestRingSize = 64 * 1024;
+  state->request_ring = ShmRing::Create(RequestRingName(name),
+                                        kRequestRingSize);
+  if (state->request_ring == nullptr) {
+    return nullptr;
+  }
+  state->response_ring = ShmRing::Create(ResponseRingName(name), ring_size);
+  if (state->response_ring == nullptr) {
+    return nullptr;
+  }
+  return std::unique_ptr<ShmLinkServer>(
+      new ShmLinkServer(name, std::move(state), link_ctx));
+}
+
+void ShmLinkServer::Stop() {
+  if (stopped_.exchange(true)) {
+    return;
+  }
+  state_->request_ring->Close();
+  state_->response_ring->Close();
+  state_->responses.shutdown();
+  if (request_thread_.joinable()) {
+    request_thread_.join();
+  }
+  if (response_thread_.joinable()) {
+    response_thread_.join();
+  }
+  // parked recv callbacks only touch the response queue
+  state_->request_ring.reset();
+  state_->response_ring.reset();
+  VLOG(3) << "shared memory link: " << name_ << " is stopped";
+}
+
+void ShmLinkServer::ServeRequests() {
+  ShmRing::Record request;
+  while (state_->request_ring->Read(&request) == retcode::SUCCESS) {
+    if (request.data == kCancelRequest) {
+      CancelRecv(request.id);
+    } else {
+      ParkRecv(request.id, request.key);
+    }
+  }
+}
+
+void ShmLinkServer::ParkRecv(uint64_t id, const std::string& key) {
+  auto state = state_;
+  {
+    std::lock_guard<std::mutex> lck(state->parked_mtx);
+    state->parked[id] = std::make_pair(key, 0);
+  }
+  auto& recv_queue = link_ctx_->GetRecvQueue(key);
+  // callback may be invoked in place when data is available
+  auto pop_id = recv_queue.async_pop(
+      [state, id, key](bool ok, std::string&& data) {
+        {
+          std::lock_guard<std::mutex> lck(state->parked_mtx);
+          state->parked.erase(id);
+        }
+        ShmRing::Record response;
+        response.id = id;
+        if (ok) {
+          response.key = key;
+          response.data = std::move(data);
+        }
+        state->responses.push(std::move(response));
+      });
+  std::lock_guard<std::mutex> lck(state->parked_mtx);
+  auto it = state->parked.find(id);
+  if (it != state->parked.end()) {
+    it->second.second = pop_id;
+  }
+}
+
+void ShmLinkServer::CancelRecv(uint64_t id) {
+  std::string key;
+  uint64_t pop_id{0};
+  {
+    std::lock_guard<std::mutex> lck(state_->parked_mtx);
+    auto it = state_->parked.find(id);
+    if (it == state_->parked.end()) {
+      // data is popped, its response answers the request
+      return;
+    }
+    key = it->second.first;
+    pop_id = it->second.second;
+  }
+  if (!link_ctx_->GetRecvQueue(key).cancel_async_pop(pop_id)) {
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> lck(state_->parked_mtx);
+    state_->parked.erase(id);
+  }
+  VLOG(5) << "recv of key: " << key << " by shared memory is cancelled";
+  ShmRing::Record response;
+  response.id = id;
+  state_->responses.push(std::move(response));
+}
+
+void ShmLinkServer::WriteResponses() {
+  ShmRing::Record response;
+  while (state_->responses.wait_and_pop(response, -1)) {
+    auto ret = state_->response_ring->Write(response.id, response.key,
+                                            response.data);
+    if (ret != retcode::SUCCESS) {
+      LOG(ERROR) << "deliver data of key: " << response.key
+                 << " by shared memory failed";
+      break;
+    }
+  }
+}
+
+ShmLinkClient::ShmLinkClient(std::unique_ptr<ShmRing> request_ring,
+                             std::unique_ptr<ShmRing> response_ring) :
+    request_ring_(std::move(request_ring)),
+    response_ring_(std::move(response_ring)) {
+  dispatch_thread_ = std::thread([this]() {DispatchResponses();});
+}
+
+ShmLinkClient::~ShmLinkClient() {
+  request_ring_->Close();
+  response_ring_->Close();
+  if (dispatch_thread_.joinable()) {
+    dispatch_thread_.join();
+  }
+}
+
+std::shared_ptr<ShmLinkClient> ShmLinkClient::Connect(
+    const std::string& name) {
+  auto request_ring =
+      ShmRing::Open(ShmLinkServer::RequestRingName(name));
+  if (request_ring == nullptr) {
+    return nullptr;
+  }
+  auto response_ring =
+      ShmRing::Open(ShmLinkServer::ResponseRingName(name));
+  if (response_ring == nullptr) {
+    return nullptr;
+  }
+  return std::shared_ptr<ShmLinkClient>(
+      new ShmLinkClient(std::move(request_ring), std::move(response_ring)));
+}
+
+retcode ShmLinkClient::Recv(const std::string& key, std::string* data,
+                            int32_t timeout_ms) {
+  uint64_t id = request_id_.fetch_add(1);
+  std::future<ShmRing::Record> result;
+  {
+    std::lock_guard<std::mutex> lck(pending_mtx_);
+    if (closed_) {
+      return retcode::FAIL;
+    }
+    result = pending_[id].get_future();
+  }
+  auto ret = request_ring_->Write(id, key, std::string_view());
+  if (ret != retcode::SUCCESS) {
+    std::lock_guard<std::mutex> lck(pending_mtx_);
+    pending_.erase(id);
+    return retcode::FAIL;
+  }
+  auto timeout = std::chrono::milliseconds(timeout_ms);
+  if (timeout_ms >= 0 &&
+      result.wait_for(timeout) == std::future_status::timeout) {
+    LOG(WARNING) << "recv data of key: " << key << " by shared memory "
+                 << "timeout(ms): " << timeout_ms << ", cancel it";
+    // daemon answers cancel with failure unless data is already popped
+    ret = request_ring_->Write(id, key, kCancelRequest);
+    if (ret != retcode::SUCCESS ||
+        result.wait_for(timeout) == std::future_status::timeout) {
+      std::lock_guard<std::mutex> lck(pending_mtx_);
+      pending_.erase(id);
+      return retcode::FAIL;
+    }
+  }
+  auto response = result.get();
+  if (response.key.empty()) {
+    LOG(ERROR) << "recv data of key: " << key
+               << " by shared memory failed";
+    return retcode::FAIL;
+  }
+  *data = std::move(response.data);
+  return retcode::SUCCESS;
+}
+
+void ShmLinkClient::DispatchResponses() {
+  ShmRing::Record response;
+  while (response_ring_->Read(&response) == retcode::SUCCESS) {
+    std::lock_guard<std::mutex> lck(pending_mtx_);
+    auto it = pending_.find(response.id);
+    if (it == pending_.end()) {
+      LOG(WARNING) << "no recv request for response: " << response.id;
+      continue;
+    }
+    it->second.set_value(std::move(response));
+    pending_.erase(it);
+  }
+  // fail requests which will never be answered
+  std::lock_guard<std::mutex> lck(pending_mtx_);
+  closed_ = true;
+  for (auto& [id, pending] : pending_) {
+    pending.set_value(ShmRing::Record());
+  }
+  pending_.clear();
+}
+}  // namespace primihub::network
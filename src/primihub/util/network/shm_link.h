@@ -0,0 +1,122 @@
+/*
+* Copyright (c) 2023 by PrimiHub
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      https://www.apache.org/licenses/
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#ifndef SRC_PRIMIHUB_UTIL_NETWORK_SHM_LINK_H_
+#define SRC_PRIMIHUB_UTIL_NETWORK_SHM_LINK_H_
+#include <atomic>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+
+#include "src/primihub/common/common.h"
+#include "src/primihub/util/threadsafe_queue.h"
+#include "src/primihub/util/network/shm_ring.h"
+
+namespace primihub::network {
+class LinkContext;
+/**
+ * intra-host delivery of received data from node daemon to task process.
+ * task process sends recv request for a key through request ring,
+ * daemon answers with data popped from recv queue of its link context
+ * through response ring, so data never crosses loopback grpc.
+ * recv queues stay in daemon, task falls back to ForwardRecv rpc
+ * whenever shared memory is not available.
+ * response with empty key means recv queue of the key is shutdown
+ * or the request is cancelled.
+ * task cancels a request which is not answered in time, daemon drops
+ * the parked pop unless data is already popped, either way exactly one
+ * response is sent, so no data is lost by a timeout
+*/
+class ShmLinkServer {
+ public:
+  ~ShmLinkServer();
+  /**
+   * name: prefix of shared memory objects, passed to task process
+  */
+  static std::unique_ptr<ShmLinkServer> Create(const std::string& name,
+                                               uint64_t ring_size,
+                                               LinkContext* link_ctx);
+  static std::string RequestRingName(const std::string& name) {
+    return name + "_req";
+  }
+  static std::string ResponseRingName(const std::string& name) {
+    return name + "_resp";
+  }
+  const std::string& name() const {return name_;}
+  void Stop();
+
+ protected:
+  /**
+   * shared with parked recv callbacks which may outlive server
+  */
+  struct State {
+    std::unique_ptr<ShmRing> request_ring;
+    std::unique_ptr<ShmRing> response_ring;
+    ThreadSafeQueue<ShmRing::Record> responses;
+    // key: request id, value: key and pop id of parked recv
+    std::mutex parked_mtx;
+    std::unordered_map<uint64_t, std::pair<std::string, uint64_t>> parked;
+  };
+  ShmLinkServer(const std::string& name, std::shared_ptr<State> state,
+                LinkContext* link_ctx);
+  void ServeRequests();
+  void ParkRecv(uint64_t id, const std::string& key);
+  void CancelRecv(uint64_t id);
+  void WriteResponses();
+
+ private:
+  std::string name_;
+  std::shared_ptr<State> state_;
+  LinkContext* link_ctx_{nullptr};
+  std::atomic<bool> stopped_{false};
+  std::thread request_thread_;
+  std::thread response_thread_;
+};
+
+/**
+ * task process side of ShmLinkServer
+*/
+class ShmLinkClient {
+ public:
+  ~ShmLinkClient();
+  static std::shared_ptr<ShmLinkClient> Connect(const std::string& name);
+  /**
+   * block until data of key is delivered by daemon,
+   * return FAIL if link or recv queue is shutdown or no data is delivered
+   * in timeout_ms, negative timeout_ms means waiting forever
+  */
+  retcode Recv(const std::string& key, std::string* data,
+               int32_t timeout_ms = -1);
+
+ protected:
+  ShmLinkClient(std::unique_ptr<ShmRing> request_ring,
+                std::unique_ptr<ShmRing> response_ring);
+  void DispatchResponses();
+
+ private:
+  std::unique_ptr<ShmRing> request_ring_;
+  std::unique_ptr<ShmRing> response_ring_;
+  std::atomic<uint64_t> request_id_{0};
+  std::mutex pending_mtx_;
+  bool closed_{false};
+  std::unordered_map<uint64_t, std::promise<ShmRing::Record>> pending_;
+  std::thread dispatch_thread_;
+};
+}  // namespace primihub::network
+#endif  // SRC_PRIMIHUB_UTIL_NETWORK_SHM_LINK_H_
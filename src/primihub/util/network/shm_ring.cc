@@ -0,0 +1,311 @@
+/*
+* Copyright (c) 2023 by PrimiHub
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      https://www.apache.org/licenses/
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#include "src/primihub/util/network/shm_ring.h"
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+#include <glog/logging.h>
+#include <algorithm>
+
+#include "src/primihub/util/endian_util.h"
+
+namespace primihub::network {
+struct ShmRingHeader {
+  uint32_t magic;
+  uint32_t version;
+  uint64_t capacity;
+  pthread_mutex_t mtx;
+  pthread_cond_t not_empty;
+  pthread_cond_t not_full;
+  uint64_t head;      // total bytes read
+  uint64_t tail;      // total bytes written
+  uint32_t closed;
+};
+
+namespace {
+constexpr uint32_t kShmRingMagic = 0x50485352;   // "PHSR"
+constexpr uint32_t kShmRingVersion = 1;
+constexpr size_t kRecordHeaderSize =
+    sizeof(uint64_t) + sizeof(uint32_t) + sizeof(uint64_t);
+
+size_t DataOffset() {
+  // keep ring buffer cache line aligned
+  return (sizeof(ShmRingHeader) + 63) / 64 * 64;
+}
+
+int64_t MonotonicNowMs() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return static_cast<int64_t>(ts.tv_sec) * 1000 + ts.tv_nsec / 1000000;
+}
+
+/**
+ * the other process may die while holding the lock
+*/
+void LockRobust(pthread_mutex_t* mtx) {
+  if (pthread_mutex_lock(mtx) == EOWNERDEAD) {
+    pthread_mutex_consistent(mtx);
+  }
+}
+
+/**
+ * deadline_ms < 0 means waiting forever, return false if timeout
+*/
+bool WaitCond(pthread_cond_t* cond, pthread_mutex_t* mtx,
+              int64_t deadline_ms) {
+  int rc{0};
+  if (deadline_ms < 0) {
+    rc = pthread_cond_wait(cond, mtx);
+  } else {
+    struct timespec ts;
+    ts.tv_sec = deadline_ms / 1000;
+    ts.tv_nsec = (deadline_ms % 1000) * 1000000;
+    rc = pthread_cond_timedwait(cond, mtx, &ts);
+  }
+  if (rc == EOWNERDEAD) {
+    pthread_mutex_consistent(mtx);
+  }
+  return rc != ETIMEDOUT;
+}
+}  // namespace
+
+ShmRing::ShmRing(const std::string& name, ShmRingHeader* header,
+                 size_t map_size, bool owner) :
+    name_(name), header_(header), map_size_(map_size), owner_(owner) {
+  buffer_ = reinterpret_cast<char*>(header_) + DataOffset();
+}
+
+ShmRing::~ShmRing() {
+  if (owner_) {
+    Close();
+  }
+  munmap(header_, map_size_);
+  if (owner_) {
+    shm_unlink(name_.c_str());
+  }
+}
+
+std::unique_ptr<ShmRing> ShmRing::Create(const std::string& name,
+                                         uint64_t capacity) {
+  size_t map_size = DataOffset() + capacity;
+  int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+  if (fd < 0) {
+    LOG(ERROR) << "create shared memory: " << name << " failed, "
+               << strerror(errno);
+    return nullptr;
+  }
+  if (ftruncate(fd, map_size) != 0) {
+    LOG(ERROR) << "resize shared memory: " << name << " to " << map_size
+               << " failed, " << strerror(errno);
+    close(fd);
+    shm_unlink(name.c_str());
+    return nullptr;
+  }
+  void* addr = mmap(nullptr, map_size, PROT_READ | PROT_WRITE,
+                    MAP_SHARED, fd, 0);
+  close(fd);
+  if (addr == MAP_FAILED) {
+    LOG(ERROR) << "map shared memory: " << name << " failed, "
+               << strerror(errno);
+    shm_unlink(name.c_str());
+    return nullptr;
+  }
+  auto header = reinterpret_cast<ShmRingHeader*>(addr);
+  memset(header, 0, sizeof(ShmRingHeader));
+  header->capacity = capacity;
+  pthread_mutexattr_t mtx_attr;
+  pthread_mutexattr_init(&mtx_attr);
+  pthread_mutexattr_setpshared(&mtx_attr, PTHREAD_PROCESS_SHARED);
+  pthread_mutexattr_setrobust(&mtx_attr, PTHREAD_MUTEX_ROBUST);
+  pthread_mutex_init(&header->mtx, &mtx_attr);
+  pthread_mutexattr_destroy(&mtx_attr);
+  pthread_condattr_t cond_attr;
+  pthread_condattr_init(&cond_attr);
+  pthread_condattr_setpshared(&cond_attr, PTHREAD_PROCESS_SHARED);
+  pthread_condattr_setclock(&cond_attr, CLOCK_MONOTONIC);
+  pthread_cond_init(&header->not_empty, &cond_attr);
+  pthread_cond_init(&header->not_full, &cond_attr);
+  pthread_condattr_destroy(&cond_attr);
+  header->version = kShmRingVersion;
+  __atomic_store_n(&header->magic, kShmRingMagic, __ATOMIC_RELEASE);
+  return std::unique_ptr<ShmRing>(
+      new ShmRing(name, header, map_size, true));
+}
+
+std::unique_ptr<ShmRing> ShmRing::Open(const std::string& name) {
+  int fd = shm_open(name.c_str(), O_RDWR, 0600);
+  if (fd < 0) {
+    LOG(ERROR) << "open shared memory: " << name << " failed, "
+               << strerror(errno);
+    return nullptr;
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0 ||
+      static_cast<size_t>(st.st_size) <= DataOffset()) {
+    LOG(ERROR) << "invalid shared memory: " << name;
+    close(fd);
+    return nullptr;
+  }
+  size_t map_size = st.st_size;
+  void* addr = mmap(nullptr, map_size, PROT_READ | PROT_WRITE,
+                    MAP_SHARED, fd, 0);
+  close(fd);
+  if (addr == MAP_FAILED) {
+    LOG(ERROR) << "map shared memory: " << name << " failed, "
+               << strerror(errno);
+    return nullptr;
+  }
+  auto header = reinterpret_cast<ShmRingHeader*>(addr);
+  if (__atomic_load_n(&header->magic, __ATOMIC_ACQUIRE) != kShmRingMagic ||
+      header->version != kShmRingVersion ||
+      header->capacity + DataOffset() > map_size) {
+    LOG(ERROR) << "shared memory: " << name << " is not a ring";
+    munmap(addr, map_size);
+    return nullptr;
+  }
+  return std::unique_ptr<ShmRing>(
+      new ShmRing(name, header, map_size, false));
+}
+
+uint64_t ShmRing::capacity() const {
+  return header_->capacity;
+}
+
+void ShmRing::Close() {
+  LockRobust(&header_->mtx);
+  header_->closed = 1;
+  pthread_cond_broadcast(&header_->not_empty);
+  pthread_cond_broadcast(&header_->not_full);
+  pthread_mutex_unlock(&header_->mtx);
+}
+
+retcode ShmRing::WriteBytes(const char* data, size_t size,
+                            int64_t deadline_ms) {
+  uint64_t capacity = header_->capacity;
+  size_t offset = 0;
+  while (offset < size) {
+    LockRobust(&header_->mtx);
+    while (!header_->closed &&
+           header_->tail - header_->head == capacity) {
+      if (!WaitCond(&header_->not_full, &header_->mtx, deadline_ms)) {
+        pthread_mutex_unlock(&header_->mtx);
+        return retcode::FAIL;
+      }
+    }
+    if (header_->closed) {
+      pthread_mutex_unlock(&header_->mtx);
+      return retcode::FAIL;
+    }
+    uint64_t tail = header_->tail;
+    uint64_t free_size = capacity - (tail - header_->head);
+    pthread_mutex_unlock(&header_->mtx);
+    // only this writer moves tail, so the free space is owned by it
+    uint64_t pos = tail % capacity;
+    size_t n = std::min<uint64_t>({free_size, size - offset, capacity - pos});
+    memcpy(buffer_ + pos, data + offset, n);
+    offset += n;
+    LockRobust(&header_->mtx);
+    header_->tail = tail + n;
+    pthread_cond_signal(&header_->not_empty);
+    pthread_mutex_unlock(&header_->mtx);
+  }
+  return retcode::SUCCESS;
+}
+
+retcode ShmRing::ReadBytes(char* data, size_t size) {
+  uint64_t capacity = header_->capacity;
+  size_t offset = 0;
+  while (offset < size) {
+    LockRobust(&header_->mtx);
+    // remaining bytes are drained after ring is closed
+    while (!header_->closed && header_->tail == header_->head) {
+      WaitCond(&header_->not_empty, &header_->mtx, -1);
+    }
+    if (header_->tail == header_->head) {
+      pthread_mutex_unlock(&header_->mtx);
+      return retcode::FAIL;
+    }
+    uint64_t head = header_->head;
+    uint64_t available = header_->tail - head;
+    pthread_mutex_unlock(&header_->mtx);
+    uint64_t pos = head % capacity;
+    size_t n = std::min<uint64_t>({available, size - offset, capacity - pos});
+    memcpy(data + offset, buffer_ + pos, n);
+    offset += n;
+    LockRobust(&header_->mtx);
+    header_->head = head + n;
+    pthread_cond_signal(&header_->not_full);
+    pthread_mutex_unlock(&header_->mtx);
+  }
+  return retcode::SUCCESS;
+}
+
+retcode ShmRing::Write(uint64_t id, const std::string& key,
+                       std::string_view data, int32_t timeout_ms) {
+  int64_t deadline_ms = timeout_ms < 0 ? -1 : MonotonicNowMs() + timeout_ms;
+  char record_header[kRecordHeaderSize];
+  uint64_t be_id = htonll(id);
+  uint32_t be_key_len = htonl(static_cast<uint32_t>(key.size()));
+  uint64_t be_data_len = htonll(data.size());
+  memcpy(record_header, &be_id, sizeof(be_id));
+  memcpy(record_header + 8, &be_key_len, sizeof(be_key_len));
+  memcpy(record_header + 12, &be_data_len, sizeof(be_data_len));
+  std::lock_guard<std::mutex> lck(write_mtx_);
+  auto ret = WriteBytes(record_header, kRecordHeaderSize, deadline_ms);
+  if (ret == retcode::SUCCESS) {
+    ret = WriteBytes(key.data(), key.size(), deadline_ms);
+  }
+  if (ret == retcode::SUCCESS) {
+    ret = WriteBytes(data.data(), data.size(), deadline_ms);
+  }
+  if (ret != retcode::SUCCESS) {
+    LOG(ERROR) << "write record to shared memory: " << name_ << " failed, "
+               << "key: " << key << " data length: " << data.size();
+    // stream is broken once a record is written partially
+    Close();
+  }
+  return ret;
+}
+
+retcode ShmRing::Read(Record* record) {
+  char record_header[kRecordHeaderSize];
+  std::lock_guard<std::mutex> lck(read_mtx_);
+  auto ret = ReadBytes(record_header, kRecordHeaderSize);
+  if (ret != retcode::SUCCESS) {
+    return ret;
+  }
+  uint64_t be_id{0};
+  uint32_t be_key_len{0};
+  uint64_t be_data_len{0};
+  memcpy(&be_id, record_header, sizeof(be_id));
+  memcpy(&be_key_len, record_header + 8, sizeof(be_key_len));
+  memcpy(&be_data_len, record_header + 12, sizeof(be_data_len));
+  record->id = ntohll(be_id);
+  record->key.resize(ntohl(be_key_len));
+  record->data.resize(ntohll(be_data_len));
+  ret = ReadBytes(record->key.data(), record->key.size());
+  if (ret == retcode::SUCCESS) {
+    ret = ReadBytes(record->data.data(), record->data.size());
+  }
+  return ret;
+}
+}  // namespace primihub::network
@@ -0,0 +1,86 @@
+/*
+* Copyright (c) 2023 by PrimiHub
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      https://www.apache.org/licenses/
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#ifndef SRC_PRIMIHUB_UTIL_NETWORK_SHM_RING_H_
+#define SRC_PRIMIHUB_UTIL_NETWORK_SHM_RING_H_
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+
+#include "src/primihub/common/common.h"
+
+namespace primihub::network {
+struct ShmRingHeader;
+/**
+ * one-way byte ring in POSIX shared memory,
+ * used between node daemon and the task process it launches.
+ * one process writes records and the other one reads them,
+ * record larger than ring is streamed while reader consumes it.
+ * record layout: | id(8) | key_len(4) | data_len(8) | key | data |
+ * creator owns the shared memory object and unlinks it when destroyed
+*/
+class ShmRing {
+ public:
+  struct Record {
+    uint64_t id{0};
+    std::string key;
+    std::string data;
+  };
+  ~ShmRing();
+  /**
+   * name: shared memory object name, e.g. "/primihub_xxx"
+  */
+  static std::unique_ptr<ShmRing> Create(const std::string& name,
+                                         uint64_t capacity);
+  static std::unique_ptr<ShmRing> Open(const std::string& name);
+
+  /**
+   * writer of the same process are serialized,
+   * timeout_ms < 0 means waiting forever.
+   * return FAIL if timeout or ring is closed
+  */
+  retcode Write(uint64_t id, const std::string& key, std::string_view data,
+                int32_t timeout_ms = -1);
+  /**
+   * block until next record arrives,
+   * return FAIL if ring is closed
+  */
+  retcode Read(Record* record);
+  /**
+   * wake up both sides, following read and write fail
+  */
+  void Close();
+  const std::string& name() const {return name_;}
+  uint64_t capacity() const;
+
+ protected:
+  ShmRing(const std::string& name, ShmRingHeader* header,
+          size_t map_size, bool owner);
+  retcode WriteBytes(const char* data, size_t size, int64_t deadline_ms);
+  retcode ReadBytes(char* data, size_t size);
+
+ private:
+  std::string name_;
+  ShmRingHeader* header_{nullptr};
+  char* buffer_{nullptr};
+  size_t map_size_{0};
+  bool owner_{false};
+  std::mutex write_mtx_;
+  std::mutex read_mtx_;
+};
+}  // namespace primihub::network
+#endif  // SRC_PRIMIHUB_UTIL_NETWORK_SHM_RING_H_
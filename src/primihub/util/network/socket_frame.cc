@@ -0,0 +1,252 @@
+/*
+* Copyright (c) 2023 by PrimiHub
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      https://www.apache.org/licenses/
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#include "src/primihub/util/network/socket_frame.h"
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <glog/logging.h>
+#include <errno.h>
+#include <string.h>
+#include <algorithm>
+#include <utility>
+
+#include "src/primihub/util/endian_util.h"
+
+namespace primihub::network {
+void EncodeSocketFrameHeader(SocketFrame::FrameType type, retcode ret_code,
+                             uint64_t seq_no, uint32_t key_len,
+                             uint32_t meta_len, uint64_t data_len, char* buf,
+                             uint8_t compress_type) {
+  uint32_t magic = htonl(SocketFrame::kMagic);
+  uint64_t be_seq_no = htonll(seq_no);
+  uint32_t be_key_len = htonl(key_len);
+  uint32_t be_meta_len = htonl(meta_len);
+  uint64_t be_data_len = htonll(data_len);
+  memcpy(buf, &magic, 4);
+  buf[4] = static_cast<char>(type);
+  buf[5] = ret_code == retcode::SUCCESS ? 0 : 1;
+  buf[6] = static_cast<char>(compress_type);
+  buf[7] = 0;
+  memcpy(buf + 8, &be_seq_no, 8);
+  memcpy(buf + 16, &be_key_len, 4);
+  memcpy(buf + 20, &be_meta_len, 4);
+  memcpy(buf + 24, &be_data_len, 8);
+}
+
+retcode DecodeSocketFrameHeader(const char* buf, SocketFrame* frame,
+                                uint64_t* key_len, uint64_t* meta_len,
+                                uint64_t* data_len) {
+  uint32_t magic;
+  memcpy(&magic, buf, 4);
+  if (ntohl(magic) != SocketFrame::kMagic) {
+    LOG(ERROR) << "invalid frame magic: " << ntohl(magic);
+    return retcode::FAIL;
+  }
+  uint8_t type = static_cast<uint8_t>(buf[4]);
+  if (type > SocketFrame::ACK) {
+    LOG(ERROR) << "invalid frame type: " << static_cast<int>(type);
+    return retcode::FAIL;
+  }
+  frame->type = static_cast<SocketFrame::FrameType>(type);
+  frame->ret_code = buf[5] == 0 ? retcode::SUCCESS : retcode::FAIL;
+  frame->compress_type = static_cast<uint8_t>(buf[6]);
+  uint64_t be_seq_no;
+  uint32_t be_key_len;
+  uint32_t be_meta_len;
+  uint64_t be_data_len;
+  memcpy(&be_seq_no, buf + 8, 8);
+  memcpy(&be_key_len, buf + 16, 4);
+  memcpy(&be_meta_len, buf + 20, 4);
+  memcpy(&be_data_len, buf + 24, 8);
+  frame->seq_no = ntohll(be_seq_no);
+  *key_len = ntohl(be_key_len);
+  *meta_len = ntohl(be_meta_len);
+  *data_len = ntohll(be_data_len);
+  if (*key_len > SocketFrame::kMaxKeySize) {
+    LOG(ERROR) << "frame key is too large: " << *key_len;
+    return retcode::FAIL;
+  }
+  if (*meta_len > SocketFrame::kMaxMetaSize) {
+    LOG(ERROR) << "frame meta is too large: " << *meta_len;
+    return retcode::FAIL;
+  }
+  if (*data_len > SocketFrame::kMaxFrameSize) {
+    LOG(ERROR) << "frame is too large: " << *data_len;
+    return retcode::FAIL;
+  }
+  return retcode::SUCCESS;
+}
+
+retcode WriteSocketFrame(int fd, SocketFrame::FrameType type,
+                         retcode ret_code, uint64_t seq_no,
+                         const std::string& key, const std::string& meta,
+                         std::string_view data, uint8_t compress_type) {
+  char header[SocketFrame::kHeaderSize];
+  EncodeSocketFrameHeader(type, ret_code, seq_no, key.size(), meta.size(),
+                          data.size(), header, compress_type);
+  struct iovec iov[4];
+  iov[0].iov_base = header;
+  iov[0].iov_len = SocketFrame::kHeaderSize;
+  iov[1].iov_base = const_cast<char*>(key.data());
+  iov[1].iov_len = key.size();
+  iov[2].iov_base = const_cast<char*>(meta.data());
+  iov[2].iov_len = meta.size();
+  iov[3].iov_base = const_cast<char*>(data.data());
+  iov[3].iov_len = data.size();
+  struct iovec* cur_iov = iov;
+  int iov_count = 4;
+  while (iov_count > 0) {
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = cur_iov;
+    msg.msg_iovlen = iov_count;
+    ssize_t sended = sendmsg(fd, &msg, MSG_NOSIGNAL);
+    if (sended < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      LOG(ERROR) << "send frame failed, error: " << strerror(errno);
+      return retcode::FAIL;
+    }
+    // skip the part has been sended
+    size_t remain = static_cast<size_t>(sended);
+    while (iov_count > 0 && remain >= cur_iov->iov_len) {
+      remain -= cur_iov->iov_len;
+      cur_iov++;
+      iov_count--;
+    }
+    if (iov_count > 0) {
+      cur_iov->iov_base = static_cast<char*>(cur_iov->iov_base) + remain;
+      cur_iov->iov_len -= remain;
+    }
+  }
+  return retcode::SUCCESS;
+}
+
+namespace {
+retcode ReadFully(int fd, char* buf, size_t length) {
+  size_t readed = 0;
+  while (readed < length) {
+    ssize_t n = recv(fd, buf + readed, length - readed, 0);
+    if (n == 0) {
+      VLOG(5) << "connection is closed by peer";
+      return retcode::FAIL;
+    }
+    if (n < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      LOG(ERROR) << "recv frame failed, error: " << strerror(errno);
+      return retcode::FAIL;
+    }
+    readed += n;
+  }
+  return retcode::SUCCESS;
+}
+}  // namespace
+
+retcode ReadSocketFrame(int fd, SocketFrame* frame) {
+  char header[SocketFrame::kHeaderSize];
+  auto ret = ReadFully(fd, header, SocketFrame::kHeaderSize);
+  if (ret != retcode::SUCCESS) {
+    return retcode::FAIL;
+  }
+  uint64_t key_len{0};
+  uint64_t meta_len{0};
+  uint64_t data_len{0};
+  ret = DecodeSocketFrameHeader(header, frame, &key_len, &meta_len, &data_len);
+  if (ret != retcode::SUCCESS) {
+    return retcode::FAIL;
+  }
+  frame->key.resize(key_len);
+  frame->meta.resize(meta_len);
+  ret = ReadFully(fd, frame->key.data(), key_len);
+  if (ret == retcode::SUCCESS) {
+    ret = ReadFully(fd, frame->meta.data(), meta_len);
+  }
+  // data buffer grows as it arrives, length in header is not trusted
+  frame->data.clear();
+  while (ret == retcode::SUCCESS && frame->data.size() < data_len) {
+    size_t offset = frame->data.size();
+    size_t n = std::min(data_len - offset, SocketFrame::kMaxReserveSize);
+    frame->data.resize(offset + n);
+    ret = ReadFully(fd, frame->data.data() + offset, n);
+  }
+  return ret;
+}
+
+retcode SocketFrameDecoder::Feed(const char* buf, size_t length) {
+  size_t offset = 0;
+  while (offset < length) {
+    if (!header_ready_) {
+      size_t need = SocketFrame::kHeaderSize - header_buf_.size();
+      size_t n = std::min(need, length - offset);
+      header_buf_.append(buf + offset, n);
+      offset += n;
+      if (header_buf_.size() < SocketFrame::kHeaderSize) {
+        break;
+      }
+      current_ = SocketFrame();
+      auto ret = DecodeSocketFrameHeader(header_buf_.data(), &current_,
+                                         &key_len_, &meta_len_, &data_len_);
+      header_buf_.clear();
+      if (ret != retcode::SUCCESS) {
+        return retcode::FAIL;
+      }
+      current_.key.reserve(key_len_);
+      current_.meta.reserve(meta_len_);
+      current_.data.reserve(std::min(data_len_,
+                                     SocketFrame::kMaxReserveSize));
+      header_ready_ = true;
+    }
+    // fill key, meta, data in order
+    if (current_.key.size() < key_len_) {
+      size_t n = std::min(key_len_ - current_.key.size(), length - offset);
+      current_.key.append(buf + offset, n);
+      offset += n;
+    }
+    if (current_.key.size() == key_len_ && current_.meta.size() < meta_len_) {
+      size_t n = std::min(meta_len_ - current_.meta.size(), length - offset);
+      current_.meta.append(buf + offset, n);
+      offset += n;
+    }
+    if (current_.key.size() == key_len_ &&
+        current_.meta.size() == meta_len_ &&
+        current_.data.size() < data_len_) {
+      size_t n = std::min(data_len_ - current_.data.size(), length - offset);
+      current_.data.append(buf + offset, n);
+      offset += n;
+    }
+    if (current_.key.size() == key_len_ &&
+        current_.meta.size() == meta_len_ &&
+        current_.data.size() == data_len_) {
+      frames_.push(std::move(current_));
+      current_ = SocketFrame();
+      header_ready_ = false;
+    }
+  }
+  return retcode::SUCCESS;
+}
+
+bool SocketFrameDecoder::Next(SocketFrame* frame) {
+  if (frames_.empty()) {
+    return false;
+  }
+  *frame = std::move(frames_.front());
+  frames_.pop();
+  return true;
+}
+}  // namespace primihub::network
@@ -0,0 +1,99 @@
+/*
+* Copyright (c) 2023 by PrimiHub
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      https://www.apache.org/licenses/
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#ifndef SRC_PRIMIHUB_UTIL_NETWORK_SOCKET_FRAME_H_
+#define SRC_PRIMIHUB_UTIL_NETWORK_SOCKET_FRAME_H_
+#include <queue>
+#include <string>
+#include <string_view>
+
+#include "src/primihub/common/common.h"
+
+namespace primihub::network {
+/**
+ * length-prefixed frame used by raw socket link
+ * layout: | header(32 bytes) | key | meta | data |
+ * header: magic(4) type(1) ret_code(1) compress_type(1) reserved(1)
+ *         seq_no(8) key_len(4) meta_len(4) data_len(8),
+ *         all in network byte order
+*/
+struct SocketFrame {
+  enum FrameType : uint8_t {
+    DATA = 0,   // payload for key, pushed into the peer's recv queue
+    RECV = 1,   // fetch data for key from peer, answered with DATA
+    ACK = 2,    // completion of DATA identified by seq_no
+  };
+  static constexpr uint32_t kMagic = 0x50484C4B;  // "PHLK"
+  static constexpr size_t kHeaderSize = 32;
+  // lengths in header beyond the limits are rejected as corrupted frame
+  static constexpr uint64_t kMaxFrameSize = 16ULL * 1024 * 1024 * 1024;
+  static constexpr uint64_t kMaxKeySize = 64 * 1024;
+  static constexpr uint64_t kMaxMetaSize = 1024 * 1024;
+  // buffer of data grows as it arrives beyond this size
+  static constexpr uint64_t kMaxReserveSize = 64 * 1024 * 1024;
+
+  FrameType type{DATA};
+  retcode ret_code{retcode::SUCCESS};
+  uint8_t compress_type{0};   // value of rpc::CompressType
+  uint64_t seq_no{0};
+  std::string key;
+  std::string meta;   // serialized rpc::TaskContext, first frame only
+  std::string data;
+};
+
+/**
+ * write one frame to blocking socket, data is sent from caller's buffer
+*/
+retcode WriteSocketFrame(int fd, SocketFrame::FrameType type,
+                         retcode ret_code, uint64_t seq_no,
+                         const std::string& key, const std::string& meta,
+                         std::string_view data, uint8_t compress_type = 0);
+/**
+ * read one frame from blocking socket
+*/
+retcode ReadSocketFrame(int fd, SocketFrame* frame);
+
+/**
+ * incremental decoder for non-blocking socket,
+ * feed received bytes and fetch complete frames
+*/
+class SocketFrameDecoder {
+ public:
+  SocketFrameDecoder() = default;
+  /**
+   * return FAIL if the stream is corrupted
+  */
+  retcode Feed(const char* buf, size_t length);
+  bool Next(SocketFrame* frame);
+
+ private:
+  std::string header_buf_;
+  bool header_ready_{false};
+  uint64_t key_len_{0};
+  uint64_t meta_len_{0};
+  uint64_t data_len_{0};
+  SocketFrame current_;
+  std::queue<SocketFrame> frames_;
+};
+
+void EncodeSocketFrameHeader(SocketFrame::FrameType type, retcode ret_code,
+                             uint64_t seq_no, uint32_t key_len,
+                             uint32_t meta_len, uint64_t data_len, char* buf,
+                             uint8_t compress_type = 0);
+retcode DecodeSocketFrameHeader(const char* buf, SocketFrame* frame,
+                                uint64_t* key_len, uint64_t* meta_len,
+                                uint64_t* data_len);
+}  // namespace primihub::network
+#endif  // SRC_PRIMIHUB_UTIL_NETWORK_SOCKET_FRAME_H_
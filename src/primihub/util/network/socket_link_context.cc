@@ -0,0 +1,182 @@
+/*
+* Copyright (c) 2023 by PrimiHub
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      https://www.apache.org/licenses/
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#include "src/primihub/util/network/socket_link_context.h"
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+#include <glog/logging.h>
+#include <utility>
+
+#include "src/primihub/common/config/server_config.h"
+#include "src/primihub/util/log.h"
+
+namespace primihub::network {
+SocketChannel::SocketChannel(const primihub::Node& node,
+                             LinkContext* link_ctx,
+                             uint32_t port_offset) :
+    GrpcStreamChannel(node, link_ctx) {
+  data_port_ = node.port_ + port_offset;
+}
+
+SocketChannel::~SocketChannel() {
+  std::lock_guard<std::mutex> lck(stream_mtx_);
+  CloseStream();
+}
+
+retcode SocketChannel::Connect() {
+  struct addrinfo hints;
+  memset(&hints, 0, sizeof(hints));
+  hints.ai_family = AF_UNSPEC;
+  hints.ai_socktype = SOCK_STREAM;
+  struct addrinfo* addr_list{nullptr};
+  std::string port_str = std::to_string(data_port_);
+  int ret = getaddrinfo(dest_node_.ip_.c_str(), port_str.c_str(),
+                        &hints, &addr_list);
+  if (ret != 0) {
+    PH_LOG(ERROR, LogType::kTask)
+        << "resolve address: " << dest_node_.ip_ << " failed, "
+        << "error: " << gai_strerror(ret);
+    return retcode::FAIL;
+  }
+  for (auto addr = addr_list; addr != nullptr; addr = addr->ai_next) {
+    int fd = ::socket(addr->ai_family, addr->ai_socktype | SOCK_CLOEXEC,
+                      addr->ai_protocol);
+    if (fd < 0) {
+      continue;
+    }
+    if (::connect(fd, addr->ai_addr, addr->ai_addrlen) == 0) {
+      fd_ = fd;
+      break;
+    }
+    ::close(fd);
+  }
+  freeaddrinfo(addr_list);
+  if (fd_ < 0) {
+    PH_LOG(ERROR, LogType::kTask)
+        << "connect to " << dest_node_.ip_ << ":" << data_port_ << " failed, "
+        << "error: " << strerror(errno);
+    return retcode::FAIL;
+  }
+  int opt = 1;
+  setsockopt(fd_, IPPROTO_TCP, TCP_NODELAY, &opt, sizeof(opt));
+  return retcode::SUCCESS;
+}
+
+retcode SocketChannel::OpenStream() {
+  if (!stream_broken_.load(std::memory_order_relaxed)) {
+    return retcode::SUCCESS;
+  }
+  CloseStream();
+  auto ret = Connect();
+  if (ret != retcode::SUCCESS) {
+    return retcode::FAIL;
+  }
+  task_info_sent_ = false;
+  stream_broken_.store(false);
+  int fd = fd_;
+  read_fut_ = std::async(std::launch::async, [this, fd]() {
+    this->SocketReadLoop(fd);
+  });
+  PH_VLOG(5, LogType::kTask)
+      << "open socket link to " << dest_node_.ip_ << ":" << data_port_;
+  return retcode::SUCCESS;
+}
+
+void SocketChannel::CloseStream() {
+  if (fd_ < 0) {
+    return;
+  }
+  ::shutdown(fd_, SHUT_RDWR);
+  if (read_fut_.valid()) {
+    read_fut_.get();
+  }
+  ::close(fd_);
+  fd_ = -1;
+  stream_broken_.store(true);
+}
+
+void SocketChannel::SocketReadLoop(int fd) {
+  SocketFrame frame;
+  while (ReadSocketFrame(fd, &frame) == retcode::SUCCESS) {
+    bool is_data = frame.type == SocketFrame::DATA;
+    if (frame.ret_code == retcode::SUCCESS) {
+      DispatchResponse(frame.seq_no, is_data, true, frame.data.size(),
+                       true, "", frame.data);
+    } else {
+      // error message is carried by data
+      DispatchResponse(frame.seq_no, is_data, true, 0,
+                       false, frame.data, std::string_view());
+    }
+  }
+  stream_broken_.store(true);
+  FailAllPending("socket link is closed");
+}
+
+retcode SocketChannel::WriteMessage(rpc::LinkFrame::FrameType type,
+                                    const std::string& key,
+                                    std::string_view data,
+                                    uint64_t seq_no,
+                                    rpc::CompressType compress_type) {
+  std::lock_guard<std::mutex> lck(stream_mtx_);
+  auto ret = OpenStream();
+  if (ret != retcode::SUCCESS) {
+    return retcode::FAIL;
+  }
+  std::string meta;
+  if (!task_info_sent_) {
+    rpc::TaskContext task_info;
+    BuildTaskInfo(&task_info);
+    task_info.SerializeToString(&meta);
+    task_info_sent_ = true;
+  }
+  auto frame_type = type == rpc::LinkFrame::RECV ?
+      SocketFrame::RECV : SocketFrame::DATA;
+  ret = WriteSocketFrame(fd_, frame_type, retcode::SUCCESS,
+                         seq_no, key, meta, data,
+                         static_cast<uint8_t>(compress_type));
+  if (ret != retcode::SUCCESS) {
+    PH_LOG(WARNING, LogType::kTask)
+        << "write frame to socket link " << dest_node_.ip_ << ":"
+        << data_port_ << " failed, key: " << key;
+    CloseStream();
+    return retcode::FAIL;
+  }
+  return retcode::SUCCESS;
+}
+
+SocketLinkContext::SocketLinkContext() {
+  auto& server_config = primihub::ServerConfig::getInstance();
+  port_offset_ = server_config.getNodeConfig().link_cfg.socket_port_offset;
+}
+
+std::shared_ptr<IChannel> SocketLinkContext::buildChannel(
+    const primihub::Node& node,
+    LinkContext* link_ctx) {
+  // raw socket link is plaintext, it is never used if tls is configured
+  // by either side
+  auto& server_config = primihub::ServerConfig::getInstance();
+  if (node.use_tls() || server_config.getServiceConfig().use_tls()) {
+    LOG(WARNING) << "raw socket link is plaintext only, "
+                 << "use grpc stream over tls for node: " << node.to_string();
+    return std::make_shared<GrpcStreamChannel>(node, link_ctx);
+  }
+  return std::make_shared<SocketChannel>(node, link_ctx, port_offset_);
+}
+}  // namespace primihub::network
@@ -0,0 +1,71 @@
+/*
+* Copyright (c) 2023 by PrimiHub
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      https://www.apache.org/licenses/
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#ifndef SRC_PRIMIHUB_UTIL_NETWORK_SOCKET_LINK_CONTEXT_H_
+#define SRC_PRIMIHUB_UTIL_NETWORK_SOCKET_LINK_CONTEXT_H_
+#include <memory>
+#include <string>
+#include <string_view>
+
+#include "src/primihub/util/network/grpc_stream_link_context.h"
+#include "src/primihub/util/network/socket_frame.h"
+
+namespace primihub::network {
+/**
+ * SocketChannel
+ * data is exchanged over one persistent tcp connection with
+ * length-prefixed SocketFrame, bypass protobuf and http2 framing.
+ * peer is served by SocketLinkServer listening on grpc_port + port_offset,
+ * control command still uses unary rpc provided by GrpcChannel.
+ * frames are plaintext, neither encrypted nor authenticated
+*/
+class SocketChannel : public GrpcStreamChannel {
+ public:
+  SocketChannel(const primihub::Node& node, LinkContext* link_ctx,
+                uint32_t port_offset);
+  virtual ~SocketChannel();
+
+ protected:
+  retcode OpenStream() override;
+  void CloseStream() override;
+  retcode WriteMessage(rpc::LinkFrame::FrameType type,
+                       const std::string& key,
+                       std::string_view data,
+                       uint64_t seq_no,
+                       rpc::CompressType compress_type) override;
+  retcode Connect();
+  void SocketReadLoop(int fd);
+
+ private:
+  int fd_{-1};
+  uint32_t data_port_{0};
+};
+
+class SocketLinkContext : public GrpcLinkContext {
+ public:
+  SocketLinkContext();
+  virtual ~SocketLinkContext() = default;
+  /**
+   * raw socket link is plaintext only, channel falls back to
+   * grpc stream over tls if tls is enabled on either side
+  */
+  std::shared_ptr<IChannel> buildChannel(const primihub::Node& node,
+                                         LinkContext* link_ctx) override;
+
+ private:
+  uint32_t port_offset_{0};
+};
+}  // namespace primihub::network
+#endif  // SRC_PRIMIHUB_UTIL_NETWORK_SOCKET_LINK_CONTEXT_H_
@@ -0,0 +1,376 @@
+/*
+* Copyright (c) 2023 by PrimiHub
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      https://www.apache.org/licenses/
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#include "src/primihub/util/network/socket_link_server.h"
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+#include <glog/logging.h>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace primihub::network {
+namespace {
+constexpr size_t kReadBufferSize = 256 * 1024;
+constexpr int kMaxEvents = 64;
+constexpr int kEpollTimeoutMs = 1000;
+}  // namespace
+
+SocketLinkServer::Connection::~Connection() {
+  if (fd >= 0) {
+    ::close(fd);
+    fd = -1;
+  }
+}
+
+retcode SocketLinkServer::Connection::Write(SocketFrame::FrameType type,
+                                            retcode ret_code,
+                                            uint64_t seq_no,
+                                            const std::string& key,
+                                            std::string_view data) {
+  std::lock_guard<std::mutex> lck(write_mtx);
+  if (closed.load()) {
+    return retcode::FAIL;
+  }
+  static const std::string empty_meta;
+  return WriteSocketFrame(fd, type, ret_code, seq_no, key, empty_meta, data);
+}
+
+void SocketLinkServer::Connection::Close() {
+  bool expected{false};
+  if (!closed.compare_exchange_strong(expected, true)) {
+    return;
+  }
+  // fd is closed by destructor when all pending handlers finished
+  ::shutdown(fd, SHUT_RDWR);
+  data_queue.shutdown();
+  std::unordered_map<uint64_t, CancelFunc> pending;
+  {
+    std::lock_guard<std::mutex> lck(recv_mtx);
+    pending.swap(pending_recv);
+  }
+  // slots still being parked are cancelled by ParkRecv
+  for (auto& [id, cancel] : pending) {
+    if (cancel) {
+      cancel();
+    }
+  }
+}
+
+uint64_t SocketLinkServer::Connection::StartRecv() {
+  std::lock_guard<std::mutex> lck(recv_mtx);
+  uint64_t id = ++recv_id;
+  pending_recv[id] = nullptr;
+  return id;
+}
+
+void SocketLinkServer::Connection::ParkRecv(uint64_t id, CancelFunc cancel) {
+  {
+    std::lock_guard<std::mutex> lck(recv_mtx);
+    if (!closed.load()) {
+      auto it = pending_recv.find(id);
+      // done has been invoked in place otherwise
+      if (it != pending_recv.end()) {
+        it->second = std::move(cancel);
+      }
+      return;
+    }
+  }
+  if (cancel) {
+    cancel();
+  }
+}
+
+void SocketLinkServer::Connection::FinishRecv(uint64_t id) {
+  std::lock_guard<std::mutex> lck(recv_mtx);
+  pending_recv.erase(id);
+}
+
+SocketLinkServer::SocketLinkServer(DataHandler data_handler,
+                                   RecvHandler recv_handler) :
+    data_handler_(std::move(data_handler)),
+    recv_handler_(std::move(recv_handler)) {
+  read_buf_.resize(kReadBufferSize);
+}
+
+SocketLinkServer::~SocketLinkServer() {
+  Stop();
+}
+
+retcode SocketLinkServer::Start(const std::string& ip, uint16_t port) {
+  listen_fd_ = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (listen_fd_ < 0) {
+    LOG(ERROR) << "create socket failed, error: " << strerror(errno);
+    return retcode::FAIL;
+  }
+  int opt = 1;
+  setsockopt(listen_fd_, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
+  struct sockaddr_in addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(port);
+  if (inet_pton(AF_INET, ip.c_str(), &addr.sin_addr) != 1) {
+    LOG(ERROR) << "invalid listen address: " << ip;
+    return retcode::FAIL;
+  }
+  if (::bind(listen_fd_, reinterpret_cast<struct sockaddr*>(&addr),
+             sizeof(addr)) < 0) {
+    LOG(ERROR) << "bind " << ip << ":" << port << " failed, "
+               << "error: " << strerror(errno);
+    return retcode::FAIL;
+  }
+  if (::listen(listen_fd_, SOMAXCONN) < 0) {
+    LOG(ERROR) << "listen failed, error: " << strerror(errno);
+    return retcode::FAIL;
+  }
+  socklen_t addr_len = sizeof(addr);
+  getsockname(listen_fd_, reinterpret_cast<struct sockaddr*>(&addr),
+              &addr_len);
+  port_ = ntohs(addr.sin_port);
+
+  epoll_fd_ = epoll_create1(EPOLL_CLOEXEC);
+  wakeup_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if (epoll_fd_ < 0 || wakeup_fd_ < 0) {
+    LOG(ERROR) << "create epoll failed, error: " << strerror(errno);
+    return retcode::FAIL;
+  }
+  struct epoll_event ev;
+  memset(&ev, 0, sizeof(ev));
+  ev.events = EPOLLIN;
+  ev.data.fd = listen_fd_;
+  epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, listen_fd_, &ev);
+  ev.data.fd = wakeup_fd_;
+  epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, wakeup_fd_, &ev);
+  stop_.store(false);
+  loop_fut_ = std::async(std::launch::async, [this]() {
+    SET_THREAD_NAME("SocketLinkServer");
+    this->EventLoop();
+  });
+  LOG(INFO) << "socket link server listening on " << ip << ":" << port_;
+  return retcode::SUCCESS;
+}
+
+void SocketLinkServer::Stop() {
+  bool expected{false};
+  if (!stop_.compare_exchange_strong(expected, true)) {
+    return;
+  }
+  if (wakeup_fd_ >= 0) {
+    uint64_t one = 1;
+    [[maybe_unused]] auto n = ::write(wakeup_fd_, &one, sizeof(one));
+  }
+  if (loop_fut_.valid()) {
+    loop_fut_.get();
+  }
+  for (auto& [fd, conn] : connections_) {
+    conn->Close();
+  }
+  connections_.clear();
+  // data workers end when their connection is closed
+  for (auto& worker : workers_) {
+    worker.thread.join();
+  }
+  workers_.clear();
+  for (int* fd : {&listen_fd_, &epoll_fd_, &wakeup_fd_}) {
+    if (*fd >= 0) {
+      ::close(*fd);
+      *fd = -1;
+    }
+  }
+}
+
+void SocketLinkServer::EventLoop() {
+  std::vector<struct epoll_event> events(kMaxEvents);
+  while (!stop_.load(std::memory_order_relaxed)) {
+    int n = epoll_wait(epoll_fd_, events.data(), kMaxEvents, kEpollTimeoutMs);
+    if (n < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      LOG(ERROR) << "epoll_wait failed, error: " << strerror(errno);
+      break;
+    }
+    for (int i = 0; i < n; i++) {
+      int fd = events[i].data.fd;
+      if (fd == listen_fd_) {
+        AcceptConnections();
+        continue;
+      }
+      if (fd == wakeup_fd_) {
+        uint64_t value;
+        [[maybe_unused]] auto n = ::read(wakeup_fd_, &value, sizeof(value));
+        continue;
+      }
+      auto it = connections_.find(fd);
+      if (it == connections_.end()) {
+        continue;
+      }
+      // read remaining data before handling hangup
+      auto ret = ReadConnection(it->second);
+      if (ret != retcode::SUCCESS) {
+        CloseConnection(fd);
+      }
+    }
+  }
+}
+
+void SocketLinkServer::AcceptConnections() {
+  int conn_fd = accept4(listen_fd_, nullptr, nullptr, SOCK_CLOEXEC);
+  if (conn_fd < 0) {
+    if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+      LOG(ERROR) << "accept failed, error: " << strerror(errno);
+    }
+    return;
+  }
+  int opt = 1;
+  setsockopt(conn_fd, IPPROTO_TCP, TCP_NODELAY, &opt, sizeof(opt));
+  auto conn = std::make_shared<Connection>(conn_fd);
+  struct epoll_event ev;
+  memset(&ev, 0, sizeof(ev));
+  ev.events = EPOLLIN | EPOLLRDHUP;
+  ev.data.fd = conn_fd;
+  if (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, conn_fd, &ev) < 0) {
+    LOG(ERROR) << "add connection to epoll failed, "
+               << "error: " << strerror(errno);
+    return;
+  }
+  connections_[conn_fd] = conn;
+  RunWorker("SocketLinkData", [this, conn]() {
+    ProcessDataFrames(data_handler_, conn);
+  });
+  VLOG(5) << "accept new link connection, fd: " << conn_fd;
+}
+
+retcode SocketLinkServer::ReadConnection(std::shared_ptr<Connection> conn) {
+  do {
+    ssize_t n = recv(conn->fd, read_buf_.data(), read_buf_.size(),
+                     MSG_DONTWAIT);
+    if (n == 0) {
+      VLOG(5) << "link connection closed by peer, fd: " << conn->fd;
+      return retcode::FAIL;
+    }
+    if (n < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      if (errno == EAGAIN || errno == EWOULDBLOCK) {
+        break;
+      }
+      LOG(ERROR) << "recv failed, error: " << strerror(errno);
+      return retcode::FAIL;
+    }
+    auto ret = conn->decoder.Feed(read_buf_.data(), n);
+    if (ret != retcode::SUCCESS) {
+      LOG(ERROR) << "corrupted frame received, close connection";
+      return retcode::FAIL;
+    }
+    SocketFrame frame;
+    while (conn->decoder.Next(&frame)) {
+      DispatchFrame(conn, std::move(frame));
+    }
+  } while (true);
+  return retcode::SUCCESS;
+}
+
+void SocketLinkServer::DispatchFrame(std::shared_ptr<Connection> conn,
+                                     SocketFrame&& frame) {
+  if (!frame.meta.empty()) {
+    conn->meta = frame.meta;
+  } else {
+    frame.meta = conn->meta;
+  }
+  switch (frame.type) {
+  case SocketFrame::DATA:
+    conn->data_queue.push(std::move(frame));
+    break;
+  case SocketFrame::RECV: {
+    // pop is parked instead of blocking a thread, keep reading other frames
+    uint64_t seq_no = frame.seq_no;
+    std::string key = frame.key;
+    uint64_t recv_id = conn->StartRecv();
+    auto cancel = recv_handler_(frame.meta, frame.key,
+        [conn, recv_id, seq_no, key](retcode ret, std::string&& data) {
+      conn->FinishRecv(recv_id);
+      if (ret != retcode::SUCCESS) {
+        data = "no data is available for key:" + key;
+      }
+      conn->Write(SocketFrame::DATA, ret, seq_no, key, data);
+    });
+    conn->ParkRecv(recv_id, std::move(cancel));
+    break;
+  }
+  default:
+    LOG(WARNING) << "unexpected frame type: " << static_cast<int>(frame.type);
+    break;
+  }
+}
+
+void SocketLinkServer::ProcessDataFrames(DataHandler data_handler,
+                                         std::shared_ptr<Connection> conn) {
+  do {
+    SocketFrame frame;
+    conn->data_queue.wait_and_pop(frame);
+    if (conn->closed.load()) {
+      break;
+    }
+    uint64_t seq_no = frame.seq_no;
+    std::string key = frame.key;
+    data_handler(frame.meta, frame.key, std::move(frame.data),
+                 frame.compress_type, [conn, seq_no, key](retcode ret) {
+      std::string msg_info;
+      if (ret != retcode::SUCCESS) {
+        msg_info = "process received data encountes error";
+      }
+      conn->Write(SocketFrame::ACK, ret, seq_no, key, msg_info);
+    });
+  } while (true);
+}
+
+void SocketLinkServer::RunWorker(const char* name,
+                                 std::function<void()> func) {
+  for (auto it = workers_.begin(); it != workers_.end();) {
+    if (it->done->load()) {
+      it->thread.join();
+      it = workers_.erase(it);
+    } else {
+      ++it;
+    }
+  }
+  auto done = std::make_shared<std::atomic<bool>>(false);
+  std::thread worker([name, done, func = std::move(func)]() {
+    SET_THREAD_NAME(name);
+    func();
+    done->store(true);
+  });
+  workers_.push_back(Worker{std::move(worker), std::move(done)});
+}
+
+void SocketLinkServer::CloseConnection(int fd) {
+  auto it = connections_.find(fd);
+  if (it == connections_.end()) {
+    return;
+  }
+  epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, fd, nullptr);
+  it->second->Close();
+  connections_.erase(it);
+}
+}  // namespace primihub::network
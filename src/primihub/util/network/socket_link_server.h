@@ -0,0 +1,147 @@
+/*
+* Copyright (c) 2023 by PrimiHub
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      https://www.apache.org/licenses/
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#ifndef SRC_PRIMIHUB_UTIL_NETWORK_SOCKET_LINK_SERVER_H_
+#define SRC_PRIMIHUB_UTIL_NETWORK_SOCKET_LINK_SERVER_H_
+#include <atomic>
+#include <functional>
+#include <future>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+
+#include "src/primihub/common/common.h"
+#include "src/primihub/util/threadsafe_queue.h"
+#include "src/primihub/util/network/socket_frame.h"
+
+namespace primihub::network {
+/**
+ * epoll based tcp server for raw socket link,
+ * DATA frames of one connection are handled in order by data_handler
+ * and acked when data_handler calls back, which may be later and in
+ * another thread, so that a slow key holds back its own sender only.
+ * RECV frames park a pop by recv_handler and are answered with DATA frame
+ * when data is available, parked pops are cancelled when the connection
+ * is closed, so no payload is popped for a dead peer.
+ * the link is plaintext only, frames are neither encrypted nor
+ * authenticated, so it is not served when tls is configured
+*/
+class SocketLinkServer {
+ public:
+  /**
+   * ack the DATA frame with result, must be called exactly once
+  */
+  using AckCallback = std::function<void(retcode ret)>;
+  /**
+   * meta: serialized task info carried by the first frame of connection
+   * compress_type: value of rpc::CompressType applied to data by peer
+  */
+  using DataHandler = std::function<void(const std::string& meta,
+                                         const std::string& key,
+                                         std::string&& data,
+                                         uint8_t compress_type,
+                                         AckCallback ack)>;
+  using RecvCallback = std::function<void(retcode ret, std::string&& data)>;
+  /**
+   * return true if RecvCallback will never be invoked
+  */
+  using CancelFunc = std::function<bool()>;
+  /**
+   * park a pop of data for key without blocking, done is invoked exactly
+   * once, maybe in place or in another thread, unless the returned
+   * CancelFunc returns true
+  */
+  using RecvHandler = std::function<CancelFunc(const std::string& meta,
+                                               const std::string& key,
+                                               RecvCallback done)>;
+  SocketLinkServer(DataHandler data_handler, RecvHandler recv_handler);
+  ~SocketLinkServer();
+  /**
+   * listen on ip:port, port 0 means choose by system
+  */
+  retcode Start(const std::string& ip, uint16_t port);
+  /**
+   * close connections and join all threads started by server
+  */
+  void Stop();
+  uint16_t Port() const {return port_;}
+
+ protected:
+  struct Connection {
+    explicit Connection(int conn_fd) : fd(conn_fd) {}
+    ~Connection();
+    retcode Write(SocketFrame::FrameType type, retcode ret_code,
+                  uint64_t seq_no, const std::string& key,
+                  std::string_view data);
+    void Close();
+    /**
+     * reserve a slot for pop which is being parked by recv_handler
+    */
+    uint64_t StartRecv();
+    /**
+     * keep cancel of parked pop until it is done or connection is closed,
+     * pop is cancelled at once if connection has been closed
+    */
+    void ParkRecv(uint64_t recv_id, CancelFunc cancel);
+    void FinishRecv(uint64_t recv_id);
+    int fd{-1};
+    SocketFrameDecoder decoder;
+    std::string meta;
+    std::mutex write_mtx;
+    ThreadSafeQueue<SocketFrame> data_queue;
+    std::atomic<bool> closed{false};
+    std::mutex recv_mtx;
+    uint64_t recv_id{0};
+    // key: recv id, value: cancel of parked pop, empty while parking
+    std::unordered_map<uint64_t, CancelFunc> pending_recv;
+  };
+  void EventLoop();
+  void AcceptConnections();
+  retcode ReadConnection(std::shared_ptr<Connection> conn);
+  void DispatchFrame(std::shared_ptr<Connection> conn, SocketFrame&& frame);
+  void CloseConnection(int fd);
+  /**
+   * run func in a worker thread joined by Stop,
+   * finished workers are joined on the way
+  */
+  void RunWorker(const char* name, std::function<void()> func);
+  // process DATA frames of connection in order
+  static void ProcessDataFrames(DataHandler data_handler,
+                                std::shared_ptr<Connection> conn);
+
+ private:
+  DataHandler data_handler_;
+  RecvHandler recv_handler_;
+  int listen_fd_{-1};
+  int epoll_fd_{-1};
+  int wakeup_fd_{-1};
+  uint16_t port_{0};
+  std::atomic<bool> stop_{false};
+  std::future<void> loop_fut_;
+  std::unordered_map<int, std::shared_ptr<Connection>> connections_;
+  std::string read_buf_;
+  struct Worker {
+    std::thread thread;
+    std::shared_ptr<std::atomic<bool>> done;
+  };
+  // data workers started by event loop only, joined by Stop after loop ends
+  std::list<Worker> workers_;
+};
+}  // namespace primihub::network
+#endif  // SRC_PRIMIHUB_UTIL_NETWORK_SOCKET_LINK_SERVER_H_
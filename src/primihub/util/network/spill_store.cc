@@ -0,0 +1,116 @@
+/*
+* Copyright (c) 2023 by PrimiHub
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      https://www.apache.org/licenses/
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#include "src/primihub/util/network/spill_store.h"
+#include <glog/logging.h>
+#include <unistd.h>
+#include <fstream>
+#include <random>
+#include <sstream>
+#include <utility>
+
+#include "src/primihub/util/file_util.h"
+
+namespace primihub::network {
+namespace {
+constexpr char kPlaceholderMagic[] = "PHSPILL:";
+}  // namespace
+
+SpillStore::SpillStore(const std::string& spill_dir) : spill_dir_(spill_dir) {
+  // random nonce makes placeholder distinguishable from real payload
+  std::random_device rd;
+  std::stringstream ss;
+  ss << kPlaceholderMagic << std::hex << getpid() << "_"
+     << (static_cast<uint64_t>(rd()) << 32 | rd()) << "_";
+  prefix_ = ss.str();
+}
+
+SpillStore::~SpillStore() {
+  std::lock_guard<std::mutex> lck(mtx_);
+  for (const auto& [placeholder, file_path] : spilled_files_) {
+    RemoveFile(file_path);
+  }
+  spilled_files_.clear();
+}
+
+retcode SpillStore::Spill(std::string* data) {
+  uint64_t spill_id = spill_id_.fetch_add(1);
+  std::string placeholder = prefix_ + std::to_string(spill_id);
+  std::string file_path = spill_dir_ + "/" +
+      placeholder.substr(sizeof(kPlaceholderMagic) - 1) + ".spill";
+  if (ValidateDir(file_path) != 0) {
+    LOG(ERROR) << "create spill dir: " << spill_dir_ << " failed";
+    return retcode::FAIL;
+  }
+  std::ofstream fout(file_path, std::ios::binary | std::ios::trunc);
+  if (!fout) {
+    LOG(ERROR) << "open spill file: " << file_path << " failed";
+    return retcode::FAIL;
+  }
+  fout.write(data->data(), data->size());
+  fout.close();
+  if (!fout) {
+    LOG(ERROR) << "write spill file: " << file_path << " failed";
+    RemoveFile(file_path);
+    return retcode::FAIL;
+  }
+  spilled_bytes_.fetch_add(data->size());
+  {
+    std::lock_guard<std::mutex> lck(mtx_);
+    spilled_files_[placeholder] = file_path;
+  }
+  VLOG(5) << "spill " << data->size() << " bytes to " << file_path;
+  *data = std::move(placeholder);
+  return retcode::SUCCESS;
+}
+
+bool SpillStore::IsPlaceholder(const std::string& item) {
+  if (item.size() > prefix_.size() + 20 ||
+      item.compare(0, prefix_.size(), prefix_) != 0) {
+    return false;
+  }
+  std::lock_guard<std::mutex> lck(mtx_);
+  return spilled_files_.find(item) != spilled_files_.end();
+}
+
+retcode SpillStore::Load(std::string* item) {
+  std::string file_path;
+  {
+    std::lock_guard<std::mutex> lck(mtx_);
+    auto it = spilled_files_.find(*item);
+    if (it == spilled_files_.end()) {
+      return retcode::FAIL;
+    }
+    file_path = std::move(it->second);
+    spilled_files_.erase(it);
+  }
+  std::string data;
+  int64_t file_size = FileSize(file_path);
+  std::ifstream fin(file_path, std::ios::binary);
+  if (fin) {
+    data.resize(file_size);
+    fin.read(data.data(), file_size);
+  }
+  bool success = fin.good();
+  fin.close();
+  RemoveFile(file_path);
+  if (!success) {
+    LOG(ERROR) << "load spill file: " << file_path << " failed";
+    return retcode::FAIL;
+  }
+  *item = std::move(data);
+  return retcode::SUCCESS;
+}
+}  // namespace primihub::network
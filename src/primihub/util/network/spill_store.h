@@ -0,0 +1,60 @@
+/*
+* Copyright (c) 2023 by PrimiHub
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      https://www.apache.org/licenses/
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#ifndef SRC_PRIMIHUB_UTIL_NETWORK_SPILL_STORE_H_
+#define SRC_PRIMIHUB_UTIL_NETWORK_SPILL_STORE_H_
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include "src/primihub/common/common.h"
+
+namespace primihub::network {
+/**
+ * keep received payload on local disk instead of memory.
+ * spilled payload is represented in recv queue by a placeholder
+ * which is replaced by the payload when it is popped,
+ * files which are never popped are removed when store is destroyed
+*/
+class SpillStore {
+ public:
+  explicit SpillStore(const std::string& spill_dir);
+  ~SpillStore();
+  /**
+   * write data to file, data is replaced by its placeholder on success
+  */
+  retcode Spill(std::string* data);
+  /**
+   * true if item is placeholder created by this store
+  */
+  bool IsPlaceholder(const std::string& item);
+  /**
+   * replace placeholder by the spilled payload and remove the file
+  */
+  retcode Load(std::string* item);
+  uint64_t spilled_bytes() const {return spilled_bytes_.load();}
+
+ private:
+  std::string spill_dir_;
+  std::string prefix_;      // placeholder prefix, unique for each store
+  std::atomic<uint64_t> spill_id_{0};
+  std::atomic<uint64_t> spilled_bytes_{0};
+  std::mutex mtx_;
+  // key: placeholder, value: file path
+  std::unordered_map<std::string, std::string> spilled_files_;
+};
+}  // namespace primihub::network
+#endif  // SRC_PRIMIHUB_UTIL_NETWORK_SPILL_STORE_H_
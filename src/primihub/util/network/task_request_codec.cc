@@ -0,0 +1,133 @@
+/*
+* Copyright (c) 2023 by PrimiHub
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      https://www.apache.org/licenses/
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#include "src/primihub/util/network/task_request_codec.h"
+#include <google/protobuf/io/coded_stream.h>
+#include <google/protobuf/io/zero_copy_stream_impl_lite.h>
+#include <google/protobuf/wire_format_lite.h>
+#include <grpcpp/impl/codegen/proto_buffer_reader.h>
+#include <glog/logging.h>
+#include <algorithm>
+
+namespace primihub::network {
+namespace {
+using google::protobuf::internal::WireFormatLite;
+const uint32_t kDataTag = WireFormatLite::MakeTag(
+    rpc::TaskRequest::kDataFieldNumber,
+    WireFormatLite::WIRETYPE_LENGTH_DELIMITED);
+}  // namespace
+
+retcode BuildTaskRequestChunks(const rpc::TaskContext& task_info,
+                               const std::string& key,
+                               std::string_view data,
+                               std::vector<grpc::ByteBuffer>* chunks,
+                               rpc::CompressType compress_type) {
+  size_t max_package_size = LIMITED_PACKAGE_SIZE;
+  size_t total_length = data.size();
+  size_t sended_size = 0;
+  chunks->reserve(total_length / max_package_size + 1);
+  do {
+    size_t data_len = std::min(max_package_size, total_length - sended_size);
+    std::string header_buf;
+    if (sended_size == 0) {
+      rpc::TaskRequest header;
+      header.mutable_task_info()->CopyFrom(task_info);
+      header.set_role(key);
+      header.set_data_len(total_length);
+      header.set_compress_type(compress_type);
+      header.SerializeToString(&header_buf);
+    }
+    {
+      google::protobuf::io::StringOutputStream output(&header_buf);
+      google::protobuf::io::CodedOutputStream coded_output(&output);
+      coded_output.WriteTag(kDataTag);
+      coded_output.WriteVarint32(static_cast<uint32_t>(data_len));
+    }
+    grpc::Slice slices[2] = {
+      grpc::Slice(header_buf),
+      grpc::Slice(data.data() + sended_size, data_len,
+                  grpc::Slice::STATIC_SLICE),
+    };
+    size_t slice_num = data_len > 0 ? 2 : 1;
+    chunks->emplace_back(slices, slice_num);
+    sended_size += data_len;
+  } while (sended_size < total_length);
+  return retcode::SUCCESS;
+}
+
+retcode TaskRequestAssembler::Feed(grpc::ByteBuffer* chunk) {
+  grpc::ProtoBufferReader reader(chunk);
+  google::protobuf::io::CodedInputStream input(&reader);
+  // fields except data are collected and parsed as header
+  std::string header_buf;
+  google::protobuf::io::StringOutputStream header_output(&header_buf);
+  google::protobuf::io::CodedOutputStream header_stream(&header_output);
+  do {
+    uint32_t tag = input.ReadTag();
+    if (tag == 0) {
+      break;
+    }
+    if (tag != kDataTag) {
+      if (!WireFormatLite::SkipField(&input, tag, &header_stream)) {
+        LOG(ERROR) << "decode TaskRequest field failed, tag: " << tag;
+        return retcode::FAIL;
+      }
+      continue;
+    }
+    header_stream.Trim();
+    if (ApplyHeader(header_buf) != retcode::SUCCESS) {
+      return retcode::FAIL;
+    }
+    uint32_t length{0};
+    if (!input.ReadVarint32(&length)) {
+      LOG(ERROR) << "decode length of TaskRequest data failed";
+      return retcode::FAIL;
+    }
+    // copy from received slices into destination directly
+    while (length > 0) {
+      const void* ptr{nullptr};
+      int size{0};
+      if (!input.GetDirectBufferPointer(&ptr, &size)) {
+        LOG(ERROR) << "TaskRequest data is truncated";
+        return retcode::FAIL;
+      }
+      size_t copy_len = std::min<size_t>(size, length);
+      data_.append(reinterpret_cast<const char*>(ptr), copy_len);
+      input.Skip(copy_len);
+      length -= copy_len;
+    }
+  } while (true);
+  header_stream.Trim();
+  return ApplyHeader(header_buf);
+}
+
+retcode TaskRequestAssembler::ApplyHeader(const std::string& header_buf) {
+  // header of the following chunks is ignored
+  if (has_header_ || header_buf.empty()) {
+    return retcode::SUCCESS;
+  }
+  if (!header_.ParseFromString(header_buf)) {
+    LOG(ERROR) << "parse TaskRequest header failed";
+    return retcode::FAIL;
+  }
+  has_header_ = true;
+  data_.reserve(header_.data_len());
+  return retcode::SUCCESS;
+}
+
+bool TaskRequestAssembler::IsComplete() const {
+  return data_.size() == header_.data_len();
+}
+}  // namespace primihub::network
@@ -0,0 +1,71 @@
+/*
+* Copyright (c) 2023 by PrimiHub
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      https://www.apache.org/licenses/
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#ifndef SRC_PRIMIHUB_UTIL_NETWORK_TASK_REQUEST_CODEC_H_
+#define SRC_PRIMIHUB_UTIL_NETWORK_TASK_REQUEST_CODEC_H_
+#include <grpcpp/support/byte_buffer.h>
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "src/primihub/common/common.h"
+#include "src/primihub/protos/worker.pb.h"
+
+namespace primihub::network {
+/**
+ * TaskRequest chunks encoded on grpc::ByteBuffer directly.
+ * payload slice refers to the caller's buffer instead of being copied into
+ * protobuf message, and task header (task_info, role, data_len) is only
+ * carried by the first chunk. wire format is still TaskRequest,
+ * so peers decoding with protobuf are not affected.
+ * the buffer of data must outlive the rpc which writes the chunks
+ * compress_type: how data has been compressed by sender
+*/
+retcode BuildTaskRequestChunks(
+    const rpc::TaskContext& task_info,
+    const std::string& key,
+    std::string_view data,
+    std::vector<grpc::ByteBuffer>* chunks,
+    rpc::CompressType compress_type = rpc::CompressType::COMPRESS_NONE);
+
+/**
+ * reassemble TaskRequest chunks, payload is appended from received slices
+ * into destination which is preallocated according to data_len of header
+*/
+class TaskRequestAssembler {
+ public:
+  TaskRequestAssembler() = default;
+  retcode Feed(grpc::ByteBuffer* chunk);
+  bool HasHeader() const {return has_header_;}
+  /**
+   * all data declared by data_len of header has been received
+  */
+  bool IsComplete() const;
+  const rpc::TaskContext& task_info() const {return header_.task_info();}
+  const std::string& key() const {return header_.role();}
+  rpc::CompressType compress_type() const {return header_.compress_type();}
+  std::string& data() {return data_;}
+
+ protected:
+  retcode ApplyHeader(const std::string& header_buf);
+
+ private:
+  bool has_header_{false};
+  rpc::TaskRequest header_;
+  std::string data_;
+};
+}  // namespace primihub::network
+#endif  // SRC_PRIMIHUB_UTIL_NETWORK_TASK_REQUEST_CODEC_H_
@@ -0,0 +1,260 @@
+// Copyright [2023] <primihub.com>
+#ifndef SRC_PRIMIHUB_UTIL_RESIDENT_REGISTRY_H_
+#define SRC_PRIMIHUB_UTIL_RESIDENT_REGISTRY_H_
+
+#include <glog/logging.h>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+
+namespace primihub {
+/**
+ * read-only objects shared by sessions of many tasks in one process,
+ * e.g. databases which are expensive to load.
+ * an object is loaded once by the first session which asks for it,
+ * concurrent sessions wait for that load instead of loading again,
+ * and it stays resident after its sessions end.
+ * sessions on one object are limited by max_sessions, a session waits
+ * up to admission_timeout_ms for a free slot.
+ * memory of resident objects is bounded by max_memory_bytes,
+ * idle objects are evicted in lru order to make room, an object which
+ * still does not fit is served to its sessions and dropped afterwards.
+ * 0 means unlimited for both limits.
+*/
+template <typename T>
+class ResidentRegistry {
+ public:
+  using ObjectPtr = std::shared_ptr<T>;
+  using Loader = std::function<ObjectPtr(const std::string& key)>;
+  struct Options {
+    uint64_t max_memory_bytes{0};
+    uint32_t max_sessions{0};
+    // negative means waiting forever
+    int32_t admission_timeout_ms{30000};
+  };
+  struct Stats {
+    size_t resident_count{0};
+    uint64_t memory_bytes{0};
+    uint64_t hits{0};
+    uint64_t loads{0};
+    uint64_t evictions{0};
+    uint64_t rejected{0};
+  };
+
+  /**
+   * admission of one session, object is kept alive and its slot is held
+   * until the session is destroyed
+  */
+  class Session {
+   public:
+    ~Session() {
+      registry_->Release(key_);
+    }
+    const ObjectPtr& object() const {return object_;}
+
+   private:
+    friend class ResidentRegistry;
+    Session(ResidentRegistry* registry, std::string key, ObjectPtr object) :
+        registry_(registry), key_(std::move(key)), object_(std::move(object)) {}
+    ResidentRegistry* registry_;
+    std::string key_;
+    ObjectPtr object_;
+  };
+
+  explicit ResidentRegistry(Loader loader) : loader_(std::move(loader)) {}
+
+  void Configure(const Options& options) {
+    std::lock_guard<std::mutex> lck(mtx_);
+    options_ = options;
+  }
+
+  /**
+   * memory_bytes is the estimated memory of object, used when it is loaded.
+   * return nullptr if admission timeout or object can not be loaded
+  */
+  std::unique_ptr<Session> Acquire(const std::string& key,
+                                   uint64_t memory_bytes) {
+    std::unique_lock<std::mutex> lck(mtx_);
+    auto deadline = std::chrono::steady_clock::now() +
+                    std::chrono::milliseconds(options_.admission_timeout_ms);
+    for (;;) {
+      auto it = entries_.find(key);
+      if (it == entries_.end()) {
+        return Load(key, memory_bytes, &lck);
+      }
+      auto& entry = it->second;
+      if (options_.max_sessions == 0 ||
+          entry.sessions < options_.max_sessions) {
+        entry.sessions++;
+        entry.last_used = ++tick_;
+        stats_.hits++;
+        auto object_fut = entry.object;
+        lck.unlock();
+        // wait for the load started by another session
+        return CreateSession(key, object_fut.get());
+      }
+      if (options_.admission_timeout_ms < 0) {
+        cv_.wait(lck);
+      } else if (cv_.wait_until(lck, deadline) == std::cv_status::timeout) {
+        stats_.rejected++;
+        LOG(ERROR) << "admission of: " << key << " timeout, "
+                   << "max sessions: " << options_.max_sessions;
+        return nullptr;
+      }
+    }
+  }
+
+  /**
+   * load object ahead of sessions
+  */
+  bool Preload(const std::string& key, uint64_t memory_bytes) {
+    return Acquire(key, memory_bytes) != nullptr;
+  }
+
+  /**
+   * drop object of key, e.g. its source has been rebuilt.
+   * it is erased at once if idle, otherwise after its sessions end
+  */
+  void Drop(const std::string& key) {
+    std::lock_guard<std::mutex> lck(mtx_);
+    auto it = entries_.find(key);
+    if (it == entries_.end()) {
+      return;
+    }
+    if (it->second.sessions != 0) {
+      it->second.resident = false;
+      return;
+    }
+    memory_bytes_ -= it->second.memory_bytes;
+    entries_.erase(it);
+    stats_.evictions++;
+  }
+
+  Stats stats() const {
+    std::lock_guard<std::mutex> lck(mtx_);
+    auto s = stats_;
+    s.memory_bytes = memory_bytes_;
+    s.resident_count = 0;
+    for (const auto& [key, entry] : entries_) {
+      if (entry.resident) {
+        s.resident_count++;
+      }
+    }
+    return s;
+  }
+
+ protected:
+  struct Entry {
+    std::shared_future<ObjectPtr> object;
+    uint64_t memory_bytes{0};
+    uint32_t sessions{0};
+    uint64_t last_used{0};
+    bool resident{true};
+  };
+
+  std::unique_ptr<Session> Load(const std::string& key, uint64_t memory_bytes,
+                                std::unique_lock<std::mutex>* lck) {
+    EvictIdle(memory_bytes);
+    std::promise<ObjectPtr> promise;
+    Entry entry;
+    entry.object = promise.get_future().share();
+    entry.memory_bytes = memory_bytes;
+    entry.sessions = 1;
+    entry.last_used = ++tick_;
+    entry.resident = options_.max_memory_bytes == 0 ||
+        memory_bytes_ + memory_bytes <= options_.max_memory_bytes;
+    if (!entry.resident) {
+      LOG(WARNING) << "memory of: " << key << " exceeds resident budget, "
+                   << "it is dropped after its sessions end";
+    }
+    memory_bytes_ += memory_bytes;
+    stats_.loads++;
+    entries_.emplace(key, std::move(entry));
+    lck->unlock();
+    ObjectPtr object{nullptr};
+    try {
+      object = loader_(key);
+    } catch (std::exception& e) {
+      LOG(ERROR) << "load: " << key << " failed, " << e.what();
+    }
+    promise.set_value(object);
+    return CreateSession(key, std::move(object));
+  }
+
+  std::unique_ptr<Session> CreateSession(const std::string& key,
+                                         ObjectPtr object) {
+    if (object == nullptr) {
+      Release(key);
+      return nullptr;
+    }
+    return std::unique_ptr<Session>(new Session(this, key, std::move(object)));
+  }
+
+  void Release(const std::string& key) {
+    {
+      std::lock_guard<std::mutex> lck(mtx_);
+      auto it = entries_.find(key);
+      if (it == entries_.end()) {
+        return;
+      }
+      auto& entry = it->second;
+      entry.sessions--;
+      entry.last_used = ++tick_;
+      if (entry.sessions == 0 &&
+          (!entry.resident || entry.object.get() == nullptr)) {
+        memory_bytes_ -= entry.memory_bytes;
+        entries_.erase(it);
+      }
+    }
+    cv_.notify_all();
+  }
+
+  /**
+   * evict idle resident objects in lru order until memory_bytes fits,
+   * caller holds the lock
+  */
+  void EvictIdle(uint64_t memory_bytes) {
+    if (options_.max_memory_bytes == 0) {
+      return;
+    }
+    while (memory_bytes_ + memory_bytes > options_.max_memory_bytes) {
+      auto victim = entries_.end();
+      for (auto it = entries_.begin(); it != entries_.end(); ++it) {
+        if (it->second.sessions != 0) {
+          continue;
+        }
+        if (victim == entries_.end() ||
+            it->second.last_used < victim->second.last_used) {
+          victim = it;
+        }
+      }
+      if (victim == entries_.end()) {
+        return;
+      }
+      VLOG(5) << "evict: " << victim->first << " "
+              << "memory: " << victim->second.memory_bytes;
+      memory_bytes_ -= victim->second.memory_bytes;
+      entries_.erase(victim);
+      stats_.evictions++;
+    }
+  }
+
+ private:
+  Loader loader_;
+  Options options_;
+  std::map<std::string, Entry> entries_;
+  uint64_t memory_bytes_{0};
+  uint64_t tick_{0};
+  Stats stats_;
+  mutable std::mutex mtx_;
+  std::condition_variable cv_;
+};
+}  // namespace primihub
+#endif  // SRC_PRIMIHUB_UTIL_RESIDENT_REGISTRY_H_
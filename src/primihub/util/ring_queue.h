@@ -0,0 +1,471 @@
+// Copyright [2023] <primihub.com>
+#ifndef SRC_PRIMIHUB_UTIL_RING_QUEUE_H_
+#define SRC_PRIMIHUB_UTIL_RING_QUEUE_H_
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace primihub {
+enum class QueueStatus {
+  kOk = 0,
+  kTimeout,     // nothing happened before timeout
+  kCancelled,   // cancel flag of caller is set
+  kClosed,      // queue is shutdown, pop fails only after drained
+};
+
+namespace internal {
+constexpr size_t kCacheLineSize = 64;
+
+inline size_t RoundUpPowerOfTwo(size_t n) {
+  size_t capacity = 2;
+  while (capacity < n) {
+    capacity <<= 1;
+  }
+  return capacity;
+}
+
+/**
+ * block waiters on condition variable only when the queue is empty or full,
+ * notifier skips the mutex when nobody is waiting,
+ * so uncontended push/pop stays lock-free
+*/
+class WaitNotifier {
+ public:
+  static constexpr int kSpinCount = 64;
+  /**
+   * wait until ready() returns true, timeout_ms < 0 means waiting forever.
+   * return the last result of ready()
+  */
+  template <typename Pred>
+  bool Wait(Pred ready, int32_t timeout_ms) {
+    // the other side is usually about to make progress,
+    // spin a little before parking on the condition variable
+    for (int i = 0; i < kSpinCount; i++) {
+      if (ready()) {
+        return true;
+      }
+      std::this_thread::yield();
+    }
+    auto deadline = std::chrono::steady_clock::now() +
+                    std::chrono::milliseconds(timeout_ms);
+    std::unique_lock<std::mutex> lck(mtx_);
+    waiters_.fetch_add(1, std::memory_order_seq_cst);
+    bool result{false};
+    if (timeout_ms < 0) {
+      cv_.wait(lck, ready);
+      result = true;
+    } else {
+      result = cv_.wait_until(lck, deadline, ready);
+    }
+    waiters_.fetch_sub(1, std::memory_order_relaxed);
+    return result;
+  }
+
+  void NotifyOne() {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (waiters_.load(std::memory_order_relaxed) == 0) {
+      return;
+    }
+    { std::lock_guard<std::mutex> lck(mtx_); }
+    cv_.notify_one();
+  }
+
+  void NotifyAll() {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (waiters_.load(std::memory_order_relaxed) == 0) {
+      return;
+    }
+    { std::lock_guard<std::mutex> lck(mtx_); }
+    cv_.notify_all();
+  }
+
+ private:
+  std::atomic<uint32_t> waiters_{0};
+  std::mutex mtx_;
+  std::condition_variable cv_;
+};
+
+/**
+ * single producer single consumer ring,
+ * batch operation publishes all items with one index update
+*/
+template <typename T>
+class SpscRing {
+ public:
+  using value_type = T;
+  explicit SpscRing(size_t capacity) :
+      mask_(RoundUpPowerOfTwo(capacity) - 1), slots_(mask_ + 1) {}
+
+  size_t capacity() const {return mask_ + 1;}
+  size_t size() const {
+    return tail_.load(std::memory_order_acquire) -
+           head_.load(std::memory_order_acquire);
+  }
+
+  template <typename U>
+  bool try_push(U&& item) {
+    size_t tail = tail_.load(std::memory_order_relaxed);
+    if (tail - head_cache_ > mask_) {
+      head_cache_ = head_.load(std::memory_order_acquire);
+      if (tail - head_cache_ > mask_) {
+        return false;
+      }
+    }
+    slots_[tail & mask_] = std::forward<U>(item);
+    tail_.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+  /**
+   * move up to count items, return the number of items pushed
+  */
+  size_t try_push_batch(T* items, size_t count) {
+    size_t tail = tail_.load(std::memory_order_relaxed);
+    size_t free_slots = capacity() - (tail - head_cache_);
+    if (free_slots < count) {
+      head_cache_ = head_.load(std::memory_order_acquire);
+      free_slots = capacity() - (tail - head_cache_);
+    }
+    size_t n = count < free_slots ? count : free_slots;
+    for (size_t i = 0; i < n; i++) {
+      slots_[(tail + i) & mask_] = std::move(items[i]);
+    }
+    if (n > 0) {
+      tail_.store(tail + n, std::memory_order_release);
+    }
+    return n;
+  }
+
+  bool try_pop(T& item) {
+    size_t head = head_.load(std::memory_order_relaxed);
+    if (head == tail_cache_) {
+      tail_cache_ = tail_.load(std::memory_order_acquire);
+      if (head == tail_cache_) {
+        return false;
+      }
+    }
+    item = std::move(slots_[head & mask_]);
+    head_.store(head + 1, std::memory_order_release);
+    return true;
+  }
+
+  /**
+   * append up to max_count items, return the number of items popped
+  */
+  size_t try_pop_batch(std::vector<T>* items, size_t max_count) {
+    size_t head = head_.load(std::memory_order_relaxed);
+    if (tail_cache_ - head < max_count) {
+      tail_cache_ = tail_.load(std::memory_order_acquire);
+    }
+    size_t available = tail_cache_ - head;
+    size_t n = max_count < available ? max_count : available;
+    for (size_t i = 0; i < n; i++) {
+      items->push_back(std::move(slots_[(head + i) & mask_]));
+    }
+    if (n > 0) {
+      head_.store(head + n, std::memory_order_release);
+    }
+    return n;
+  }
+
+ private:
+  const size_t mask_;
+  std::vector<T> slots_;
+  // consumer side
+  alignas(kCacheLineSize) std::atomic<size_t> head_{0};
+  size_t tail_cache_{0};
+  // producer side
+  alignas(kCacheLineSize) std::atomic<size_t> tail_{0};
+  size_t head_cache_{0};
+};
+
+/**
+ * multiple producer multiple consumer ring,
+ * each slot carries a sequence number telling whether it is ready
+ * for producer or consumer, so threads only contend on the cursor
+*/
+template <typename T>
+class MpmcRing {
+ public:
+  using value_type = T;
+  explicit MpmcRing(size_t capacity) :
+      mask_(RoundUpPowerOfTwo(capacity) - 1),
+      cells_(new Cell[mask_ + 1]) {
+    for (size_t i = 0; i <= mask_; i++) {
+      cells_[i].seq.store(i, std::memory_order_relaxed);
+    }
+  }
+
+  size_t capacity() const {return mask_ + 1;}
+  size_t size() const {
+    size_t tail = tail_.load(std::memory_order_acquire);
+    size_t head = head_.load(std::memory_order_acquire);
+    return tail > head ? tail - head : 0;
+  }
+
+  template <typename U>
+  bool try_push(U&& item) {
+    size_t pos = tail_.load(std::memory_order_relaxed);
+    Cell* cell{nullptr};
+    while (true) {
+      cell = &cells_[pos & mask_];
+      size_t seq = cell->seq.load(std::memory_order_acquire);
+      intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+      if (diff == 0) {
+        if (tail_.compare_exchange_weak(pos, pos + 1,
+                                        std::memory_order_relaxed)) {
+          break;
+        }
+      } else if (diff < 0) {
+        return false;   // full
+      } else {
+        pos = tail_.load(std::memory_order_relaxed);
+      }
+    }
+    cell->data = std::forward<U>(item);
+    cell->seq.store(pos + 1, std::memory_order_release);
+    return true;
+  }
+
+  size_t try_push_batch(T* items, size_t count) {
+    size_t n = 0;
+    while (n < count && try_push(std::move(items[n]))) {
+      n++;
+    }
+    return n;
+  }
+
+  bool try_pop(T& item) {
+    size_t pos = head_.load(std::memory_order_relaxed);
+    Cell* cell{nullptr};
+    while (true) {
+      cell = &cells_[pos & mask_];
+      size_t seq = cell->seq.load(std::memory_order_acquire);
+      intptr_t diff =
+          static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos + 1);
+      if (diff == 0) {
+        if (head_.compare_exchange_weak(pos, pos + 1,
+                                        std::memory_order_relaxed)) {
+          break;
+        }
+      } else if (diff < 0) {
+        return false;   // empty
+      } else {
+        pos = head_.load(std::memory_order_relaxed);
+      }
+    }
+    item = std::move(cell->data);
+    cell->seq.store(pos + mask_ + 1, std::memory_order_release);
+    return true;
+  }
+
+  size_t try_pop_batch(std::vector<T>* items, size_t max_count) {
+    size_t n = 0;
+    T item;
+    while (n < max_count && try_pop(item)) {
+      items->push_back(std::move(item));
+      n++;
+    }
+    return n;
+  }
+
+ private:
+  struct Cell {
+    std::atomic<size_t> seq;
+    T data;
+  };
+  const size_t mask_;
+  std::unique_ptr<Cell[]> cells_;
+  alignas(kCacheLineSize) std::atomic<size_t> head_{0};
+  alignas(kCacheLineSize) std::atomic<size_t> tail_{0};
+};
+}  // namespace internal
+
+/**
+ * bounded lock-free queue with blocking, timed and cancellable waits.
+ * producer waits when the queue is full, consumer waits when it is empty.
+ * cancel: optional flag of caller checked while waiting,
+ *         caller sets it and calls interrupt() to wake up the waiter.
+ * shutdown wakes up all waiters, following push fails,
+ * pop fails after remaining items are drained.
+ * T must be default constructible and movable
+*/
+template <typename Ring>
+class BlockingRingQueue {
+ public:
+  using T = typename Ring::value_type;
+  static constexpr size_t kDefaultCapacity = 1024;
+  explicit BlockingRingQueue(size_t capacity = kDefaultCapacity) :
+      ring_(capacity) {}
+  ~BlockingRingQueue() {
+    shutdown();
+  }
+  BlockingRingQueue(const BlockingRingQueue&) = delete;
+  BlockingRingQueue& operator=(const BlockingRingQueue&) = delete;
+
+  size_t capacity() const {return ring_.capacity();}
+  size_t size() const {return ring_.size();}
+  bool empty() const {return ring_.size() == 0;}
+  bool closed() const {return closed_.load(std::memory_order_acquire);}
+
+  template <typename U>
+  bool try_push(U&& item) {
+    if (closed()) {
+      return false;
+    }
+    if (!ring_.try_push(std::forward<U>(item))) {
+      return false;
+    }
+    not_empty_.NotifyOne();
+    return true;
+  }
+
+  bool try_pop(T& item) {
+    if (!ring_.try_pop(item)) {
+      return false;
+    }
+    not_full_.NotifyOne();
+    return true;
+  }
+
+  QueueStatus push(T&& item, int32_t timeout_ms = -1,
+                   const std::atomic<bool>* cancel = nullptr) {
+    bool pushed{false};
+    auto status = WaitFor(&not_full_, timeout_ms, cancel, [&]() {
+      pushed = pushed || ring_.try_push(std::move(item));
+      return pushed;
+    });
+    if (status == QueueStatus::kOk) {
+      not_empty_.NotifyOne();
+    }
+    return status;
+  }
+
+  QueueStatus push(const T& item, int32_t timeout_ms = -1,
+                   const std::atomic<bool>* cancel = nullptr) {
+    T copied = item;
+    return push(std::move(copied), timeout_ms, cancel);
+  }
+
+  QueueStatus pop(T* item, int32_t timeout_ms = -1,
+                  const std::atomic<bool>* cancel = nullptr) {
+    bool popped{false};
+    auto status = WaitFor(&not_empty_, timeout_ms, cancel, [&]() {
+      popped = popped || ring_.try_pop(*item);
+      return popped;
+    }, true);
+    if (status == QueueStatus::kOk) {
+      not_full_.NotifyOne();
+    }
+    return status;
+  }
+
+  /**
+   * push all items in order, waiting for free slots as needed.
+   * items are moved from, pushed_count reports progress on failure
+  */
+  QueueStatus push_batch(std::vector<T>* items, int32_t timeout_ms = -1,
+                         const std::atomic<bool>* cancel = nullptr,
+                         size_t* pushed_count = nullptr) {
+    size_t pushed = 0;
+    size_t total = items->size();
+    auto status = WaitFor(&not_full_, timeout_ms, cancel, [&]() {
+      size_t n = ring_.try_push_batch(items->data() + pushed, total - pushed);
+      if (n > 0) {
+        pushed += n;
+        not_empty_.NotifyAll();
+      }
+      return pushed == total;
+    });
+    if (pushed_count != nullptr) {
+      *pushed_count = pushed;
+    }
+    return status;
+  }
+
+  /**
+   * wait until at least one item is available,
+   * then append up to max_count items
+  */
+  QueueStatus pop_batch(std::vector<T>* items, size_t max_count,
+                        int32_t timeout_ms = -1,
+                        const std::atomic<bool>* cancel = nullptr) {
+    size_t popped = 0;
+    auto status = WaitFor(&not_empty_, timeout_ms, cancel, [&]() {
+      popped += ring_.try_pop_batch(items, max_count - popped);
+      return popped > 0;
+    }, true);
+    if (popped > 0) {
+      not_full_.NotifyAll();
+    }
+    return status;
+  }
+
+  /**
+   * wake up waiters to check their cancel flag
+  */
+  void interrupt() {
+    not_empty_.NotifyAll();
+    not_full_.NotifyAll();
+  }
+
+  void shutdown() {
+    closed_.store(true, std::memory_order_release);
+    interrupt();
+  }
+
+ protected:
+  /**
+   * drain: closed queue still serves remaining items
+  */
+  template <typename Op>
+  QueueStatus WaitFor(internal::WaitNotifier* notifier, int32_t timeout_ms,
+                      const std::atomic<bool>* cancel, Op op,
+                      bool drain = false) {
+    QueueStatus status{QueueStatus::kOk};
+    auto ready = [&]() {
+      if (!drain && closed()) {
+        status = QueueStatus::kClosed;
+        return true;
+      }
+      if (op()) {
+        status = QueueStatus::kOk;
+        return true;
+      }
+      if (closed()) {
+        status = QueueStatus::kClosed;
+        return true;
+      }
+      if (cancel != nullptr && cancel->load(std::memory_order_acquire)) {
+        status = QueueStatus::kCancelled;
+        return true;
+      }
+      return false;
+    };
+    if (!notifier->Wait(ready, timeout_ms)) {
+      return QueueStatus::kTimeout;
+    }
+    return status;
+  }
+
+ private:
+  Ring ring_;
+  std::atomic<bool> closed_{false};
+  internal::WaitNotifier not_empty_;
+  internal::WaitNotifier not_full_;
+};
+
+template <typename T>
+using SpscRingQueue = BlockingRingQueue<internal::SpscRing<T>>;
+template <typename T>
+using MpmcRingQueue = BlockingRingQueue<internal::MpmcRing<T>>;
+}  // namespace primihub
+#endif  // SRC_PRIMIHUB_UTIL_RING_QUEUE_H_
@@ -6,11 +6,39 @@
 #include <mutex>
 #include <condition_variable>
 #include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <utility>
+#include <vector>
 
 namespace primihub {
 template<typename T>
 class ThreadSafeQueue {
  public:
+  /**
+   * ok is false when queue is shutdown or destroyed before item arrived
+  */
+  using PopCallback = std::function<void(bool ok, T&& item)>;
+  /**
+   * invoked outside of the lock for every item leaving the queue,
+   * return false if item can not be delivered, then the pop fails
+  */
+  using PopHook = std::function<bool(T& item)>;
+  ThreadSafeQueue() = default;
+  ~ThreadSafeQueue() {
+    shutdown();
+  }
+
+  /**
+   * e.g. release memory budget held by the item,
+   * must be set before the queue is shared with other threads
+  */
+  void set_pop_hook(PopHook hook) {
+    m_pop_hook = std::move(hook);
+  }
+
   void push(const T& item) {
     emplace(item);
   }
@@ -22,11 +50,62 @@ class ThreadSafeQueue {
   template<typename... Args>
   void emplace(Args&&... args) {
     std::unique_lock<std::mutex> lock(m_mutex);
+    if (!m_waiters.empty()) {
+      // hand over to the oldest parked callback
+      auto callback = std::move(m_waiters.front().second);
+      m_waiters.pop_front();
+      lock.unlock();
+      T item(std::forward<Args>(args)...);
+      bool ok = on_pop(item);
+      callback(ok, std::move(item));
+      return;
+    }
     m_queue.emplace(std::forward<Args>(args)...);
     lock.unlock();
     m_cv.notify_one();
   }
 
+  /**
+   * pop without blocking the caller, callback is invoked immediately
+   * if item is available, otherwise it is parked and invoked by the thread
+   * which pushes the next item, so callback must not block.
+   * return id of the parked callback which can be used to cancel it
+  */
+  uint64_t async_pop(PopCallback callback) {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    uint64_t id = ++m_waiter_id;
+    if (stop_.load()) {
+      lock.unlock();
+      callback(false, T());
+      return id;
+    }
+    if (!m_queue.empty()) {
+      T item = std::move(m_queue.front());
+      m_queue.pop();
+      lock.unlock();
+      bool ok = on_pop(item);
+      callback(ok, std::move(item));
+      return id;
+    }
+    m_waiters.emplace_back(id, std::move(callback));
+    return id;
+  }
+
+  /**
+   * return true if parked callback is removed and will never be invoked,
+   * false if it has been invoked already
+  */
+  bool cancel_async_pop(uint64_t id) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (auto it = m_waiters.begin(); it != m_waiters.end(); ++it) {
+      if (it->first == id) {
+        m_waiters.erase(it);
+        return true;
+      }
+    }
+    return false;
+  }
+
   bool empty() const {
     std::unique_lock<std::mutex> lock(m_mutex);
     return m_queue.empty();
@@ -40,20 +119,75 @@ class ThreadSafeQueue {
 
     popped_value = std::move(m_queue.front());
     m_queue.pop();
-    return true;
+    lock.unlock();
+    return on_pop(popped_value);
   }
 
-  void wait_and_pop(T& popped_value) {
+  /**
+   * return false if shutdown before item arrived or item is rejected
+   * by pop hook
+  */
+  bool wait_and_pop(T& popped_value) {
     std::unique_lock<std::mutex> lock(m_mutex);
     // while (m_queue.empty()) {
     //   m_cv.wait(lock);
     // }
     m_cv.wait(lock, [&]() {return stop_.load() || !m_queue.empty();});
     if (stop_.load()) {
-      return;
+      return false;
+    }
+    popped_value = std::move(m_queue.front());
+    m_queue.pop();
+    lock.unlock();
+    return on_pop(popped_value);
+  }
+
+  /**
+   * timeout_ms < 0 means waiting forever,
+   * return false if timeout or shutdown before item arrived
+   * or item is rejected by pop hook
+  */
+  bool wait_and_pop(T& popped_value, int32_t timeout_ms) {
+    if (timeout_ms < 0) {
+      return wait_and_pop(popped_value);
+    }
+    std::unique_lock<std::mutex> lock(m_mutex);
+    bool ready = m_cv.wait_for(lock, std::chrono::milliseconds(timeout_ms),
+        [&]() {return stop_.load() || !m_queue.empty();});
+    if (!ready || stop_.load()) {
+      return false;
     }
     popped_value = std::move(m_queue.front());
     m_queue.pop();
+    lock.unlock();
+    return on_pop(popped_value);
+  }
+
+  /**
+   * append up to max_count available items without blocking,
+   * items rejected by pop hook are dropped,
+   * return the number of items appended
+  */
+  size_t try_pop_batch(std::vector<T>* items, size_t max_count) {
+    size_t begin = items->size();
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      while (!m_queue.empty() && items->size() - begin < max_count) {
+        items->push_back(std::move(m_queue.front()));
+        m_queue.pop();
+      }
+    }
+    size_t end = begin;
+    for (size_t i = begin; i < items->size(); i++) {
+      if (on_pop((*items)[i])) {
+        if (end != i) {
+          (*items)[end] = std::move((*items)[i]);
+        }
+        end++;
+      }
+    }
+    items->erase(items->begin() + end, items->end());
+    return end - begin;
   }
 
   // Provides only basic exception safety guarantee when RVO is not applied.
@@ -68,16 +202,38 @@ class ThreadSafeQueue {
     }
     auto item = std::move(m_queue.front());
     m_queue.pop();
+    lock.unlock();
+    if (!on_pop(item)) {
+      return T();
+    }
     return item;
   }
 
   void shutdown() {
+    std::unique_lock<std::mutex> lock(m_mutex);
     stop_.store(true);
-    m_cv.notify_one();
+    auto waiters = std::move(m_waiters);
+    m_waiters.clear();
+    lock.unlock();
+    // every blocked consumer must observe the shutdown
+    m_cv.notify_all();
+    for (auto& [id, callback] : waiters) {
+      callback(false, T());
+    }
   }
 
  private:
+  bool on_pop(T& item) {
+    if (m_pop_hook) {
+      return m_pop_hook(item);
+    }
+    return true;
+  }
+
   std::queue<T> m_queue;
+  PopHook m_pop_hook;
+  std::list<std::pair<uint64_t, PopCallback>> m_waiters;
+  uint64_t m_waiter_id{0};
   mutable std::mutex m_mutex;
   std::condition_variable m_cv;
   std::atomic<bool> stop_{false};
@@ -0,0 +1,87 @@
+// Copyright [2023] <primihub.com>
+// query latency and server cpu time of id pir versus database size.
+// usage: id_pir_benchmark <row bytes> <row count> [row count ...]
+#include <sys/resource.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "src/primihub/kernel/pir/operator/id_pir_impl/id_pir_database.h"
+#include "src/primihub/kernel/pir/operator/id_pir_impl/seal_pir.h"
+
+namespace {
+double NowMs() {
+  auto now = std::chrono::steady_clock::now().time_since_epoch();
+  return std::chrono::duration<double, std::milli>(now).count();
+}
+
+double CpuMs() {
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  return (usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1e3 +
+         (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1e3;
+}
+}  // namespace
+
+int main(int argc, char** argv) {
+  using primihub::pir::IdPirDatabase;
+  using primihub::pir::SealPirClient;
+  using primihub::pir::SealPirServer;
+  if (argc < 3) {
+    std::cerr << "usage: " << argv[0]
+              << " <row bytes> <row count> [row count ...]" << std::endl;
+    return 1;
+  }
+  size_t row_bytes = std::strtoull(argv[1], nullptr, 10);
+  size_t thread_num = std::max<size_t>(
+      std::thread::hardware_concurrency() / 2, 1);
+  std::cout << "rows,db_bytes,preprocess_ms,query_ms,answer_ms,"
+            << "answer_cpu_ms,extract_ms,query_bytes,response_bytes"
+            << std::endl;
+  for (int i = 2; i < argc; i++) {
+    size_t row_count = std::strtoull(argv[i], nullptr, 10);
+    std::vector<std::string> rows(row_count);
+    for (size_t j = 0; j < row_count; j++) {
+      rows[j] = std::to_string(j);
+      rows[j].resize(row_bytes, 'x');
+    }
+    auto db = IdPirDatabase::Create(rows);
+    SealPirServer server(*db, thread_num);
+    auto start = NowMs();
+    if (server.Preprocess() != primihub::retcode::SUCCESS) {
+      return 1;
+    }
+    auto preprocess_ms = NowMs() - start;
+    SealPirClient client(db->row_count(), db->row_bytes());
+    std::vector<uint64_t> query_rows{row_count / 2};
+    std::string query;
+    start = NowMs();
+    client.CreateQuery(query_rows, &query);
+    auto query_ms = NowMs() - start;
+    std::string response;
+    auto cpu_start = CpuMs();
+    start = NowMs();
+    if (server.Answer(query, &response) != primihub::retcode::SUCCESS) {
+      return 1;
+    }
+    auto answer_ms = NowMs() - start;
+    auto answer_cpu_ms = CpuMs() - cpu_start;
+    std::vector<std::string> result;
+    start = NowMs();
+    client.ExtractRows(response, query_rows, &result);
+    auto extract_ms = NowMs() - start;
+    if (result.size() != 1 || result[0] != rows[query_rows[0]]) {
+      std::cerr << "wrong result of row: " << query_rows[0] << std::endl;
+      return 1;
+    }
+    std::cout << row_count << "," << db->data().size() << ","
+              << preprocess_ms << "," << query_ms << "," << answer_ms << ","
+              << answer_cpu_ms << "," << extract_ms << "," << query.size()
+              << "," << response.size() << std::endl;
+  }
+  return 0;
+}
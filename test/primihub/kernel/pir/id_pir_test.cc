@@ -0,0 +1,80 @@
+// Copyright [2023] <primihub.com>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "src/primihub/kernel/pir/operator/id_pir_impl/id_pir_database.h"
+#include "src/primihub/kernel/pir/operator/id_pir_impl/seal_pir.h"
+
+namespace primihub::pir {
+namespace {
+std::vector<std::string> MakeRows(size_t row_count, size_t max_size) {
+  std::vector<std::string> rows;
+  for (size_t i = 0; i < row_count; i++) {
+    std::string row = "row_" + std::to_string(i) + "_";
+    row.resize(1 + (i * 7919) % max_size, static_cast<char>('a' + i % 26));
+    rows.push_back(std::move(row));
+  }
+  return rows;
+}
+
+void ExpectSealPirRoundTrip(const std::vector<std::string>& rows,
+                            const std::vector<uint64_t>& query_rows) {
+  auto db = IdPirDatabase::Create(rows);
+  ASSERT_NE(db, nullptr);
+  SealPirServer server(*db, 4);
+  ASSERT_EQ(server.Preprocess(), retcode::SUCCESS);
+  SealPirClient client(db->row_count(), db->row_bytes());
+  std::string query;
+  ASSERT_EQ(client.CreateQuery(query_rows, &query), retcode::SUCCESS);
+  std::string response;
+  ASSERT_EQ(server.Answer(query, &response), retcode::SUCCESS);
+  std::vector<std::string> result;
+  ASSERT_EQ(client.ExtractRows(response, query_rows, &result),
+            retcode::SUCCESS);
+  ASSERT_EQ(result.size(), query_rows.size());
+  for (size_t i = 0; i < query_rows.size(); i++) {
+    EXPECT_EQ(result[i], rows[query_rows[i]]);
+  }
+}
+}  // namespace
+
+TEST(IdPirTest, database_cache) {
+  auto rows = MakeRows(100, 50);
+  auto db = IdPirDatabase::Create(rows);
+  ASSERT_NE(db, nullptr);
+  EXPECT_EQ(db->row_count(), rows.size());
+  EXPECT_EQ(db->row_bytes(), 50);
+  std::string path = "data/cache/id_pir_test_db";
+  ASSERT_EQ(db->Save(path), retcode::SUCCESS);
+  auto loaded = IdPirDatabase::Load(path);
+  ASSERT_NE(loaded, nullptr);
+  EXPECT_EQ(loaded->row_count(), db->row_count());
+  EXPECT_EQ(loaded->row_bytes(), db->row_bytes());
+  for (size_t i = 0; i < rows.size(); i++) {
+    EXPECT_EQ(IdPirDatabase::TrimRow(loaded->Row(i)), rows[i]);
+  }
+  std::remove(path.c_str());
+  EXPECT_EQ(IdPirDatabase::Load(path), nullptr);
+}
+
+TEST(IdPirTest, seal_pir_query) {
+  // many rows share one plaintext
+  ExpectSealPirRoundTrip(MakeRows(3000, 40), {0, 1, 204, 1500, 2999});
+  // one row spans several plaintexts
+  ExpectSealPirRoundTrip(MakeRows(5, 9000), {4, 0, 4});
+  ExpectSealPirRoundTrip(MakeRows(1, 10), {0});
+}
+
+TEST(IdPirTest, seal_pir_reject_invalid_query) {
+  auto db = IdPirDatabase::Create(MakeRows(10, 10));
+  SealPirClient client(db->row_count(), db->row_bytes());
+  std::string query;
+  EXPECT_EQ(client.CreateQuery({10}, &query), retcode::FAIL);
+  SealPirServer server(*db, 1);
+  ASSERT_EQ(server.Preprocess(), retcode::SUCCESS);
+  std::string response;
+  EXPECT_EQ(server.Answer("", &response), retcode::FAIL);
+}
+}  // namespace primihub::pir
@@ -0,0 +1,101 @@
+// Copyright [2023] <primihub.com>
+#include <glog/logging.h>
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "private_set_intersection/cpp/psi_client.h"
+#include "private_set_intersection/cpp/psi_server.h"
+#include "src/primihub/kernel/psi/operator/ecdh_batch_engine.h"
+
+namespace primihub::psi {
+namespace openminded_psi = private_set_intersection;
+namespace {
+std::vector<std::string> BuildInput(size_t start, size_t count) {
+  std::vector<std::string> input;
+  for (size_t i = start; i < start + count; i++) {
+    input.push_back("element_" + std::to_string(i));
+  }
+  return input;
+}
+
+/**
+ * intersection indexes of client elements, computed by engine
+*/
+std::vector<int64_t> RunPsi(EcdhBatchEngine* engine,
+                            const std::vector<std::string>& client_input,
+                            const std::vector<std::string>& server_input) {
+  auto client_key = openminded_psi::PsiClient::CreateWithNewKey(true)
+      .value()->GetPrivateKeyBytes();
+  auto server = openminded_psi::PsiServer::CreateWithNewKey(true).value();
+  auto server_setup = server->CreateSetupMessage(
+      0.0001, client_input.size(), server_input).value();
+  psi_proto::Request request;
+  EXPECT_EQ(engine->CreateRequest(client_key, true, client_input, &request),
+            retcode::SUCCESS);
+  EXPECT_EQ(request.encrypted_elements_size(), client_input.size());
+  psi_proto::Response response;
+  EXPECT_EQ(engine->ProcessRequest(server->GetPrivateKeyBytes(), true,
+                                   request, &response),
+            retcode::SUCCESS);
+  std::vector<int64_t> intersection;
+  EXPECT_EQ(engine->GetIntersection(client_key, true, server_setup, response,
+                                    &intersection),
+            retcode::SUCCESS);
+  return intersection;
+}
+}  // namespace
+
+TEST(EcdhBatchEngineTest, keep_order_of_single_thread) {
+  auto input = BuildInput(0, 5000);
+  auto client_key = openminded_psi::PsiClient::CreateWithNewKey(true)
+      .value()->GetPrivateKeyBytes();
+  EcdhBatchEngine single_engine(1);
+  EcdhBatchEngine multi_engine(4);
+  psi_proto::Request single_request;
+  psi_proto::Request multi_request;
+  ASSERT_EQ(single_engine.CreateRequest(client_key, true, input,
+                                        &single_request),
+            retcode::SUCCESS);
+  ASSERT_EQ(multi_engine.CreateRequest(client_key, true, input,
+                                       &multi_request),
+            retcode::SUCCESS);
+  ASSERT_EQ(single_request.encrypted_elements_size(),
+            multi_request.encrypted_elements_size());
+  for (int i = 0; i < single_request.encrypted_elements_size(); i++) {
+    EXPECT_EQ(single_request.encrypted_elements(i),
+              multi_request.encrypted_elements(i));
+  }
+}
+
+TEST(EcdhBatchEngineTest, intersection) {
+  // client: [0, 6000), server: [3000, 10000)
+  auto client_input = BuildInput(0, 6000);
+  auto server_input = BuildInput(3000, 7000);
+  EcdhBatchEngine engine(4);
+  auto intersection = RunPsi(&engine, client_input, server_input);
+  ASSERT_EQ(intersection.size(), 3000);
+  for (size_t i = 0; i < intersection.size(); i++) {
+    EXPECT_EQ(intersection[i], 3000 + i);
+  }
+}
+
+TEST(EcdhBatchEngineTest, scaling) {
+  auto client_input = BuildInput(0, 20000);
+  auto server_input = BuildInput(10000, 20000);
+  size_t max_thread_num = std::max(std::thread::hardware_concurrency(), 1u);
+  for (size_t thread_num = 1; thread_num <= max_thread_num; thread_num *= 2) {
+    EcdhBatchEngine engine(thread_num);
+    auto start = std::chrono::steady_clock::now();
+    auto intersection = RunPsi(&engine, client_input, server_input);
+    auto time_cost = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - start).count();
+    EXPECT_EQ(intersection.size(), 10000);
+    LOG(INFO) << "thread num: " << thread_num << " "
+              << "time cost(ms): " << time_cost;
+  }
+}
+}  // namespace primihub::psi
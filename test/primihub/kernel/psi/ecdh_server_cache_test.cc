@@ -0,0 +1,81 @@
+// Copyright [2023] <primihub.com>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "src/primihub/kernel/psi/operator/ecdh_server_cache.h"
+
+namespace primihub::psi {
+namespace {
+class TestEcdhServerCache : public EcdhServerCache {
+ public:
+  using EcdhServerCache::EcdhServerCache;
+  using EcdhServerCache::EntryPath;
+};
+}  // namespace
+
+TEST(EcdhServerCacheTest, load_and_invalidate) {
+  std::string cache_dir = "/tmp/ecdh_server_cache_test";
+  std::vector<std::string> dataset{"a", "b", "c"};
+  EcdhServerCache cache(cache_dir, "dataset_id", {0, 1}, 0.0001, true);
+  auto fingerprint = EcdhServerCache::Fingerprint(dataset);
+  auto bucket = EcdhServerCache::ClientSizeBucket(1000);
+  EXPECT_EQ(bucket, 1024);
+  EXPECT_EQ(EcdhServerCache::ClientSizeBucket(1024), 1024);
+  EcdhServerCache::Entry entry;
+  EXPECT_EQ(cache.Load(fingerprint, bucket, &entry), retcode::FAIL);
+  entry.server_key = "server key";
+  entry.server_setup = std::string("setup\0data", 10);
+  ASSERT_EQ(cache.Store(fingerprint, bucket, entry), retcode::SUCCESS);
+
+  EcdhServerCache::Entry loaded;
+  ASSERT_EQ(cache.Load(fingerprint, bucket, &loaded), retcode::SUCCESS);
+  EXPECT_EQ(loaded.server_key, entry.server_key);
+  EXPECT_EQ(loaded.server_setup, entry.server_setup);
+  // other bucket, key columns or fpr is another entry
+  EXPECT_EQ(cache.Load(fingerprint, bucket * 2, &loaded), retcode::FAIL);
+  EcdhServerCache other_cache(cache_dir, "dataset_id", {0}, 0.0001, true);
+  EXPECT_EQ(other_cache.Load(fingerprint, bucket, &loaded), retcode::FAIL);
+  // entry of changed dataset is removed
+  dataset.push_back("d");
+  auto new_fingerprint = EcdhServerCache::Fingerprint(dataset);
+  EXPECT_NE(new_fingerprint, fingerprint);
+  EXPECT_EQ(cache.Load(new_fingerprint, bucket, &loaded), retcode::FAIL);
+  EXPECT_EQ(cache.Load(fingerprint, bucket, &loaded), retcode::FAIL);
+}
+
+TEST(EcdhServerCacheTest, corrupted_entry_is_a_miss) {
+  std::string cache_dir = "/tmp/ecdh_server_cache_corrupt_test";
+  std::filesystem::remove_all(cache_dir);
+  TestEcdhServerCache cache(cache_dir, "dataset_id", {0}, 0.0001, true);
+  auto fingerprint = EcdhServerCache::Fingerprint({"a", "b"});
+  EcdhServerCache::Entry entry;
+  entry.server_key = "server key";
+  entry.server_setup = "setup data";
+  auto file_path = cache.EntryPath(1024);
+  EcdhServerCache::Entry loaded;
+  // truncated entry
+  ASSERT_EQ(cache.Store(fingerprint, 1024, entry), retcode::SUCCESS);
+  std::filesystem::resize_file(file_path,
+                               std::filesystem::file_size(file_path) - 3);
+  EXPECT_EQ(cache.Load(fingerprint, 1024, &loaded), retcode::FAIL);
+  EXPECT_FALSE(std::filesystem::exists(file_path));
+  // length far beyond file size must not be allocated
+  ASSERT_EQ(cache.Store(fingerprint, 1024, entry), retcode::SUCCESS);
+  {
+    std::fstream file(file_path,
+                      std::ios::binary | std::ios::in | std::ios::out);
+    file.seekp(8);
+    std::string huge_len(8, '\xff');
+    file.write(huge_len.data(), huge_len.size());
+  }
+  EXPECT_EQ(cache.Load(fingerprint, 1024, &loaded), retcode::FAIL);
+  // cache is rebuilt after miss
+  ASSERT_EQ(cache.Store(fingerprint, 1024, entry), retcode::SUCCESS);
+  ASSERT_EQ(cache.Load(fingerprint, 1024, &loaded), retcode::SUCCESS);
+  EXPECT_EQ(loaded.server_setup, entry.server_setup);
+  std::filesystem::remove_all(cache_dir);
+}
+}  // namespace primihub::psi
@@ -0,0 +1,117 @@
+// Copyright [2023] <primihub.com>
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "arrow/api.h"
+#include "src/primihub/kernel/psi/operator/external_psi.h"
+#include "src/primihub/kernel/psi/operator/key_hasher.h"
+
+namespace primihub::psi {
+namespace {
+constexpr char kSpillDir[] = "/tmp/primihub_external_psi_test";
+
+class ExternalPsiForTest : public ExternalPsiOperator {
+ public:
+  using ExternalPsiOperator::ExternalPsiOperator;
+  using ExternalPsiOperator::Group;
+  using ExternalPsiOperator::FlushBucket;
+  using ExternalPsiOperator::CellsPerGroup;
+  using ExternalPsiOperator::GroupCells;
+  using ExternalPsiOperator::LoadDigests;
+  using ExternalPsiOperator::EmitResult;
+};
+
+std::shared_ptr<arrow::Table> MakeKeyTable(
+    const std::vector<std::string>& keys) {
+  arrow::StringBuilder builder;
+  builder.AppendValues(keys);
+  std::shared_ptr<arrow::Array> array;
+  builder.Finish(&array);
+  auto schema = arrow::schema({arrow::field("id", arrow::utf8())});
+  return arrow::Table::Make(schema, {array});
+}
+
+std::string DigestOf(const std::string& key) {
+  auto hash = KeyHasher::HashKey(key);
+  return std::string(reinterpret_cast<const char*>(&hash),
+                     ExternalPsiOperator::kDigestSize);
+}
+}  // namespace
+
+TEST(ExternalPsiTest, spill_and_emit_result) {
+  Options options;
+  options.psi_memory_limit_mb = 1;
+  ExternalPsiForTest external_psi(options, PsiType::KKRT, kSpillDir);
+  std::vector<std::string> keys;
+  for (int i = 0; i < 1000; i++) {
+    keys.push_back("k" + std::to_string(i));
+  }
+  // two batches, the second one repeats keys of the first one
+  EXPECT_EQ(external_psi.Spill(*MakeKeyTable(keys)), retcode::SUCCESS);
+  keys.resize(10);
+  EXPECT_EQ(external_psi.Spill(*MakeKeyTable(keys)), retcode::SUCCESS);
+  for (size_t i = 0; i < ExternalPsiOperator::kBucketNum; i++) {
+    EXPECT_EQ(external_psi.FlushBucket(i), retcode::SUCCESS);
+  }
+  ExternalPsiForTest::Group all{0, ExternalPsiOperator::kCellNum};
+  std::vector<std::string> digests;
+  EXPECT_EQ(external_psi.LoadDigests(all, &digests), retcode::SUCCESS);
+  EXPECT_EQ(digests.size(), 1000);
+  EXPECT_TRUE(std::is_sorted(digests.begin(), digests.end()));
+
+  std::vector<std::string> result{DigestOf("k1"), DigestOf("k500")};
+  std::sort(result.begin(), result.end());
+  std::vector<std::string> emitted;
+  auto ret = external_psi.EmitResult(all, result,
+      [&](const std::vector<std::string>& part) -> retcode {
+        emitted.insert(emitted.end(), part.begin(), part.end());
+        return retcode::SUCCESS;
+      });
+  EXPECT_EQ(ret, retcode::SUCCESS);
+  std::sort(emitted.begin(), emitted.end());
+  EXPECT_EQ(emitted, (std::vector<std::string>{"k1", "k500"}));
+}
+
+TEST(ExternalPsiTest, group_cells_by_memory_limit) {
+  Options options;
+  options.psi_memory_limit_mb = 1;
+  ExternalPsiForTest external_psi(options, PsiType::KKRT, kSpillDir);
+  std::vector<std::string> keys;
+  for (int i = 0; i < 20000; i++) {
+    keys.push_back("k" + std::to_string(i));
+  }
+  EXPECT_EQ(external_psi.Spill(*MakeKeyTable(keys)), retcode::SUCCESS);
+  for (size_t i = 0; i < ExternalPsiOperator::kBucketNum; i++) {
+    EXPECT_EQ(external_psi.FlushBucket(i), retcode::SUCCESS);
+  }
+  // 8192 keys fit in 1MB, a quarter of cells holds about 5000 keys
+  EXPECT_EQ(external_psi.CellsPerGroup(1), ExternalPsiOperator::kCellNum / 4);
+  EXPECT_EQ(external_psi.CellsPerGroup(1024), ExternalPsiOperator::kCellNum);
+  // groups narrower than a bucket split bucket files
+  auto groups = external_psi.GroupCells(128);
+  ASSERT_EQ(groups.size(), ExternalPsiOperator::kCellNum / 128);
+  EXPECT_EQ(groups.back().second, ExternalPsiOperator::kCellNum);
+  size_t total = 0;
+  for (const auto& group : groups) {
+    std::vector<std::string> digests;
+    EXPECT_EQ(external_psi.LoadDigests(group, &digests), retcode::SUCCESS);
+    total += digests.size();
+  }
+  EXPECT_EQ(total, keys.size());
+}
+
+TEST(ExternalPsiTest, cell_exceeds_memory_limit) {
+  Options options;
+  options.psi_memory_limit_mb = 1;
+  ExternalPsiForTest external_psi(options, PsiType::KKRT, kSpillDir);
+  size_t max_keys = (1 << 20) / ExternalPsiOperator::kBytesPerKey;
+  // duplicated keys fall in the same cell
+  std::vector<std::string> keys(max_keys + 1, "k");
+  EXPECT_EQ(external_psi.Spill(*MakeKeyTable(keys)), retcode::SUCCESS);
+  EXPECT_EQ(external_psi.CellsPerGroup(1), 0);
+  EXPECT_EQ(external_psi.CellsPerGroup(2), ExternalPsiOperator::kCellNum);
+}
+}  // namespace primihub::psi
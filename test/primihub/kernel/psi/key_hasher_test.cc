@@ -0,0 +1,111 @@
+// Copyright [2023] <primihub.com>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "arrow/api.h"
+#include "src/primihub/kernel/psi/operator/key_hasher.h"
+#include "src/primihub/kernel/psi/util.h"
+
+namespace primihub::psi {
+namespace {
+std::shared_ptr<arrow::Array> MakeStringArray(
+    const std::vector<std::string>& values) {
+  arrow::StringBuilder builder;
+  builder.AppendValues(values);
+  std::shared_ptr<arrow::Array> array;
+  builder.Finish(&array);
+  return array;
+}
+
+bool BlockEqual(const oc::block& a, const oc::block& b) {
+  return std::memcmp(&a, &b, sizeof(oc::block)) == 0;
+}
+}  // namespace
+
+TEST(KeyHasherTest, hash_table_as_joined_string) {
+  // first column in two chunks, second column is numeric
+  auto name_col = std::make_shared<arrow::ChunkedArray>(arrow::ArrayVector{
+      MakeStringArray({"ab", "a", "a long key over 16 bytes"}),
+      MakeStringArray({"", "ab"})});
+  arrow::Int64Builder id_builder;
+  id_builder.AppendValues(std::vector<int64_t>{1, 1, -30, 7, 1});
+  std::shared_ptr<arrow::Array> id_array;
+  id_builder.Finish(&id_array);
+  auto schema = arrow::schema({arrow::field("name", arrow::utf8()),
+                               arrow::field("id", arrow::int64())});
+  auto table = arrow::Table::Make(
+      schema, {name_col, std::make_shared<arrow::ChunkedArray>(id_array)});
+  std::vector<std::string> keys{
+      std::string("ab") + DATA_RECORD_SEP + "1",
+      std::string("a") + DATA_RECORD_SEP + "1",
+      std::string("a long key over 16 bytes") + DATA_RECORD_SEP + "-30",
+      std::string("") + DATA_RECORD_SEP + "7",
+      std::string("ab") + DATA_RECORD_SEP + "1"};
+
+  KeyHasher hasher(2);
+  std::vector<oc::block> table_hash;
+  ASSERT_EQ(hasher.HashTable(*table, &table_hash), retcode::SUCCESS);
+  std::vector<oc::block> string_hash;
+  ASSERT_EQ(hasher.HashKeys(keys, &string_hash), retcode::SUCCESS);
+  ASSERT_EQ(table_hash.size(), keys.size());
+  for (size_t i = 0; i < keys.size(); i++) {
+    EXPECT_TRUE(BlockEqual(table_hash[i], string_hash[i])) << "row: " << i;
+  }
+  EXPECT_FALSE(BlockEqual(table_hash[0], table_hash[1]));
+
+  std::vector<int64_t> rows;
+  EXPECT_EQ(KeyHasher::FilterDuplicate(&table_hash, &rows), 1);
+  EXPECT_EQ(rows, std::vector<int64_t>({0, 1, 2, 3}));
+  std::vector<std::string> extracted;
+  ASSERT_EQ(PsiCommonUtil().ExtractRowsFromTable(*table, {4, 2}, &extracted),
+            retcode::SUCCESS);
+  EXPECT_EQ(extracted, std::vector<std::string>({keys[4], keys[2]}));
+}
+
+TEST(KeyHasherTest, composite_key_is_not_concatenated) {
+  auto left = KeyHasher::HashKey(std::string("ab") + DATA_RECORD_SEP + "c");
+  auto right = KeyHasher::HashKey(std::string("a") + DATA_RECORD_SEP + "bc");
+  EXPECT_FALSE(BlockEqual(left, right));
+  EXPECT_FALSE(BlockEqual(KeyHasher::HashKey("abc"), left));
+  // zero padding of last block is not ambiguous
+  EXPECT_FALSE(BlockEqual(KeyHasher::HashKey("a"),
+                          KeyHasher::HashKey(std::string("a\0", 2))));
+  EXPECT_TRUE(BlockEqual(KeyHasher::HashKey("abc"),
+                         KeyHasher::HashKey("abc")));
+}
+
+TEST(KeyHasherTest, shard_of_key) {
+  std::vector<size_t> shard_size(4, 0);
+  for (int i = 0; i < 4000; i++) {
+    auto hash = KeyHasher::HashKey(std::to_string(i));
+    auto shard = KeyHasher::ShardOf(hash, shard_size.size());
+    ASSERT_LT(shard, shard_size.size());
+    shard_size[shard]++;
+  }
+  for (auto size : shard_size) {
+    EXPECT_GT(size, 800);
+  }
+}
+
+TEST(KeyHasherTest, shard_padded_size_covers_shards) {
+  EXPECT_EQ(KeyHasher::ShardPaddedSize(0, 4), 1);
+  EXPECT_EQ(KeyHasher::ShardPaddedSize(10, 4), 10);
+  for (size_t total : {1000, 100000}) {
+    size_t shard_num = 8;
+    size_t padded_size = KeyHasher::ShardPaddedSize(total, shard_num);
+    EXPECT_GT(padded_size, total / shard_num);
+    EXPECT_LT(padded_size, total / shard_num * 2);
+    std::vector<size_t> shard_size(shard_num, 0);
+    for (size_t i = 0; i < total; i++) {
+      auto hash = KeyHasher::HashKey(std::to_string(i));
+      shard_size[KeyHasher::ShardOf(hash, shard_num)]++;
+    }
+    for (auto size : shard_size) {
+      EXPECT_LE(size, padded_size);
+    }
+  }
+}
+}  // namespace primihub::psi
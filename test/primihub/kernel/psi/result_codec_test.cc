@@ -0,0 +1,60 @@
+// Copyright [2023] <primihub.com>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "src/primihub/kernel/psi/operator/result_codec.h"
+
+namespace primihub::psi {
+namespace {
+void ExpectRoundTrip(const std::vector<uint64_t>& index, uint64_t universe,
+                     IndexCodec::Form expected_form) {
+  EXPECT_EQ(IndexCodec::ChooseForm(index, universe), expected_form);
+  std::string encoded;
+  ASSERT_EQ(IndexCodec::Encode(index, universe, &encoded), retcode::SUCCESS);
+  EXPECT_EQ(static_cast<IndexCodec::Form>(encoded[0]), expected_form);
+  uint64_t decoded_universe{0};
+  std::vector<uint64_t> decoded;
+  ASSERT_EQ(IndexCodec::Decode(encoded, &decoded_universe, &decoded),
+            retcode::SUCCESS);
+  EXPECT_EQ(decoded_universe, universe);
+  EXPECT_EQ(decoded, index);
+}
+}  // namespace
+
+TEST(IndexCodecTest, form_by_density) {
+  // sparse
+  std::vector<uint64_t> index{3, 1000, 1001, 99999};
+  ExpectRoundTrip(index, 100000, IndexCodec::Form::DELTA);
+  // about half of universe
+  index.clear();
+  for (uint64_t i = 0; i < 10000; i += 2) {
+    index.push_back(i);
+  }
+  ExpectRoundTrip(index, 10000, IndexCodec::Form::BITMAP);
+  // nearly full
+  index.clear();
+  for (uint64_t i = 0; i < 10000; i++) {
+    if (i % 1000 != 7) {
+      index.push_back(i);
+    }
+  }
+  ExpectRoundTrip(index, 10000, IndexCodec::Form::COMPLEMENT);
+  // fingerprint universe is far larger than the set
+  index = {1ull << 40, 1ull << 50, (1ull << 62) + 5};
+  ExpectRoundTrip(index, 1ull << 63, IndexCodec::Form::DELTA);
+  ExpectRoundTrip({}, 0, IndexCodec::Form::DELTA);
+}
+
+TEST(IndexCodecTest, reject_invalid_input) {
+  std::string encoded;
+  EXPECT_EQ(IndexCodec::Encode({5, 3}, 10, &encoded), retcode::FAIL);
+  EXPECT_EQ(IndexCodec::Encode({3, 10}, 10, &encoded), retcode::FAIL);
+  ASSERT_EQ(IndexCodec::Encode({1, 2, 8}, 10, &encoded), retcode::SUCCESS);
+  uint64_t universe{0};
+  std::vector<uint64_t> decoded;
+  encoded.pop_back();
+  EXPECT_EQ(IndexCodec::Decode(encoded, &universe, &decoded), retcode::FAIL);
+  EXPECT_EQ(IndexCodec::Decode("", &universe, &decoded), retcode::FAIL);
+}
+}  // namespace primihub::psi
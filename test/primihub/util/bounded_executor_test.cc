@@ -0,0 +1,63 @@
+// Copyright [2023] <primihub.com>
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "src/primihub/util/bounded_executor.h"
+
+namespace primihub {
+TEST(BoundedExecutorTest, bounded_parallelism_and_queue) {
+  BoundedExecutor executor(2, 3);
+  std::atomic<int> running{0};
+  std::atomic<int> max_running{0};
+  std::vector<std::future<void>> futures;
+  for (int i = 0; i < 20; i++) {
+    futures.push_back(executor.Submit([&]() {
+      int now = ++running;
+      int prev = max_running.load();
+      while (now > prev && !max_running.compare_exchange_weak(prev, now)) {}
+      std::this_thread::sleep_for(std::chrono::milliseconds(2));
+      --running;
+    }));
+  }
+  for (auto& fut : futures) {
+    fut.get();
+  }
+  EXPECT_LE(max_running.load(), 2);
+  auto stats = executor.stats();
+  EXPECT_EQ(stats.submitted, 20);
+  EXPECT_LE(stats.max_queue_depth, 3);
+  EXPECT_EQ(stats.queue_depth, 0);
+}
+
+TEST(BoundedExecutorTest, exception_and_shutdown) {
+  BoundedExecutor executor(1);
+  auto fut = executor.Submit([]() {throw std::runtime_error("failed");});
+  EXPECT_THROW(fut.get(), std::runtime_error);
+  std::atomic<int> done{0};
+  for (int i = 0; i < 4; i++) {
+    executor.Submit([&]() {done++;});
+  }
+  // queued tasks are finished before shutdown returns
+  executor.Shutdown();
+  EXPECT_EQ(done.load(), 4);
+  auto dropped = executor.Submit([&]() {done++;});
+  EXPECT_THROW(dropped.get(), std::future_error);
+  EXPECT_EQ(done.load(), 4);
+}
+
+TEST(BoundedExecutorTest, numa_node_cpus) {
+  // node 0 exists on every linux machine exposing numa topology
+  auto cpus = BoundedExecutor::NumaNodeCpus(0);
+  for (auto cpu : cpus) {
+    EXPECT_GE(cpu, 0);
+  }
+  EXPECT_TRUE(BoundedExecutor::NumaNodeCpus(100000).empty());
+  BoundedExecutor executor(2, 0, 0);
+  executor.Submit([]() {}).get();
+}
+}  // namespace primihub
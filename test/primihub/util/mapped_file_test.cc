@@ -0,0 +1,47 @@
+// Copyright [2023] <primihub.com>
+#include <cstdio>
+#include <fstream>
+#include <istream>
+#include <string>
+
+#include "gtest/gtest.h"
+#include "src/primihub/util/mapped_file.h"
+
+namespace primihub {
+TEST(MappedFileTest, map_and_stream) {
+  std::string path = "mapped_file_test.data";
+  std::string content;
+  for (int i = 0; i < 10000; i++) {
+    content.append(std::to_string(i)).append(" ");
+  }
+  {
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    out << content;
+  }
+  auto mapped_file = MappedFile::Open(path);
+  ASSERT_NE(mapped_file, nullptr);
+  EXPECT_EQ(mapped_file->view(), content);
+  mapped_file->Advise(MappedFile::Advice::SEQUENTIAL);
+  mapped_file->Advise(MappedFile::Advice::WILLNEED, 5000, 100);
+
+  MemoryStreamBuf stream_buf(mapped_file->view());
+  std::istream in(&stream_buf);
+  int value{-1};
+  ASSERT_TRUE(in >> value);
+  EXPECT_EQ(value, 0);
+  in.seekg(-static_cast<int>(std::string("9999 ").size()), std::ios::end);
+  ASSERT_TRUE(in >> value);
+  EXPECT_EQ(value, 9999);
+  EXPECT_FALSE(in >> value);
+  in.clear();
+  in.seekg(2);
+  EXPECT_EQ(in.tellg(), 2);
+  ASSERT_TRUE(in >> value);
+  EXPECT_EQ(value, 1);
+  in.seekg(content.size() + 1);
+  EXPECT_TRUE(in.fail());
+
+  std::remove(path.c_str());
+  EXPECT_EQ(MappedFile::Open(path), nullptr);
+}
+}  // namespace primihub
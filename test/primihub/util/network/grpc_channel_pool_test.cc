@@ -0,0 +1,65 @@
+// Copyright [2023] <primihub.com>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "src/primihub/util/network/grpc_channel_pool.h"
+
+namespace primihub::network {
+TEST(GrpcChannelPoolTest, share_channel_by_address_and_tls) {
+  auto& pool = GrpcChannelPool::GetInstance();
+  common::ChannelPoolConfig cfg;
+  pool.Init(cfg);
+  auto channel = pool.GetChannel("127.0.0.1:50050", nullptr);
+  EXPECT_EQ(channel, pool.GetChannel("127.0.0.1:50050", nullptr));
+  EXPECT_NE(channel, pool.GetChannel("127.0.0.1:50051", nullptr));
+  grpc::SslCredentialsOptions ssl_opts;
+  ssl_opts.pem_root_certs = "root ca";
+  auto tls_channel = pool.GetChannel("127.0.0.1:50050", &ssl_opts);
+  EXPECT_NE(channel, tls_channel);
+  EXPECT_EQ(tls_channel, pool.GetChannel("127.0.0.1:50050", &ssl_opts));
+  ssl_opts.pem_root_certs = "other root ca";
+  EXPECT_NE(tls_channel, pool.GetChannel("127.0.0.1:50050", &ssl_opts));
+  // the same bytes split differently are different credentials
+  grpc::SslCredentialsOptions moved_opts;
+  moved_opts.pem_root_certs = "other root";
+  moved_opts.pem_private_key = " ca";
+  EXPECT_NE(pool.GetChannel("127.0.0.1:50050", &ssl_opts),
+            pool.GetChannel("127.0.0.1:50050", &moved_opts));
+  auto stats = pool.GetStats();
+  EXPECT_EQ(stats.hit, 3);
+  EXPECT_EQ(stats.miss, 5);
+  EXPECT_EQ(stats.size, 5);
+  pool.Clear();
+}
+
+TEST(GrpcChannelPoolTest, warmup_and_idle_eviction) {
+  auto& pool = GrpcChannelPool::GetInstance();
+  common::ChannelPoolConfig cfg;
+  cfg.idle_timeout_s = 1;
+  pool.Init(cfg);
+  std::vector<std::string> peers{"127.0.0.1:50050", "127.0.0.1:50051"};
+  EXPECT_EQ(pool.Warmup(peers, nullptr), peers.size());
+  auto borrowed = pool.GetChannel("127.0.0.1:50050", nullptr);
+  std::this_thread::sleep_for(std::chrono::milliseconds(1100));
+  // idle channel is released, borrowed one stays in pool
+  pool.GetChannel("127.0.0.1:50052", nullptr);
+  auto stats = pool.GetStats();
+  EXPECT_EQ(stats.evicted, 1);
+  EXPECT_EQ(stats.size, 2);
+  pool.Clear();
+}
+
+TEST(GrpcChannelPoolTest, disabled_pool_builds_private_channel) {
+  auto& pool = GrpcChannelPool::GetInstance();
+  common::ChannelPoolConfig cfg;
+  cfg.enable = false;
+  pool.Init(cfg);
+  auto channel = pool.GetChannel("127.0.0.1:50050", nullptr);
+  EXPECT_NE(channel, nullptr);
+  EXPECT_NE(channel, pool.GetChannel("127.0.0.1:50050", nullptr));
+  EXPECT_EQ(pool.Warmup({"127.0.0.1:50050"}, nullptr), 0);
+}
+}  // namespace primihub::network
@@ -0,0 +1,176 @@
+// Copyright [2023] <primihub.com>
+// round trip latency and throughput of grpc link stream versus raw socket
+// link on loopback, each round sends one message and receives it back.
+// usage: link_benchmark [message bytes ...]
+#include <grpcpp/grpcpp.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "src/primihub/util/network/grpc_stream_link_context.h"
+#include "src/primihub/util/network/socket_link_context.h"
+#include "src/primihub/util/network/socket_link_server.h"
+#include "src/primihub/util/threadsafe_queue.h"
+
+namespace {
+using primihub::retcode;
+using primihub::ThreadSafeQueue;
+namespace network = primihub::network;
+namespace rpc = primihub::rpc;
+constexpr int32_t kRecvWaitMs = 10 * 1000;
+
+/**
+ * per-key data queues shared by both servers, like link queues of a node
+*/
+class KeyStore {
+ public:
+  ThreadSafeQueue<std::string>& GetQueue(const std::string& key) {
+    std::lock_guard<std::mutex> lck(mtx_);
+    return queues_[key];
+  }
+
+ private:
+  std::mutex mtx_;
+  std::map<std::string, ThreadSafeQueue<std::string>> queues_;
+};
+
+/**
+ * minimal LinkStream peer, DATA is acked once its last frame arrives,
+ * RECV is answered with one DATA frame
+*/
+class LinkStreamService : public rpc::VMNode::Service {
+ public:
+  explicit LinkStreamService(KeyStore* store) : store_(store) {}
+  grpc::Status LinkStream(
+      grpc::ServerContext* /*context*/,
+      grpc::ServerReaderWriter<rpc::LinkFrame, rpc::LinkFrame>* stream)
+      override {
+    rpc::LinkFrame frame;
+    std::string message;
+    while (stream->Read(&frame)) {
+      rpc::LinkFrame reply;
+      reply.set_seq_no(frame.seq_no());
+      reply.set_ret_code(rpc::retcode::SUCCESS);
+      reply.set_last(true);
+      if (frame.type() == rpc::LinkFrame::RECV) {
+        std::string data;
+        auto& queue = store_->GetQueue(frame.key());
+        if (!queue.wait_and_pop(data, kRecvWaitMs)) {
+          break;
+        }
+        reply.set_type(rpc::LinkFrame::DATA);
+        reply.set_data_len(data.size());
+        reply.set_data(std::move(data));
+      } else {
+        message.append(frame.data());
+        if (!frame.last()) {
+          continue;
+        }
+        store_->GetQueue(frame.key()).push(std::move(message));
+        message.clear();
+        reply.set_type(rpc::LinkFrame::ACK);
+      }
+      if (!stream->Write(reply)) {
+        break;
+      }
+    }
+    return grpc::Status::OK;
+  }
+
+ private:
+  KeyStore* store_;
+};
+
+double NowUs() {
+  auto now = std::chrono::steady_clock::now().time_since_epoch();
+  return std::chrono::duration<double, std::micro>(now).count();
+}
+
+bool RunRounds(const std::string& link_name, network::IChannel* channel,
+               size_t msg_size) {
+  std::string data(msg_size, 'x');
+  size_t rounds = std::clamp<size_t>((64 << 20) / msg_size, 10, 2000);
+  std::string key = link_name + "_" + std::to_string(msg_size);
+  auto start = NowUs();
+  for (size_t i = 0; i < rounds; i++) {
+    if (channel->send(key, data) != retcode::SUCCESS ||
+        channel->forwardRecv(key).size() != msg_size) {
+      std::cerr << link_name << " round trip failed, "
+                << "message bytes: " << msg_size << std::endl;
+      return false;
+    }
+  }
+  auto elapse = NowUs() - start;
+  std::cout << link_name << "," << msg_size << "," << rounds << ","
+            << elapse / rounds << ","
+            << 2.0 * msg_size * rounds / elapse << std::endl;
+  return true;
+}
+}  // namespace
+
+int main(int argc, char** argv) {
+  std::vector<size_t> msg_sizes;
+  for (int i = 1; i < argc; i++) {
+    msg_sizes.push_back(std::max<size_t>(
+        std::strtoull(argv[i], nullptr, 10), 1));
+  }
+  if (msg_sizes.empty()) {
+    msg_sizes = {64, 4096, 64 * 1024, 1024 * 1024};
+  }
+  KeyStore store;
+  LinkStreamService service(&store);
+  int grpc_port{0};
+  grpc::ServerBuilder builder;
+  builder.AddListeningPort("127.0.0.1:0", grpc::InsecureServerCredentials(),
+                           &grpc_port);
+  builder.RegisterService(&service);
+  auto grpc_server = builder.BuildAndStart();
+  network::SocketLinkServer socket_server(
+      [&](const std::string& /*meta*/, const std::string& key,
+          std::string&& data, uint8_t /*compress_type*/,
+          network::SocketLinkServer::AckCallback ack) {
+        store.GetQueue(key).push(std::move(data));
+        ack(retcode::SUCCESS);
+      },
+      [&](const std::string& /*meta*/, const std::string& key,
+          network::SocketLinkServer::RecvCallback done) {
+        auto& queue = store.GetQueue(key);
+        auto pop_id = queue.async_pop([done](bool ok, std::string&& data) {
+          done(ok ? retcode::SUCCESS : retcode::FAIL, std::move(data));
+        });
+        return [&queue, pop_id]() {return queue.cancel_async_pop(pop_id);};
+      });
+  if (grpc_server == nullptr ||
+      socket_server.Start("127.0.0.1", 0) != retcode::SUCCESS) {
+    std::cerr << "start loopback servers failed" << std::endl;
+    return 1;
+  }
+  int ret{0};
+  {
+    network::GrpcLinkContext link_ctx;
+    link_ctx.setSendTimeout(kRecvWaitMs);
+    network::GrpcStreamChannel grpc_channel(
+        primihub::Node("127.0.0.1", grpc_port, false), &link_ctx);
+    network::SocketChannel socket_channel(
+        primihub::Node("127.0.0.1", socket_server.Port(), false),
+        &link_ctx, 0);
+    std::cout << "link,message_bytes,rounds,round_trip_us,throughput_mb_s"
+              << std::endl;
+    for (auto msg_size : msg_sizes) {
+      if (!RunRounds("grpc_stream", &grpc_channel, msg_size) ||
+          !RunRounds("raw_socket", &socket_channel, msg_size)) {
+        ret = 1;
+        break;
+      }
+    }
+  }
+  socket_server.Stop();
+  grpc_server->Shutdown();
+  return ret;
+}
@@ -0,0 +1,73 @@
+// Copyright [2023] <primihub.com>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "src/primihub/util/endian_util.h"
+#include "src/primihub/util/network/link_compressor.h"
+
+namespace primihub::network {
+TEST(LinkCompressorTest, roundtrip_for_supported_types) {
+  std::string data;
+  for (size_t i = 0; i < 100000; i++) {
+    data.append(std::to_string(i % 1000)).append(",");
+  }
+  for (auto type : LinkCompressor::SupportedTypes()) {
+    LinkCompressor compressor;
+    std::string compressed;
+    ASSERT_EQ(compressor.Compress(type, data, &compressed), retcode::SUCCESS);
+    EXPECT_LT(compressed.size(), data.size());
+    std::string decompressed;
+    ASSERT_EQ(compressor.Decompress(type, compressed, &decompressed),
+              retcode::SUCCESS);
+    EXPECT_EQ(decompressed, data);
+    EXPECT_LT(compressor.CompressRatio(), 1.0);
+    // raw size claimed by peer is checked before allocation
+    for (uint64_t raw_size : {uint64_t{UINT64_MAX},
+                              LinkCompressor::kMaxRawSize,
+                              uint64_t{data.size() + 1}}) {
+      std::string forged = compressed;
+      uint64_t be_raw_size = htonll(raw_size);
+      memcpy(forged.data(), &be_raw_size, sizeof(be_raw_size));
+      EXPECT_EQ(compressor.Decompress(type, forged, &decompressed),
+                retcode::FAIL);
+    }
+    // corrupted payload is rejected
+    compressed.resize(compressed.size() / 2);
+    EXPECT_EQ(compressor.Decompress(type, compressed, &decompressed),
+              retcode::FAIL);
+  }
+}
+
+TEST(LinkCompressorTest, skip_small_excluded_and_incompressible_data) {
+  common::CompressConfig compress_cfg;
+  compress_cfg.algorithm = "zstd";
+  compress_cfg.min_size = 1024;
+  compress_cfg.exclude_keys = {"ciphertext"};
+  LinkCompressor compressor(compress_cfg);
+  EXPECT_EQ(compressor.PreferredType(), rpc::CompressType::COMPRESS_ZSTD);
+  EXPECT_FALSE(compressor.ShouldCompress("plain", 100));
+  EXPECT_TRUE(compressor.ShouldCompress("plain", 4096));
+  EXPECT_FALSE(compressor.ShouldCompress("ciphertext", 4096));
+  compressor.DisableCompression("plain");
+  EXPECT_FALSE(compressor.ShouldCompress("plain", 4096));
+
+  std::mt19937_64 rng(7);
+  std::string random_data(64 * 1024, '\0');
+  for (auto& ch : random_data) {
+    ch = static_cast<char>(rng());
+  }
+  std::string compressed;
+  EXPECT_EQ(compressor.Compress(rpc::CompressType::COMPRESS_ZSTD,
+                                random_data, &compressed), retcode::FAIL);
+  EXPECT_EQ(compressor.stats().skipped_bytes.load(), random_data.size());
+
+  // negotiation picks the first offered type supported locally
+  std::vector<rpc::CompressType> offered{
+      static_cast<rpc::CompressType>(100), rpc::CompressType::COMPRESS_LZ4};
+  EXPECT_EQ(LinkCompressor::Choose(offered), rpc::CompressType::COMPRESS_LZ4);
+  EXPECT_EQ(LinkCompressor::Choose({}), rpc::CompressType::COMPRESS_NONE);
+}
+}  // namespace primihub::network
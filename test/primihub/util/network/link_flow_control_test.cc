@@ -0,0 +1,125 @@
+// Copyright [2023] <primihub.com>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <future>
+#include <memory>
+#include <string>
+#include <thread>
+
+#include "gtest/gtest.h"
+#include "src/primihub/util/memory_budget.h"
+#include "src/primihub/util/network/link_context.h"
+
+namespace primihub::network {
+namespace {
+class TestLinkContext : public LinkContext {
+ public:
+  std::shared_ptr<IChannel> getChannel(const primihub::Node& node) override {
+    return nullptr;
+  }
+};
+}  // namespace
+
+TEST(MemoryBudgetTest, acquire_blocks_until_released) {
+  auto task_budget = std::make_shared<MemoryBudget>(100);
+  MemoryBudget key_budget(0, task_budget);
+  ASSERT_TRUE(key_budget.TryAcquire(80));
+  EXPECT_FALSE(key_budget.TryAcquire(30));
+  EXPECT_EQ(task_budget->used(), 80);
+  EXPECT_FALSE(key_budget.Acquire(30, 10));
+  auto fut = std::async(std::launch::async, [&]() {
+    return key_budget.Acquire(30);
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  key_budget.Release(80);
+  EXPECT_TRUE(fut.get());
+  EXPECT_EQ(task_budget->used(), 30);
+  // oversized request is granted when nothing is held
+  key_budget.Release(30);
+  EXPECT_TRUE(key_budget.TryAcquire(1000));
+  key_budget.Release(1000);
+  // overcommit is granted once, until usage drops within limit
+  ASSERT_TRUE(key_budget.TryAcquire(80));
+  EXPECT_TRUE(key_budget.TryOvercommit(1000));
+  EXPECT_FALSE(key_budget.TryOvercommit(1));
+  EXPECT_EQ(task_budget->used(), 1080);
+  key_budget.Release(1000);
+  EXPECT_TRUE(key_budget.TryOvercommit(1));
+  key_budget.Release(81);
+  key_budget.Shutdown();
+  EXPECT_FALSE(key_budget.Acquire(1, -1));
+}
+
+TEST(LinkFlowControlTest, push_never_blocks_and_sender_waits_per_key) {
+  primihub::common::FlowControlConfig flow_cfg;
+  flow_cfg.key_memory_budget = 1024;
+  flow_cfg.wait_timeout_ms = 5000;
+  TestLinkContext link_ctx;
+  link_ctx.initFlowControl(flow_cfg);
+
+  std::string data(1000, 'a');
+  ASSERT_EQ(link_ctx.PushRecvData("key", std::string(data)),
+            retcode::SUCCESS);
+  // buffered over budget instead of blocking the shared reader
+  ASSERT_EQ(link_ctx.PushRecvData("key", std::string(data)),
+            retcode::SUCCESS);
+  // only one payload may go over budget, then data is rejected
+  EXPECT_EQ(link_ctx.PushRecvData("key", std::string(data)),
+            retcode::FAIL);
+  EXPECT_FALSE(link_ctx.HasRecvBudget("key", 0));
+  EXPECT_TRUE(link_ctx.HasRecvBudget("other_key", data.size()));
+  // sender of key is held back until consumer catches up
+  std::atomic<bool> ready{false};
+  auto fut = std::async(std::launch::async, [&]() {
+    auto ret = link_ctx.WaitRecvBudget("key", 0);
+    ready.store(true);
+    return ret;
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  EXPECT_FALSE(ready.load());
+  std::string recv_data;
+  ASSERT_TRUE(link_ctx.GetRecvQueue("key").wait_and_pop(recv_data));
+  EXPECT_EQ(recv_data, data);
+  EXPECT_TRUE(fut.get());
+  ASSERT_TRUE(link_ctx.GetRecvQueue("key").wait_and_pop(recv_data));
+  EXPECT_TRUE(link_ctx.HasRecvBudget("key", data.size()));
+}
+
+TEST(LinkFlowControlTest, data_beyond_budget_is_spilled) {
+  primihub::common::FlowControlConfig flow_cfg;
+  flow_cfg.key_memory_budget = 1024;
+  flow_cfg.wait_timeout_ms = 5000;
+  flow_cfg.spill_enable = true;
+  flow_cfg.spill_dir = ::testing::TempDir() + "link_spill";
+  flow_cfg.spill_threshold = 4096;
+  TestLinkContext link_ctx;
+  link_ctx.initFlowControl(flow_cfg);
+
+  std::string small_data(1000, 'a');
+  std::string large_data(8192, 'b');
+  ASSERT_EQ(link_ctx.PushRecvData("key", std::string(small_data)),
+            retcode::SUCCESS);
+  // spilled data does not hold memory budget
+  ASSERT_EQ(link_ctx.PushRecvData("key", std::string(large_data)),
+            retcode::SUCCESS);
+  EXPECT_FALSE(link_ctx.HasRecvBudget("key", small_data.size()));
+  // budget is full, small data is spilled as well
+  ASSERT_EQ(link_ctx.PushRecvData("key", std::string(small_data)),
+            retcode::SUCCESS);
+  // consume in order, spilled data is loaded back
+  std::string recv_data;
+  auto& recv_queue = link_ctx.GetRecvQueue("key");
+  ASSERT_TRUE(recv_queue.wait_and_pop(recv_data));
+  EXPECT_EQ(recv_data, small_data);
+  ASSERT_TRUE(recv_queue.wait_and_pop(recv_data));
+  EXPECT_EQ(recv_data, large_data);
+  ASSERT_TRUE(recv_queue.wait_and_pop(recv_data));
+  EXPECT_EQ(recv_data, small_data);
+  // spilled data which can not be loaded back fails the pop
+  ASSERT_EQ(link_ctx.PushRecvData("key", std::string(large_data)),
+            retcode::SUCCESS);
+  std::filesystem::remove_all(flow_cfg.spill_dir);
+  EXPECT_FALSE(recv_queue.wait_and_pop(recv_data));
+}
+}  // namespace primihub::network
@@ -0,0 +1,122 @@
+// Copyright [2023] <primihub.com>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "src/primihub/util/network/message_coalescer.h"
+
+namespace primihub::network {
+namespace {
+class WireRecorder {
+ public:
+  retcode Send(std::string_view data) {
+    std::lock_guard<std::mutex> lck(mtx_);
+    wire_messages_.emplace_back(data);
+    return retcode::SUCCESS;
+  }
+  std::vector<std::string> Messages() {
+    std::lock_guard<std::mutex> lck(mtx_);
+    std::vector<std::string> messages;
+    for (const auto& wire_message : wire_messages_) {
+      EXPECT_EQ(MessageCoalescer::Decode(std::string(wire_message),
+                                         &messages),
+                retcode::SUCCESS);
+    }
+    return messages;
+  }
+  size_t WireCount() {
+    std::lock_guard<std::mutex> lck(mtx_);
+    return wire_messages_.size();
+  }
+
+ private:
+  std::mutex mtx_;
+  std::vector<std::string> wire_messages_;
+};
+}  // namespace
+
+TEST(MessageCoalescerTest, batch_keeps_order_and_counts_saved) {
+  common::CoalesceConfig coalesce_cfg;
+  coalesce_cfg.enable = true;
+  coalesce_cfg.flush_window_us = 1000 * 1000;
+  coalesce_cfg.max_batch_size = 64;
+  coalesce_cfg.max_message_size = 32;
+  WireRecorder recorder;
+  MessageCoalescer coalescer(coalesce_cfg, [&](std::string_view data) {
+    return recorder.Send(data);
+  });
+  std::vector<std::string> expected{"a", "bb", "", "ccc"};
+  for (const auto& message : expected) {
+    ASSERT_EQ(coalescer.Append(message), retcode::SUCCESS);
+  }
+  EXPECT_EQ(recorder.WireCount(), 0);
+  // large message is sent after pending ones
+  expected.push_back(std::string(40, 'd'));
+  ASSERT_EQ(coalescer.Append(expected.back()), retcode::SUCCESS);
+  EXPECT_EQ(recorder.WireCount(), 2);
+  // batch is sent once max_batch_size is reached
+  for (int i = 0; i < 8; i++) {
+    expected.push_back(std::string(10, 'e' + i));
+    ASSERT_EQ(coalescer.Append(expected.back()), retcode::SUCCESS);
+  }
+  EXPECT_EQ(recorder.WireCount(), 3);
+  // message looking like a batch is not misread
+  expected.push_back(std::string("PHMSGBAT\0\0\0\5", 12));
+  ASSERT_EQ(coalescer.Append(expected.back()), retcode::SUCCESS);
+  ASSERT_EQ(coalescer.Flush(), retcode::SUCCESS);
+  EXPECT_EQ(recorder.Messages(), expected);
+  EXPECT_EQ(coalescer.message_count(), expected.size());
+  EXPECT_EQ(coalescer.saved_count(),
+            expected.size() - recorder.WireCount());
+}
+
+TEST(MessageCoalescerTest, flush_window_sends_pending) {
+  common::CoalesceConfig coalesce_cfg;
+  coalesce_cfg.enable = true;
+  coalesce_cfg.flush_window_us = 1000;
+  WireRecorder recorder;
+  MessageCoalescer coalescer(coalesce_cfg, [&](std::string_view data) {
+    return recorder.Send(data);
+  });
+  ASSERT_EQ(coalescer.Append("x"), retcode::SUCCESS);
+  ASSERT_EQ(coalescer.Append("y"), retcode::SUCCESS);
+  for (int i = 0; i < 100 && recorder.WireCount() == 0; i++) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  EXPECT_EQ(recorder.Messages(), std::vector<std::string>({"x", "y"}));
+}
+
+TEST(MessageCoalescerTest, malformed_batch_fails_decode) {
+  common::CoalesceConfig coalesce_cfg;
+  coalesce_cfg.enable = true;
+  coalesce_cfg.flush_window_us = 1000 * 1000;
+  std::string wire_message;
+  MessageCoalescer coalescer(coalesce_cfg, [&](std::string_view data) {
+    wire_message = std::string(data);
+    return retcode::SUCCESS;
+  });
+  ASSERT_EQ(coalescer.Append("abc"), retcode::SUCCESS);
+  ASSERT_EQ(coalescer.Append("de"), retcode::SUCCESS);
+  ASSERT_EQ(coalescer.Flush(), retcode::SUCCESS);
+  ASSERT_TRUE(MessageCoalescer::IsBatch(wire_message));
+  std::vector<std::string> messages;
+  // last message is cut short
+  EXPECT_EQ(MessageCoalescer::Decode(
+                wire_message.substr(0, wire_message.size() - 1), &messages),
+            retcode::FAIL);
+  // length prefix of last message is cut short
+  EXPECT_EQ(MessageCoalescer::Decode(
+                wire_message.substr(0, wire_message.size() - 4), &messages),
+            retcode::FAIL);
+  // trailing bytes beyond the message count
+  EXPECT_EQ(MessageCoalescer::Decode(wire_message + "x", &messages),
+            retcode::FAIL);
+  EXPECT_TRUE(messages.empty());
+  EXPECT_EQ(MessageCoalescer::Decode(std::move(wire_message), &messages),
+            retcode::SUCCESS);
+  EXPECT_EQ(messages, std::vector<std::string>({"abc", "de"}));
+}
+}  // namespace primihub::network
@@ -0,0 +1,71 @@
+// Copyright [2023] <primihub.com>
+#include <unistd.h>
+#include <chrono>
+#include <future>
+#include <memory>
+#include <string>
+#include <thread>
+
+#include "gtest/gtest.h"
+#include "src/primihub/util/network/link_context.h"
+#include "src/primihub/util/network/shm_link.h"
+
+namespace primihub::network {
+namespace {
+class TestLinkContext : public LinkContext {
+ public:
+  std::shared_ptr<IChannel> getChannel(const primihub::Node& node) override {
+    return nullptr;
+  }
+};
+}  // namespace
+
+TEST(ShmLinkTest, task_pulls_buffered_data_by_shared_memory) {
+  std::string name = "/primihub_test_" + std::to_string(getpid());
+  TestLinkContext daemon_link_ctx;
+  // ring smaller than payload, payload is streamed
+  auto server = ShmLinkServer::Create(name, 4096, &daemon_link_ctx);
+  ASSERT_NE(server, nullptr);
+  auto client = ShmLinkClient::Connect(name);
+  ASSERT_NE(client, nullptr);
+
+  TestLinkContext task_link_ctx;
+  Node local_node("node0", "127.0.0.1", 50050, false);
+  task_link_ctx.AttachLocalLink(client, local_node);
+  EXPECT_TRUE(task_link_ctx.UseLocalLink(local_node));
+  EXPECT_FALSE(task_link_ctx.UseLocalLink(
+      Node("node1", "127.0.0.1", 50051, false)));
+
+  std::string small_data("small");
+  std::string large_data(100 * 1024, 'x');
+  ASSERT_EQ(daemon_link_ctx.PushRecvData("key0", std::string(small_data)),
+            retcode::SUCCESS);
+  std::string recv_data;
+  ASSERT_EQ(task_link_ctx.RecvByLocalLink("key0", &recv_data),
+            retcode::SUCCESS);
+  EXPECT_EQ(recv_data, small_data);
+  // request is parked until data arrives
+  auto fut = std::async(std::launch::async, [&]() {
+    std::string data;
+    auto ret = task_link_ctx.RecvByLocalLink("key1", &data);
+    return ret == retcode::SUCCESS ? data : std::string();
+  });
+  ASSERT_EQ(daemon_link_ctx.PushRecvData("key1", std::string(large_data)),
+            retcode::SUCCESS);
+  EXPECT_EQ(fut.get(), large_data);
+  // timed out request is cancelled and leaves data in daemon
+  EXPECT_EQ(client->Recv("key3", &recv_data, 20), retcode::FAIL);
+  ASSERT_EQ(daemon_link_ctx.PushRecvData("key3", std::string(small_data)),
+            retcode::SUCCESS);
+  ASSERT_EQ(client->Recv("key3", &recv_data, 1000), retcode::SUCCESS);
+  EXPECT_EQ(recv_data, small_data);
+  // pending request fails once daemon side stops
+  auto pending = std::async(std::launch::async, [&]() {
+    std::string data;
+    return task_link_ctx.RecvByLocalLink("key2", &data);
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  server->Stop();
+  EXPECT_EQ(pending.get(), retcode::FAIL);
+}
+}  // namespace primihub::network
@@ -0,0 +1,282 @@
+// Copyright [2023] <primihub.com>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "src/primihub/util/network/socket_frame.h"
+#include "src/primihub/util/network/socket_link_context.h"
+#include "src/primihub/util/network/socket_link_server.h"
+#include "src/primihub/util/threadsafe_queue.h"
+
+namespace primihub::network {
+namespace {
+int ConnectLoopback(uint16_t port) {
+  int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+  struct sockaddr_in addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(port);
+  inet_pton(AF_INET, "127.0.0.1", &addr.sin_addr);
+  if (::connect(fd, reinterpret_cast<struct sockaddr*>(&addr),
+                sizeof(addr)) < 0) {
+    ::close(fd);
+    return -1;
+  }
+  int opt = 1;
+  setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &opt, sizeof(opt));
+  return fd;
+}
+
+/**
+ * loopback peer simulating node: DATA is pushed to per-key queue,
+ * RECV pops from the same queue, ack of held key is delayed until released
+*/
+class LoopbackPeer {
+ public:
+  LoopbackPeer() : server_(
+      [this](const std::string& meta, const std::string& key,
+             std::string&& data, uint8_t /*compress_type*/,
+             SocketLinkServer::AckCallback ack) {
+        meta_ = meta;
+        GetQueue(key).push(std::move(data));
+        std::lock_guard<std::mutex> lck(mtx_);
+        if (key == held_key_) {
+          held_acks_.push_back(std::move(ack));
+          return;
+        }
+        ack(retcode::SUCCESS);
+      },
+      [this](const std::string& /*meta*/, const std::string& key,
+             SocketLinkServer::RecvCallback done) {
+        auto& queue = GetQueue(key);
+        auto pop_id = queue.async_pop([done](bool ok, std::string&& data) {
+          done(ok ? retcode::SUCCESS : retcode::FAIL, std::move(data));
+        });
+        return [this, &queue, pop_id]() {
+          bool cancelled = queue.cancel_async_pop(pop_id);
+          if (cancelled) {
+            cancelled_.fetch_add(1);
+          }
+          return cancelled;
+        };
+      }) {}
+  retcode Start() {return server_.Start("127.0.0.1", 0);}
+  void Stop() {server_.Stop();}
+  uint16_t Port() {return server_.Port();}
+  std::string meta() {return meta_;}
+  size_t cancelled() {return cancelled_.load();}
+  ThreadSafeQueue<std::string>& GetQueue(const std::string& key) {
+    std::lock_guard<std::mutex> lck(mtx_);
+    return queues_[key];
+  }
+  void HoldAck(const std::string& key) {
+    std::lock_guard<std::mutex> lck(mtx_);
+    held_key_ = key;
+  }
+  void ReleaseAcks() {
+    std::vector<SocketLinkServer::AckCallback> acks;
+    {
+      std::lock_guard<std::mutex> lck(mtx_);
+      held_key_.clear();
+      acks.swap(held_acks_);
+    }
+    for (auto& ack : acks) {
+      ack(retcode::SUCCESS);
+    }
+  }
+
+ private:
+  std::mutex mtx_;
+  std::string held_key_;
+  std::vector<SocketLinkServer::AckCallback> held_acks_;
+  std::map<std::string, ThreadSafeQueue<std::string>> queues_;
+  std::string meta_;
+  std::atomic<size_t> cancelled_{0};
+  SocketLinkServer server_;
+};
+}  // namespace
+
+TEST(SocketFrameTest, decoder_handles_split_and_merged_frames) {
+  // encode two frames into one buffer
+  std::string wire;
+  for (uint64_t seq_no : {1, 2}) {
+    std::string key = "key_" + std::to_string(seq_no);
+    std::string data(1000 * seq_no, 'a' + seq_no);
+    char header[SocketFrame::kHeaderSize];
+    EncodeSocketFrameHeader(SocketFrame::DATA, retcode::SUCCESS, seq_no,
+                            key.size(), 4, data.size(), header);
+    wire.append(header, SocketFrame::kHeaderSize);
+    wire.append(key).append("meta").append(data);
+  }
+  // feed byte by byte
+  SocketFrameDecoder decoder;
+  for (char ch : wire) {
+    ASSERT_EQ(decoder.Feed(&ch, 1), retcode::SUCCESS);
+  }
+  SocketFrame frame;
+  for (uint64_t seq_no : {1, 2}) {
+    ASSERT_TRUE(decoder.Next(&frame));
+    EXPECT_EQ(frame.seq_no, seq_no);
+    EXPECT_EQ(frame.key, "key_" + std::to_string(seq_no));
+    EXPECT_EQ(frame.meta, "meta");
+    EXPECT_EQ(frame.data, std::string(1000 * seq_no, 'a' + seq_no));
+  }
+  EXPECT_FALSE(decoder.Next(&frame));
+  // corrupted magic
+  SocketFrameDecoder bad_decoder;
+  std::string garbage(SocketFrame::kHeaderSize, 'x');
+  EXPECT_EQ(bad_decoder.Feed(garbage.data(), garbage.size()), retcode::FAIL);
+}
+
+TEST(SocketFrameTest, reject_oversized_header_length) {
+  char header[SocketFrame::kHeaderSize];
+  SocketFrame frame;
+  uint64_t key_len{0};
+  uint64_t meta_len{0};
+  uint64_t data_len{0};
+  EncodeSocketFrameHeader(SocketFrame::DATA, retcode::SUCCESS, 1,
+                          SocketFrame::kMaxKeySize + 1, 0, 0, header);
+  EXPECT_EQ(DecodeSocketFrameHeader(header, &frame, &key_len, &meta_len,
+                                    &data_len), retcode::FAIL);
+  EncodeSocketFrameHeader(SocketFrame::DATA, retcode::SUCCESS, 1,
+                          0, UINT32_MAX, 0, header);
+  EXPECT_EQ(DecodeSocketFrameHeader(header, &frame, &key_len, &meta_len,
+                                    &data_len), retcode::FAIL);
+  EncodeSocketFrameHeader(SocketFrame::DATA, retcode::SUCCESS, 1,
+                          SocketFrame::kMaxKeySize, SocketFrame::kMaxMetaSize,
+                          0, header);
+  EXPECT_EQ(DecodeSocketFrameHeader(header, &frame, &key_len, &meta_len,
+                                    &data_len), retcode::SUCCESS);
+}
+
+TEST(SocketLinkServerTest, loopback_send_ack_and_recv) {
+  LoopbackPeer peer;
+  ASSERT_EQ(peer.Start(), retcode::SUCCESS);
+  int fd = ConnectLoopback(peer.Port());
+  ASSERT_GE(fd, 0);
+  // DATA for different keys, task meta only in first frame
+  std::vector<std::string> keys{"key_a", "key_b", "key_a"};
+  for (size_t i = 0; i < keys.size(); i++) {
+    std::string meta = i == 0 ? "task_meta" : "";
+    std::string data = keys[i] + "_" + std::to_string(i);
+    ASSERT_EQ(WriteSocketFrame(fd, SocketFrame::DATA, retcode::SUCCESS, i,
+                               keys[i], meta, data), retcode::SUCCESS);
+    SocketFrame ack;
+    ASSERT_EQ(ReadSocketFrame(fd, &ack), retcode::SUCCESS);
+    EXPECT_EQ(ack.type, SocketFrame::ACK);
+    EXPECT_EQ(ack.seq_no, i);
+    EXPECT_EQ(ack.ret_code, retcode::SUCCESS);
+  }
+  EXPECT_EQ(peer.meta(), "task_meta");
+  // RECV is demultiplexed by key and keeps order within key
+  for (const auto& expected : {"key_a_0", "key_a_2"}) {
+    ASSERT_EQ(WriteSocketFrame(fd, SocketFrame::RECV, retcode::SUCCESS, 100,
+                               "key_a", "", ""), retcode::SUCCESS);
+    SocketFrame response;
+    ASSERT_EQ(ReadSocketFrame(fd, &response), retcode::SUCCESS);
+    EXPECT_EQ(response.type, SocketFrame::DATA);
+    EXPECT_EQ(response.data, expected);
+  }
+  ::close(fd);
+}
+
+TEST(SocketLinkServerTest, parked_recv_is_cancelled_on_close) {
+  LoopbackPeer peer;
+  ASSERT_EQ(peer.Start(), retcode::SUCCESS);
+  int fd = ConnectLoopback(peer.Port());
+  ASSERT_GE(fd, 0);
+  ASSERT_EQ(WriteSocketFrame(fd, SocketFrame::RECV, retcode::SUCCESS, 1,
+                             "key", "task_meta", ""), retcode::SUCCESS);
+  ::close(fd);
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+  while (peer.cancelled() == 0 &&
+         std::chrono::steady_clock::now() < deadline) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+  }
+  ASSERT_EQ(peer.cancelled(), 1);
+  // payload pushed later is kept for a live receiver
+  peer.GetQueue("key").push("data");
+  std::string data;
+  EXPECT_TRUE(peer.GetQueue("key").try_pop(data));
+  EXPECT_EQ(data, "data");
+}
+
+TEST(SocketLinkServerTest, held_ack_does_not_block_other_keys) {
+  LoopbackPeer peer;
+  ASSERT_EQ(peer.Start(), retcode::SUCCESS);
+  int fd = ConnectLoopback(peer.Port());
+  ASSERT_GE(fd, 0);
+  peer.HoldAck("slow");
+  ASSERT_EQ(WriteSocketFrame(fd, SocketFrame::DATA, retcode::SUCCESS, 1,
+                             "slow", "task_meta", "slow_data"),
+            retcode::SUCCESS);
+  ASSERT_EQ(WriteSocketFrame(fd, SocketFrame::DATA, retcode::SUCCESS, 2,
+                             "fast", "", "fast_data"), retcode::SUCCESS);
+  // frame of other key is buffered and acked while slow key is held back
+  SocketFrame ack;
+  ASSERT_EQ(ReadSocketFrame(fd, &ack), retcode::SUCCESS);
+  EXPECT_EQ(ack.type, SocketFrame::ACK);
+  EXPECT_EQ(ack.seq_no, 2);
+  std::string data;
+  EXPECT_TRUE(peer.GetQueue("fast").try_pop(data));
+  EXPECT_EQ(data, "fast_data");
+  EXPECT_TRUE(peer.GetQueue("slow").try_pop(data));
+  EXPECT_EQ(data, "slow_data");
+  peer.ReleaseAcks();
+  ASSERT_EQ(ReadSocketFrame(fd, &ack), retcode::SUCCESS);
+  EXPECT_EQ(ack.type, SocketFrame::ACK);
+  EXPECT_EQ(ack.seq_no, 1);
+  ::close(fd);
+}
+
+TEST(SocketChannelTest, round_trip_and_fail_after_peer_close) {
+  LoopbackPeer peer;
+  ASSERT_EQ(peer.Start(), retcode::SUCCESS);
+  SocketLinkContext link_ctx;
+  link_ctx.setSendTimeout(5000);
+  primihub::Node node("127.0.0.1", peer.Port(), false);
+  auto channel = std::make_shared<SocketChannel>(node, &link_ctx, 0);
+  ASSERT_EQ(channel->send("key", std::string("hello")), retcode::SUCCESS);
+  std::string data;
+  EXPECT_TRUE(peer.GetQueue("key").try_pop(data));
+  EXPECT_EQ(data, "hello");
+  peer.GetQueue("key").push("world");
+  EXPECT_EQ(channel->forwardRecv("key"), "world");
+  // pending recv is failed once peer goes away instead of waiting timeout
+  auto fut = std::async(std::launch::async, [&]() {
+    return channel->forwardRecv("empty_key");
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  auto start = std::chrono::steady_clock::now();
+  peer.Stop();
+  EXPECT_EQ(fut.get(), "");
+  EXPECT_LT(std::chrono::steady_clock::now() - start,
+            std::chrono::seconds(5));
+  EXPECT_EQ(channel->send("key", std::string("hello")), retcode::FAIL);
+}
+
+TEST(SocketLinkContextTest, tls_node_falls_back_to_grpc_stream) {
+  SocketLinkContext link_ctx;
+  primihub::Node plain_node("127.0.0.1", 50050, false);
+  auto channel = link_ctx.buildChannel(plain_node, &link_ctx);
+  EXPECT_NE(std::dynamic_pointer_cast<SocketChannel>(channel), nullptr);
+  // raw socket is plaintext only, never used for tls peer
+  primihub::Node tls_node("127.0.0.1", 50050, true);
+  channel = link_ctx.buildChannel(tls_node, &link_ctx);
+  EXPECT_EQ(std::dynamic_pointer_cast<SocketChannel>(channel), nullptr);
+  EXPECT_NE(std::dynamic_pointer_cast<GrpcStreamChannel>(channel), nullptr);
+}
+}  // namespace primihub::network
@@ -0,0 +1,89 @@
+// Copyright [2023] <primihub.com>
+#include <grpcpp/impl/codegen/proto_utils.h>
+
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "src/primihub/util/network/task_request_codec.h"
+
+namespace primihub::network {
+namespace {
+rpc::TaskContext MockTaskInfo() {
+  rpc::TaskContext task_info;
+  task_info.set_job_id("job_id");
+  task_info.set_task_id("task_id");
+  task_info.set_request_id("request_id");
+  return task_info;
+}
+}  // namespace
+
+TEST(TaskRequestCodecTest, chunks_round_trip) {
+  auto task_info = MockTaskInfo();
+  std::string data(LIMITED_PACKAGE_SIZE * 2 + 100, 'x');
+  for (size_t i = 0; i < data.size(); i++) {
+    data[i] = static_cast<char>(i % 251);
+  }
+  std::vector<grpc::ByteBuffer> chunks;
+  ASSERT_EQ(BuildTaskRequestChunks(task_info, "key", data, &chunks),
+            retcode::SUCCESS);
+  ASSERT_EQ(chunks.size(), 3);
+  TaskRequestAssembler assembler;
+  for (auto& chunk : chunks) {
+    ASSERT_EQ(assembler.Feed(&chunk), retcode::SUCCESS);
+  }
+  EXPECT_TRUE(assembler.IsComplete());
+  EXPECT_EQ(assembler.key(), "key");
+  EXPECT_EQ(assembler.task_info().request_id(), "request_id");
+  EXPECT_EQ(assembler.data(), data);
+}
+
+TEST(TaskRequestCodecTest, compatible_with_protobuf) {
+  auto task_info = MockTaskInfo();
+  std::string data(LIMITED_PACKAGE_SIZE + 1, 'y');
+  std::vector<grpc::ByteBuffer> chunks;
+  BuildTaskRequestChunks(task_info, "key", data, &chunks);
+  ASSERT_EQ(chunks.size(), 2);
+  // chunks are decoded by protobuf, header is only in the first chunk
+  rpc::TaskRequest first;
+  rpc::TaskRequest second;
+  auto status = grpc::SerializationTraits<rpc::TaskRequest>::Deserialize(
+      &chunks[0], &first);
+  ASSERT_TRUE(status.ok());
+  status = grpc::SerializationTraits<rpc::TaskRequest>::Deserialize(
+      &chunks[1], &second);
+  ASSERT_TRUE(status.ok());
+  EXPECT_EQ(first.role(), "key");
+  EXPECT_EQ(first.data_len(), data.size());
+  EXPECT_EQ(first.data().size(), LIMITED_PACKAGE_SIZE);
+  EXPECT_FALSE(second.has_task_info());
+  EXPECT_EQ(second.data(), "y");
+  // protobuf encoded chunks with repeated header are accepted
+  TaskRequestAssembler assembler;
+  for (size_t i = 0; i < 2; i++) {
+    rpc::TaskRequest request;
+    request.mutable_task_info()->CopyFrom(task_info);
+    request.set_role("key");
+    request.set_data_len(4);
+    request.set_data(i == 0 ? "ab" : "cd");
+    grpc::ByteBuffer buffer;
+    bool own_buffer{false};
+    grpc::SerializationTraits<rpc::TaskRequest>::Serialize(
+        request, &buffer, &own_buffer);
+    ASSERT_EQ(assembler.Feed(&buffer), retcode::SUCCESS);
+  }
+  EXPECT_TRUE(assembler.IsComplete());
+  EXPECT_EQ(assembler.data(), "abcd");
+}
+
+TEST(TaskRequestCodecTest, empty_data) {
+  std::vector<grpc::ByteBuffer> chunks;
+  BuildTaskRequestChunks(MockTaskInfo(), "key", "", &chunks);
+  ASSERT_EQ(chunks.size(), 1);
+  TaskRequestAssembler assembler;
+  ASSERT_EQ(assembler.Feed(&chunks[0]), retcode::SUCCESS);
+  EXPECT_TRUE(assembler.IsComplete());
+  EXPECT_EQ(assembler.key(), "key");
+  EXPECT_TRUE(assembler.data().empty());
+}
+}  // namespace primihub::network
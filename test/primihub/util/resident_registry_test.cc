@@ -0,0 +1,130 @@
+// Copyright [2023] <primihub.com>
+#include <atomic>
+#include <future>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "src/primihub/util/resident_registry.h"
+
+namespace primihub {
+namespace {
+using Registry = ResidentRegistry<std::string>;
+}  // namespace
+
+TEST(ResidentRegistryTest, load_once_and_stay_resident) {
+  std::atomic<int> load_count{0};
+  Registry registry([&](const std::string& key) {
+    load_count++;
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    return std::make_shared<std::string>("db_" + key);
+  });
+  std::vector<std::future<bool>> futs;
+  for (int i = 0; i < 8; i++) {
+    futs.push_back(std::async(std::launch::async, [&]() {
+      auto session = registry.Acquire("a", 100);
+      return session != nullptr && *session->object() == "db_a";
+    }));
+  }
+  for (auto& fut : futs) {
+    EXPECT_TRUE(fut.get());
+  }
+  EXPECT_EQ(load_count, 1);
+  auto session = registry.Acquire("a", 100);
+  ASSERT_NE(session, nullptr);
+  EXPECT_EQ(load_count, 1);
+  auto stats = registry.stats();
+  EXPECT_EQ(stats.resident_count, 1);
+  EXPECT_EQ(stats.memory_bytes, 100);
+  EXPECT_EQ(stats.loads, 1);
+  EXPECT_EQ(stats.hits, 8);
+}
+
+TEST(ResidentRegistryTest, admission_limit) {
+  Registry registry([](const std::string& key) {
+    return std::make_shared<std::string>(key);
+  });
+  Registry::Options options;
+  options.max_sessions = 2;
+  options.admission_timeout_ms = 50;
+  registry.Configure(options);
+  auto s1 = registry.Acquire("a", 1);
+  auto s2 = registry.Acquire("a", 1);
+  ASSERT_NE(s1, nullptr);
+  ASSERT_NE(s2, nullptr);
+  // other db is not limited by sessions of "a"
+  EXPECT_NE(registry.Acquire("b", 1), nullptr);
+  EXPECT_EQ(registry.Acquire("a", 1), nullptr);
+  EXPECT_EQ(registry.stats().rejected, 1);
+
+  auto waiter = std::async(std::launch::async, [&]() {
+    return registry.Acquire("a", 1) != nullptr;
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  s1.reset();
+  EXPECT_TRUE(waiter.get());
+}
+
+TEST(ResidentRegistryTest, memory_budget_evicts_idle) {
+  std::atomic<int> load_count{0};
+  Registry registry([&](const std::string& key) {
+    load_count++;
+    return std::make_shared<std::string>(key);
+  });
+  Registry::Options options;
+  options.max_memory_bytes = 100;
+  registry.Configure(options);
+  EXPECT_TRUE(registry.Preload("a", 60));
+  {
+    auto s_b = registry.Acquire("b", 60);
+    ASSERT_NE(s_b, nullptr);
+    // "a" is idle and evicted for "b"
+    auto stats = registry.stats();
+    EXPECT_EQ(stats.evictions, 1);
+    EXPECT_EQ(stats.memory_bytes, 60);
+    // "b" is busy, "c" is served but not kept
+    auto s_c = registry.Acquire("c", 60);
+    ASSERT_NE(s_c, nullptr);
+    EXPECT_EQ(registry.stats().memory_bytes, 120);
+  }
+  auto stats = registry.stats();
+  EXPECT_EQ(stats.resident_count, 1);
+  EXPECT_EQ(stats.memory_bytes, 60);
+  EXPECT_NE(registry.Acquire("b", 60), nullptr);
+  EXPECT_EQ(load_count, 3);
+}
+
+TEST(ResidentRegistryTest, failed_load_is_not_kept) {
+  int load_count{0};
+  Registry registry([&](const std::string& key) {
+    load_count++;
+    return load_count == 1 ? nullptr : std::make_shared<std::string>(key);
+  });
+  EXPECT_EQ(registry.Acquire("a", 10), nullptr);
+  EXPECT_EQ(registry.stats().memory_bytes, 0);
+  EXPECT_NE(registry.Acquire("a", 10), nullptr);
+  EXPECT_EQ(load_count, 2);
+}
+
+TEST(ResidentRegistryTest, drop_stale_object) {
+  int load_count{0};
+  Registry registry([&](const std::string& key) {
+    load_count++;
+    return std::make_shared<std::string>(key);
+  });
+  EXPECT_TRUE(registry.Preload("a", 10));
+  registry.Drop("a");
+  EXPECT_EQ(registry.stats().memory_bytes, 0);
+  EXPECT_EQ(registry.stats().resident_count, 0);
+  // object in use is served until its session ends
+  auto session = registry.Acquire("a", 10);
+  ASSERT_NE(session, nullptr);
+  registry.Drop("a");
+  EXPECT_EQ(*session->object(), "a");
+  session.reset();
+  EXPECT_EQ(registry.stats().memory_bytes, 0);
+  EXPECT_EQ(load_count, 2);
+}
+}  // namespace primihub
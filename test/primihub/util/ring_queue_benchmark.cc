@@ -0,0 +1,91 @@
+// Copyright [2023] <primihub.com>
+// push/pop throughput of ring queues versus the mutex based queue.
+// usage: ring_queue_benchmark [items per producer]
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "src/primihub/util/ring_queue.h"
+#include "src/primihub/util/threadsafe_queue.h"
+
+namespace {
+constexpr int kProducerCount = 4;
+
+/**
+ * return ns per item, negative if any item is lost
+*/
+template <typename Push, typename Pop>
+double RunThroughput(int producer_count, int items_per_producer,
+                     Push push, Pop pop) {
+  auto start = std::chrono::steady_clock::now();
+  std::vector<std::thread> producers;
+  for (int p = 0; p < producer_count; p++) {
+    producers.emplace_back([&, p]() {
+      for (int i = 0; i < items_per_producer; i++) {
+        push(p * items_per_producer + i);
+      }
+    });
+  }
+  auto total = static_cast<int64_t>(producer_count) * items_per_producer;
+  int64_t sum{0};
+  for (int64_t i = 0; i < total; i++) {
+    sum += pop();
+  }
+  for (auto& producer : producers) {
+    producer.join();
+  }
+  std::chrono::duration<double, std::nano> cost =
+      std::chrono::steady_clock::now() - start;
+  if (sum != total * (total - 1) / 2) {
+    return -1;
+  }
+  return cost.count() / total;
+}
+}  // namespace
+
+int main(int argc, char** argv) {
+  using primihub::MpmcRingQueue;
+  using primihub::SpscRingQueue;
+  using primihub::ThreadSafeQueue;
+  int items_per_producer = 200000;
+  if (argc > 1) {
+    items_per_producer = std::atoi(argv[1]);
+  }
+  if (items_per_producer <= 0) {
+    std::cerr << "usage: " << argv[0] << " [items per producer]" << std::endl;
+    return 1;
+  }
+  std::cout << "producers,queue,ns_per_item" << std::endl;
+  for (int producer_count : {1, kProducerCount}) {
+    std::vector<std::pair<const char*, double>> results;
+    ThreadSafeQueue<int> locked_queue;
+    results.emplace_back("ThreadSafeQueue", RunThroughput(
+        producer_count, items_per_producer,
+        [&](int v) {locked_queue.push(v);},
+        [&]() {return locked_queue.pop();}));
+    MpmcRingQueue<int> mpmc_queue(4096);
+    results.emplace_back("MpmcRingQueue", RunThroughput(
+        producer_count, items_per_producer,
+        [&](int v) {mpmc_queue.push(v);},
+        [&]() {int v{0}; mpmc_queue.pop(&v); return v;}));
+    if (producer_count == 1) {
+      SpscRingQueue<int> spsc_queue(4096);
+      results.emplace_back("SpscRingQueue", RunThroughput(
+          1, items_per_producer,
+          [&](int v) {spsc_queue.push(v);},
+          [&]() {int v{0}; spsc_queue.pop(&v); return v;}));
+    }
+    for (const auto& [name, ns_per_item] : results) {
+      if (ns_per_item < 0) {
+        std::cerr << name << " lost items" << std::endl;
+        return 1;
+      }
+      std::cout << producer_count << "," << name << "," << ns_per_item
+                << std::endl;
+    }
+  }
+  return 0;
+}
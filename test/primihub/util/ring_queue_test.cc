@@ -0,0 +1,80 @@
+// Copyright [2023] <primihub.com>
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "src/primihub/util/ring_queue.h"
+
+namespace primihub {
+TEST(RingQueueTest, batch_wait_and_shutdown) {
+  SpscRingQueue<std::string> queue(4);
+  ASSERT_EQ(queue.capacity(), 4);
+  std::vector<std::string> items{"a", "b", "c", "d", "e", "f"};
+  size_t pushed{0};
+  EXPECT_EQ(queue.push_batch(&items, 10, nullptr, &pushed),
+            QueueStatus::kTimeout);
+  EXPECT_EQ(pushed, 4);
+  std::vector<std::string> popped;
+  EXPECT_EQ(queue.pop_batch(&popped, 3), QueueStatus::kOk);
+  EXPECT_EQ(popped, std::vector<std::string>({"a", "b", "c"}));
+
+  // cancelled waiter is woken up by interrupt
+  std::string item;
+  ASSERT_EQ(queue.pop(&item), QueueStatus::kOk);
+  EXPECT_EQ(item, "d");
+  std::atomic<bool> cancel{false};
+  auto fut = std::async(std::launch::async, [&]() {
+    std::string data;
+    return queue.pop(&data, -1, &cancel);
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  cancel.store(true);
+  queue.interrupt();
+  EXPECT_EQ(fut.get(), QueueStatus::kCancelled);
+
+  // shutdown wakes up every waiter, remaining items are drained
+  MpmcRingQueue<std::string> mpmc_queue(2);
+  std::vector<std::future<QueueStatus>> waiters;
+  for (int i = 0; i < 4; i++) {
+    waiters.push_back(std::async(std::launch::async, [&]() {
+      std::string data;
+      return mpmc_queue.pop(&data);
+    }));
+  }
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  mpmc_queue.shutdown();
+  for (auto& waiter : waiters) {
+    EXPECT_EQ(waiter.get(), QueueStatus::kClosed);
+  }
+  EXPECT_EQ(mpmc_queue.push("x"), QueueStatus::kClosed);
+}
+
+TEST(RingQueueTest, concurrent_producers_deliver_every_item) {
+  constexpr int kProducerCount = 4;
+  constexpr int kItemsPerProducer = 20000;
+  MpmcRingQueue<int> queue(64);
+  std::vector<std::thread> producers;
+  for (int p = 0; p < kProducerCount; p++) {
+    producers.emplace_back([&, p]() {
+      for (int i = 0; i < kItemsPerProducer; i++) {
+        queue.push(p * kItemsPerProducer + i);
+      }
+    });
+  }
+  int64_t total = kProducerCount * kItemsPerProducer;
+  int64_t sum{0};
+  for (int64_t i = 0; i < total; i++) {
+    int item{0};
+    ASSERT_EQ(queue.pop(&item), QueueStatus::kOk);
+    sum += item;
+  }
+  for (auto& producer : producers) {
+    producer.join();
+  }
+  EXPECT_EQ(sum, total * (total - 1) / 2);
+}
+}  // namespace primihub
@@ -0,0 +1,109 @@
+// Copyright [2023] <primihub.com>
+#include <chrono>
+#include <future>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "src/primihub/util/threadsafe_queue.h"
+
+namespace primihub {
+TEST(ThreadSafeQueueTest, async_pop_is_parked_until_push) {
+  ThreadSafeQueue<std::string> queue;
+  std::vector<std::string> popped;
+  auto on_pop = [&](bool ok, std::string&& item) {
+    EXPECT_TRUE(ok);
+    popped.push_back(std::move(item));
+  };
+  // available item is popped in place
+  queue.push("first");
+  queue.async_pop(on_pop);
+  ASSERT_EQ(popped.size(), 1);
+  // parked callbacks are served in order by pusher
+  queue.async_pop(on_pop);
+  queue.async_pop(on_pop);
+  EXPECT_EQ(popped.size(), 1);
+  std::thread pusher([&]() {
+    queue.push("second");
+    queue.push("third");
+  });
+  pusher.join();
+  EXPECT_EQ(popped, std::vector<std::string>({"first", "second", "third"}));
+  EXPECT_TRUE(queue.empty());
+}
+
+TEST(ThreadSafeQueueTest, cancel_and_shutdown_async_pop) {
+  ThreadSafeQueue<std::string> queue;
+  size_t invoked{0};
+  size_t failed{0};
+  auto on_pop = [&](bool ok, std::string&& /*item*/) {
+    invoked++;
+    if (!ok) {
+      failed++;
+    }
+  };
+  auto cancelled_id = queue.async_pop(on_pop);
+  EXPECT_TRUE(queue.cancel_async_pop(cancelled_id));
+  // cancelled callback does not consume item
+  queue.push("data");
+  EXPECT_EQ(invoked, 0);
+  std::string item;
+  ASSERT_TRUE(queue.try_pop(item));
+  // fired callback can not be cancelled
+  queue.push("data");
+  auto fired_id = queue.async_pop(on_pop);
+  EXPECT_FALSE(queue.cancel_async_pop(fired_id));
+  EXPECT_EQ(invoked, 1);
+  // shutdown wakes up parked callbacks
+  queue.async_pop(on_pop);
+  queue.shutdown();
+  EXPECT_EQ(invoked, 2);
+  EXPECT_EQ(failed, 1);
+}
+
+TEST(ThreadSafeQueueTest, timed_batch_pop_and_shutdown_all_waiters) {
+  ThreadSafeQueue<std::string> queue;
+  std::string item;
+  EXPECT_FALSE(queue.wait_and_pop(item, 10));
+  queue.push("a");
+  queue.push("b");
+  queue.push("c");
+  std::vector<std::string> items;
+  EXPECT_EQ(queue.try_pop_batch(&items, 2), 2);
+  EXPECT_EQ(items, std::vector<std::string>({"a", "b"}));
+  EXPECT_TRUE(queue.wait_and_pop(item, 10));
+  EXPECT_EQ(item, "c");
+  // every blocked consumer is woken up
+  std::vector<std::future<bool>> waiters;
+  for (int i = 0; i < 3; i++) {
+    waiters.push_back(std::async(std::launch::async, [&]() {
+      std::string data;
+      return queue.wait_and_pop(data, -1);
+    }));
+  }
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  queue.shutdown();
+  for (auto& waiter : waiters) {
+    EXPECT_FALSE(waiter.get());
+  }
+}
+
+TEST(ThreadSafeQueueTest, pop_fails_if_item_rejected_by_hook) {
+  ThreadSafeQueue<std::string> queue;
+  queue.set_pop_hook([](std::string& item) {return item != "bad";});
+  std::string item;
+  queue.push("bad");
+  EXPECT_FALSE(queue.wait_and_pop(item));
+  queue.push("bad");
+  queue.async_pop([](bool ok, std::string&& /*item*/) {
+    EXPECT_FALSE(ok);
+  });
+  queue.push("good");
+  queue.push("bad");
+  queue.push("good");
+  std::vector<std::string> items;
+  EXPECT_EQ(queue.try_pop_batch(&items, 3), 2);
+  EXPECT_EQ(items, std::vector<std::string>({"good", "good"}));
+}
+}  // namespace primihub
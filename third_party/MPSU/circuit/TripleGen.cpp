@@ -2,13 +2,14 @@
 // Author: lx-1234
 
 #include "TripleGen.h"
+#include "../common/util.h"
 #include <vector>
 
 namespace mpsu {
 
 void twoPartyTripleGen(u32 myIdx, u32 idx, u32 numElements,
                        u32 numThreads, Socket &chl, std::string fileName) {
-    std::string outFileName = "./triple/" + fileName + "_"
+    std::string outFileName = dataDir() + "/triple/" + fileName + "_"
                             + std::to_string(numElements) + "_P"
                             + std::to_string(myIdx + 1)
                             + std::to_string(idx + 1);
@@ -56,23 +57,14 @@ void twoPartyTripleGen(u32 myIdx, u32 idx, u32 numElements,
 }
 
 void tripleGenParty(u32 idx, u32 numParties, u32 numElements, u32 numThreads) {
+    std::vector<Socket> chl = connectParties(idx, numParties);
+    tripleGenParty(idx, numParties, numElements, numThreads, chl);
+}
+
+void tripleGenParty(u32 idx, u32 numParties, u32 numElements, u32 numThreads,
+                    std::vector<Socket> &chl) {
     Timer timer;
     timer.setTimePoint("begin");
-    // connect
-    std::vector<Socket> chl;
-    for (u32 i = 0; i < numParties; ++i) {
-        // PORT + senderId * 100 + receiverId
-        if (i < idx) {
-            chl.emplace_back(
-                coproto::asioConnect("localhost:"
-                + std::to_string(PORT + idx * 100 + i), true));
-        } else if (i > idx) {
-            chl.emplace_back(
-                coproto::asioConnect("localhost:"
-                + std::to_string(PORT + i * 100 + idx), false));
-        }
-    }
-
     timer.setTimePoint("connect done");
 
     // generate triples
@@ -17,4 +17,8 @@ void twoPartyTripleGen(u32 myIdx, u32 idx, u32 numElements,
 
 void tripleGenParty(u32 idx, u32 numParties, u32 numElements, u32 numThreads);
 
+// run over connected channels, see MPSUParty
+void tripleGenParty(u32 idx, u32 numParties, u32 numElements, u32 numThreads,
+                    std::vector<Socket> &chl);
+
 }  // namespace mpsu
@@ -3,6 +3,7 @@
 
 
 #include "common/util.h"
+#include <coproto/Socket/AsioSocket.h>
 
 namespace mpsu {
 
@@ -35,4 +36,28 @@ void bitsetToBlock(std::bitset<128> &data, block &out) {
         std::bitset<128>(0xFFFFFFFFFFFFFFFF)).to_ullong());
 }
 
+std::vector<Socket> connectParties(u32 idx, u32 numParties) {
+    std::vector<Socket> chl;
+    for (u32 i = 0; i < numParties; ++i) {
+        if (i < idx) {
+            chl.emplace_back(coproto::asioConnect("localhost:"
+                            + std::to_string(PORT + idx * 100 + i), true));
+        } else if (i > idx) {
+            chl.emplace_back(coproto::asioConnect("localhost:"
+                            + std::to_string(PORT + i * 100 + idx), false));
+        }
+    }
+    return chl;
+}
+
+static std::string gDataDir = ".";
+
+void setDataDir(const std::string &dir) {
+    gDataDir = dir;
+}
+
+const std::string &dataDir() {
+    return gDataDir;
+}
+
 }  // namespace mpsu
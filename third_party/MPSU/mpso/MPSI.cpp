@@ -27,6 +27,15 @@ namespace mpsu {
 std::vector<block> MPSIParty(u32 idx, u32 numParties, u32 numElements,
                              std::vector<block> &set, u32 numThreads,
                              bool fakeBase, bool fakeTriples) {
+    std::vector<Socket> chl = connectParties(idx, numParties);
+    return MPSIParty(idx, numParties, numElements, set, numThreads,
+                     chl, fakeBase, fakeTriples);
+}
+
+std::vector<block> MPSIParty(u32 idx, u32 numParties, u32 numElements,
+                             std::vector<block> &set, u32 numThreads,
+                             std::vector<Socket> &chl,
+                             bool fakeBase, bool fakeTriples) {
     // shuffle receiver's set
     MShuffleParty shuffleParty(idx, numParties, numElements);
     shuffleParty.getShareCorrelation();
@@ -36,51 +45,6 @@ std::vector<block> MPSIParty(u32 idx, u32 numParties, u32 numElements,
     Timer timer;
     timer.setTimePoint("start");
 
-    // mpsi connect
-    std::vector<Socket> chl(numParties - 1);
-    // PORT + senderId * 100 + receiverId
-    if (idx == 0) {
-        for (u32 i = 0; i < numParties - 1; ++i) {
-            chl[i] = coproto::asioConnect("localhost:"
-                                         + std::to_string(PORT + i + 1), true);
-        }
-    } else if (idx == 1) {
-        // connect to party{1}
-        chl[0] = coproto::asioConnect("localhost:"
-                                    + std::to_string(PORT + idx), false);
-        if (numParties > 2) {
-            // connect to party{idx + 2}
-            chl[idx] = coproto::asioConnect(
-                "localhost:"
-                + std::to_string(PORT + idx * 100 + idx + 1),
-                true);
-        }
-    } else if (idx != numParties - 1) {
-        // connect to party{1}
-        chl[0] = coproto::asioConnect(
-            "localhost:"
-            + std::to_string(PORT + idx), false);
-        // connect to party{idx}
-        chl[idx - 1] = coproto::asioConnect(
-            "localhost:" + std::to_string(PORT + (idx - 1) * 100 + idx),
-            false);
-        // connect to party{idx + 2}
-        chl[idx] = coproto::asioConnect(
-            "localhost:" + std::to_string(PORT + idx * 100 + idx + 1),
-            true);
-    } else {
-        // connect to party{1}
-        chl[0] = coproto::asioConnect(
-            "localhost:" + std::to_string(PORT + idx),
-            false);
-        // connect to party{idx}
-        chl[idx - 1] = coproto::asioConnect(
-            "localhost:" + std::to_string(PORT + (idx - 1) * 100 + idx),
-            false);
-    }
-
-    // std::cout << "P" << idx + 1 << " connect done" << std::endl;
-
     timer.setTimePoint("connect done");
     // std::cout << "P" << idx + 1 << " connect done" << std::endl;
 
@@ -351,6 +315,15 @@ std::vector<block> MPSIParty(u32 idx, u32 numParties, u32 numElements,
 u32 MPSICAParty(u32 idx, u32 numParties, u32 numElements,
                 std::vector<block> &set, u32 numThreads,
                 bool fakeBase, bool fakeTriples) {
+    std::vector<Socket> chl = connectParties(idx, numParties);
+    return MPSICAParty(idx, numParties, numElements, set, numThreads,
+                       chl, fakeBase, fakeTriples);
+}
+
+u32 MPSICAParty(u32 idx, u32 numParties, u32 numElements,
+                std::vector<block> &set, u32 numThreads,
+                std::vector<Socket> &chl,
+                bool fakeBase, bool fakeTriples) {
     // shuffle receiver's set
     MShuffleParty shuffleParty(idx, numParties, numElements);
     shuffleParty.getShareCorrelation();
@@ -360,46 +333,6 @@ u32 MPSICAParty(u32 idx, u32 numParties, u32 numElements,
     Timer timer;
     timer.setTimePoint("start");
 
-    // mpsi connect
-    std::vector<Socket> chl(numParties - 1);
-    // PORT + senderId * 100 + receiverId
-    if (idx == 0) {
-        for (u32 i = 0; i < numParties - 1; ++i) {
-            chl[i] = coproto::asioConnect(
-                "localhost:" + std::to_string(PORT + i + 1), true);
-        }
-    } else if (idx == 1) {
-        // connect to party{1}
-        chl[0] = coproto::asioConnect(
-            "localhost:" + std::to_string(PORT + idx), false);
-        if (numParties > 2) {
-            // connect to party{idx + 2}
-            chl[idx] = coproto::asioConnect(
-                "localhost:" + std::to_string(PORT + idx * 100 + idx + 1),
-                true);
-        }
-    } else if (idx != numParties - 1) {
-        // connect to party{1}
-        chl[0] = coproto::asioConnect(
-            "localhost:" + std::to_string(PORT + idx), false);
-        // connect to party{idx}
-        chl[idx - 1] = coproto::asioConnect(
-            "localhost:" + std::to_string(PORT + (idx - 1) * 100 + idx),
-            false);
-        // connect to party{idx + 2}
-        chl[idx] = coproto::asioConnect(
-            "localhost:" + std::to_string(PORT + idx * 100 + idx + 1),
-            true);
-    } else {
-        // connect to party{1}
-        chl[0] = coproto::asioConnect(
-            "localhost:" + std::to_string(PORT + idx), false);
-        // connect to party{idx}
-        chl[idx - 1] = coproto::asioConnect(
-            "localhost:" + std::to_string(PORT + (idx - 1) * 100 + idx),
-            false);
-    }
-
     timer.setTimePoint("connect done");
     // std::cout << "P" << idx + 1 << " connect done" << std::endl;
 
@@ -24,6 +24,15 @@ namespace mpsu {
 std::vector<block> MPSUParty(u32 idx, u32 numParties, u32 numElements,
                              std::vector<block> &set, u32 numThreads,
                              bool fakeBase, bool fakeTriples) {
+    std::vector<Socket> chl = connectParties(idx, numParties);
+    return MPSUParty(idx, numParties, numElements, set, numThreads,
+                     chl, fakeBase, fakeTriples);
+}
+
+std::vector<block> MPSUParty(u32 idx, u32 numParties, u32 numElements,
+                             std::vector<block> &set, u32 numThreads,
+                             std::vector<Socket> &chl,
+                             bool fakeBase, bool fakeTriples) {
     // shuffle k - 1 difference sets
     MShuffleParty shuffleParty(idx, numParties, numElements * (numParties - 1));
     shuffleParty.getShareCorrelation();
@@ -33,21 +42,6 @@ std::vector<block> MPSUParty(u32 idx, u32 numParties, u32 numElements,
     Timer timer;
     timer.setTimePoint("start");
 
-    // connect
-    std::vector<Socket> chl;
-    for (u32 i = 0; i < numParties; ++i) {
-        // PORT + senderId * 100 + receiverId
-        if (i < idx) {
-            chl.emplace_back(coproto::asioConnect("localhost:"
-                            + std::to_string(PORT + idx * 100 + i),
-                            true));
-        } else if (i > idx) {
-            chl.emplace_back(coproto::asioConnect("localhost:"
-                            + std::to_string(PORT + i * 100 + idx),
-                            false));
-        }
-    }
-
     timer.setTimePoint("connect done");
     // std::cout << "P" << idx + 1 << " connect done" << std::endl;
 
@@ -100,7 +94,7 @@ std::vector<block> MPSUParty(u32 idx, u32 numParties, u32 numElements,
         for (u32 i = 0; i < numParties; ++i) {
             std::string triplePath = "";
             if (!fakeTriples && i != idx) {
-                triplePath = triplePath + "./triple/triple_"
+                triplePath = triplePath + dataDir() + "/triple/triple_"
                            + std::to_string(numParties) + "_"
                            + std::to_string(numElements) + "_P"
                            + std::to_string(idx + 1) + std::to_string(i + 1);
@@ -232,7 +226,7 @@ std::vector<block> MPSUParty(u32 idx, u32 numParties, u32 numElements,
         for (u32 i = 0; i < numParties - 1; ++i) {
             std::string triplePath = "";
             if (!fakeTriples) {
-                triplePath = triplePath + "./triple/triple_"
+                triplePath = triplePath + dataDir() + "/triple/triple_"
                            + std::to_string(numParties) + "_"
                            + std::to_string(numElements) + "_P"
                            + std::to_string(idx + 1) + std::to_string(i + 1);
@@ -391,6 +385,15 @@ std::vector<block> MPSUParty(u32 idx, u32 numParties, u32 numElements,
 u32 MPSUCAParty(u32 idx, u32 numParties, u32 numElements,
                 std::vector<block> &set, u32 numThreads,
                 bool fakeBase, bool fakeTriples) {
+    std::vector<Socket> chl = connectParties(idx, numParties);
+    return MPSUCAParty(idx, numParties, numElements, set, numThreads,
+                       chl, fakeBase, fakeTriples);
+}
+
+u32 MPSUCAParty(u32 idx, u32 numParties, u32 numElements,
+                std::vector<block> &set, u32 numThreads,
+                std::vector<Socket> &chl,
+                bool fakeBase, bool fakeTriples) {
     // shuffle k - 1 difference sets
     MShuffleParty shuffleParty(idx, numParties, numElements * (numParties - 1));
     shuffleParty.getShareCorrelation();
@@ -398,23 +401,6 @@ u32 MPSUCAParty(u32 idx, u32 numParties, u32 numElements,
     Timer timer;
     timer.setTimePoint("start");
 
-    // connect
-    std::vector<Socket> chl;
-    for (u32 i = 0; i < numParties; ++i) {
-        // PORT + senderId * 100 + receiverId
-        if (i < idx) {
-            chl.emplace_back(
-                coproto::asioConnect(
-                    "localhost:"
-                    + std::to_string(PORT + idx * 100 + i), true));
-        } else if (i > idx) {
-            chl.emplace_back(
-                coproto::asioConnect(
-                    "localhost:"
-                    + std::to_string(PORT + i * 100 + idx), false));
-        }
-    }
-
     timer.setTimePoint("connect done");
 
     PRNG prng(sysRandomSeed());
@@ -478,7 +464,7 @@ u32 MPSUCAParty(u32 idx, u32 numParties, u32 numElements,
         for (u32 i = 0; i < numParties; ++i) {
             std::string triplePath = "";
             if (!fakeTriples) {
-                triplePath = triplePath + "./triple/triple_"
+                triplePath = triplePath + dataDir() + "/triple/triple_"
                            + std::to_string(numParties) + "_"
                            + std::to_string(numElements)+ "_P"
                            + std::to_string(idx + 1) + std::to_string(i + 1);
@@ -595,7 +581,7 @@ u32 MPSUCAParty(u32 idx, u32 numParties, u32 numElements,
         for (u32 i = 0; i < numParties - 1; ++i) {
             std::string triplePath;
             if (!fakeTriples) {
-                triplePath = triplePath + "./triple/triple_"
+                triplePath = triplePath + dataDir() + "/triple/triple_"
                            + std::to_string(numParties) + "_"
                            + std::to_string(numElements) + "_P"
                            + std::to_string(idx + 1) + std::to_string(i + 1);
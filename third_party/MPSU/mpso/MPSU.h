@@ -15,9 +15,21 @@ std::vector<block> MPSUParty(u32 idx, u32 numParties, u32 numElements,
                              std::vector<block> &set, u32 numThreads,
                              bool fakeBase = true, bool fakeTriples = true);
 
+// run over connected channels, chl[i] is channel with party{i + 1}
+// for i < idx, and with party{i + 2} otherwise
+std::vector<block> MPSUParty(u32 idx, u32 numParties, u32 numElements,
+                             std::vector<block> &set, u32 numThreads,
+                             std::vector<Socket> &chl,
+                             bool fakeBase = true, bool fakeTriples = true);
+
 // set is 128-bit elements
 u32 MPSUCAParty(u32 idx, u32 numParties, u32 numElements,
                 std::vector<block> &set, u32 numThreads,
                 bool fakeBase = true, bool fakeTriples = true);
 
+u32 MPSUCAParty(u32 idx, u32 numParties, u32 numElements,
+                std::vector<block> &set, u32 numThreads,
+                std::vector<Socket> &chl,
+                bool fakeBase = true, bool fakeTriples = true);
+
 }  // namespace mpsu
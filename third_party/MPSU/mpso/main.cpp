@@ -133,6 +133,8 @@ int main(int agrc, char** argv) {
 
     bool help = cmd.isSet("h");
 
+    setDataDir(cmd.getOr<std::string>("dir", "."));
+
     if (help) {
         std::cout << "protocols" << std::endl;
         std::cout
@@ -166,6 +168,9 @@ int main(int agrc, char** argv) {
         std::cout << "    -genTriple:   generate boolean triples" << std::endl;
         std::cout << "    -genBase:     generate base OTs" << std::endl;
         std::cout << "    -fakeTriple:  use fake boolean triples" << std::endl;
+        std::cout
+        << "    -dir:         directory of sc/ and triple/, default ."
+        << std::endl;
         return 0;
     }
 
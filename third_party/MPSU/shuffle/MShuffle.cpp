@@ -7,7 +7,7 @@
 using namespace coproto;
 
 void MShuffleParty::getShareCorrelation(std::string fileName) {
-    std::string inFileName = "./sc/" + fileName + "_"
+    std::string inFileName = mpsu::dataDir() + "/sc/" + fileName + "_"
                            + std::to_string(mNumParties) + "_"
                            + std::to_string(mNumElements) + "_P"
                            + std::to_string(mIdx + 1);
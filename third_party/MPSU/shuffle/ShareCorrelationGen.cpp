@@ -12,7 +12,7 @@
 bool ShareCorrelation::exist(std::string fileName) {
     std::vector<std::string> inFileName(mNumParties);
     for (u32 i = 1; i <= mNumParties; i++) {
-        inFileName[i - 1] = "./sc/" + fileName + "_"
+        inFileName[i - 1] = mpsu::dataDir() + "/sc/" + fileName + "_"
                           + std::to_string(mNumParties) + "_"
                           + std::to_string(mNumElements) + "_P"
                           + std::to_string(i);
@@ -91,7 +91,7 @@ void ShareCorrelation::generate() {
 void ShareCorrelation::writeToFile(std::string fileName) {
     std::vector<std::string> outFileName(mNumParties);
     for (size_t i = 1; i <= mNumParties; i++) {
-        outFileName[i - 1] = "./sc/" + fileName + "_"
+        outFileName[i - 1] = mpsu::dataDir() + "/sc/" + fileName + "_"
                            + std::to_string(mNumParties) + "_"
                            + std::to_string(mNumElements) + "_P"
                            + std::to_string(i);